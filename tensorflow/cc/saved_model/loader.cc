@@ -17,6 +17,7 @@ limitations under the License.
 
 #include <string>
 #include <unordered_set>
+#include <vector>
 
 #include "absl/status/status.h"
 #include "absl/strings/str_cat.h"
@@ -26,12 +27,16 @@ limitations under the License.
 #include "tensorflow/cc/saved_model/metrics.h"
 #include "tensorflow/cc/saved_model/reader.h"
 #include "tensorflow/cc/saved_model/util.h"
+#include "tensorflow/core/common_runtime/device_mgr.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/function.pb.h"
 #include "tensorflow/core/framework/graph_debug_info.pb.h"
 #include "tensorflow/core/framework/node_def.pb.h"
 #include "tensorflow/core/framework/op_def.pb.h"
+#include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.pb.h"
+#include "tensorflow/core/kernels/lazy_restore_manager.h"
+#include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/io/path.h"
 #include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/monitoring/sampler.h"
@@ -45,6 +50,7 @@ limitations under the License.
 #include "tensorflow/core/protobuf/saver.pb.h"
 #include "tensorflow/core/public/session.h"
 #include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
 
 namespace tensorflow {
@@ -265,6 +271,74 @@ Status RunRestore(const RunOptions& run_options, const string& export_dir,
                  nullptr /* outputs */, &run_metadata, session);
 }
 
+// Removes the LazyRestoreManager from "resource_managers", so that later
+// restores in the session copy their tensors as usual.
+void UnregisterLazyRestoreManager(
+    const std::vector<ResourceMgr*>& resource_managers) {
+  for (ResourceMgr* resource_manager : resource_managers) {
+    const Status status =
+        resource_manager->Delete<checkpoint::LazyRestoreManager>(
+            resource_manager->default_container(),
+            std::string(checkpoint::kLazyRestoreManagerResourceName));
+    if (!status.ok()) {
+      LOG(WARNING) << "Failed to unregister the lazy restore manager: "
+                   << status;
+    }
+  }
+}
+
+// Setting TF_SAVED_MODEL_LAZY_VARIABLE_RESTORE registers a LazyRestoreManager
+// with the CPU devices of "session", so that its RestoreV2 kernels restore
+// variables by aliasing the memory-mapped checkpoint and variables are paged
+// in on first access. TF_SAVED_MODEL_LAZY_VARIABLE_PREFETCH_MB sets how many
+// megabytes of the variables to page in from a background thread once the
+// restore completes. Leaves "manager" empty if lazy restore is disabled or
+// unsupported by the session. Otherwise sets "resource_managers" to those the
+// manager was registered with.
+Status RegisterLazyRestoreManager(
+    Session* session,
+    core::RefCountPtr<checkpoint::LazyRestoreManager>* manager,
+    std::vector<ResourceMgr*>* resource_managers) {
+  bool lazy_restore;
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_SAVED_MODEL_LAZY_VARIABLE_RESTORE",
+                                        /*default_val=*/false, &lazy_restore));
+  if (!lazy_restore) return OkStatus();
+  const DeviceMgr* device_mgr;
+  const Status status = session->LocalDeviceManager(&device_mgr);
+  if (!status.ok()) {
+    LOG(WARNING) << "Restoring variables eagerly, since lazy restore is not "
+                    "supported by this session: "
+                 << status;
+    return OkStatus();
+  }
+  checkpoint::LazyRestoreManager::Options options;
+  int64_t prefetch_megabytes;
+  TF_RETURN_IF_ERROR(
+      ReadInt64FromEnvVar("TF_SAVED_MODEL_LAZY_VARIABLE_PREFETCH_MB",
+                          /*default_val=*/0, &prefetch_megabytes));
+  options.prefetch_bytes = prefetch_megabytes << 20;
+  manager->reset(new checkpoint::LazyRestoreManager(options));
+  for (Device* device : device_mgr->ListDevices()) {
+    if (device->device_type() != DEVICE_CPU) continue;
+    ResourceMgr* resource_manager = device->resource_manager();
+    // Create() takes over this reference, even if it fails.
+    (*manager)->Ref();
+    const Status create_status = resource_manager->Create(
+        resource_manager->default_container(),
+        std::string(checkpoint::kLazyRestoreManagerResourceName),
+        manager->get());
+    if (!create_status.ok()) {
+      UnregisterLazyRestoreManager(*resource_managers);
+      resource_managers->clear();
+      manager->reset();
+      return create_status;
+    }
+    resource_managers->push_back(resource_manager);
+  }
+  LOG(INFO) << "Restoring SavedModel variables lazily.";
+  return OkStatus();
+}
+
 }  // namespace
 
 SavedModelBundleInterface::~SavedModelBundleInterface() {}
@@ -447,10 +521,20 @@ Status RestoreSession(const RunOptions& run_options,
   std::vector<AssetFileDef> asset_file_defs;
   TF_RETURN_IF_ERROR(internal::GetAssetFileDefs(meta_graph, &asset_file_defs));
   if (meta_graph.has_saver_def()) {
-    TF_RETURN_IF_ERROR(RunRestore(run_options, export_dir,
-                                  meta_graph.saver_def().restore_op_name(),
-                                  meta_graph.saver_def().filename_tensor_name(),
-                                  asset_file_defs, session->get()));
+    core::RefCountPtr<checkpoint::LazyRestoreManager> lazy_restore_manager;
+    std::vector<ResourceMgr*> lazy_restore_resource_managers;
+    TF_RETURN_IF_ERROR(RegisterLazyRestoreManager(
+        session->get(), &lazy_restore_manager,
+        &lazy_restore_resource_managers));
+    const Status restore_status = RunRestore(
+        run_options, export_dir, meta_graph.saver_def().restore_op_name(),
+        meta_graph.saver_def().filename_tensor_name(), asset_file_defs,
+        session->get());
+    // The manager only serves this restore. It keeps itself alive while it
+    // prefetches and reports in the background.
+    UnregisterLazyRestoreManager(lazy_restore_resource_managers);
+    TF_RETURN_IF_ERROR(restore_status);
+    if (lazy_restore_manager) lazy_restore_manager->Start();
   }
   // Record walltime spent in restoring graph from disk, but postpone metric
   // increments until graph init finishes.
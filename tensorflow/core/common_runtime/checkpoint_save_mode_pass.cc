@@ -0,0 +1,91 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/checkpoint_save_mode_pass.h"
+
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+
+namespace {
+
+// Inputs of SaveV2 before the saved tensors: prefix, tensor names and
+// shape_and_slices.
+constexpr int kSaveFixedInputs = 3;
+
+// Returns true if the outputs of "node" may alias the buffers of its inputs.
+bool ForwardsInputs(const Node& node) {
+  return node.IsIdentity() || node.type_string() == "IdentityN" ||
+         node.IsEnter() || node.IsExit() || node.IsSwitch() ||
+         node.IsMerge() || node.IsNextIteration();
+}
+
+}  // namespace
+
+bool SavesMutableTensor(const Node& save) {
+  std::vector<const Edge*> stack;
+  for (const Edge* edge : save.in_edges()) {
+    if (!edge->IsControlEdge() && edge->dst_input() >= kSaveFixedInputs) {
+      stack.push_back(edge);
+    }
+  }
+  absl::flat_hash_set<const Node*> visited;
+  while (!stack.empty()) {
+    const Edge* edge = stack.back();
+    stack.pop_back();
+    const Node* src = edge->src();
+    // The executor dereferences reference outputs for non-reference inputs
+    // without copying them.
+    if (IsRefType(src->output_type(edge->src_output()))) return true;
+    if (!ForwardsInputs(*src) || !visited.insert(src).second) continue;
+    for (const Edge* in_edge : src->in_edges()) {
+      if (!in_edge->IsControlEdge()) stack.push_back(in_edge);
+    }
+  }
+  return false;
+}
+
+Status CheckpointSaveModePass::Run(
+    const GraphOptimizationPassOptions& options) {
+  if (options.graph == nullptr) return OkStatus();
+  bool async_save;
+  TF_RETURN_IF_ERROR(ReadBoolFromEnvVar("TF_CHECKPOINT_ASYNC_SAVE",
+                                        /*default_val=*/false, &async_save));
+  for (Node* node : options.graph->get()->op_nodes()) {
+    if (node->type_string() != "SaveV2") continue;
+    bool requested = async_save;
+    if (!requested) {
+      TryGetNodeAttr(node->attrs(), kAsyncCheckpointSaveAttr, &requested);
+    }
+    if (!requested) continue;
+    const bool granted = !SavesMutableTensor(*node);
+    if (!granted) {
+      VLOG(1) << "Saving " << node->name()
+              << " synchronously because it saves a reference variable";
+    }
+    node->AddAttr(kAsyncCheckpointSaveAttr, granted);
+  }
+  return OkStatus();
+}
+
+REGISTER_OPTIMIZATION(OptimizationPassRegistry::PRE_PLACEMENT, 40,
+                      CheckpointSaveModePass);
+
+}  // namespace tensorflow
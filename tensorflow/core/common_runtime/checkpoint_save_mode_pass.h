@@ -0,0 +1,47 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_CHECKPOINT_SAVE_MODE_PASS_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_CHECKPOINT_SAVE_MODE_PASS_H_
+
+#include "tensorflow/core/common_runtime/optimization_registry.h"
+#include "tensorflow/core/graph/graph.h"
+
+namespace tensorflow {
+
+// Attribute of SaveV2 nodes that selects asynchronous saving (see
+// kernels/async_checkpoint_saver.h).
+inline constexpr char kAsyncCheckpointSaveAttr[] = "_async_checkpoint_save";
+
+// Returns true if a tensor saved by "save", a SaveV2 node, may be updated in
+// place after the save captured it, i.e. if it comes from a reference
+// variable, directly or through ops that forward their input buffers.
+bool SavesMutableTensor(const Node& save);
+
+// Decides which SaveV2 nodes write their checkpoint asynchronously.
+//
+// Asynchronous saving is opt-in: it is requested for a node by setting
+// kAsyncCheckpointSaveAttr to true, or for all nodes with
+// TF_CHECKPOINT_ASYNC_SAVE=1. A request is only granted if the node saves no
+// mutable tensors, since the asynchronous writer relies on its inputs being
+// copy-on-write snapshots, as resource variable reads are. The pass sets the
+// attribute of the requesting nodes to the outcome, which the kernel reads.
+class CheckpointSaveModePass : public GraphOptimizationPass {
+ public:
+  Status Run(const GraphOptimizationPassOptions& options) override;
+};
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_CHECKPOINT_SAVE_MODE_PASS_H_
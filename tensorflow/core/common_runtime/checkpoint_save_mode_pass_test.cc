@@ -0,0 +1,100 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/common_runtime/checkpoint_save_mode_pass.h"
+
+#include <stdlib.h>
+
+#include <memory>
+
+#include "tensorflow/core/framework/node_def_util.h"
+#include "tensorflow/core/framework/op.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/graph/graph.h"
+#include "tensorflow/core/graph/node_builder.h"
+#include "tensorflow/core/graph/testlib.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace {
+
+Node* Save(Graph* graph, Node* tensor) {
+  Node* prefix = test::graph::Constant(graph, Tensor(tstring("ckpt")));
+  Tensor names(DT_STRING, TensorShape({1}));
+  names.flat<tstring>()(0) = "t";
+  Tensor slices(DT_STRING, TensorShape({1}));
+  Node* save;
+  TF_CHECK_OK(NodeBuilder(graph->NewName("save"), "SaveV2")
+                  .Input(prefix)
+                  .Input(test::graph::Constant(graph, names))
+                  .Input(test::graph::Constant(graph, slices))
+                  .Input(std::vector<NodeBuilder::NodeOut>{{tensor, 0}})
+                  .Finalize(graph, &save));
+  return save;
+}
+
+void RunPass(std::unique_ptr<Graph>* graph) {
+  GraphOptimizationPassOptions options;
+  options.graph = graph;
+  CheckpointSaveModePass pass;
+  TF_ASSERT_OK(pass.Run(options));
+}
+
+bool IsAsync(const Node* save) {
+  bool async_save = false;
+  TryGetNodeAttr(save->attrs(), kAsyncCheckpointSaveAttr, &async_save);
+  return async_save;
+}
+
+TEST(CheckpointSaveModePassTest, DetectsReferenceVariables) {
+  auto graph = std::make_unique<Graph>(OpRegistry::Global());
+  Node* var = test::graph::Var(graph.get(), DT_FLOAT, TensorShape({2}));
+  Node* constant = test::graph::Constant(graph.get(), Tensor(1.0f));
+  EXPECT_TRUE(SavesMutableTensor(*Save(graph.get(), var)));
+  EXPECT_TRUE(SavesMutableTensor(
+      *Save(graph.get(), test::graph::Identity(graph.get(), var))));
+  EXPECT_FALSE(SavesMutableTensor(*Save(graph.get(), constant)));
+  EXPECT_FALSE(SavesMutableTensor(
+      *Save(graph.get(), test::graph::Identity(graph.get(), constant))));
+}
+
+TEST(CheckpointSaveModePassTest, AsyncSaveIsOptIn) {
+  unsetenv("TF_CHECKPOINT_ASYNC_SAVE");
+  auto graph = std::make_unique<Graph>(OpRegistry::Global());
+  Node* constant = test::graph::Constant(graph.get(), Tensor(1.0f));
+  Node* default_save = Save(graph.get(), constant);
+  Node* requested_save = Save(graph.get(), constant);
+  requested_save->AddAttr(kAsyncCheckpointSaveAttr, true);
+  RunPass(&graph);
+  EXPECT_FALSE(IsAsync(default_save));
+  EXPECT_TRUE(IsAsync(requested_save));
+}
+
+TEST(CheckpointSaveModePassTest, SavesReferenceVariablesSynchronously) {
+  setenv("TF_CHECKPOINT_ASYNC_SAVE", "1", /*overwrite=*/1);
+  auto graph = std::make_unique<Graph>(OpRegistry::Global());
+  Node* var = test::graph::Var(graph.get(), DT_FLOAT, TensorShape({2}));
+  Node* constant = test::graph::Constant(graph.get(), Tensor(1.0f));
+  Node* var_save = Save(graph.get(), test::graph::Identity(graph.get(), var));
+  Node* constant_save = Save(graph.get(), constant);
+  RunPass(&graph);
+  EXPECT_FALSE(IsAsync(var_save));
+  EXPECT_TRUE(IsAsync(constant_save));
+  unsetenv("TF_CHECKPOINT_ASYNC_SAVE");
+}
+
+}  // namespace
+}  // namespace tensorflow
@@ -48,6 +48,7 @@ limitations under the License.
 #include "tensorflow/core/framework/logging.h"
 #include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/node_def.pb.h"
+#include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/run_handler.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/versions.pb.h"
@@ -56,6 +57,7 @@ limitations under the License.
 #include "tensorflow/core/graph/graph_partition.h"
 #include "tensorflow/core/graph/subgraph.h"
 #include "tensorflow/core/graph/tensor_id.h"
+#include "tensorflow/core/grappler/costs/op_cost_profile.h"
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/core/notification.h"
 #include "tensorflow/core/lib/core/refcount.h"
@@ -823,6 +825,21 @@ Status DirectSession::RunInternal(
             item.graph.get(), cost_graph));
       }
     }
+
+    // Record the op execution times of this step for Grappler's cost
+    // estimates. The compute costs of the cost model are the maximum over all
+    // the steps measured so far, so only its shapes are used.
+    if (run_metadata != nullptr && grappler::OpCostProfile::IsRecording()) {
+      for (const auto& item : executors_and_keys->items) {
+        CostGraphDef cost_graph;
+        TF_RETURN_IF_ERROR(cost_model_manager_.AddToCostGraphDef(
+            item.graph.get(), &cost_graph));
+        GraphDef graph_def;
+        item.graph->ToGraphDef(&graph_def);
+        grappler::OpCostProfile::Record(run_metadata->step_stats(), cost_graph,
+                                        graph_def);
+      }
+    }
   }
 
   // If requested via RunOptions, output the partition graphs.
@@ -1792,6 +1809,8 @@ Status DirectSession::CreateGraphs(
     closed_ = true;
   }
   if (factory_ != nullptr) factory_->Deregister(this);
+  // Return the scratch memory of the kernels to the allocators.
+  ReleaseScratchMemory();
   return OkStatus();
 }
 
@@ -66,6 +66,7 @@ limitations under the License.
 #include "tensorflow/core/distributed_runtime/session_mgr.h"
 #endif  // !IS_MOBILE_PLATFORM
 #include "tensorflow/core/framework/resource_mgr.h"
+#include "tensorflow/core/lib/monitoring/counter.h"
 #include "tensorflow/core/lib/monitoring/gauge.h"
 #include "tensorflow/core/platform/blocking_counter.h"
 #include "tensorflow/core/util/env_var.h"
@@ -95,10 +96,26 @@ bool ReadBoolFromEnvVar(StringPiece env_var_name, bool default_val) {
   return default_val;
 }
 
+int64_t ReadInt64FromEnvVar(StringPiece env_var_name, int64_t default_val) {
+  int64_t val;
+  if (tensorflow::ReadInt64FromEnvVar(env_var_name, default_val, &val).ok()) {
+    return val;
+  }
+  return default_val;
+}
+
 auto* eager_context_created =
     monitoring::Gauge<bool, 0>::New("/tensorflow/core/eager_context_created",
                                     "True if an eager context was created.");
 
+auto* eager_kernel_cache_lookups = monitoring::Counter<1>::New(
+    "/tensorflow/core/eager_kernel_cache_lookups",
+    "The number of eager kernel cache lookups, by result.", "result");
+
+auto* eager_kernel_cache_evictions = monitoring::Counter<0>::New(
+    "/tensorflow/core/eager_kernel_cache_evictions",
+    "The number of kernels evicted from the eager kernel cache.");
+
 }  // namespace
 
 const int64_t EagerContext::kGlobalRendezvousId = -1;
@@ -153,6 +170,8 @@ EagerContext::EagerContext(
   // provided). For builds using "tensorflow/tsl/platform/default", this is
   // currently a no-op.
   eager_context_created->GetCell()->Set(true);
+  kernel_cache_capacity_ =
+      ReadInt64FromEnvVar("TF_EAGER_KERNEL_CACHE_CAPACITY", 0);
   InitPrioritizedDeviceTypeList();
   runner_ = [this](std::function<void()> closure) {
     this->thread_pool_->Schedule(std::move(closure));
@@ -455,6 +474,7 @@ void EagerContext::ClearCachesAndDefaultExecutor() {
     mutex_lock ml(cache_mu_);
     default_executor_.WaitForAllPendingNodes().IgnoreError();
     kernel_cache_.clear();
+    kernel_cache_clock_.clear();
     for (auto& entry : registered_functions_) {
       entry.second->cached_kernel_keys->clear();
     }
@@ -1035,6 +1055,9 @@ EagerContext::GetCacheStats() {
   {
     mutex_lock l(cache_mu_);
     stats.kernel_cache_size = kernel_cache_.size();
+    stats.kernel_cache_hits = kernel_cache_hits_;
+    stats.kernel_cache_misses = kernel_cache_misses_;
+    stats.kernel_cache_evictions = kernel_cache_evictions_;
     for (const auto& iter : registered_functions_) {
       stats.func_kernel_cache_entries[iter.first] =
           iter.second->cached_kernel_keys->size();
@@ -1148,12 +1171,24 @@ Status EagerContext::SyncExecutors() {
 
 core::RefCountPtr<KernelAndDevice> EagerContext::GetCachedKernel(
     Fprint128 cache_key) {
+  // Looked up once, since GetCell() locks the metric.
+  static monitoring::CounterCell* const hit_cell =
+      eager_kernel_cache_lookups->GetCell("hit");
+  static monitoring::CounterCell* const miss_cell =
+      eager_kernel_cache_lookups->GetCell("miss");
   tf_shared_lock l(cache_mu_);
   auto iter = kernel_cache_.find(cache_key);
   if (iter == kernel_cache_.end()) {
+    ++kernel_cache_misses_;
+    miss_cell->IncrementBy(1);
     return nullptr;
   }
-  core::RefCountPtr<KernelAndDevice> new_ref(iter->second.get());
+  ++kernel_cache_hits_;
+  hit_cell->IncrementBy(1);
+  if (kernel_cache_capacity_ > 0) {
+    iter->second.referenced.store(true, std::memory_order_relaxed);
+  }
+  core::RefCountPtr<KernelAndDevice> new_ref(iter->second.kernel.get());
   new_ref->Ref();
   return new_ref;
 }
@@ -1170,7 +1205,8 @@ void EagerContext::AddKernelToCache(Fprint128 cache_key,
   mutex_lock ml(cache_mu_);
   core::RefCountPtr<KernelAndDevice> new_ref(kernel);
   new_ref->Ref();
-  kernel_cache_[cache_key] = std::move(new_ref);
+  auto [iter, inserted] = kernel_cache_.try_emplace(cache_key);
+  iter->second.kernel = std::move(new_ref);
   auto* registered_function =
       gtl::FindPtrOrNull(registered_functions_, kernel->name());
 
@@ -1180,6 +1216,67 @@ void EagerContext::AddKernelToCache(Fprint128 cache_key,
     VLOG(5) << "Cached key size of kernel " << kernel->name()
             << " is: " << registered_function->cached_kernel_keys->size();
   }
+
+  if (kernel_cache_capacity_ > 0) {
+    // Treat the new entry as recently used so that it is not the first one to
+    // be evicted.
+    iter->second.referenced.store(true, std::memory_order_relaxed);
+    if (inserted) kernel_cache_clock_.push_back(cache_key);
+    EvictKernelsLocked();
+  }
+}
+
+void EagerContext::SetKernelCacheCapacity(int64_t capacity) {
+  mutex_lock ml(cache_mu_);
+  if (kernel_cache_capacity_ <= 0 && capacity > 0) {
+    // The clock is not maintained while the cache is unbounded.
+    kernel_cache_clock_.clear();
+    for (const auto& entry : kernel_cache_) {
+      kernel_cache_clock_.push_back(entry.first);
+    }
+  } else if (capacity <= 0) {
+    kernel_cache_clock_.clear();
+  }
+  kernel_cache_capacity_ = capacity;
+  if (kernel_cache_capacity_ > 0) EvictKernelsLocked();
+}
+
+void EagerContext::EvictKernelsLocked() {
+  while (static_cast<int64_t>(kernel_cache_.size()) >
+             kernel_cache_capacity_ &&
+         !kernel_cache_clock_.empty()) {
+    Fprint128 key = kernel_cache_clock_.front();
+    kernel_cache_clock_.pop_front();
+    auto iter = kernel_cache_.find(key);
+    // The entry was already removed, e.g. by RemoveFunction.
+    if (iter == kernel_cache_.end()) continue;
+    // Give recently used entries a second chance.
+    if (iter->second.referenced.exchange(false, std::memory_order_relaxed)) {
+      kernel_cache_clock_.push_back(key);
+      continue;
+    }
+    // Evicted kernels may still be referenced by pending nodes; those hold
+    // their own reference, so it is safe to drop the cache's reference here.
+    auto* registered_function = gtl::FindPtrOrNull(
+        registered_functions_, iter->second.kernel->name());
+    if (registered_function != nullptr) {
+      auto& keys = *registered_function->cached_kernel_keys;
+      keys.erase(std::remove(keys.begin(), keys.end(), key), keys.end());
+    }
+    VLOG(5) << "Evicting kernel " << iter->second.kernel->name()
+            << " from the kernel cache.";
+    kernel_cache_.erase(iter);
+    ++kernel_cache_evictions_;
+    eager_kernel_cache_evictions->GetCell()->IncrementBy(1);
+  }
+  // Drop stale keys left behind by removed entries so the clock stays
+  // proportional to the cache size.
+  if (kernel_cache_clock_.size() > 2 * kernel_cache_.size() + 16) {
+    kernel_cache_clock_.clear();
+    for (const auto& entry : kernel_cache_) {
+      kernel_cache_clock_.push_back(entry.first);
+    }
+  }
 }
 
 void EagerContext::AddDeviceToCache(Fprint128 device_cache_key,
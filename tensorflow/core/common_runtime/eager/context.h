@@ -18,6 +18,7 @@ limitations under the License.
 #include <algorithm>
 #include <atomic>
 #include <cstddef>
+#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
@@ -272,7 +273,14 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
   core::RefCountPtr<KernelAndDevice> GetCachedKernel(Fprint128 cache_key);
   Device* GetCachedDevice(Fprint128 device_cache_key);
 
+  // Adds `kernel` to the kernel cache. If the cache is bounded (see
+  // SetKernelCacheCapacity) and full, the least recently used kernels are
+  // evicted first.
   void AddKernelToCache(Fprint128 cache_key, KernelAndDevice* kernel);
+  // Limits the number of entries in the kernel cache to `capacity`, evicting
+  // entries if needed. A capacity of 0 means the cache is unbounded. The
+  // initial capacity is read from TF_EAGER_KERNEL_CACHE_CAPACITY.
+  void SetKernelCacheCapacity(int64_t capacity);
   void AddDeviceToCache(Fprint128 device_cache_key, Device* device);
 
   bool LogDevicePlacement() const { return log_device_placement_; }
@@ -751,9 +759,24 @@ class EagerContext : public ImmediateExecutionContext, public core::RefCounted {
 
     std::unique_ptr<std::vector<Fprint128>> cached_kernel_keys;
   };
-  std::unordered_map<Fprint128, core::RefCountPtr<KernelAndDevice>,
-                     Fprint128Hasher>
+  struct KernelCacheEntry {
+    core::RefCountPtr<KernelAndDevice> kernel;
+    // Set on every lookup and cleared by the eviction sweep. Lookups only hold
+    // a shared lock on `cache_mu_`, so this has to be atomic.
+    std::atomic<bool> referenced{false};
+  };
+  // Evicts entries until the cache holds at most `kernel_cache_capacity_`
+  // entries, using the CLOCK approximation of LRU over `kernel_cache_clock_`.
+  void EvictKernelsLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(cache_mu_);
+  std::unordered_map<Fprint128, KernelCacheEntry, Fprint128Hasher>
       kernel_cache_ TF_GUARDED_BY(cache_mu_);
+  // Keys of `kernel_cache_` in insertion order; only maintained when the cache
+  // is bounded. May contain keys that were already removed from the cache.
+  std::deque<Fprint128> kernel_cache_clock_ TF_GUARDED_BY(cache_mu_);
+  int64_t kernel_cache_capacity_ TF_GUARDED_BY(cache_mu_) = 0;
+  std::atomic<int64_t> kernel_cache_hits_{0};
+  std::atomic<int64_t> kernel_cache_misses_{0};
+  std::atomic<int64_t> kernel_cache_evictions_{0};
   std::unordered_map<string, RegisteredFunction*> registered_functions_
       TF_GUARDED_BY(cache_mu_);
   absl::flat_hash_map<Fprint128, Device*, Fprint128Hasher> device_cache_
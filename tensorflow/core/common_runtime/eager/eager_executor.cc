@@ -19,6 +19,7 @@ limitations under the License.
 #include <functional>
 #include <memory>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/lib/core/errors.h"
 #include "tensorflow/core/lib/gtl/cleanup.h"
@@ -53,9 +54,47 @@ EagerExecutor::EagerExecutor(bool async, bool enable_streaming_enqueue,
   }
 }
 
+EagerExecutor::NodeInbox::~NodeInbox() {
+  NodeItem* item = head_.exchange(nullptr);
+  while (item != nullptr) {
+    NodeItem* next = item->next_pending;
+    item->Unref();
+    item = next;
+  }
+}
+
+bool EagerExecutor::NodeInbox::Push(NodeItem* item) {
+  NodeItem* head = head_.load(std::memory_order_relaxed);
+  do {
+    item->next_pending = head;
+  } while (!head_.compare_exchange_weak(head, item));
+  return head == nullptr;
+}
+
+void EagerExecutor::NodeInbox::PopAll(
+    std::deque<core::RefCountPtr<NodeItem>>* out) {
+  NodeItem* head = head_.exchange(nullptr);
+  // The list is in LIFO order; reverse it so that nodes run in the order in
+  // which they were added.
+  NodeItem* fifo = nullptr;
+  while (head != nullptr) {
+    NodeItem* next = head->next_pending;
+    head->next_pending = fifo;
+    fifo = head;
+    head = next;
+  }
+  while (fifo != nullptr) {
+    NodeItem* next = fifo->next_pending;
+    fifo->next_pending = nullptr;
+    out->emplace_back(fifo);
+    fifo = next;
+  }
+}
+
 EagerExecutor::~EagerExecutor() {
   tensorflow::mutex_lock l(node_queue_mutex_);
   state_ = ExecutorState::kShutDown;
+  accepting_nodes_ = false;
   nodes_pending_.notify_all();
   for (const auto& cleanups_for_key : cleanups_) {
     for (const std::function<void()>& cleanup : cleanups_for_key.second) {
@@ -76,6 +115,7 @@ Status EagerExecutor::ShutDown() {
         // So, we fall through to
         // thread_exited_notification_.WaitForNotification() below.
         state_ = ExecutorState::kShuttingDown;
+        accepting_nodes_ = false;
       }
       // It is OK to ignore the returned status here because it will be saved
       // as the final status_.
@@ -94,6 +134,19 @@ Status EagerExecutor::ShutDown() {
 
   thread_exited_notification_.WaitForNotification();
 
+  // A producer that passed the lock-free state check right before shutdown
+  // may still have pushed a node after the executor thread drained the inbox.
+  // Such nodes will never run, so abort them.
+  std::deque<core::RefCountPtr<NodeItem>> items_to_abort;
+  {
+    tensorflow::mutex_lock l(node_queue_mutex_);
+    pending_inbox_.PopAll(&items_to_abort);
+  }
+  for (auto& item : items_to_abort) {
+    item->node->Abort(errors::FailedPrecondition(
+        "EagerExecutor was shut down before the node could run."));
+  }
+
   return status();
 }
 
@@ -149,26 +202,29 @@ Status EagerExecutor::AddOrExecute(std::unique_ptr<EagerNode> node) {
     // In sync mode, run the node item regardless of executor status.
     return RunItem(std::move(item), /*from_queue=*/false);
   } else {
-    tensorflow::mutex_lock l(node_queue_mutex_);
-    DVLOG(3) << "Add node [id " << item->id << "]" << item->node->DebugString()
-             << " with status: " << status_;
-    if (state_ != ExecutorState::kActive) {
-      status = errors::FailedPrecondition(
-          "EagerExecutor accepts new EagerNodes to run only in Active state. "
-          "Current state is '",
-          StateStringLocked(), "'");
-    } else {
-      status = status_;
-      if (status.ok()) {
-        node_queue_.push(std::move(item));
-        // If there were no previous nodes pending, wake the run thread to
-        // start processing requests again.
-        if (node_queue_.size() == 1) {
-          nodes_pending_.notify_all();
-        }
-        if (in_flight_nodes_limit_ == 0) {
-          return OkStatus();
-        }
+    DVLOG(3) << "Add node [id " << item->id << "]"
+             << item->node->DebugString();
+    if (!accepting_nodes_ || !ok()) {
+      // Slow path: take the lock to produce the precise error. The state may
+      // also have been reset by ClearError() in the meantime.
+      tensorflow::mutex_lock l(node_queue_mutex_);
+      if (state_ != ExecutorState::kActive) {
+        status = errors::FailedPrecondition(
+            "EagerExecutor accepts new EagerNodes to run only in Active "
+            "state. Current state is '",
+            StateStringLocked(), "'");
+      } else {
+        status = status_;
+      }
+    }
+    if (status.ok()) {
+      EnqueuePendingNode(std::move(item));
+      if (in_flight_nodes_limit_ == 0) {
+        return OkStatus();
+      }
+      {
+        tensorflow::mutex_lock l(node_queue_mutex_);
+        MaybeDrainInboxLocked();
         // Limit the concurrency by controlling the number of in flight nodes.
         while (true) {
           int64_t in_flight_nodes_count =
@@ -181,9 +237,10 @@ Status EagerExecutor::AddOrExecute(std::unique_ptr<EagerNode> node) {
                   << " unfinished_nodes_.size() = " << unfinished_nodes_.size()
                   << ".";
           nodes_done_.wait(l);
+          MaybeDrainInboxLocked();
         }
-        return OkStatus();
       }
+      return OkStatus();
     }
   }
 
@@ -205,6 +262,7 @@ tensorflow::Status EagerExecutor::WaitForAllPendingNodesLocked(
   tensorflow::condition_variable cond;
   // Don't wait if an error is already set.
   if (!status_.ok()) return status_;
+  MaybeDrainInboxLocked();
   if (node_queue_.empty() && unfinished_nodes_.empty()) return OkStatus();
   // node_queue_ must be empty in sync mode.
   DCHECK(Async() || node_queue_.empty());
@@ -221,15 +279,27 @@ void EagerExecutor::ClearError() {
   // TODO(iga): Check state_ and return an error if it is not kActive.
   if (ok()) return;
 
-  tensorflow::mutex_lock l(node_queue_mutex_);
-  // If an error was set, node_done_notifications_ and node_queue_ should have
-  // been cleared, and no new entries should have been added since.
-  DCHECK(node_done_notifications_.empty());
-  DCHECK(node_queue_.empty());
-  status_ = OkStatus();
-  ok_ = true;
-  last_eager_client_ = nullptr;
-  nodes_pending_.notify_all();
+  // Nodes that were pushed to the inbox while the error was being set were
+  // never moved to node_queue_. They belong to the failed sequence of
+  // operations, so abort them with the error being cleared.
+  std::deque<core::RefCountPtr<NodeItem>> items_to_abort;
+  Status cleared_status;
+  {
+    tensorflow::mutex_lock l(node_queue_mutex_);
+    // If an error was set, node_done_notifications_ and node_queue_ should
+    // have been cleared, and no new entries should have been added since.
+    DCHECK(node_done_notifications_.empty());
+    DCHECK(node_queue_.empty());
+    pending_inbox_.PopAll(&items_to_abort);
+    cleared_status = status_;
+    status_ = OkStatus();
+    ok_ = true;
+    last_eager_client_ = nullptr;
+    nodes_pending_.notify_all();
+  }
+  for (auto& item : items_to_abort) {
+    item->node->Abort(cleared_status);
+  }
 }
 
 void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
@@ -256,7 +326,7 @@ void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
     if (from_queue) {
       // Since this was from the async queue, pop it from the front of the queue
       DCHECK(!node_queue_.empty() && item.get() == node_queue_.front().get());
-      node_queue_.pop();
+      node_queue_.pop_front();
     } else if (async) {
       // If it is an Async node then we will find the node in the unfinished
       // nodes list. However we only notify if we are at the front of the list
@@ -288,9 +358,11 @@ void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
                                 "EagerExecutor. This error cancels all future "
                                 "operations and poisons their output tensors.");
       }
+      ++error_epoch_;
+      pending_inbox_.PopAll(&node_queue_);
       while (!node_queue_.empty()) {
         items_to_destroy.push_front(std::move(node_queue_.front()));
-        node_queue_.pop();
+        node_queue_.pop_front();
       }
       for (auto& it : unfinished_nodes_) {
         items_to_destroy.push_front(std::move(it.second));
@@ -315,6 +387,9 @@ void EagerExecutor::NodeDone(const core::RefCountPtr<NodeItem>& item,
 
 void EagerExecutor::NotifyWaiters(uint64 id) {
   if (!node_done_notifications_.empty()) {
+    // Make sure nodes that are still in the inbox bound the set of waiters
+    // that can be notified.
+    MaybeDrainInboxLocked();
     uint64 upperbound_id = 0;
     if (!unfinished_nodes_.empty()) {
       upperbound_id = unfinished_nodes_.begin()->first - 1;
@@ -344,31 +419,65 @@ void EagerExecutor::NotifyWaiters(uint64 id) {
   }
 }
 
+void EagerExecutor::EnqueuePendingNode(core::RefCountPtr<NodeItem> item) {
+  const bool was_empty = pending_inbox_.Push(item.release());
+  // Only the producer that makes the inbox non-empty needs to wake the
+  // executor thread, and only if it is actually waiting. The executor thread
+  // publishes `run_thread_waiting_` before re-checking the inbox, so either it
+  // sees this node or this load sees the flag.
+  if (was_empty && run_thread_waiting_) {
+    tensorflow::mutex_lock l(node_queue_mutex_);
+    nodes_pending_.notify_all();
+  }
+}
+
+void EagerExecutor::MaybeDrainInboxLocked() {
+  if (!status_.ok() || state_ == ExecutorState::kShutDown) return;
+  pending_inbox_.PopAll(&node_queue_);
+}
+
 void EagerExecutor::Run() {
   auto thread_exited_notifier =
       gtl::MakeCleanup([this] { thread_exited_notification_.Notify(); });
+  std::vector<core::RefCountPtr<NodeItem>> batch;
   while (true) {
-    core::RefCountPtr<NodeItem> curr_item;
+    uint64 epoch;
     {
       tensorflow::mutex_lock l(node_queue_mutex_);
-      while (node_queue_.empty() || !status_.ok()) {
+      while (true) {
+        MaybeDrainInboxLocked();
+        if (!node_queue_.empty() && status_.ok()) break;
         if (state_ == ExecutorState::kShutDown) return;
-        nodes_pending_.wait(l);
+        run_thread_waiting_ = true;
+        if (!status_.ok() || pending_inbox_.empty()) {
+          nodes_pending_.wait(l);
+        }
+        run_thread_waiting_ = false;
       }
-      // Obtain raw pointer since we don't want to remove from the queue until
+      // Obtain raw pointers since we don't want to remove from the queue until
       // the node has been run. Otherwise, WaitForAllPendingNodes can return
       // too early.
       // Note, we don't std::move from the here because the front of the queue
       // will then contain a nullptr. This can be a problem in
       // WaitForAllPendingNodes where we get the top EagerNode pointer
       // and register a notification for its completion.
-      curr_item.reset(node_queue_.front().get());
-      curr_item->Ref();
+      epoch = error_epoch_;
+      batch.reserve(node_queue_.size());
+      for (const auto& queued_item : node_queue_) {
+        queued_item->Ref();
+        batch.emplace_back(queued_item.get());
+      }
     }
-    Status status = RunItem(std::move(curr_item), /*from_queue=*/true);
-    if (!status.ok()) {
-      VLOG(1) << "Failed to run item: " << status;
+    for (auto& curr_item : batch) {
+      // A fatal error clears and aborts everything in node_queue_, including
+      // the rest of this batch.
+      if (error_epoch_ != epoch) break;
+      Status status = RunItem(std::move(curr_item), /*from_queue=*/true);
+      if (!status.ok()) {
+        VLOG(1) << "Failed to run item: " << status;
+      }
     }
+    batch.clear();
   }
 }
 
@@ -434,7 +543,7 @@ Status EagerExecutor::MoveToUnfinished(core::RefCountPtr<NodeItem> item,
 
   if (from_queue) {
     DCHECK(!node_queue_.empty() && item.get() == node_queue_.front().get());
-    node_queue_.pop();
+    node_queue_.pop_front();
   }
 
   DVLOG(3) << "Add Node: [id " << item->id << "] to unfinished map.";
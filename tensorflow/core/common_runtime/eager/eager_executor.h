@@ -18,10 +18,10 @@ limitations under the License.
 #include <algorithm>
 #include <atomic>
 #include <cstddef>
+#include <deque>
 #include <functional>
 #include <map>
 #include <memory>
-#include <queue>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -113,6 +113,11 @@ class AsyncRemoteExecuteNode : public AsyncEagerNode {
 // TODO(agarwal): Support out-of-order execution and dispatching multiple
 // EagerNode in parallel.
 // TODO(agarwal): Implement optimizations over EagerNode traces.
+//
+// In async mode, producers hand nodes to the executor thread through a
+// lock-free inbox and only take `node_queue_mutex_` to wake the executor
+// thread when it is idle. The executor thread moves everything in the inbox
+// to `node_queue_` in one step and runs the resulting batch back to back.
 class EagerExecutor {
  public:
   explicit EagerExecutor(bool async, bool enable_streaming_enqueue = true,
@@ -195,6 +200,34 @@ class EagerExecutor {
     uint64 id;
     std::unique_ptr<EagerNode> node;
     NodeState state;
+    // Intrusive link used while the item sits in `pending_inbox_`. The inbox
+    // owns one reference to the item while it is linked.
+    NodeItem* next_pending = nullptr;
+  };
+
+  // Lock-free multi-producer inbox of NodeItems. Producers push with a CAS on
+  // the head of an intrusive LIFO list. The consumer detaches the whole list
+  // with a single exchange and restores FIFO order, so there is no per-node
+  // pop and no ABA hazard. `PopAll` must only be called by one thread at a
+  // time; EagerExecutor calls it with `node_queue_mutex_` held.
+  class NodeInbox {
+   public:
+    NodeInbox() = default;
+    NodeInbox(const NodeInbox&) = delete;
+    NodeInbox& operator=(const NodeInbox&) = delete;
+    ~NodeInbox();
+
+    // Takes ownership of one reference on `item`. Returns true if the inbox
+    // was empty before the push.
+    bool Push(NodeItem* item);
+
+    // Appends all pushed items to `out` in push order.
+    void PopAll(std::deque<core::RefCountPtr<NodeItem>>* out);
+
+    bool empty() const { return head_.load() == nullptr; }
+
+   private:
+    std::atomic<NodeItem*> head_{nullptr};
   };
 
   const char* StateStringLocked()
@@ -204,10 +237,20 @@ class EagerExecutor {
                 bool from_queue);
   void NotifyWaiters(uint64 id) TF_EXCLUSIVE_LOCKS_REQUIRED(node_queue_mutex_);
 
+  // Pushes `item` into `pending_inbox_` and wakes up the executor thread if it
+  // is blocked waiting for work.
+  void EnqueuePendingNode(core::RefCountPtr<NodeItem> item);
+
+  // Moves nodes from `pending_inbox_` to the end of `node_queue_`. Nodes are
+  // left in the inbox if `status_` is not ok or the executor is shut down, so
+  // that `node_queue_` stays empty in those states.
+  void MaybeDrainInboxLocked() TF_EXCLUSIVE_LOCKS_REQUIRED(node_queue_mutex_);
+
   // Starts execution of pending EagerNodes. This function loops till executor
   // state_ is set to kShutDown. If any errors are encountered, these are set
   // inside `status_`. The loop blocks anytime there are no pending nodes, or if
-  // `status_` is not ok.
+  // `status_` is not ok. Nodes that are queued together are run back to back
+  // without re-acquiring `node_queue_mutex_` in between.
   void Run();
 
   Status RunItem(core::RefCountPtr<NodeItem> item, bool from_queue);
@@ -230,9 +273,24 @@ class EagerExecutor {
   condition_variable nodes_done_ TF_GUARDED_BY(node_queue_mutex_);
 
   // Queue of pending NodeItems. Ordered by NodeItem::id.
-  std::queue<core::RefCountPtr<NodeItem>> node_queue_
+  std::deque<core::RefCountPtr<NodeItem>> node_queue_
       TF_GUARDED_BY(node_queue_mutex_);
 
+  // Nodes added by AddOrExecute() that have not been moved to `node_queue_`
+  // yet. Declared before `thread_` so that it outlives the executor thread.
+  NodeInbox pending_inbox_;
+
+  // True while the executor thread is blocked on `nodes_pending_`. Producers
+  // only take `node_queue_mutex_` to signal when this is set.
+  std::atomic<bool> run_thread_waiting_{false};
+
+  // Mirrors `state_ == ExecutorState::kActive` for the lock-free enqueue path.
+  std::atomic<bool> accepting_nodes_{true};
+
+  // Incremented every time a fatal error clears `node_queue_`. The executor
+  // thread uses it to stop running a batch whose nodes were aborted.
+  std::atomic<uint64> error_epoch_{0};
+
   // Ordered by NodeItem::id.
   std::map<uint64, core::RefCountPtr<NodeItem>, std::less<uint64>>
       unfinished_nodes_ TF_GUARDED_BY(node_queue_mutex_);
@@ -14,9 +14,12 @@ limitations under the License.
 ==============================================================================*/
 #include "tensorflow/core/common_runtime/eager/eager_executor.h"
 
+#include <atomic>
 #include <memory>
 #include <utility>
+#include <vector>
 
+#include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/status.h"
 #include "tensorflow/core/platform/status_matchers.h"
 #include "tensorflow/core/platform/test.h"
@@ -102,6 +105,25 @@ class TestAsyncEagerNode : public AsyncEagerNode {
   Status run_return_status_;
 };
 
+class TestCountingEagerNode : public EagerNode {
+ public:
+  explicit TestCountingEagerNode(std::atomic<int>* counter)
+      : counter_(counter) {}
+  TestCountingEagerNode(const TestCountingEagerNode&) = delete;
+  TestCountingEagerNode& operator=(const TestCountingEagerNode&) = delete;
+
+  Status Run() override {
+    counter_->fetch_add(1);
+    return OkStatus();
+  }
+
+  void Abort(Status status) override {}
+  string DebugString() const override { return "testCountingEagerNode"; }
+
+ private:
+  std::atomic<int>* counter_;
+};
+
 TEST(EagerExecutorTest, TestSyncExecutorWithEagerNode) {
   auto sync_executor = std::make_unique<EagerExecutor>(
       /*async=*/false, /*enable_streaming_enqueue=*/true);
@@ -201,6 +223,30 @@ TEST(EagerExecutorTest, TestAsyncExecutorWithInFlightRequestLimit) {
   ASSERT_EQ(state->read_state(), TestState::State::kSuccess);
 }
 
+TEST(EagerExecutorTest, TestAsyncExecutorWithConcurrentProducers) {
+  auto async_executor = std::make_unique<EagerExecutor>(
+      /*async=*/true, /*enable_streaming_enqueue=*/true);
+
+  constexpr int kNumProducers = 4;
+  constexpr int kNodesPerProducer = 250;
+  std::atomic<int> counter(0);
+  {
+    std::vector<std::unique_ptr<Thread>> producers;
+    for (int i = 0; i < kNumProducers; ++i) {
+      producers.emplace_back(Env::Default()->StartThread(
+          ThreadOptions(), "producer", [&async_executor, &counter]() {
+            for (int j = 0; j < kNodesPerProducer; ++j) {
+              TF_ASSERT_OK(async_executor->AddOrExecute(
+                  std::make_unique<TestCountingEagerNode>(&counter)));
+            }
+          }));
+    }
+  }
+  TF_ASSERT_OK(async_executor->WaitForAllPendingNodes());
+  EXPECT_EQ(counter.load(), kNumProducers * kNodesPerProducer);
+  TF_ASSERT_OK(async_executor->ShutDown());
+}
+
 TEST(EagerExecutorTest, TestAsyncExecutorWithEagerNode) {
   auto async_executor = std::make_unique<EagerExecutor>(
       /*async=*/true, /*enable_streaming_enqueue=*/true);
@@ -1191,19 +1191,30 @@ StatusOr<Fprint128> GetKernelCacheKey(
     bool reuse_rendezvous_for_functions) {
   EagerContext& ctx = op.EagerContext();
 
+  // `op_cache_key` covers the op name, its attributes (including dtypes) and
+  // its device. It is computed once per attribute set by AttrBuilder and
+  // reused across dispatches, which makes it the cheap first level of the key.
+  // Only input devices and resource variable dtypes and shapes are combined
+  // here. Shapes of other inputs are not part of the key, since kernels do
+  // not depend on them. Resource shapes are not bucketed, because they select
+  // function instantiations specialized on them. A separate map keyed by
+  // `op_cache_key` would therefore add a lookup without saving any hashing;
+  // the size of the cache is bounded by eviction instead.
   Fprint128 cache_key = op_cache_key;
-  /// Include soft placement policy in cache key since the placement strategy
-  // can change and thus affect which kernel is picked.
-  cache_key = tsl::FingerprintCat128(cache_key, ctx.AllowSoftPlacement());
-
-  // Include run_eager_op_as_function policy in cache key since the execution
-  // strategy can change and affect which kernel is picked.
+  // The following context policies are folded into a single word so that they
+  // cost one fingerprint combination per dispatch instead of three:
+  //  - The soft placement policy, since the placement strategy can change and
+  //    thus affect which kernel is picked.
+  //  - The run_eager_op_as_function policy, since the execution strategy can
+  //    change and affect which kernel is picked.
+  //  - The launch-time rendezvous reuse setting, which is bundled with the
+  //    kernel.
   VLOG(3) << "ctx.RunEagerOpAsFunction(): " << ctx.RunEagerOpAsFunction();
-  cache_key = tsl::FingerprintCat128(cache_key, ctx.RunEagerOpAsFunction());
-
-  // The launch-time rendezvous reuse setting is bundled with the kernel, so we
-  // need to include it in the cache key.
-  cache_key = tsl::FingerprintCat128(cache_key, reuse_rendezvous_for_functions);
+  const uint64 policy_bits =
+      (ctx.AllowSoftPlacement() ? 1 : 0) |
+      (ctx.RunEagerOpAsFunction() ? 2 : 0) |
+      (reuse_rendezvous_for_functions ? 4 : 0);
+  cache_key = tsl::FingerprintCat128(cache_key, policy_bits);
 
   for (int i = 0, end = input_device_ptrs.size(); i < end; ++i) {
     cache_key = tsl::FingerprintCat128(
@@ -410,5 +410,52 @@ TEST(ExecuteTest, MultipleNestedCompiledFunction) {
   ctx->Unref();
 }
 
+TEST(ExecuteTest, BoundedKernelCache) {
+  StaticDeviceMgr device_mgr(
+      DeviceFactory::NewDevice("CPU", {}, "/job:localhost/replica:0/task:0"));
+  auto ctx = new EagerContext(
+      SessionOptions(),
+      tensorflow::ContextDevicePlacementPolicy::DEVICE_PLACEMENT_EXPLICIT,
+      false, &device_mgr, false, nullptr, nullptr);
+  ctx->SetRunEagerOpAsFunction(false);
+  ctx->SetKernelCacheCapacity(1);
+
+  Tensor input_tensor = test::AsScalar<int64_t>(3);
+  auto input = core::RefCountPtr<ImmediateExecutionTensorHandle>(
+      ctx->CreateLocalHandleFromTFTensor(input_tensor,
+                                         ctx->HostCPUName().c_str()));
+  auto run_op = [&](const char* op_name) {
+    auto op = std::make_unique<EagerOperation>(ctx);
+    TF_ASSERT_OK(op->Reset(
+        /*op=*/op_name,
+        /*raw_device_name=*/"/job:localhost/replica:0/task:0/device:CPU:0"));
+    TF_ASSERT_OK(op->AddInput(input.get()));
+    TF_ASSERT_OK(op->AddInput(input.get()));
+    std::vector<TensorHandle*> retvals(1);
+    int num_retvals = retvals.size();
+    TF_ASSERT_OK(EagerExecute(op.get(), retvals.data(), &num_retvals));
+    retvals[0]->Unref();
+  };
+
+  run_op("Mul");
+  run_op("Mul");
+  auto stats = ctx->GetCacheStats();
+  EXPECT_EQ(stats.kernel_cache_size, 1);
+  EXPECT_EQ(stats.kernel_cache_misses, 1);
+  EXPECT_EQ(stats.kernel_cache_hits, 1);
+  EXPECT_EQ(stats.kernel_cache_evictions, 0);
+
+  // Adding a second kernel evicts the first one to stay within capacity.
+  run_op("Add");
+  run_op("Mul");
+  stats = ctx->GetCacheStats();
+  EXPECT_EQ(stats.kernel_cache_size, 1);
+  EXPECT_EQ(stats.kernel_cache_misses, 3);
+  EXPECT_EQ(stats.kernel_cache_evictions, 2);
+
+  input.reset();
+  ctx->Unref();
+}
+
 }  // namespace
 }  // namespace tensorflow
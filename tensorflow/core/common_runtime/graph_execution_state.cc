@@ -56,6 +56,7 @@ limitations under the License.
 #include "tensorflow/core/util/util.h"
 
 #ifndef IS_MOBILE_PLATFORM
+#include "tensorflow/core/common_runtime/optimized_graph_cache.h"
 #include "tensorflow/core/grappler/clusters/virtual_cluster.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/optimizers/meta_optimizer.h"
@@ -812,11 +813,58 @@ Status GraphExecutionState::OptimizeGraph(
       }
     }
 
-    // Now we can run the MetaOptimizer on the constructed GrapplerItem.
+    // Look up the optimized graph in the persistent cache, if enabled.
+    const string& cache_dir = GetOptimizedGraphCacheDir();
+    string cache_key;
     GraphDef new_graph;
-    TF_RETURN_IF_ERROR(
-        grappler::RunMetaOptimizer(std::move(item), session_options_->config,
-                                   cpu_device, &cluster, &new_graph));
+    bool read_from_cache = false;
+    if (!cache_dir.empty()) {
+      std::vector<string> feeds;
+      feeds.reserve(item.feed.size());
+      for (const auto& feed : item.feed) feeds.push_back(feed.first);
+      cache_key = GetOptimizedGraphCacheKey(item.graph, feeds, item.fetch,
+                                            session_options_->config,
+                                            *device_set_);
+      Status s = ReadOptimizedGraphFromCache(cache_dir, cache_key,
+                                             Env::Default(), &new_graph);
+      if (s.ok()) {
+        metrics::IncrementFunctionGraphOptimizationCacheHitCount(
+            1, metrics::GraphOptimizationSource::kSession);
+        read_from_cache = true;
+      } else if (errors::IsNotFound(s)) {
+        metrics::IncrementFunctionGraphOptimizationCacheMissCount(
+            1, metrics::GraphOptimizationSource::kSession);
+      } else {
+        metrics::IncrementFunctionGraphOptimizationCacheFailureCount(
+            1, metrics::GraphOptimizationSource::kSession);
+        LOG(ERROR) << "Reading from the optimized session graph cache failed; "
+                      "running Grappler instead. Error: "
+                   << s;
+        new_graph.Clear();
+      }
+    }
+
+    // Now we can run the MetaOptimizer on the constructed GrapplerItem.
+    if (!read_from_cache) {
+      bool all_optimizers_succeeded;
+      TF_RETURN_IF_ERROR(grappler::RunMetaOptimizer(
+          std::move(item), session_options_->config, cpu_device, &cluster,
+          &new_graph, &all_optimizers_succeeded));
+      // A graph that some optimizer failed on, e.g. by exceeding the
+      // deadline, is usable but must not be served to later sessions.
+      if (!cache_dir.empty() && !all_optimizers_succeeded) {
+        VLOG(1) << "Not caching the optimized session graph, since some "
+                   "Grappler optimizers failed";
+      } else if (!cache_dir.empty()) {
+        Status s = WriteOptimizedGraphToCache(
+            cache_dir, cache_key, new_graph, GetOptimizedGraphCacheMaxBytes(),
+            Env::Default());
+        // Failing to cache the graph does not fail the session.
+        if (!s.ok()) {
+          LOG(ERROR) << "Caching the optimized session graph failed: " << s;
+        }
+      }
+    }
 
     // Merge optimized graph function library with an original library.
     // Optimized graph might have new functions specialized for it's
@@ -0,0 +1,286 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/optimized_graph_cache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_format.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/framework/device_attributes.pb.h"
+#include "tensorflow/core/framework/function.pb.h"
+#include "tensorflow/core/grappler/optimizers/custom_graph_optimizer_registry.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/cpu_info.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/fingerprint.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/public/version.h"
+#include "tensorflow/core/util/env_var.h"
+#include "tensorflow/core/util/util.h"
+#include "tensorflow/core/util/version_info.h"
+
+namespace tensorflow {
+namespace {
+
+// Accumulates the fingerprint of a sequence of strings and protos. Each
+// element is fingerprinted separately, so no element is ever serialized
+// together with the others.
+class KeyBuilder {
+ public:
+  void Add(StringPiece s) {
+    fingerprint_ = tsl::FingerprintCat128(fingerprint_, Fingerprint128(s));
+  }
+
+  void Add(uint64 value) {
+    fingerprint_ = tsl::FingerprintCat128(fingerprint_, value);
+  }
+
+  void Add(const protobuf::MessageLite& proto) {
+    string serialized;
+    // Deterministic serialization sorts map fields such as node attributes.
+    SerializeToStringDeterministic(proto, &serialized);
+    Add(serialized);
+  }
+
+  void Add(const Fprint128& fingerprint) {
+    fingerprint_ = tsl::FingerprintCat128(fingerprint_, fingerprint);
+  }
+
+  Fprint128 fingerprint() const { return fingerprint_; }
+
+  std::string Key() const {
+    return absl::StrFormat("%016x%016x", fingerprint_.high64,
+                           fingerprint_.low64);
+  }
+
+ private:
+  Fprint128 fingerprint_ = {0, 0};
+};
+
+constexpr char kCacheFilePrefix[] = "session_graph_";
+constexpr char kCacheFileSuffix[] = ".pb";
+constexpr int64_t kDefaultCacheMaxMegabytes = 1024;
+
+std::string GetCacheFileName(const std::string& dir_name,
+                             const std::string& key) {
+  return io::JoinPath(dir_name,
+                      absl::StrCat(kCacheFilePrefix, key, kCacheFileSuffix));
+}
+
+// Fingerprints what Grappler depends on besides its inputs, which does not
+// change while the process runs.
+Fprint128 EnvironmentFingerprint() {
+  KeyBuilder builder;
+  // Grappler may optimize the same graph differently in other builds.
+  builder.Add(TF_VERSION_STRING);
+  builder.Add(TF_GIT_VERSION);
+  builder.Add(TF_COMPILER_VERSION);
+  builder.Add(TF_GRAPH_DEF_VERSION);
+
+  // Custom optimizers requested by the config only run if they are linked
+  // in. Plugin optimizers come with their devices, which are in the key.
+  std::vector<string> custom_optimizers =
+      grappler::CustomGraphOptimizerRegistry::GetRegisteredOptimizers();
+  std::sort(custom_optimizers.begin(), custom_optimizers.end());
+  builder.Add(custom_optimizers.size());
+  for (const string& name : custom_optimizers) builder.Add(name);
+
+  // The remapper fuses ops for oneDNN, depending on the features of the CPU.
+  builder.Add(IsMKLEnabled() ? 1 : 0);
+  builder.Add(port::CPUVendorIDString());
+  for (const port::CPUFeature feature :
+       {port::SSE, port::SSE2, port::SSE3, port::SSSE3, port::SSE4_1,
+        port::SSE4_2, port::AVX, port::AVX2, port::FMA, port::F16C,
+        port::AVX512F, port::AVX512BW, port::AVX512DQ, port::AVX512VL,
+        port::AVX512_VNNI, port::AVX512_BF16, port::AVX_VNNI, port::AMX_TILE,
+        port::AMX_INT8, port::AMX_BF16}) {
+    builder.Add(port::TestCPUFeature(feature) ? 1 : 0);
+  }
+
+  // Auto-clustering may also be enabled outside of the ConfigProto.
+  const char* xla_flags = getenv("TF_XLA_FLAGS");
+  builder.Add(xla_flags == nullptr ? "" : xla_flags);
+  return builder.fingerprint();
+}
+
+// Deletes the least recently written cache files in `dir_name` other than
+// `kept_file_name` until the cache files take at most `max_bytes`.
+Status EvictFromCache(const std::string& dir_name,
+                      const std::string& kept_file_name, int64_t max_bytes,
+                      Env* env) {
+  std::vector<std::string> children;
+  TF_RETURN_IF_ERROR(env->GetChildren(dir_name, &children));
+  std::vector<std::pair<int64_t, std::string>> files;  // By write time.
+  int64_t total_bytes = 0;
+  for (const std::string& child : children) {
+    if (!absl::StartsWith(child, kCacheFilePrefix) ||
+        !absl::EndsWith(child, kCacheFileSuffix)) {
+      continue;
+    }
+    const std::string file_name = io::JoinPath(dir_name, child);
+    FileStatistics stats;
+    // Other processes may evict files concurrently.
+    if (!env->Stat(file_name, &stats).ok()) continue;
+    total_bytes += stats.length;
+    if (file_name != kept_file_name) {
+      files.emplace_back(stats.mtime_nsec, file_name);
+    }
+  }
+  std::sort(files.begin(), files.end());
+  for (const auto& file : files) {
+    if (total_bytes <= max_bytes) break;
+    FileStatistics stats;
+    if (!env->Stat(file.second, &stats).ok()) continue;
+    if (env->DeleteFile(file.second).ok()) {
+      VLOG(1) << "Evicted optimized graph cache file " << file.second;
+      total_bytes -= stats.length;
+    }
+  }
+  return OkStatus();
+}
+
+}  // namespace
+
+const std::string& GetOptimizedGraphCacheDir() {
+  static const std::string* const dir_name = []() {
+    const char* dir_name = getenv(kOptimizedGraphCachingEnvVariableName);
+    return new std::string(dir_name == nullptr ? "" : dir_name);
+  }();
+  return *dir_name;
+}
+
+int64_t GetOptimizedGraphCacheMaxBytes() {
+  static const int64_t max_bytes = []() {
+    int64_t max_megabytes;
+    Status s = ReadInt64FromEnvVar(
+        kOptimizedGraphCacheMaxMegabytesEnvVariableName,
+        kDefaultCacheMaxMegabytes, &max_megabytes);
+    if (!s.ok()) {
+      LOG(WARNING) << s;
+      max_megabytes = kDefaultCacheMaxMegabytes;
+    }
+    return max_megabytes << 20;
+  }();
+  return max_bytes;
+}
+
+std::string GetOptimizedGraphCacheKey(const GraphDef& graph,
+                                      const std::vector<std::string>& feeds,
+                                      const std::vector<std::string>& fetches,
+                                      const ConfigProto& config,
+                                      const DeviceSet& device_set) {
+  static const Fprint128 environment_fingerprint = EnvironmentFingerprint();
+  KeyBuilder builder;
+  builder.Add(environment_fingerprint);
+
+  builder.Add(graph.node_size());
+  for (const NodeDef& node : graph.node()) builder.Add(node);
+  builder.Add(graph.versions());
+
+  // The order of the functions in the library depends on the order in which
+  // they were added, which is not part of the graph.
+  std::vector<const FunctionDef*> functions;
+  functions.reserve(graph.library().function_size());
+  for (const FunctionDef& fdef : graph.library().function()) {
+    functions.push_back(&fdef);
+  }
+  std::sort(functions.begin(), functions.end(),
+            [](const FunctionDef* a, const FunctionDef* b) {
+              return a->signature().name() < b->signature().name();
+            });
+  builder.Add(functions.size());
+  for (const FunctionDef* fdef : functions) builder.Add(*fdef);
+  std::vector<const GradientDef*> gradients;
+  gradients.reserve(graph.library().gradient_size());
+  for (const GradientDef& gdef : graph.library().gradient()) {
+    gradients.push_back(&gdef);
+  }
+  std::sort(gradients.begin(), gradients.end(),
+            [](const GradientDef* a, const GradientDef* b) {
+              return a->function_name() < b->function_name();
+            });
+  builder.Add(gradients.size());
+  for (const GradientDef* gdef : gradients) builder.Add(*gdef);
+
+  builder.Add(feeds.size());
+  for (const std::string& feed : feeds) builder.Add(feed);
+  builder.Add(fetches.size());
+  for (const std::string& fetch : fetches) builder.Add(fetch);
+
+  builder.Add(config);
+
+  // Only the attributes that survive a restart: the incarnation is random.
+  std::vector<const Device*> devices(device_set.devices().begin(),
+                                     device_set.devices().end());
+  std::sort(devices.begin(), devices.end(),
+            [](const Device* a, const Device* b) {
+              return a->name() < b->name();
+            });
+  builder.Add(devices.size());
+  for (const Device* device : devices) {
+    DeviceAttributes attributes = device->attributes();
+    attributes.clear_incarnation();
+    builder.Add(attributes);
+  }
+  return builder.Key();
+}
+
+Status ReadOptimizedGraphFromCache(const std::string& dir_name,
+                                   const std::string& key, Env* env,
+                                   GraphDef* graph) {
+  const std::string file_name = GetCacheFileName(dir_name, key);
+  TF_RETURN_IF_ERROR(env->FileExists(file_name));
+  const uint64 start_time_usecs = env->NowMicros();
+  TF_RETURN_IF_ERROR(ReadBinaryProto(env, file_name, graph));
+  VLOG(1) << "Read optimized graph from cache file " << file_name << " in "
+          << env->NowMicros() - start_time_usecs << " us";
+  return OkStatus();
+}
+
+Status WriteOptimizedGraphToCache(const std::string& dir_name,
+                                  const std::string& key,
+                                  const GraphDef& graph, int64_t max_bytes,
+                                  Env* env) {
+  if (!env->FileExists(dir_name).ok()) {
+    TF_RETURN_IF_ERROR(env->RecursivelyCreateDir(dir_name));
+  }
+  bool has_atomic_move = false;
+  TF_RETURN_IF_ERROR(env->HasAtomicMove(dir_name, &has_atomic_move));
+  if (!has_atomic_move) {
+    LOG_EVERY_POW_2(WARNING)
+        << "Filesystem for the optimized session graph cache at " << dir_name
+        << " does not support atomic moves. Concurrent loads may read "
+           "partially written cache files.";
+  }
+  const std::string file_name = GetCacheFileName(dir_name, key);
+  std::string temp_file_name = file_name;
+  if (!env->CreateUniqueFileName(&temp_file_name, ".tmp")) {
+    return errors::Unavailable("Could not create a unique file inside ",
+                               dir_name);
+  }
+  TF_RETURN_IF_ERROR(WriteBinaryProto(env, temp_file_name, graph));
+  TF_RETURN_IF_ERROR(env->RenameFile(temp_file_name, file_name));
+  if (max_bytes <= 0) return OkStatus();
+  return EvictFromCache(dir_name, file_name, max_bytes, env);
+}
+
+}  // namespace tensorflow
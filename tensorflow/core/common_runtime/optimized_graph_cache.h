@@ -0,0 +1,85 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+// This file contains util functions for the persistent cache of the session
+// graphs optimized by Grappler (see GraphExecutionState::OptimizeGraph()).
+#ifndef TENSORFLOW_CORE_COMMON_RUNTIME_OPTIMIZED_GRAPH_CACHE_H_
+#define TENSORFLOW_CORE_COMMON_RUNTIME_OPTIMIZED_GRAPH_CACHE_H_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/status.h"
+#include "tensorflow/core/protobuf/config.pb.h"
+
+namespace tensorflow {
+
+// The name of the env variable for the caching location of the optimized
+// session graphs. If it is unset or empty, no caching is performed.
+//
+// Restarted replicas loading the same SavedModel with the same config on the
+// same devices read the optimized graph back instead of running Grappler.
+static const char kOptimizedGraphCachingEnvVariableName[] =
+    "TF_SESSION_GRAPH_CACHING";
+
+// The name of the env variable bounding the total size of the cached graphs,
+// in megabytes. The least recently written graphs are evicted first. A
+// non-positive value disables the bound.
+static const char kOptimizedGraphCacheMaxMegabytesEnvVariableName[] =
+    "TF_SESSION_GRAPH_CACHING_MAX_MB";
+
+// Returns the caching location, read from the environment on the first call.
+// Empty if caching is disabled.
+const std::string& GetOptimizedGraphCacheDir();
+
+// Returns the bound on the total size of the cached graphs, read from the
+// environment on the first call.
+int64_t GetOptimizedGraphCacheMaxBytes();
+
+// Returns the key of the optimized version of `graph` (including its function
+// library), pruned for `feeds` and `fetches`, under `config` on the devices in
+// `device_set`. The key is a fingerprint of all of those and of everything
+// else Grappler depends on: the TensorFlow build, the registered custom
+// optimizers, whether oneDNN is enabled, the instruction set of the CPU and
+// the XLA auto-clustering flags. Graphs that could optimize differently never
+// share a key.
+std::string GetOptimizedGraphCacheKey(const GraphDef& graph,
+                                      const std::vector<std::string>& feeds,
+                                      const std::vector<std::string>& fetches,
+                                      const ConfigProto& config,
+                                      const DeviceSet& device_set);
+
+// Reads the optimized graph cached under `key` in `dir_name`. Returns a
+// NotFound error if there is none.
+Status ReadOptimizedGraphFromCache(const std::string& dir_name,
+                                   const std::string& key, Env* env,
+                                   GraphDef* graph);
+
+// Caches `graph` under `key` in `dir_name`, which is created if needed. The
+// cache file is written atomically on file systems supporting atomic moves.
+// If `max_bytes` is positive, the least recently written graphs are then
+// deleted until the cached graphs take at most `max_bytes`; the new one is
+// always kept.
+Status WriteOptimizedGraphToCache(const std::string& dir_name,
+                                  const std::string& key,
+                                  const GraphDef& graph, int64_t max_bytes,
+                                  Env* env);
+
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_COMMON_RUNTIME_OPTIMIZED_GRAPH_CACHE_H_
@@ -0,0 +1,192 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/common_runtime/optimized_graph_cache.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/build_graph_options.h"
+#include "tensorflow/core/common_runtime/device.h"
+#include "tensorflow/core/common_runtime/device_factory.h"
+#include "tensorflow/core/common_runtime/device_set.h"
+#include "tensorflow/core/common_runtime/graph_execution_state.h"
+#include "tensorflow/core/framework/function_testlib.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/public/session_options.h"
+
+namespace tensorflow {
+namespace {
+
+class OptimizedGraphCacheTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    SessionOptions options;
+    (*options.config.mutable_device_count())["CPU"] = 2;
+    TF_ASSERT_OK(DeviceFactory::AddDevices(options, "/job:a/replica:0/task:0",
+                                           &devices_));
+    for (const auto& device : devices_) device_set_.AddDevice(device.get());
+
+    graph_ = test::function::GDef(
+        {test::function::NDef("x", "Placeholder", {}, {{"dtype", DT_FLOAT}}),
+         test::function::NDef("y", "XTimesTwo", {"x"}, {{"T", DT_FLOAT}})},
+        {test::function::XTimesTwo(), test::function::XTimesFour()});
+  }
+
+  std::string Key(const GraphDef& graph) {
+    return GetOptimizedGraphCacheKey(graph, {"x"}, {"y"}, config_,
+                                     device_set_);
+  }
+
+  std::vector<std::unique_ptr<Device>> devices_;
+  DeviceSet device_set_;
+  ConfigProto config_;
+  GraphDef graph_;
+};
+
+TEST_F(OptimizedGraphCacheTest, KeyIsStable) {
+  EXPECT_EQ(Key(graph_), Key(graph_));
+
+  // The order of the function library does not matter.
+  GraphDef reordered = graph_;
+  reordered.mutable_library()->mutable_function()->SwapElements(0, 1);
+  EXPECT_EQ(Key(graph_), Key(reordered));
+}
+
+TEST_F(OptimizedGraphCacheTest, KeyDependsOnInputs) {
+  const std::string key = Key(graph_);
+
+  GraphDef graph = graph_;
+  (*graph.mutable_node(1)->mutable_attr())["_foo"].set_i(1);
+  EXPECT_NE(key, Key(graph));
+
+  graph = graph_;
+  *graph.mutable_library()->add_function() = test::function::XTimes16();
+  EXPECT_NE(key, Key(graph));
+
+  EXPECT_NE(key, GetOptimizedGraphCacheKey(graph_, {}, {"y"}, config_,
+                                           device_set_));
+  EXPECT_NE(key, GetOptimizedGraphCacheKey(graph_, {"x"}, {"y", "x"}, config_,
+                                           device_set_));
+
+  ConfigProto config = config_;
+  RewriterConfig* rewriter_config =
+      config.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config->set_min_graph_nodes(-1);
+  EXPECT_NE(key, GetOptimizedGraphCacheKey(graph_, {"x"}, {"y"}, config,
+                                           device_set_));
+
+  DeviceSet device_set;
+  device_set.AddDevice(devices_[0].get());
+  EXPECT_NE(key, GetOptimizedGraphCacheKey(graph_, {"x"}, {"y"}, config_,
+                                           device_set));
+}
+
+TEST_F(OptimizedGraphCacheTest, WriteAndRead) {
+  Env* env = Env::Default();
+  const std::string dir_name =
+      io::JoinPath(testing::TmpDir(), "optimized_graph_cache");
+  const std::string key = Key(graph_);
+
+  GraphDef read;
+  EXPECT_TRUE(errors::IsNotFound(
+      ReadOptimizedGraphFromCache(dir_name, key, env, &read)));
+
+  TF_ASSERT_OK(WriteOptimizedGraphToCache(dir_name, key, graph_,
+                                          /*max_bytes=*/0, env));
+  TF_ASSERT_OK(ReadOptimizedGraphFromCache(dir_name, key, env, &read));
+  EXPECT_EQ(read.DebugString(), graph_.DebugString());
+
+  // No temporary files are left behind.
+  std::vector<std::string> files;
+  TF_ASSERT_OK(env->GetChildren(dir_name, &files));
+  EXPECT_EQ(files.size(), 1);
+}
+
+TEST_F(OptimizedGraphCacheTest, EvictsLeastRecentlyWritten) {
+  Env* env = Env::Default();
+  const std::string dir_name =
+      io::JoinPath(testing::TmpDir(), "optimized_graph_cache_eviction");
+  GraphDef other_graph = graph_;
+  other_graph.mutable_node(1)->set_name("z");
+
+  TF_ASSERT_OK(WriteOptimizedGraphToCache(dir_name, Key(graph_), graph_,
+                                          /*max_bytes=*/0, env));
+  // The bound is smaller than any graph: only the new graph is kept.
+  TF_ASSERT_OK(WriteOptimizedGraphToCache(dir_name, Key(other_graph),
+                                          other_graph, /*max_bytes=*/1, env));
+  GraphDef read;
+  EXPECT_TRUE(errors::IsNotFound(
+      ReadOptimizedGraphFromCache(dir_name, Key(graph_), env, &read)));
+  TF_ASSERT_OK(
+      ReadOptimizedGraphFromCache(dir_name, Key(other_graph), env, &read));
+  EXPECT_EQ(read.DebugString(), other_graph.DebugString());
+
+  // Without a bound, nothing is evicted.
+  TF_ASSERT_OK(WriteOptimizedGraphToCache(dir_name, Key(graph_), graph_,
+                                          /*max_bytes=*/0, env));
+  std::vector<std::string> files;
+  TF_ASSERT_OK(env->GetChildren(dir_name, &files));
+  EXPECT_EQ(files.size(), 2);
+}
+
+TEST_F(OptimizedGraphCacheTest, GraphExecutionStateReadsCache) {
+  const std::string dir_name =
+      io::JoinPath(testing::TmpDir(), "optimized_session_graph_cache");
+  // The location is read once, by the first optimized session graph.
+  setenv(kOptimizedGraphCachingEnvVariableName, dir_name.c_str(),
+         /*overwrite=*/1);
+  ASSERT_EQ(GetOptimizedGraphCacheDir(), dir_name);
+
+  device_set_.set_client_device(devices_[0].get());
+  SessionOptions session_options;
+  GraphExecutionStateOptions options;
+  options.device_set = &device_set_;
+  options.session_options = &session_options;
+  BuildGraphOptions build_options;
+  build_options.callable_options.add_feed("x:0");
+  build_options.callable_options.add_fetch("y:0");
+  auto build_graph = [&]() {
+    std::unique_ptr<GraphExecutionState> state;
+    TF_ASSERT_OK(GraphExecutionState::MakeForBaseGraph(GraphDef(graph_),
+                                                       options, &state));
+    std::unique_ptr<ClientGraph> client_graph;
+    TF_ASSERT_OK(state->BuildGraph(build_options, &client_graph));
+  };
+  const auto source = metrics::GraphOptimizationSource::kSession;
+  const int64_t hits =
+      metrics::GetFunctionGraphOptimizationCacheHitCount(source);
+  const int64_t misses =
+      metrics::GetFunctionGraphOptimizationCacheMissCount(source);
+
+  build_graph();
+  EXPECT_EQ(hits, metrics::GetFunctionGraphOptimizationCacheHitCount(source));
+  EXPECT_EQ(misses + 1,
+            metrics::GetFunctionGraphOptimizationCacheMissCount(source));
+
+  // Another session optimizing the same graph reads it from the cache.
+  build_graph();
+  EXPECT_EQ(hits + 1,
+            metrics::GetFunctionGraphOptimizationCacheHitCount(source));
+  EXPECT_EQ(misses + 1,
+            metrics::GetFunctionGraphOptimizationCacheMissCount(source));
+  EXPECT_EQ(0, metrics::GetFunctionGraphOptimizationCacheFailureCount(source));
+}
+
+}  // namespace
+}  // namespace tensorflow
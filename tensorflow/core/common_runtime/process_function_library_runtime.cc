@@ -51,11 +51,14 @@ limitations under the License.
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/graph/graph_node_util.h"
 #include "tensorflow/core/lib/core/errors.h"
+#include "tensorflow/core/lib/gtl/cleanup.h"
 #include "tensorflow/core/lib/gtl/inlined_vector.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
 #include "tensorflow/core/platform/blocking_counter.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/notification.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/public/session_options.h"
 #include "tensorflow/core/util/device_name_utils.h"
 #include "tensorflow/core/util/dump_graph.h"
@@ -69,6 +72,25 @@ namespace tensorflow {
 
 const char ProcessFunctionLibraryRuntime::kDefaultFLRDevice[] = "null";
 
+namespace {
+
+// The number of op nodes across all component functions above which they are
+// instantiated in parallel even if there are only a few of them.
+constexpr int64_t kMinNodesForParallelInstantiation = 256;
+
+// Instantiates the component functions of multi-device functions, which
+// converts and optimizes each of them and creates its executor. Separate from
+// the inter-op pool, so that a caller running on an inter-op thread (e.g. a
+// PartitionedCall op) never waits for work queued behind it.
+thread::ThreadPool* ComponentInstantiationPool() {
+  static thread::ThreadPool* pool =
+      new thread::ThreadPool(Env::Default(), "instantiate_component_function",
+                             port::MaxParallelism());
+  return pool;
+}
+
+}  // namespace
+
 void ProcessFunctionLibraryRuntime::FunctionData::DistributedInit(
     DistributedFunctionLibraryRuntime* parent, const string& function_name,
     const FunctionLibraryDefinition& lib_def, AttrSlice attrs,
@@ -300,7 +322,9 @@ ProcessFunctionLibraryRuntime::AddMultiDeviceHandle(
   mutex_lock l(mu_);
   auto h = next_handle_;
   mdevice_data_[h] = std::move(data);
-  table_[function_key] = h;
+  // A concurrent instantiation of the same function may have finished first,
+  // in which case this handle is not shared and is released separately.
+  table_.emplace(function_key, h);
   next_handle_++;
   return h;
 }
@@ -510,15 +534,39 @@ Status ProcessFunctionLibraryRuntime::InstantiateMultiDevice(
   // Check if this function has already been instantiated.
   const string& function_key = Canonicalize(function_name, attrs, options);
 
+  // Threads of the default pool, e.g. running a PartitionedCall op, must not
+  // block on work that may be queued behind them in the same pool.
+  const bool on_default_thread_pool =
+      default_thread_pool_ != nullptr &&
+      default_thread_pool_->CurrentThreadId() != -1;
+  bool owns_pending_instantiation = false;
   {
     mutex_lock l(mu_);
-    const auto& it = table_.find(function_key);
-    if (it != table_.end()) {
-      *handle = it->second;
-      ++mdevice_data_[*handle]->instantiation_counter_;
-      return OkStatus();
+    while (true) {
+      const auto& it = table_.find(function_key);
+      if (it != table_.end()) {
+        *handle = it->second;
+        ++mdevice_data_[*handle]->instantiation_counter_;
+        return OkStatus();
+      }
+      // If the same function is being instantiated concurrently, wait for it
+      // and share its handle. If it failed, instantiate it again here. Threads
+      // of the default pool instantiate their own copy instead of waiting.
+      if (pending_multi_device_instantiations_.insert(function_key).second) {
+        owns_pending_instantiation = true;
+        break;
+      }
+      if (on_default_thread_pool) break;
+      multi_device_instantiation_done_.wait(l);
     }
   }
+  auto instantiation_done =
+      gtl::MakeCleanup([this, &function_key, owns_pending_instantiation] {
+        if (!owns_pending_instantiation) return;
+        mutex_lock l(mu_);
+        pending_multi_device_instantiations_.erase(function_key);
+        multi_device_instantiation_done_.notify_all();
+      });
 
   VLOG(1) << "Instantiating MultiDevice function \"" << function_name
           << "\" on default device \"" << options.target << "\"";
@@ -639,12 +687,24 @@ Status ProcessFunctionLibraryRuntime::InstantiateMultiDevice(
   const int num_subgraphs = subgraphs->size();
   gtl::InlinedVector<Status, 4> instantiate_status(num_subgraphs);
   BlockingCounter counter(static_cast<int>(num_subgraphs));
-  auto runner = [this, num_subgraphs](std::function<void()> fn) {
-    // NOTE: Only use thread pool to instantiate sub-function when there are
-    // more than 8 sub-functions. We want to avoid cost of switching thread when
-    // there are only a few sub-functions.
-    if (default_thread_pool_ != nullptr && num_subgraphs > 8) {
-      default_thread_pool_->Schedule(fn);
+  // NOTE: Only use a thread pool to instantiate sub-functions when there are
+  // more than 8 of them, or when they are large enough for converting and
+  // optimizing them and creating their executors to dominate the cost of
+  // switching threads. The calling thread instantiates the last sub-function
+  // itself, and all of them if it belongs to the pool.
+  int64_t num_subgraph_nodes = 0;
+  for (const auto& pair : *subgraphs) {
+    num_subgraph_nodes += pair.second->num_op_nodes();
+  }
+  thread::ThreadPool* instantiation_pool = ComponentInstantiationPool();
+  const bool instantiate_in_parallel =
+      num_subgraphs > 1 && instantiation_pool->CurrentThreadId() == -1 &&
+      (num_subgraphs > 8 ||
+       num_subgraph_nodes >= kMinNodesForParallelInstantiation);
+  auto runner = [num_subgraphs, instantiate_in_parallel, instantiation_pool](
+                    int index, std::function<void()> fn) {
+    if (instantiate_in_parallel && index < num_subgraphs - 1) {
+      instantiation_pool->Schedule(fn);
     } else {
       fn();
     }
@@ -671,8 +731,8 @@ Status ProcessFunctionLibraryRuntime::InstantiateMultiDevice(
     Status* status = &instantiate_status[i];
     string unique_name = name_generator.GetName();
     ComponentFunctionData* comp_data = &data->glue_[pair.first];
-    runner([this, &pair, dev_set, comp_data, unique_name, data_lib_def,
-            &control_ret, &options, status, &counter, &data] {
+    runner(i, [this, &pair, dev_set, comp_data, unique_name, data_lib_def,
+               &control_ret, &options, status, &counter, &data] {
       const string& target = pair.first;
 
       const string& device_type =
@@ -1185,7 +1245,10 @@ Status ProcessFunctionLibraryRuntime::ReleaseMultiDeviceHandle(
       return OkStatus();
     }
     mdata = std::move(it->second);
-    table_.erase(mdata->function_key_);
+    auto table_it = table_.find(mdata->function_key_);
+    if (table_it != table_.end() && table_it->second == handle) {
+      table_.erase(table_it);
+    }
     mdevice_data_.erase(it);
   }
 
@@ -19,6 +19,7 @@ limitations under the License.
 #include <optional>
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 
 #include "absl/types/variant.h"
 #include "tensorflow/core/common_runtime/composite_device.h"
@@ -520,6 +521,14 @@ class ProcessFunctionLibraryRuntime {
   std::unordered_map<string, FunctionLibraryRuntime::Handle> table_
       TF_GUARDED_BY(mu_);
 
+  // Function keys of the multi-device functions being instantiated.
+  // Concurrent instantiations of the same function wait for the first one to
+  // finish and share its handle instead of optimizing the function again,
+  // unless they run on `default_thread_pool_`.
+  std::unordered_set<string> pending_multi_device_instantiations_
+      TF_GUARDED_BY(mu_);
+  condition_variable multi_device_instantiation_done_;
+
   // Function data for instantiated remote functions.
   std::unordered_map<FunctionLibraryRuntime::Handle,
                      std::unique_ptr<FunctionData>>
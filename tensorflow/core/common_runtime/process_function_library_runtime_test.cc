@@ -1122,6 +1122,136 @@ TEST_F(ProcessFunctionLibraryRuntimeTest, MultiDevice_CreateKernelsEagerly) {
   EXPECT_TRUE(errors::IsInternal(status));
 }
 
+TEST_F(ProcessFunctionLibraryRuntimeTest, MultiDevice_ConcurrentInstantiate) {
+  Init({test::function::XTimesTwo()});
+  const FunctionLibraryRuntime::InstantiateOptions inst_opts =
+      MakeOptions("CPU:0", {"CPU:0"}, {"CPU:0"});
+
+  // Concurrent instantiations of the same function share a single handle.
+  const int kNumThreads = 8;
+  std::vector<FunctionLibraryRuntime::Handle> handles(kNumThreads);
+  {
+    thread::ThreadPool tp(Env::Default(), "test", kNumThreads);
+    for (int i = 0; i < kNumThreads; ++i) {
+      tp.Schedule([this, &inst_opts, &handles, i]() {
+        TF_CHECK_OK(Instantiate("XTimesTwo", {{"T", DT_FLOAT}}, inst_opts,
+                                &handles[i]));
+      });
+    }
+  }
+  for (int i = 0; i < kNumThreads; ++i) {
+    EXPECT_EQ(handles[0], handles[i]);
+  }
+
+  // The function stays instantiated until all the instantiations are
+  // released.
+  for (int i = 0; i < kNumThreads - 1; ++i) {
+    TF_EXPECT_OK(proc_flr_->ReleaseHandle(handles[i]));
+  }
+  FunctionLibraryRuntime::Handle handle;
+  TF_CHECK_OK(Instantiate("XTimesTwo", {{"T", DT_FLOAT}}, inst_opts, &handle));
+  EXPECT_EQ(handles[0], handle);
+  TF_EXPECT_OK(proc_flr_->ReleaseHandle(handle));
+  TF_EXPECT_OK(proc_flr_->ReleaseHandle(handles[kNumThreads - 1]));
+  TF_CHECK_OK(Instantiate("XTimesTwo", {{"T", DT_FLOAT}}, inst_opts, &handle));
+  EXPECT_NE(handles[0], handle);
+}
+
+// Instantiating a function with more than 8 components from the only thread
+// of the default pool must not wait for work scheduled on that pool.
+TEST(ProcessFunctionLibraryRuntimeThreadPoolTest,
+     MultiDevice_InstantiateOnSingleThreadPool) {
+  const int kNumDevices = 10;
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = kNumDevices;
+  std::vector<std::unique_ptr<Device>> devices;
+  TF_ASSERT_OK(DeviceFactory::AddDevices(options, "/job:a/replica:0/task:0",
+                                         &devices));
+  StaticDeviceMgr device_mgr(std::move(devices));
+
+  // A chain of identities, one per device.
+  std::vector<FunctionDefHelper::Node> nodes;
+  string input = "x";
+  for (int i = 0; i < kNumDevices; ++i) {
+    const string name = strings::StrCat("y", i);
+    nodes.push_back({{name},
+                     "Identity",
+                     {input},
+                     {{"T", DT_FLOAT}},
+                     {},
+                     strings::StrCat("/device:CPU:", i)});
+    input = strings::StrCat(name, ":output:0");
+  }
+  FunctionDefLibrary proto;
+  *proto.add_function() = FunctionDefHelper::Create(
+      "IdentityChain", {"x: float"}, {"y: float"}, {}, nodes, {{"y", input}});
+  FunctionLibraryDefinition lib_def(OpRegistry::Global(), proto);
+
+  thread::ThreadPool pool(Env::Default(), "test", 1);
+  ProcessFunctionLibraryRuntime proc_flr(
+      &device_mgr, Env::Default(), /*config=*/nullptr, TF_GRAPH_DEF_VERSION,
+      &lib_def, OptimizerOptions(), &pool);
+  const FunctionLibraryRuntime::InstantiateOptions inst_opts =
+      MakeOptions("CPU:0", {"CPU:0"}, {"CPU:0"});
+
+  // Concurrent instantiations on the pool and outside of it.
+  FunctionLibraryRuntime::Handle pool_handle, handle;
+  Status pool_status;
+  Notification done;
+  pool.Schedule([&]() {
+    pool_status = proc_flr.Instantiate("IdentityChain", AttrSlice(), inst_opts,
+                                       &pool_handle);
+    done.Notify();
+  });
+  TF_ASSERT_OK(
+      proc_flr.Instantiate("IdentityChain", AttrSlice(), inst_opts, &handle));
+  done.WaitForNotification();
+  TF_ASSERT_OK(pool_status);
+  TF_EXPECT_OK(proc_flr.ReleaseHandle(pool_handle));
+  TF_EXPECT_OK(proc_flr.ReleaseHandle(handle));
+}
+
+// Few but large components are instantiated in parallel, without a default
+// thread pool.
+TEST(ProcessFunctionLibraryRuntimeThreadPoolTest,
+     MultiDevice_InstantiateLargeComponents) {
+  const int kNumDevices = 2;
+  const int kNodesPerDevice = 200;
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = kNumDevices;
+  std::vector<std::unique_ptr<Device>> devices;
+  TF_ASSERT_OK(DeviceFactory::AddDevices(options, "/job:a/replica:0/task:0",
+                                         &devices));
+  StaticDeviceMgr device_mgr(std::move(devices));
+
+  // A chain of identities on each device in turn.
+  std::vector<FunctionDefHelper::Node> nodes;
+  string input = "x";
+  for (int i = 0; i < kNumDevices * kNodesPerDevice; ++i) {
+    const string name = strings::StrCat("y", i);
+    nodes.push_back({{name},
+                     "Identity",
+                     {input},
+                     {{"T", DT_FLOAT}},
+                     {},
+                     strings::StrCat("/device:CPU:", i / kNodesPerDevice)});
+    input = strings::StrCat(name, ":output:0");
+  }
+  FunctionDefLibrary proto;
+  *proto.add_function() = FunctionDefHelper::Create(
+      "IdentityChain", {"x: float"}, {"y: float"}, {}, nodes, {{"y", input}});
+  FunctionLibraryDefinition lib_def(OpRegistry::Global(), proto);
+
+  ProcessFunctionLibraryRuntime proc_flr(
+      &device_mgr, Env::Default(), /*config=*/nullptr, TF_GRAPH_DEF_VERSION,
+      &lib_def, OptimizerOptions());
+  FunctionLibraryRuntime::Handle handle;
+  TF_ASSERT_OK(proc_flr.Instantiate("IdentityChain", AttrSlice(),
+                                    MakeOptions("CPU:0", {"CPU:0"}, {"CPU:0"}),
+                                    &handle));
+  TF_EXPECT_OK(proc_flr.ReleaseHandle(handle));
+}
+
 TEST_F(ProcessFunctionLibraryRuntimeTest, MultiDevice_StateHandle) {
   auto T = DT_INT32;
   // The expected sequence of outputs from this function is [6, 4, 0, 1, ...].
@@ -140,14 +140,10 @@ LocalRendezvous::~LocalRendezvous() {
   }
 }
 
-namespace {
-uint64 KeyHash(const StringPiece& k) { return Hash64(k.data(), k.size()); }
-}  // namespace
-
 Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
                              const Rendezvous::Args& send_args,
                              const Tensor& val, const bool is_dead) {
-  uint64 key_hash = KeyHash(key.FullKey());
+  uint64 key_hash = key.FullKeyHash();
   DVLOG(2) << "Send " << this << " " << key_hash << " " << key.FullKey();
 
   if (is_dead) {
@@ -226,7 +222,7 @@ Status LocalRendezvous::Send(const Rendezvous::ParsedKey& key,
 void LocalRendezvous::RecvAsync(const Rendezvous::ParsedKey& key,
                                 const Rendezvous::Args& recv_args,
                                 Rendezvous::DoneCallback done) {
-  uint64 key_hash = KeyHash(key.FullKey());
+  uint64 key_hash = key.FullKeyHash();
   DVLOG(2) << "Recv " << this << " " << key_hash << " " << key.FullKey();
   tsl::core::RefCountPtr<Rendezvous> rc_keep_alive;
 
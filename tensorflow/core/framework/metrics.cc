@@ -52,6 +52,18 @@ auto* graph_pending_queue_length_histogram = tsl::monitoring::Sampler<0>::New(
     // Power of 1.5 with bucket count 30 (> 191k)
     {tsl::monitoring::Buckets::Exponential(1, 1.5, 30)});
 
+auto* checkpoint_restore_shard_read_bandwidth =
+    tsl::monitoring::Sampler<0>::New(
+        {"/tensorflow/core/checkpoint/restore_shard_read_bandwidth",
+         "The read bandwidth of each checkpoint data file during restore, in "
+         "megabytes per second."},
+        // Power of 2 with bucket count 20 (> 512GB/s)
+        {tsl::monitoring::Buckets::Exponential(1, 2, 20)});
+
+auto* checkpoint_lazy_restore_usage = tsl::monitoring::Gauge<int64_t, 1>::New(
+    "/tensorflow/core/checkpoint/lazy_restore_usage",
+    "Usage of the tensors lazily restored from checkpoints.", "name");
+
 auto* graph_run_input_tensor_bytes = tsl::monitoring::Sampler<0>::New(
     {"/tensorflow/core/graph_run_input_tensor_bytes",
      "The size of input tensors in bytes."},
@@ -421,12 +433,25 @@ tsl::monitoring::Counter<2>* GetGraphOptimizationCounter() {
   return graph_optimization_counter;
 }
 
+void IncrementGraphOptimizationPassCount(const string& kind, const string& name,
+                                         const string& result) {
+  static auto* graph_optimization_pass_count =
+      tsl::monitoring::Counter<3>::New(
+          "/tensorflow/core/graph_optimization_pass_count",
+          "The number of times each graph optimization pass changed the "
+          "graph, left it unchanged or was skipped.",
+          "kind", "name", "result");
+  graph_optimization_pass_count->GetCell(kind, name, result)->IncrementBy(1);
+}
+
 std::string GraphOptimizationSourceMapping(GraphOptimizationSource source) {
   switch (source) {
     case GraphOptimizationSource::kJit:
       return "jit";
     case GraphOptimizationSource::kAot:
       return "aot";
+    case GraphOptimizationSource::kSession:
+      return "session";
     case GraphOptimizationSource::kUnknown:
       return "unknown";
     default:
@@ -712,6 +737,30 @@ void UpdateGraphPendingQueueLength(uint64 len) {
   graph_pending_queue_length_cell->Add(len);
 }
 
+void RecordCheckpointRestoreShardReadBandwidth(double megabytes_per_second) {
+  static auto* checkpoint_restore_shard_read_bandwidth_cell =
+      checkpoint_restore_shard_read_bandwidth->GetCell();
+  checkpoint_restore_shard_read_bandwidth_cell->Add(megabytes_per_second);
+}
+
+void RecordCheckpointLazyRestoreUsage(int64_t mapped_bytes,
+                                      int64_t resident_bytes,
+                                      int64_t num_tensors,
+                                      int64_t num_touched_tensors) {
+  static auto* mapped_bytes_cell =
+      checkpoint_lazy_restore_usage->GetCell("mapped_bytes");
+  static auto* resident_bytes_cell =
+      checkpoint_lazy_restore_usage->GetCell("resident_bytes");
+  static auto* num_tensors_cell =
+      checkpoint_lazy_restore_usage->GetCell("num_tensors");
+  static auto* num_touched_tensors_cell =
+      checkpoint_lazy_restore_usage->GetCell("num_touched_tensors");
+  mapped_bytes_cell->Set(mapped_bytes);
+  resident_bytes_cell->Set(resident_bytes);
+  num_tensors_cell->Set(num_tensors);
+  num_touched_tensors_cell->Set(num_touched_tensors);
+}
+
 void UpdateGraphBuildTime(const uint64 running_time_usecs) {
   if (running_time_usecs > 0) {
     static auto* build_graph_calls_cell = build_graph_calls->GetCell();
@@ -33,6 +33,7 @@ enum class GraphOptimizationSource {
   kUnknown,
   kJit,
   kAot,
+  kSession,
 };
 
 // Records when a data-fetching tf.data operation is executed.
@@ -240,6 +241,19 @@ void RecordTPUXlaSpmdCoresPerReplica(int64_t cores_per_replica);
 void UpdateGraphExecTime(const uint64 running_time_usecs);
 void UpdateGraphPendingQueueLength(uint64 len);
 
+// Records the read bandwidth, in megabytes per second, observed for one data
+// file of a checkpoint while restoring it.
+void RecordCheckpointRestoreShardReadBandwidth(double megabytes_per_second);
+
+// Records the usage of the tensors lazily restored from checkpoints: how many
+// bytes and tensors are mapped, and how many of them were touched (paged in)
+// so far. Checkpoints are not told apart, to keep the cardinality of the
+// metric bounded.
+void RecordCheckpointLazyRestoreUsage(int64_t mapped_bytes,
+                                      int64_t resident_bytes,
+                                      int64_t num_tensors,
+                                      int64_t num_touched_tensors);
+
 // Records that one output of an op of type `op_name` was unused.
 void RecordUnusedOutput(const string& op_name);
 
@@ -453,6 +467,13 @@ class ScopedCounter final {
 // passes.
 monitoring::Counter<2>* GetGraphOptimizationCounter();
 
+// Increments the number of times the graph optimization pass `name` of kind
+// `kind` changed the graph (`result` is "changed"), ran without changing it
+// ("unchanged"), or was skipped because it already ran on the same graph
+// without changing it ("skipped").
+void IncrementGraphOptimizationPassCount(const string& kind, const string& name,
+                                         const string& result);
+
 // Updates metrics for time to distribute variables to all TPU hosts.
 void UpdateTpuVariableDistributionTime(const uint64 distribution_time_usecs);
 
@@ -20,6 +20,7 @@ limitations under the License.
 #include <mutex>  // NOLINT
 #include <string>
 #include <unordered_map>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -757,6 +758,189 @@ Status OpKernelContext::allocate_output(StringPiece name,
   return allocate_output(start, shape, tensor, attr);
 }
 
+namespace {
+
+// A block of host memory that scratch tensors are carved out of, allocated
+// from the device allocator so that it shows in the allocator's accounting
+// and stats. Every live ScratchBuffer holds a reference on its chunk, and the
+// owning ScratchArena holds one more, so a chunk with a single reference has
+// no live allocations and may be rewound or released.
+class ScratchChunk : public core::RefCounted {
+ public:
+  ScratchChunk(Allocator* allocator, size_t size)
+      : allocator_(allocator),
+        base_(static_cast<char*>(
+            allocator->AllocateRaw(Allocator::kAllocatorAlignment, size))),
+        size_(size) {}
+  ~ScratchChunk() override {
+    if (base_ != nullptr) allocator_->DeallocateRaw(base_);
+  }
+
+  Allocator* allocator() const { return allocator_; }
+
+  // Returns nullptr if "num_bytes" does not fit in the rest of the chunk.
+  // Requires the lock of the owning arena.
+  void* Allocate(size_t num_bytes) {
+    if (base_ == nullptr || num_bytes > size_ - offset_) return nullptr;
+    void* ptr = base_ + offset_;
+    offset_ += num_bytes;
+    return ptr;
+  }
+
+  // Rewinds the bump pointer if no allocations from this chunk are live.
+  // Only the owning arena adds references, under its lock, so the check
+  // cannot race with a new allocation.
+  void MaybeReset() {
+    if (RefCountIsOne()) offset_ = 0;
+  }
+
+ private:
+  Allocator* const allocator_;
+  char* const base_;
+  const size_t size_;
+  size_t offset_ = 0;
+};
+
+class ScratchBuffer : public TensorBuffer {
+ public:
+  ScratchBuffer(ScratchChunk* chunk, void* data, size_t size)
+      : TensorBuffer(data), chunk_(chunk), size_(size) {
+    chunk_->Ref();
+  }
+  ~ScratchBuffer() override { chunk_->Unref(); }
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocated_bytes(size_);
+    proto->set_allocator_name("op_scratch_arena");
+    proto->set_ptr(reinterpret_cast<uintptr_t>(data()));
+  }
+  AllocatorMemoryType GetMemoryType() const override {
+    return AllocatorMemoryType::kHostPageable;
+  }
+
+ private:
+  ScratchChunk* const chunk_;
+  const size_t size_;
+};
+
+// Per-thread bump-pointer arena serving allocate_temp() requests that set
+// AllocatorAttributes::scratch(). Kernels release their temporaries when
+// Compute() returns, so the chunks are normally empty again by the time the
+// next kernel on this thread allocates, and the arena is reused across
+// invocations without an allocator call per temporary. A scratch tensor that
+// escapes (e.g. via set_output) keeps its chunk pinned and alive, even past
+// the exit of the owning thread, so misuse costs memory but never
+// correctness.
+//
+// The chunks are returned to their allocator when the thread exits, or by
+// ReleaseScratchMemory() once they hold no live tensors.
+class ScratchArena {
+ public:
+  static constexpr size_t kChunkBytes = 1 << 20;
+  static constexpr size_t kMaxChunks = 4;
+
+  ScratchArena() {
+    mutex_lock l(*RegistryMu());
+    Registry()->insert(this);
+  }
+
+  ~ScratchArena() {
+    {
+      mutex_lock l(*RegistryMu());
+      Registry()->erase(this);
+    }
+    for (ScratchChunk* chunk : chunks_) chunk->Unref();
+  }
+
+  static ScratchArena* ForCurrentThread() {
+    static thread_local ScratchArena arena;
+    return &arena;
+  }
+
+  // Returns nullptr if the request cannot be served from the arena, in which
+  // case the caller should fall back to "allocator".
+  TensorBuffer* Allocate(Allocator* allocator, size_t num_bytes) {
+    const size_t rounded = (num_bytes + Allocator::kAllocatorAlignment - 1) &
+                           ~(Allocator::kAllocatorAlignment - 1);
+    if (rounded == 0 || rounded > kChunkBytes) return nullptr;
+    mutex_lock l(mu_);
+    for (ScratchChunk* chunk : chunks_) {
+      if (chunk->allocator() != allocator) continue;
+      chunk->MaybeReset();
+      if (void* ptr = chunk->Allocate(rounded)) {
+        return new ScratchBuffer(chunk, ptr, num_bytes);
+      }
+    }
+    if (chunks_.size() >= kMaxChunks) return nullptr;
+    auto* chunk = new ScratchChunk(allocator, kChunkBytes);
+    void* ptr = chunk->Allocate(rounded);
+    if (ptr == nullptr) {
+      chunk->Unref();
+      return nullptr;
+    }
+    chunks_.push_back(chunk);
+    return new ScratchBuffer(chunk, ptr, num_bytes);
+  }
+
+  // Returns the chunks that hold no live tensors to their allocator.
+  void ReleaseUnused() {
+    mutex_lock l(mu_);
+    auto it = chunks_.begin();
+    while (it != chunks_.end()) {
+      if ((*it)->RefCountIsOne()) {
+        (*it)->Unref();
+        it = chunks_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  // Calls ReleaseUnused() on the arena of every thread.
+  static void ReleaseAllUnused() {
+    mutex_lock l(*RegistryMu());
+    for (ScratchArena* arena : *Registry()) arena->ReleaseUnused();
+  }
+
+ private:
+  static mutex* RegistryMu() {
+    static mutex* mu = new mutex;
+    return mu;
+  }
+  static std::unordered_set<ScratchArena*>* Registry() {
+    static auto* registry = new std::unordered_set<ScratchArena*>;
+    return registry;
+  }
+
+  // Only contended by ReleaseUnused().
+  mutex mu_;
+  gtl::InlinedVector<ScratchChunk*, kMaxChunks> chunks_ TF_GUARDED_BY(mu_);
+};
+
+// Tries to allocate "out_tensor" from the calling thread's scratch arena.
+// Only plain-old-data tensors destined for pageable host memory qualify.
+bool AllocateScratchTensor(Allocator* device_allocator, DataType type,
+                           const TensorShape& shape, Tensor* out_tensor) {
+  if (!DataTypeCanUseMemcpy(type) ||
+      device_allocator->GetMemoryType() !=
+          AllocatorMemoryType::kHostPageable) {
+    return false;
+  }
+  TensorBuffer* buf = ScratchArena::ForCurrentThread()->Allocate(
+      device_allocator, shape.num_elements() * DataTypeSize(type));
+  if (buf == nullptr) return false;
+  *out_tensor = Tensor(type, shape, buf);
+  buf->Unref();
+  return true;
+}
+
+}  // namespace
+
+void ReleaseScratchMemory() { ScratchArena::ReleaseAllUnused(); }
+
 Status OpKernelContext::allocate_tensor(
     DataType type, const TensorShape& shape, Tensor* out_tensor,
     AllocatorAttributes attr, const AllocationAttributes& allocation_attr) {
@@ -849,8 +1033,16 @@ Status OpKernelContext::allocate_temp(
   profiler::ScopedMemoryDebugAnnotation op_annotation(
       op_kernel().name_view().data(), step_id(), "temp", type,
       [&shape]() { return shape.DebugString(); });
-  Status s =
-      allocate_tensor(type, shape, out_temp, allocator_attr, allocation_attr);
+  // Scratch requests bypass the device allocator, so they are not eligible
+  // when allocations are being tracked or logged.
+  Status s;
+  if (!allocator_attr.scratch() || track_allocations() ||
+      params_->log_memory ||
+      !AllocateScratchTensor(get_allocator(allocator_attr), type, shape,
+                             out_temp)) {
+    s = allocate_tensor(type, shape, out_temp, allocator_attr,
+                        allocation_attr);
+  }
   if (track_allocations() && s.ok() && out_temp->TotalBytes() > 0) {
     Allocator* a = get_allocator(allocator_attr);
     if (a->TracksAllocationSizes()) {
@@ -1005,6 +1005,14 @@ class OpKernelContext {
   // shape. Devices such as GPUs that enqueue Ops for lazy execution
   // may retain references to the temporary tensors after the Op's
   // Compute method has run. See comment above.
+  //
+  // If allocator_attr.scratch() is set and the tensor would live in
+  // pageable host memory, it is carved out of a per-thread arena that
+  // is reused by every kernel invocation on the calling thread, which
+  // avoids an allocator call per temporary. The arena takes its memory
+  // from the device allocator in large chunks, which count in its stats
+  // until ReleaseScratchMemory() is called. Such tensors should be
+  // released before Compute returns.
   Status allocate_temp(DataType type, const TensorShape& shape,
                        Tensor* out_temp, AllocatorAttributes allocator_attr,
                        const AllocationAttributes& allocation_attr);
@@ -1509,6 +1517,11 @@ Status FindKernelDef(
 Status FindKernelDef(const DeviceType& device_type, const NodeDef& node_def,
                      const KernelDef** def, std::string* kernel_class_name);
 
+// Returns the memory of the scratch arenas of all threads (see
+// OpKernelContext::allocate_temp) that holds no live tensors to the
+// allocators it came from. Sessions call it when they are closed.
+void ReleaseScratchMemory();
+
 // Writes a list of all registered kernels to LOG(INFO), to help users debug
 // missing kernel errors.
 void LogAllRegisteredKernels();
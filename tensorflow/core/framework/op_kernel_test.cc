@@ -16,17 +16,20 @@ limitations under the License.
 #include "tensorflow/core/framework/op_kernel.h"
 
 #include <memory>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
 #include "absl/strings/str_cat.h"
 #include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/attr_value.pb.h"
 #include "tensorflow/core/framework/attr_value_util.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/op.h"
 #include "tensorflow/core/framework/op_kernel_test_base.h"
+#include "tensorflow/core/framework/tensor_description.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/tensor_util.h"
 #include "tensorflow/core/framework/types.pb.h"
@@ -36,6 +39,7 @@ limitations under the License.
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/protobuf.h"
 #include "tensorflow/core/platform/status_matchers.h"
 #include "tensorflow/core/platform/test.h"
@@ -618,6 +622,146 @@ TEST_F(OpKernelTest, ScopedAllocationTest) {
   EXPECT_EQ(sa_device->num_allocations(true), 1);
 }
 
+string AllocatorNameOf(const Tensor& t) {
+  TensorDescription description;
+  t.FillDescription(&description);
+  return description.allocation_description().allocator_name();
+}
+
+TEST_F(OpKernelTest, ScratchAllocateTemp) {
+  Env* env = Env::Default();
+  OpKernelContext::Params params;
+  DummyDevice device(env);
+  params.device = &device;
+  Status status;
+  std::unique_ptr<OpKernel> op(CreateOpKernel(
+      DEVICE_CPU, params.device, cpu_allocator(),
+      CreateNodeDef("Test4", {DT_FLOAT}), TF_GRAPH_DEF_VERSION, &status));
+  TF_ASSERT_OK(status);
+  params.op_kernel = op.get();
+  AllocatorAttributes scratch_attr;
+  scratch_attr.set_scratch(true);
+
+  const void* first_ptr = nullptr;
+  Tensor escaped;
+  {
+    auto ctx = std::make_unique<OpKernelContext>(&params);
+    Tensor t1, t2;
+    TF_ASSERT_OK(ctx->allocate_temp(DT_FLOAT, TensorShape({16}), &t1,
+                                    scratch_attr));
+    TF_ASSERT_OK(ctx->allocate_temp(DT_INT32, TensorShape({3}), &t2,
+                                    scratch_attr));
+    EXPECT_EQ(AllocatorNameOf(t1), "op_scratch_arena");
+    EXPECT_EQ(AllocatorNameOf(t2), "op_scratch_arena");
+    EXPECT_NE(t1.data(), t2.data());
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(t2.data()) %
+                  Allocator::kAllocatorAlignment,
+              0);
+    first_ptr = t1.data();
+
+    // Non-POD types always go to the device allocator.
+    Tensor str;
+    TF_ASSERT_OK(ctx->allocate_temp(DT_STRING, TensorShape({2}), &str,
+                                    scratch_attr));
+    EXPECT_NE(AllocatorNameOf(str), "op_scratch_arena");
+  }
+  {
+    // All scratch tensors from the previous invocation are gone, so the arena
+    // is rewound and hands out the same memory again.
+    auto ctx = std::make_unique<OpKernelContext>(&params);
+    TF_ASSERT_OK(ctx->allocate_temp(DT_FLOAT, TensorShape({16}), &escaped,
+                                    scratch_attr));
+    EXPECT_EQ(escaped.data(), first_ptr);
+  }
+  {
+    // A scratch tensor that outlives its kernel must not be overwritten.
+    auto ctx = std::make_unique<OpKernelContext>(&params);
+    Tensor t;
+    TF_ASSERT_OK(
+        ctx->allocate_temp(DT_FLOAT, TensorShape({16}), &t, scratch_attr));
+    EXPECT_NE(t.data(), escaped.data());
+    EXPECT_EQ(AllocatorNameOf(t), "op_scratch_arena");
+  }
+}
+
+// Counts the bytes allocated through it from the CPU allocator.
+class CountingAllocator : public Allocator {
+ public:
+  string Name() override { return "counting"; }
+  void* AllocateRaw(size_t alignment, size_t num_bytes) override {
+    void* ptr = cpu_allocator()->AllocateRaw(alignment, num_bytes);
+    mutex_lock l(mu_);
+    sizes_[ptr] = num_bytes;
+    bytes_in_use_ += num_bytes;
+    return ptr;
+  }
+  void DeallocateRaw(void* ptr) override {
+    {
+      mutex_lock l(mu_);
+      bytes_in_use_ -= sizes_[ptr];
+      sizes_.erase(ptr);
+    }
+    cpu_allocator()->DeallocateRaw(ptr);
+  }
+  AllocatorMemoryType GetMemoryType() const override {
+    return AllocatorMemoryType::kHostPageable;
+  }
+  int64_t bytes_in_use() {
+    mutex_lock l(mu_);
+    return bytes_in_use_;
+  }
+
+ private:
+  mutex mu_;
+  std::unordered_map<void*, size_t> sizes_ TF_GUARDED_BY(mu_);
+  int64_t bytes_in_use_ TF_GUARDED_BY(mu_) = 0;
+};
+
+class CountingDevice : public DeviceBase {
+ public:
+  explicit CountingDevice(Env* env) : DeviceBase(env) {}
+  Allocator* GetAllocator(AllocatorAttributes /*attr*/) override {
+    return &allocator_;
+  }
+  CountingAllocator allocator_;
+};
+
+TEST_F(OpKernelTest, ScratchMemoryIsAccountedAndReleased) {
+  Env* env = Env::Default();
+  OpKernelContext::Params params;
+  CountingDevice device(env);
+  params.device = &device;
+  Status status;
+  std::unique_ptr<OpKernel> op(CreateOpKernel(
+      DEVICE_CPU, params.device, cpu_allocator(),
+      CreateNodeDef("Test4", {DT_FLOAT}), TF_GRAPH_DEF_VERSION, &status));
+  TF_ASSERT_OK(status);
+  params.op_kernel = op.get();
+  AllocatorAttributes scratch_attr;
+  scratch_attr.set_scratch(true);
+
+  Tensor escaped;
+  {
+    auto ctx = std::make_unique<OpKernelContext>(&params);
+    Tensor t;
+    TF_ASSERT_OK(
+        ctx->allocate_temp(DT_FLOAT, TensorShape({16}), &t, scratch_attr));
+    EXPECT_EQ(AllocatorNameOf(t), "op_scratch_arena");
+    TF_ASSERT_OK(ctx->allocate_temp(DT_FLOAT, TensorShape({16}), &escaped,
+                                    scratch_attr));
+  }
+  // The arena takes its memory from the device allocator.
+  const int64_t chunk_bytes = device.allocator_.bytes_in_use();
+  EXPECT_GT(chunk_bytes, 0);
+
+  // A chunk holding a live tensor is kept.
+  ReleaseScratchMemory();
+  EXPECT_EQ(device.allocator_.bytes_in_use(), chunk_bytes);
+  escaped = Tensor();
+  ReleaseScratchMemory();
+  EXPECT_EQ(device.allocator_.bytes_in_use(), 0);
+}
+
 TEST_F(OpKernelTest, TraceString) {
   Env* env = Env::Default();
   OpKernelContext::Params params;
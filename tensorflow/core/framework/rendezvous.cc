@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/core/lib/gtl/manual_constructor.h"
 #include "tensorflow/core/lib/hash/hash.h"
 #include "tensorflow/core/lib/strings/str_util.h"
+#include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/core/platform/macros.h"
 #include "tensorflow/core/platform/mutex.h"
@@ -47,6 +48,7 @@ Rendezvous::ParsedKey& Rendezvous::ParsedKey::operator=(const ParsedKey& b) {
   dst = b.dst;
   edge_name = StringPiece(buf_.data() + (b.edge_name.data() - b_base),
                           b.edge_name.size());
+  full_key_hash_ = b.full_key_hash_;
   return *this;
 }
 
@@ -109,11 +111,37 @@ Status Rendezvous::ParseKey(StringPiece key, ParsedKey* out) {
     out->src_device = StringPiece(parts[0].data(), parts[0].size());
     out->dst_device = StringPiece(parts[2].data(), parts[2].size());
     out->edge_name = StringPiece(parts[3].data(), parts[3].size());
+    out->full_key_hash_ = Hash64(out->buf_.data(), out->buf_.size());
     return OkStatus();
   }
   return errors::InvalidArgument("Invalid  rendezvous key: ", key);
 }
 
+/* static */
+void Rendezvous::ParseKeyForFrameAndIter(const ParsedKey& key,
+                                         const FrameAndIter& frame_iter,
+                                         ParsedKey* out) {
+  // Everything up to the end of the edge name is shared with `key`; only the
+  // trailing "frame_id:iter_id" part differs.
+  const char* base = key.buf_.data();
+  const size_t prefix_size =
+      key.edge_name.data() + key.edge_name.size() - base;
+  out->buf_.assign(base, prefix_size);
+  strings::StrAppend(&out->buf_, ";", frame_iter.frame_id, ":",
+                     frame_iter.iter_id);
+  const char* out_base = out->buf_.data();
+  out->src_device = StringPiece(out_base + (key.src_device.data() - base),
+                                key.src_device.size());
+  out->src = key.src;
+  out->src_incarnation = key.src_incarnation;
+  out->dst_device = StringPiece(out_base + (key.dst_device.data() - base),
+                                key.dst_device.size());
+  out->dst = key.dst;
+  out->edge_name = StringPiece(out_base + (key.edge_name.data() - base),
+                               key.edge_name.size());
+  out->full_key_hash_ = Hash64(out->buf_.data(), out->buf_.size());
+}
+
 RendezvousInterface::~RendezvousInterface() {}
 
 Status RendezvousInterface::Recv(const ParsedKey& key, const Args& recv_args,
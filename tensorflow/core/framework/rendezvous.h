@@ -71,11 +71,16 @@ class RendezvousInterface {
     ParsedKey& operator=(const ParsedKey& b);
     StringPiece FullKey() const { return buf_; }
 
+    // Hash of FullKey(), computed once when the key is parsed so that
+    // rendezvous implementations do not rehash the key on every Send/Recv.
+    uint64 FullKeyHash() const { return full_key_hash_; }
+
    private:
     friend class Rendezvous;
     friend class SendOp;
     friend class RecvOp;
     std::string buf_;
+    uint64 full_key_hash_ = 0;
   };
 
   // The caller is a tensor producer and it sends a message (a tensor
@@ -164,6 +169,14 @@ class Rendezvous : public RendezvousInterface, public core::WeakRefCounted {
                                const FrameAndIter& frame_iter);
 
   static Status ParseKey(StringPiece key, ParsedKey* out);
+
+  // Sets "*out" to the parsed form of "key" with its frame and iteration
+  // replaced by "frame_iter". This is equivalent to, but cheaper than, calling
+  // CreateKey and ParseKey again, since the device names in "key" are not
+  // re-parsed.
+  static void ParseKeyForFrameAndIter(const ParsedKey& key,
+                                      const FrameAndIter& frame_iter,
+                                      ParsedKey* out);
 };
 
 // Returns a Rendezvous instance that is limited to use only by
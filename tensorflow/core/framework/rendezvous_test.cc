@@ -66,6 +66,32 @@ TEST(RendezvousTest, Key) {
       Rendezvous::ParseKey(strings::StrCat(key, ";", key), &parsed).ok());
 }
 
+TEST(RendezvousTest, ParseKeyForFrameAndIter) {
+  const string key = Rendezvous::CreateKey(
+      "/job:mnist/replica:1/task:2/CPU:0", 7890,
+      "/job:mnist/replica:1/task:2/device:GPU:0", "var0", FrameAndIter(0, 0));
+  Rendezvous::ParsedKey parsed;
+  TF_ASSERT_OK(Rendezvous::ParseKey(key, &parsed));
+
+  const string loop_key = Rendezvous::CreateKey(
+      "/job:mnist/replica:1/task:2/CPU:0", 7890,
+      "/job:mnist/replica:1/task:2/device:GPU:0", "var0", FrameAndIter(3, 12));
+  Rendezvous::ParsedKey expected;
+  TF_ASSERT_OK(Rendezvous::ParseKey(loop_key, &expected));
+
+  Rendezvous::ParsedKey derived;
+  Rendezvous::ParseKeyForFrameAndIter(parsed, FrameAndIter(3, 12), &derived);
+  EXPECT_EQ(derived.FullKey(), expected.FullKey());
+  EXPECT_EQ(derived.FullKeyHash(), expected.FullKeyHash());
+  EXPECT_NE(derived.FullKeyHash(), parsed.FullKeyHash());
+  EXPECT_EQ(derived.src_device, expected.src_device);
+  EXPECT_EQ(derived.src_incarnation, expected.src_incarnation);
+  EXPECT_EQ(derived.src.type, "CPU");
+  EXPECT_EQ(derived.dst_device, expected.dst_device);
+  EXPECT_EQ(derived.dst.type, "GPU");
+  EXPECT_EQ(derived.edge_name, "var0");
+}
+
 class LocalRendezvousTest : public ::testing::Test {
  public:
   LocalRendezvousTest() : threads_(Env::Default(), "test", 16) {
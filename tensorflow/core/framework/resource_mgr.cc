@@ -77,6 +77,7 @@ Status ValidateDevice(OpKernelContext* ctx, const ResourceHandle& p) {
 
 Status ResourceMgr::InsertDebugTypeName(uint64 hash_code,
                                         const string& type_name) {
+  mutex_lock l(debug_type_names_mu_);
   auto iter = debug_type_names_.emplace(hash_code, type_name);
   if (iter.first->second != type_name) {
     return errors::AlreadyExists("Duplicate hash code found for type ",
@@ -138,53 +139,71 @@ ResourceMgr::~ResourceMgr() { Clear(); }
 void ResourceMgr::Clear() {
   // We do the deallocation outside of the lock to avoid a potential deadlock
   // in case any of the destructors access the resource manager.
-  absl::flat_hash_map<string, Container*> tmp_containers;
-  {
-    mutex_lock l(mu_);
-    tmp_containers = std::move(containers_);
-    containers_.clear();  // reinitialize after move.
-  }
-  for (const auto& p : tmp_containers) {
-    delete p.second;
+  for (Shard& shard : shards_) {
+    absl::flat_hash_map<string, Container*> tmp_containers;
+    {
+      mutex_lock l(shard.mu);
+      tmp_containers = std::move(shard.containers);
+      shard.containers.clear();  // reinitialize after move.
+    }
+    for (const auto& p : tmp_containers) {
+      delete p.second;
+    }
   }
 }
 
 string ResourceMgr::DebugString() const {
-  mutex_lock l(mu_);
-  struct Line {
-    const string* container;
-    const string type;
-    const string* resource;
-    const string detail;
-  };
-  std::vector<Line> lines;
-  for (const auto& p : containers_) {
-    const string& container = p.first;
-    for (const auto& q : *p.second) {
-      const Key& key = q.first;
-      const char* type = DebugTypeName(key.first);
-      const core::RefCountPtr<ResourceBase> resource = q.second.GetResource();
-      Line l{&container, port::Demangle(type), q.second.name.get(),
-             resource ? resource->DebugString() : "<nullptr>"};
-      lines.push_back(l);
-    }
-  }
   std::vector<string> text;
-  text.reserve(lines.size());
-  for (const Line& line : lines) {
-    text.push_back(strings::Printf(
-        "%-20s | %-40s | %-40s | %-s", line.container->c_str(),
-        line.type.c_str(), line.resource->c_str(), line.detail.c_str()));
+  for (const Shard& shard : shards_) {
+    mutex_lock l(shard.mu);
+    mutex_lock dl(debug_type_names_mu_);
+    for (const auto& p : shard.containers) {
+      const string& container = p.first;
+      for (const auto& q : *p.second) {
+        const Key& key = q.first;
+        const char* type = DebugTypeName(key.first);
+        const core::RefCountPtr<ResourceBase> resource =
+            q.second.GetResource();
+        text.push_back(strings::Printf(
+            "%-20s | %-40s | %-40s | %-s", container.c_str(),
+            port::Demangle(type).c_str(), q.second.name->c_str(),
+            resource ? resource->DebugString().c_str() : "<nullptr>"));
+      }
+    }
   }
   std::sort(text.begin(), text.end());
   return absl::StrJoin(text, "\n");
 }
 
-Status ResourceMgr::DoCreate(const string& container_name, TypeIndex type,
-                             const string& name, ResourceBase* resource,
-                             bool owns_resource) {
-  Container* container = [&]() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) {
-    Container** ptr = &containers_[container_name];
+bool ResourceMgr::ContainerExistsInOtherShards(const string& container,
+                                               const Shard& except) const {
+  for (const Shard& shard : shards_) {
+    if (&shard == &except) continue;
+    tf_shared_lock l(shard.mu);
+    if (shard.containers.contains(container)) return true;
+  }
+  return false;
+}
+
+Status ResourceMgr::RefineLookupError(Status s,
+                                      bool container_missing_in_shard,
+                                      const Shard& shard,
+                                      const string& container,
+                                      const string& resource_name,
+                                      const string& type_name) const {
+  if (container_missing_in_shard && errors::IsNotFound(s) &&
+      ContainerExistsInOtherShards(container, shard)) {
+    return errors::NotFound("Resource ", container, "/", resource_name, "/",
+                            type_name, " does not exist.");
+  }
+  return s;
+}
+
+Status ResourceMgr::DoCreate(Shard& shard, const string& container_name,
+                             TypeIndex type, const string& name,
+                             ResourceBase* resource, bool owns_resource) {
+  Container* container = [&]() TF_EXCLUSIVE_LOCKS_REQUIRED(shard.mu) {
+    Container** ptr = &shard.containers[container_name];
     if (*ptr == nullptr) {
       *ptr = new Container;
     }
@@ -200,8 +219,8 @@ Status ResourceMgr::DoCreate(const string& container_name, TypeIndex type,
   if (owns_resource) {
     resource_and_name.resource = core::RefCountPtr<ResourceBase>(resource);
   } else {
-    auto cleanup_fn = [this, container, type, borrowed_name]() {
-      mutex_lock l(mu_);
+    auto cleanup_fn = [&shard, container, type, borrowed_name]() {
+      mutex_lock l(shard.mu);
       auto iter = container->find({type.hash_code(), borrowed_name});
       if (iter != container->end()) {
         container->erase(iter);
@@ -225,22 +244,34 @@ Status ResourceMgr::DoCreate(const string& container_name, TypeIndex type,
 
 Status ResourceMgr::Lookup(const ResourceHandle& handle,
                            ResourceBase** resource) const {
-  tf_shared_lock l(mu_);
-  return DoLookup(handle.container(), handle.hash_code(),
-                  /*type_name=*/"ResourceBase", handle.name(), resource);
+  const Shard& shard = ShardFor(handle.name());
+  Status s;
+  bool container_missing_in_shard;
+  {
+    tf_shared_lock l(shard.mu);
+    s = DoLookup(shard, handle.container(), handle.hash_code(),
+                 /*type_name=*/"ResourceBase", handle.name(), resource);
+    if (s.ok()) return s;
+    container_missing_in_shard =
+        !shard.containers.contains(handle.container());
+  }
+  return RefineLookupError(std::move(s), container_missing_in_shard, shard,
+                           handle.container(), handle.name(),
+                           /*type_name=*/"ResourceBase");
 }
 
-Status ResourceMgr::DoLookup(const string& container, TypeIndex type,
-                             const string& name,
+Status ResourceMgr::DoLookup(const Shard& shard, const string& container,
+                             TypeIndex type, const string& name,
                              ResourceBase** resource) const {
-  return DoLookup(container, type.hash_code(), type.name(), name, resource);
+  return DoLookup(shard, container, type.hash_code(), type.name(), name,
+                  resource);
 }
 
-Status ResourceMgr::DoLookup(const string& container, uint64 type_hash_code,
-                             const string& type_name,
+Status ResourceMgr::DoLookup(const Shard& shard, const string& container,
+                             uint64 type_hash_code, const string& type_name,
                              const string& resource_name,
                              ResourceBase** resource) const {
-  const Container* b = gtl::FindPtrOrNull(containers_, container);
+  const Container* b = gtl::FindPtrOrNull(shard.containers, container);
   if (b == nullptr) {
     return errors::NotFound("Container ", container,
                             " does not exist. (Could not find resource: ",
@@ -265,19 +296,29 @@ Status ResourceMgr::PopResourceAndName(const string& container,
                                        const string& resource_name,
                                        const string& type_name,
                                        ResourceAndName& resource_and_name) {
-  mutex_lock l(mu_);
-  Container* b = gtl::FindPtrOrNull(containers_, container);
-  if (b == nullptr) {
-    return errors::NotFound("Container ", container, " does not exist.");
-  }
-  auto iter = b->find({type_hash_code, resource_name});
-  if (iter == b->end()) {
-    return errors::NotFound("Resource ", container, "/", resource_name, "/",
-                            type_name, " does not exist.");
+  Shard& shard = ShardFor(resource_name);
+  Status s;
+  bool container_missing_in_shard = false;
+  {
+    mutex_lock l(shard.mu);
+    Container* b = gtl::FindPtrOrNull(shard.containers, container);
+    if (b == nullptr) {
+      container_missing_in_shard = true;
+      s = errors::NotFound("Container ", container, " does not exist.");
+    } else {
+      auto iter = b->find({type_hash_code, resource_name});
+      if (iter == b->end()) {
+        s = errors::NotFound("Resource ", container, "/", resource_name, "/",
+                             type_name, " does not exist.");
+      } else {
+        std::swap(resource_and_name, iter->second);
+        b->erase(iter);
+        return OkStatus();
+      }
+    }
   }
-  std::swap(resource_and_name, iter->second);
-  b->erase(iter);
-  return OkStatus();
+  return RefineLookupError(std::move(s), container_missing_in_shard, shard,
+                           container, resource_name, type_name);
 }
 
 Status ResourceMgr::DoDelete(const string& container, uint64 type_hash_code,
@@ -309,26 +350,30 @@ Status ResourceMgr::Delete(const ResourceHandle& handle) {
 }
 
 Status ResourceMgr::Cleanup(const string& container) {
-  {
-    tf_shared_lock l(mu_);
-    if (!gtl::FindOrNull(containers_, container)) {
-      // Nothing to cleanup.
-      return OkStatus();
+  for (Shard& shard : shards_) {
+    {
+      tf_shared_lock l(shard.mu);
+      if (!gtl::FindOrNull(shard.containers, container)) {
+        // Nothing to cleanup in this shard.
+        continue;
+      }
     }
-  }
-  Container* b = nullptr;
-  {
-    mutex_lock l(mu_);
-    auto iter = containers_.find(container);
-    if (iter == containers_.end()) {
-      // Nothing to cleanup, it's OK (concurrent cleanup).
-      return OkStatus();
+    Container* b = nullptr;
+    {
+      mutex_lock l(shard.mu);
+      auto iter = shard.containers.find(container);
+      if (iter == shard.containers.end()) {
+        // Nothing to cleanup, it's OK (concurrent cleanup).
+        continue;
+      }
+      b = iter->second;
+      shard.containers.erase(iter);
     }
-    b = iter->second;
-    containers_.erase(iter);
+    CHECK(b != nullptr);
+    // Deleted outside of the lock since resource destructors may access the
+    // resource manager.
+    delete b;
   }
-  CHECK(b != nullptr);
-  delete b;
   return OkStatus();
 }
 
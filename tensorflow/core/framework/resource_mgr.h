@@ -16,6 +16,7 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_FRAMEWORK_RESOURCE_MGR_H_
 #define TENSORFLOW_CORE_FRAMEWORK_RESOURCE_MGR_H_
 
+#include <array>
 #include <memory>
 #include <string>
 #include <typeindex>
@@ -194,9 +195,10 @@ class ResourceMgr {
   Status Lookup(const ResourceHandle& handle,
                 ResourceBase** resource) const TF_MUST_USE_RESULT;
 
-  // Similar to Lookup, but looks up multiple resources at once, with only a
-  // single lock acquisition.  If containers_and_names[i] is uninitialized
-  // then this function does not modify resources[i].
+  // Similar to Lookup, but looks up multiple resources at once.  Resources
+  // that fall in the same lock stripe are looked up under a single lock
+  // acquisition.  If containers_and_names[i] is uninitialized then this
+  // function does not modify resources[i].
   template <typename T, bool use_dynamic_cast = false>
   Status LookupMany(absl::Span<std::pair<const string*, const string*> const>
                         containers_and_names,
@@ -272,31 +274,63 @@ class ResourceMgr {
   typedef absl::flat_hash_map<Key, ResourceAndName, KeyHash, KeyEqual>
       Container;
 
+  // Resources are striped over kNumShards shards by resource name, so that
+  // lookups of different resources on the hot path do not all contend on a
+  // single lock. A container is represented by one Container per shard that
+  // holds resources of that container.
+  static constexpr int kNumShards = 16;
+  struct Shard {
+    mutable mutex mu;
+    absl::flat_hash_map<string, Container*> containers TF_GUARDED_BY(mu);
+  };
+
+  static int ShardIndex(const std::string& resource_name) {
+    return Hash64(resource_name) % kNumShards;
+  }
+  Shard& ShardFor(const std::string& resource_name) {
+    return shards_[ShardIndex(resource_name)];
+  }
+  const Shard& ShardFor(const std::string& resource_name) const {
+    return shards_[ShardIndex(resource_name)];
+  }
+
+  // Returns true if any shard other than `except` has resources in
+  // `container`. Must be called without holding any shard lock.
+  bool ContainerExistsInOtherShards(const std::string& container,
+                                    const Shard& except) const;
+
+  // A failed lookup only knows whether `container` has resources in the
+  // shard of `resource_name`. If `container` was missing from that shard but
+  // has resources in another one, returns the "resource does not exist" error
+  // that a lookup over the whole container would produce; otherwise returns
+  // `s`. Must be called without holding any shard lock.
+  Status RefineLookupError(Status s, bool container_missing_in_shard,
+                           const Shard& shard, const std::string& container,
+                           const std::string& resource_name,
+                           const std::string& type_name) const;
+
   const std::string default_container_;
-  mutable mutex mu_;
-  absl::flat_hash_map<string, Container*> containers_ TF_GUARDED_BY(mu_);
+  std::array<Shard, kNumShards> shards_;
 
   template <typename T, bool use_dynamic_cast = false>
-  Status LookupInternal(const std::string& container, const std::string& name,
-                        T** resource) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) TF_MUST_USE_RESULT;
-  Status LookupInternal(const std::string& container, uint64 type_hash_code,
-                        const std::string& name, ResourceBase** resource) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) TF_MUST_USE_RESULT;
-
-  Status DoCreate(const std::string& container, TypeIndex type,
+  Status LookupInternal(const Shard& shard, const std::string& container,
+                        const std::string& name, T** resource) const
+      TF_SHARED_LOCKS_REQUIRED(shard.mu) TF_MUST_USE_RESULT;
+
+  Status DoCreate(Shard& shard, const std::string& container, TypeIndex type,
                   const std::string& name, ResourceBase* resource,
                   bool owns_resource)
-      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) TF_MUST_USE_RESULT;
+      TF_EXCLUSIVE_LOCKS_REQUIRED(shard.mu) TF_MUST_USE_RESULT;
 
-  Status DoLookup(const std::string& container, TypeIndex type,
-                  const std::string& name, ResourceBase** resource) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) TF_MUST_USE_RESULT;
-  Status DoLookup(const std::string& container, uint64 type_hash_code,
-                  const std::string& type_name,
+  Status DoLookup(const Shard& shard, const std::string& container,
+                  TypeIndex type, const std::string& name,
+                  ResourceBase** resource) const
+      TF_SHARED_LOCKS_REQUIRED(shard.mu) TF_MUST_USE_RESULT;
+  Status DoLookup(const Shard& shard, const std::string& container,
+                  uint64 type_hash_code, const std::string& type_name,
                   const std::string& resource_name,
                   ResourceBase** resource) const
-      TF_SHARED_LOCKS_REQUIRED(mu_) TF_MUST_USE_RESULT;
+      TF_SHARED_LOCKS_REQUIRED(shard.mu) TF_MUST_USE_RESULT;
 
   Status DoDelete(const std::string& container, uint64 type_hash_code,
                   const std::string& resource_name,
@@ -312,16 +346,18 @@ class ResourceMgr {
       ResourceAndName& resource_and_name) TF_MUST_USE_RESULT;
   // Inserts the type name for 'hash_code' into the hash_code to type name map.
   Status InsertDebugTypeName(uint64 hash_code, const std::string& type_name)
-      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_) TF_MUST_USE_RESULT;
+      TF_MUST_USE_RESULT;
 
   // Returns the type name for the 'hash_code'.
   // Returns "<unknown>" if a resource with such a type was never inserted into
   // the container.
   const char* DebugTypeName(uint64 hash_code) const
-      TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+      TF_EXCLUSIVE_LOCKS_REQUIRED(debug_type_names_mu_);
 
   // Map from type hash_code to type name.
-  std::unordered_map<uint64, string> debug_type_names_ TF_GUARDED_BY(mu_);
+  mutable mutex debug_type_names_mu_;
+  std::unordered_map<uint64, string> debug_type_names_
+      TF_GUARDED_BY(debug_type_names_mu_);
 
   ResourceMgr(const ResourceMgr&) = delete;
   void operator=(const ResourceMgr&) = delete;
@@ -640,8 +676,9 @@ Status ResourceMgr::Create(const std::string& container,
                            const std::string& name, T* resource) {
   CheckDeriveFromResourceBase<T>();
   CHECK(resource != nullptr);
-  mutex_lock l(mu_);
-  return DoCreate(container, TypeIndex::Make<T>(), name, resource,
+  Shard& shard = ShardFor(name);
+  mutex_lock l(shard.mu);
+  return DoCreate(shard, container, TypeIndex::Make<T>(), name, resource,
                   /* owns_resource */ true);
 }
 
@@ -649,8 +686,9 @@ template <typename T>
 Status ResourceMgr::CreateUnowned(const std::string& container,
                                   const std::string& name, T* resource) {
   CheckDeriveFromResourceBase<T>();
-  mutex_lock l(mu_);
-  return DoCreate(container, TypeIndex::Make<T>(), name, resource,
+  Shard& shard = ShardFor(name);
+  mutex_lock l(shard.mu);
+  return DoCreate(shard, container, TypeIndex::Make<T>(), name, resource,
                   /* owns_resource */ false);
 }
 
@@ -658,8 +696,17 @@ template <typename T, bool use_dynamic_cast>
 Status ResourceMgr::Lookup(const std::string& container,
                            const std::string& name, T** resource) const {
   CheckDeriveFromResourceBase<T>();
-  tf_shared_lock l(mu_);
-  return LookupInternal<T, use_dynamic_cast>(container, name, resource);
+  const Shard& shard = ShardFor(name);
+  Status s;
+  bool container_missing_in_shard;
+  {
+    tf_shared_lock l(shard.mu);
+    s = LookupInternal<T, use_dynamic_cast>(shard, container, name, resource);
+    if (s.ok()) return s;
+    container_missing_in_shard = !shard.containers.contains(container);
+  }
+  return RefineLookupError(std::move(s), container_missing_in_shard, shard,
+                           container, name, TypeIndex::Make<T>().name());
 }
 
 template <typename T, bool use_dynamic_cast>
@@ -668,15 +715,24 @@ Status ResourceMgr::LookupMany(
         containers_and_names,
     std::vector<core::RefCountPtr<T>>* resources) const {
   CheckDeriveFromResourceBase<T>();
-  tf_shared_lock l(mu_);
   resources->resize(containers_and_names.size());
+  // Group the requests by shard so that each shard lock is acquired once.
+  std::array<std::vector<size_t>, kNumShards> indices_by_shard;
   for (size_t i = 0; i < containers_and_names.size(); ++i) {
-    T* resource;
-    Status s = LookupInternal<T, use_dynamic_cast>(
-        *containers_and_names[i].first, *containers_and_names[i].second,
-        &resource);
-    if (s.ok()) {
-      (*resources)[i].reset(resource);
+    indices_by_shard[ShardIndex(*containers_and_names[i].second)].push_back(i);
+  }
+  for (int shard_index = 0; shard_index < kNumShards; ++shard_index) {
+    if (indices_by_shard[shard_index].empty()) continue;
+    const Shard& shard = shards_[shard_index];
+    tf_shared_lock l(shard.mu);
+    for (size_t i : indices_by_shard[shard_index]) {
+      T* resource;
+      Status s = LookupInternal<T, use_dynamic_cast>(
+          shard, *containers_and_names[i].first,
+          *containers_and_names[i].second, &resource);
+      if (s.ok()) {
+        (*resources)[i].reset(resource);
+      }
     }
   }
   return OkStatus();
@@ -694,11 +750,12 @@ struct TypeCastFunctor<T, true> {
 };
 
 template <typename T, bool use_dynamic_cast>
-Status ResourceMgr::LookupInternal(const std::string& container,
+Status ResourceMgr::LookupInternal(const Shard& shard,
+                                   const std::string& container,
                                    const std::string& name,
                                    T** resource) const {
   ResourceBase* found = nullptr;
-  Status s = DoLookup(container, TypeIndex::Make<T>(), name, &found);
+  Status s = DoLookup(shard, container, TypeIndex::Make<T>(), name, &found);
   if (s.ok()) {
     // It's safe to down cast 'found' to T* since
     // typeid(T).hash_code() is part of the map key.
@@ -713,17 +770,18 @@ Status ResourceMgr::LookupOrCreate(const std::string& container,
                                    std::function<Status(T**)> creator) {
   CheckDeriveFromResourceBase<T>();
   *resource = nullptr;
+  Shard& shard = ShardFor(name);
   Status s;
   {
-    tf_shared_lock l(mu_);
-    s = LookupInternal<T, use_dynamic_cast>(container, name, resource);
+    tf_shared_lock l(shard.mu);
+    s = LookupInternal<T, use_dynamic_cast>(shard, container, name, resource);
     if (s.ok()) return s;
   }
-  mutex_lock l(mu_);
-  s = LookupInternal<T, use_dynamic_cast>(container, name, resource);
+  mutex_lock l(shard.mu);
+  s = LookupInternal<T, use_dynamic_cast>(shard, container, name, resource);
   if (s.ok()) return s;
   TF_RETURN_IF_ERROR(creator(resource));
-  s = DoCreate(container, TypeIndex::Make<T>(), name, *resource,
+  s = DoCreate(shard, container, TypeIndex::Make<T>(), name, *resource,
                /* owns_resource */ true);
   if (!s.ok()) {
     return errors::Internal("LookupOrCreate failed unexpectedly");
@@ -31,6 +31,7 @@ limitations under the License.
 #include "tensorflow/core/platform/refcount.h"
 #include "tensorflow/core/platform/regexp.h"
 #include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/platform/test_benchmark.h"
 #include "tensorflow/core/protobuf/error_codes.pb.h"
 
 namespace tensorflow {
@@ -213,6 +214,28 @@ TEST(ResourceMgrTest, CreateUnowned) {
   EXPECT_TRUE(kitty->RefCountIsOne());
 }
 
+TEST(ResourceMgrTest, ManyResourcesInOneContainer) {
+  ResourceMgr rm;
+  constexpr int kNumResources = 100;
+  for (int i = 0; i < kNumResources; ++i) {
+    TF_CHECK_OK(rm.Create("foo", strings::StrCat("r", i),
+                          new Resource(strings::StrCat(i))));
+  }
+  for (int i = 0; i < kNumResources; ++i) {
+    EXPECT_EQ(strings::StrCat("R/", i),
+              Find<Resource>(rm, "foo", strings::StrCat("r", i)));
+  }
+  // The container exists, so a missing resource is reported as such.
+  HasError(FindErr<Resource>(rm, "foo", "xxx"), error::NOT_FOUND,
+           "Resource foo/xxx");
+
+  TF_CHECK_OK(rm.Cleanup("foo"));
+  for (int i = 0; i < kNumResources; ++i) {
+    HasError(FindErr<Resource>(rm, "foo", strings::StrCat("r", i)),
+             error::NOT_FOUND, "Container foo");
+  }
+}
+
 TEST(ResourceMgrTest, CreateOrLookup) {
   ResourceMgr rm;
   EXPECT_EQ("R/cat", LookupOrCreate<Resource>(&rm, "foo", "bar", "cat"));
@@ -527,4 +550,28 @@ TEST(ResourceHandleTest, DeleteUsingResourceHandle) {
   EXPECT_NE(LookupResource<StubResource>(&ctx, p, &lookup_r).ok(), true);
 }
 
+static void BM_ResourceMgrLookup(::testing::benchmark::State& state) {
+  constexpr int kNumResources = 256;
+  static ResourceMgr* rm = [] {
+    auto* rm = new ResourceMgr;
+    for (int i = 0; i < kNumResources; ++i) {
+      TF_CHECK_OK(rm->Create("container", strings::StrCat("resource", i),
+                             new Resource("label")));
+    }
+    return rm;
+  }();
+  std::vector<string> names;
+  for (int i = 0; i < kNumResources; ++i) {
+    names.push_back(strings::StrCat("resource", i));
+  }
+  int i = state.thread_index();
+  for (auto s : state) {
+    Resource* r;
+    TF_CHECK_OK(rm->Lookup("container", names[i++ % kNumResources], &r));
+    r->Unref();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_ResourceMgrLookup)->Threads(1)->Threads(8)->Threads(16);
+
 }  // end namespace tensorflow
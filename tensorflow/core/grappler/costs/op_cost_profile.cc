@@ -0,0 +1,281 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_profile.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <unordered_map>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
+#include "tensorflow/core/util/env_var.h"
+
+namespace tensorflow {
+namespace grappler {
+
+namespace {
+
+// Returns the part of `op_info` that identifies ops with the same cost: the
+// op type, its non-internal attributes, the input dtypes and shapes, and the
+// type and model of the device.
+OpInfo NormalizeOpInfo(const OpInfo& op_info) {
+  OpInfo normalized;
+  normalized.set_op(op_info.op());
+  for (const auto& attr : op_info.attr()) {
+    // Internal attributes such as _class differ between identical nodes.
+    if (absl::StartsWith(attr.first, "_")) continue;
+    (*normalized.mutable_attr())[attr.first] = attr.second;
+  }
+  for (const auto& input : op_info.inputs()) {
+    OpInfo::TensorProperties* normalized_input = normalized.add_inputs();
+    normalized_input->set_dtype(input.dtype());
+    *normalized_input->mutable_shape() = input.shape();
+  }
+  DeviceProperties* device = normalized.mutable_device();
+  device->set_type(op_info.device().type());
+  device->set_vendor(op_info.device().vendor());
+  device->set_model(op_info.device().model());
+  return normalized;
+}
+
+std::string ProfileKey(const OpInfo& normalized_op_info) {
+  std::string key;
+  // Deterministic serialization sorts the attributes.
+  SerializeToStringDeterministic(normalized_op_info, &key);
+  return key;
+}
+
+// The profile that sessions record their measured costs into.
+struct RecordedProfile {
+  std::string file_name;
+  mutex mu;
+  OpCostProfile profile TF_GUARDED_BY(mu);
+  uint64 last_write_micros TF_GUARDED_BY(mu) = 0;
+};
+
+RecordedProfile* GetRecordedProfile() {
+  static RecordedProfile* recorded = []() -> RecordedProfile* {
+    std::string file_name;
+    Status status = ReadStringFromEnvVar(kOpCostProfileRecordEnvVariableName,
+                                         "", &file_name);
+    if (!status.ok() || file_name.empty()) return nullptr;
+    auto* recorded = new RecordedProfile;
+    recorded->file_name = file_name;
+    // Measurements accumulate over the processes that record the profile.
+    if (Env::Default()->FileExists(file_name).ok()) {
+      mutex_lock l(recorded->mu);
+      status = recorded->profile.Load(Env::Default(), file_name);
+      if (!status.ok()) {
+        LOG(WARNING) << "Not extending the op cost profile " << file_name
+                     << ": " << status;
+      }
+    }
+    return recorded;
+  }();
+  return recorded;
+}
+
+}  // namespace
+
+void OpCostProfile::Entry::Add(double execution_time) {
+  if (count >= kMinOutlierSamples) {
+    // A single slow run, e.g. of a preempted thread, barely moves the mean,
+    // while a lasting change in the cost of the op still moves it
+    // geometrically.
+    const double max_deviation = std::max(kOutlierStddevs * std::sqrt(variance),
+                                          kMinOutlierDeviation * mean);
+    execution_time = std::min(std::max(execution_time, mean - max_deviation),
+                              mean + max_deviation);
+  }
+  // Plain mean of the first measurements, exponentially decayed mean after.
+  if (count < kDecayWindow) ++count;
+  const double weight = 1.0 / count;
+  const double deviation = execution_time - mean;
+  mean += weight * deviation;
+  variance = (1 - weight) * (variance + weight * deviation * deviation);
+}
+
+void OpCostProfile::AddMeasurement(const OpInfo& op_info,
+                                   double execution_time) {
+  // Ops that were not timed, or took less than the timer resolution.
+  if (execution_time <= 0) return;
+  OpInfo normalized = NormalizeOpInfo(op_info);
+  Entry& entry = entries_[ProfileKey(normalized)];
+  if (entry.count == 0) entry.op_info = std::move(normalized);
+  entry.Add(execution_time);
+}
+
+void OpCostProfile::AddOpPerformance(const OpPerformanceList& op_performance) {
+  for (const OpPerformance& perf : op_performance.op_performance()) {
+    AddMeasurement(perf.op(), perf.compute_cost());
+  }
+}
+
+void OpCostProfile::AddCostGraph(const CostGraphDef& cost_graph,
+                                 const GraphDef& graph) {
+  AddOpPerformance(CostGraphToOpPerformanceData(cost_graph, graph));
+}
+
+void OpCostProfile::AddStepStats(const StepStats& step_stats,
+                                 const CostGraphDef& cost_graph,
+                                 const GraphDef& graph) {
+  const OpPerformanceList op_performance =
+      CostGraphToOpPerformanceData(cost_graph, graph);
+  std::unordered_map<std::string, const OpInfo*> op_infos;
+  for (const OpPerformance& perf : op_performance.op_performance()) {
+    op_infos[perf.node()] = &perf.op();
+  }
+  std::unordered_map<std::string, const std::string*> devices;
+  for (const CostGraphDef::Node& node : cost_graph.node()) {
+    devices[node.name()] = &node.device();
+  }
+  for (const DeviceStepStats& dev_stats : step_stats.dev_stats()) {
+    for (const NodeExecStats& node_stats : dev_stats.node_stats()) {
+      auto op_info = op_infos.find(node_stats.node_name());
+      if (op_info == op_infos.end()) continue;
+      // Device tracers report the kernels of an op under other devices, such
+      // as the streams of a GPU.
+      if (*devices[node_stats.node_name()] != dev_stats.device()) continue;
+      double execution_time;
+      if (node_stats.op_end_rel_nanos() > 0) {
+        execution_time =
+            node_stats.op_end_rel_nanos() - node_stats.op_start_rel_nanos();
+      } else {
+        execution_time = 1000.0 * (node_stats.op_end_rel_micros() -
+                                   node_stats.op_start_rel_micros());
+      }
+      // Nodes in loops are measured once per execution.
+      AddMeasurement(*op_info->second, execution_time);
+    }
+  }
+}
+
+bool OpCostProfile::Lookup(const OpInfo& op_info,
+                           Costs::Duration* execution_time) const {
+  if (entries_.empty()) return false;
+  auto it = entries_.find(ProfileKey(NormalizeOpInfo(op_info)));
+  if (it == entries_.end()) return false;
+  *execution_time = Costs::Duration(static_cast<int64_t>(
+      std::ceil(it->second.mean)));
+  return true;
+}
+
+Status OpCostProfile::Save(Env* env, const std::string& file_name) const {
+  OpPerformanceList op_performance;
+  for (const auto& it : entries_) {
+    OpPerformance* perf = op_performance.add_op_performance();
+    *perf->mutable_op() = it.second.op_info;
+    perf->set_compute_cost(static_cast<int64_t>(std::ceil(it.second.mean)));
+    NormalDistribution* execution_time = perf->mutable_execution_time_normal();
+    execution_time->set_mu(it.second.mean);
+    execution_time->set_sigma(std::sqrt(it.second.variance));
+  }
+  return WriteBinaryProto(env, file_name, op_performance);
+}
+
+Status OpCostProfile::Load(Env* env, const std::string& file_name) {
+  OpPerformanceList op_performance;
+  TF_RETURN_IF_ERROR(ReadBinaryProto(env, file_name, &op_performance));
+  for (const OpPerformance& perf : op_performance.op_performance()) {
+    OpInfo op_info = NormalizeOpInfo(perf.op());
+    const std::string key = ProfileKey(op_info);
+    if (!perf.has_execution_time_normal() || entries_.count(key) != 0 ||
+        perf.execution_time_normal().mu() <= 0) {
+      AddMeasurement(op_info, perf.compute_cost());
+      continue;
+    }
+    // Ops saved by Save() keep their statistics, weighted as a full window of
+    // measurements.
+    Entry& entry = entries_[key];
+    entry.op_info = std::move(op_info);
+    entry.count = kDecayWindow;
+    entry.mean = perf.execution_time_normal().mu();
+    const double sigma = perf.execution_time_normal().sigma();
+    entry.variance = sigma * sigma;
+  }
+  return OkStatus();
+}
+
+/* static */
+bool OpCostProfile::IsRecording() { return GetRecordedProfile() != nullptr; }
+
+/* static */
+void OpCostProfile::Record(const StepStats& step_stats,
+                           const CostGraphDef& cost_graph,
+                           const GraphDef& graph) {
+  RecordedProfile* recorded = GetRecordedProfile();
+  if (recorded == nullptr) return;
+  Env* env = Env::Default();
+  mutex_lock l(recorded->mu);
+  recorded->profile.AddStepStats(step_stats, cost_graph, graph);
+  const uint64 now_micros = env->NowMicros();
+  if (recorded->last_write_micros != 0 &&
+      now_micros - recorded->last_write_micros <
+          kRecordIntervalSeconds * 1000000) {
+    return;
+  }
+  recorded->last_write_micros = now_micros;
+  // Readers of the profile see either the previous or the new one.
+  std::string temp_file_name = recorded->file_name;
+  Status status;
+  if (!env->CreateUniqueFileName(&temp_file_name, ".tmp")) {
+    status = errors::Internal("Failed to create a temporary file name");
+  } else {
+    status = recorded->profile.Save(env, temp_file_name);
+    if (status.ok()) {
+      status = env->RenameFile(temp_file_name, recorded->file_name);
+    }
+  }
+  if (!status.ok()) {
+    LOG(WARNING) << "Failed to write the op cost profile "
+                 << recorded->file_name << ": " << status;
+    env->DeleteFile(temp_file_name).IgnoreError();
+    return;
+  }
+  VLOG(1) << "Recorded the costs of " << recorded->profile.size()
+          << " ops in the op cost profile " << recorded->file_name;
+}
+
+/* static */
+const OpCostProfile* OpCostProfile::Global() {
+  static const OpCostProfile* profile = []() -> const OpCostProfile* {
+    std::string file_name;
+    Status status =
+        ReadStringFromEnvVar(kOpCostProfileEnvVariableName, "", &file_name);
+    if (!status.ok() || file_name.empty()) return nullptr;
+    auto* profile = new OpCostProfile;
+    status = profile->Load(Env::Default(), file_name);
+    if (!status.ok()) {
+      LOG(WARNING) << "Not using the op cost profile " << file_name << ": "
+                   << status;
+      delete profile;
+      return nullptr;
+    }
+    VLOG(1) << "Loaded the costs of " << profile->size()
+            << " ops from the op cost profile " << file_name;
+    return profile;
+  }();
+  return profile;
+}
+
+}  // end namespace grappler
+}  // end namespace tensorflow
@@ -0,0 +1,144 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_PROFILE_H_
+#define TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_PROFILE_H_
+
+#include <string>
+#include <unordered_map>
+
+#include "tensorflow/core/framework/cost_graph.pb.h"
+#include "tensorflow/core/framework/graph.pb.h"
+#include "tensorflow/core/framework/step_stats.pb.h"
+#include "tensorflow/core/grappler/costs/cost_estimator.h"
+#include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+namespace grappler {
+
+// The name of the env variable holding the path of the op cost profile used by
+// OpLevelCostEstimator in place of its analytical estimates. If it is unset or
+// empty, no profile is used.
+static const char kOpCostProfileEnvVariableName[] =
+    "TF_GRAPPLER_OP_COST_PROFILE";
+
+// The name of the env variable holding the path of the op cost profile that
+// sessions record the costs they measure into, see OpCostProfile::Record. If
+// it is unset or empty, nothing is recorded.
+static const char kOpCostProfileRecordEnvVariableName[] =
+    "TF_GRAPPLER_OP_COST_PROFILE_RECORD";
+
+// Database of measured op execution times, keyed by the op type, its
+// attributes, the dtypes and shapes of its inputs and the type and model of the
+// device it runs on. It is filled from the StepStats of session runs, and
+// persisted as an OpPerformanceList.
+//
+// The execution time of an op is an exponentially decayed mean of its
+// measurements, so that the profile follows lasting changes in the cost of an
+// op, and measurements far from that mean are clamped before they are added.
+//
+// DirectSession records the StepStats of the steps that build a cost model
+// (see GraphOptions.build_cost_model) with Record(), into the profile named by
+// kOpCostProfileRecordEnvVariableName. That profile can then be used by
+// OpLevelCostEstimator through kOpCostProfileEnvVariableName.
+//
+// Not thread-safe while it is being filled; lookups are thread-safe.
+class OpCostProfile {
+ public:
+  OpCostProfile() = default;
+
+  // Adds the measured compute cost of each op in `op_performance`.
+  void AddOpPerformance(const OpPerformanceList& op_performance);
+
+  // Adds the compute cost of the nodes of `graph` that appear in `cost_graph`.
+  // Note that the compute cost in the cost graph built by a session is the
+  // maximum over all the steps measured so far; use AddStepStats() to add the
+  // execution times of a single step.
+  void AddCostGraph(const CostGraphDef& cost_graph, const GraphDef& graph);
+
+  // Adds the execution time of each execution in `step_stats` of the nodes of
+  // `graph` that appear in `cost_graph`, which gives their input shapes and
+  // devices. Its compute costs are ignored.
+  void AddStepStats(const StepStats& step_stats, const CostGraphDef& cost_graph,
+                    const GraphDef& graph);
+
+  // Returns true and sets "*execution_time" to the decayed mean of the
+  // measurements of ops matching `op_info`, if there are any.
+  bool Lookup(const OpInfo& op_info, Costs::Duration* execution_time) const;
+
+  // Number of distinct ops with measurements.
+  size_t size() const { return entries_.size(); }
+
+  // Writes one OpPerformance per distinct op, with its mean compute cost and
+  // the mean and standard deviation of its execution time, to `file_name`.
+  Status Save(Env* env, const std::string& file_name) const;
+
+  // Adds the ops of a profile written by Save() to this one.
+  Status Load(Env* env, const std::string& file_name);
+
+  // Returns the profile named by kOpCostProfileEnvVariableName, loaded once
+  // per process, or nullptr if there is none.
+  static const OpCostProfile* Global();
+
+  // Returns true if the costs measured by sessions are recorded, i.e. if
+  // kOpCostProfileRecordEnvVariableName names a profile.
+  static bool IsRecording();
+
+  // Adds the execution times in `step_stats` of the nodes of `graph`, see
+  // AddStepStats(), to the recorded profile, which starts from the file named by
+  // kOpCostProfileRecordEnvVariableName if it exists, and writes it to that
+  // file at most every kRecordIntervalSeconds. Does nothing unless
+  // IsRecording(). Thread-safe.
+  static void Record(const StepStats& step_stats,
+                     const CostGraphDef& cost_graph, const GraphDef& graph);
+
+ private:
+  // Number of measurements over which the mean of an op is averaged: once an op
+  // has that many, each new one has a weight of 1 / kDecayWindow.
+  static constexpr int kDecayWindow = 32;
+
+  // Measurements further than this many standard deviations, or than
+  // kMinOutlierDeviation times the mean, from the mean of an op with at least
+  // kMinOutlierSamples measurements are clamped to that distance.
+  static constexpr double kOutlierStddevs = 3.0;
+  static constexpr double kMinOutlierDeviation = 0.5;
+  static constexpr int kMinOutlierSamples = 4;
+
+  // Minimum interval between two writes of the recorded profile.
+  static constexpr int64_t kRecordIntervalSeconds = 60;
+
+  struct Entry {
+    // Adds a measurement of `execution_time` nanoseconds.
+    void Add(double execution_time);
+
+    OpInfo op_info;
+    // Number of measurements, up to kDecayWindow.
+    int count = 0;
+    double mean = 0;
+    double variance = 0;
+  };
+
+  // Adds a measurement of `execution_time` nanoseconds of `op_info`.
+  void AddMeasurement(const OpInfo& op_info, double execution_time);
+
+  std::unordered_map<std::string, Entry> entries_;
+};
+
+}  // end namespace grappler
+}  // end namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_GRAPPLER_COSTS_OP_COST_PROFILE_H_
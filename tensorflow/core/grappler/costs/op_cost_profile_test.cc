@@ -0,0 +1,237 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/grappler/costs/op_cost_profile.h"
+
+#include <cstdlib>
+
+#include "tensorflow/core/grappler/costs/utils.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace grappler {
+namespace {
+
+OpInfo DescribeAdd(int size) {
+  OpInfo op_info;
+  op_info.set_op("Add");
+  (*op_info.mutable_attr())["T"].set_type(DT_FLOAT);
+  for (int i = 0; i < 2; ++i) {
+    auto* input = op_info.add_inputs();
+    input->set_dtype(DT_FLOAT);
+    input->mutable_shape()->add_dim()->set_size(size);
+  }
+  op_info.mutable_device()->set_type("CPU");
+  return op_info;
+}
+
+void AddMeasurement(const OpInfo& op_info, int64_t compute_cost,
+                    OpPerformanceList* op_performance) {
+  OpPerformance* perf = op_performance->add_op_performance();
+  *perf->mutable_op() = op_info;
+  perf->set_compute_cost(compute_cost);
+}
+
+// Returns the graph of an Add of two inputs of `size` floats, and its cost
+// graph where the Add took `compute_cost` microseconds on `device`.
+void MakeAddCostGraph(int size, int64_t compute_cost, const string& device,
+                      GraphDef* graph, CostGraphDef* cost_graph) {
+  for (const char* name : {"x", "y"}) {
+    NodeDef* node = graph->add_node();
+    node->set_name(name);
+    node->set_op("Placeholder");
+    CostGraphDef::Node* cost_node = cost_graph->add_node();
+    cost_node->set_name(name);
+    cost_node->set_device(device);
+    CostGraphDef::Node::OutputInfo* output = cost_node->add_output_info();
+    output->set_dtype(DT_FLOAT);
+    output->mutable_shape()->add_dim()->set_size(size);
+  }
+  NodeDef* add = graph->add_node();
+  add->set_name("add");
+  add->set_op("Add");
+  add->add_input("x");
+  add->add_input("y");
+  (*add->mutable_attr())["T"].set_type(DT_FLOAT);
+  CostGraphDef::Node* cost_node = cost_graph->add_node();
+  cost_node->set_name("add");
+  cost_node->set_device(device);
+  cost_node->set_compute_cost(compute_cost);
+}
+
+TEST(OpCostProfileTest, Lookup) {
+  OpPerformanceList op_performance;
+  AddMeasurement(DescribeAdd(10), 100, &op_performance);
+  AddMeasurement(DescribeAdd(10), 110, &op_performance);
+  AddMeasurement(DescribeAdd(10), 90, &op_performance);
+  AddMeasurement(DescribeAdd(20), 200, &op_performance);
+  // Not timed.
+  AddMeasurement(DescribeAdd(30), 0, &op_performance);
+  OpCostProfile profile;
+  profile.AddOpPerformance(op_performance);
+  EXPECT_EQ(2, profile.size());
+
+  Costs::Duration time;
+  ASSERT_TRUE(profile.Lookup(DescribeAdd(10), &time));
+  EXPECT_EQ(Costs::Duration(100), time);
+  ASSERT_TRUE(profile.Lookup(DescribeAdd(20), &time));
+  EXPECT_EQ(Costs::Duration(200), time);
+  EXPECT_FALSE(profile.Lookup(DescribeAdd(30), &time));
+
+  // Internal attributes, input values and the device details other than its
+  // type and model do not matter.
+  OpInfo op_info = DescribeAdd(10);
+  (*op_info.mutable_attr())["_class"].set_s("loc:@foo");
+  op_info.mutable_inputs(0)->mutable_value()->set_dtype(DT_FLOAT);
+  op_info.mutable_device()->set_num_cores(8);
+  EXPECT_TRUE(profile.Lookup(op_info, &time));
+
+  op_info = DescribeAdd(10);
+  (*op_info.mutable_attr())["T"].set_type(DT_DOUBLE);
+  EXPECT_FALSE(profile.Lookup(op_info, &time));
+  op_info = DescribeAdd(10);
+  op_info.mutable_device()->set_type("GPU");
+  EXPECT_FALSE(profile.Lookup(op_info, &time));
+}
+
+TEST(OpCostProfileTest, IgnoresOutliers) {
+  OpPerformanceList op_performance;
+  for (int i = 0; i < 10; ++i) {
+    AddMeasurement(DescribeAdd(10), 100, &op_performance);
+  }
+  AddMeasurement(DescribeAdd(10), 100000, &op_performance);
+  OpCostProfile profile;
+  profile.AddOpPerformance(op_performance);
+
+  // The outlier is clamped to 150.
+  Costs::Duration time;
+  ASSERT_TRUE(profile.Lookup(DescribeAdd(10), &time));
+  EXPECT_EQ(Costs::Duration(105), time);
+}
+
+TEST(OpCostProfileTest, FollowsLastingChanges) {
+  OpPerformanceList op_performance;
+  for (int i = 0; i < 1000; ++i) {
+    AddMeasurement(DescribeAdd(10), 100, &op_performance);
+  }
+  for (int i = 0; i < 64; ++i) {
+    AddMeasurement(DescribeAdd(10), 200, &op_performance);
+  }
+  OpCostProfile profile;
+  profile.AddOpPerformance(op_performance);
+
+  Costs::Duration time;
+  ASSERT_TRUE(profile.Lookup(DescribeAdd(10), &time));
+  EXPECT_GT(time, Costs::Duration(180));
+  EXPECT_LE(time, Costs::Duration(200));
+}
+
+TEST(OpCostProfileTest, AddStepStats) {
+  const string device = "/job:localhost/replica:0/task:0/device:CPU:0";
+  GraphDef graph;
+  CostGraphDef cost_graph;
+  // The maximum over all the steps is ignored.
+  MakeAddCostGraph(10, 1000, device, &graph, &cost_graph);
+  StepStats step_stats;
+  DeviceStepStats* dev_stats = step_stats.add_dev_stats();
+  dev_stats->set_device(device);
+  for (int64_t nanos : {3000, 5000}) {
+    NodeExecStats* node_stats = dev_stats->add_node_stats();
+    node_stats->set_node_name("add");
+    node_stats->set_op_start_rel_nanos(100);
+    node_stats->set_op_end_rel_nanos(100 + nanos);
+  }
+  // Kernels traced on the streams of a device are not executions of the op.
+  DeviceStepStats* stream_stats = step_stats.add_dev_stats();
+  stream_stats->set_device(device + "/stream:all");
+  NodeExecStats* node_stats = stream_stats->add_node_stats();
+  node_stats->set_node_name("add");
+  node_stats->set_op_end_rel_nanos(1000000);
+
+  OpCostProfile profile;
+  profile.AddStepStats(step_stats, cost_graph, graph);
+  EXPECT_EQ(1, profile.size());
+  OpInfo op_info = DescribeAdd(10);
+  *op_info.mutable_device() = GetDeviceInfo(device);
+  Costs::Duration time;
+  ASSERT_TRUE(profile.Lookup(op_info, &time));
+  EXPECT_EQ(Costs::Duration(4000), time);
+}
+
+TEST(OpCostProfileTest, SaveAndLoad) {
+  OpPerformanceList op_performance;
+  AddMeasurement(DescribeAdd(10), 100, &op_performance);
+  AddMeasurement(DescribeAdd(20), 200, &op_performance);
+  OpCostProfile profile;
+  profile.AddOpPerformance(op_performance);
+
+  Env* env = Env::Default();
+  const string file_name =
+      io::JoinPath(testing::TmpDir(), "op_cost_profile.pb");
+  TF_ASSERT_OK(profile.Save(env, file_name));
+
+  OpCostProfile loaded;
+  TF_ASSERT_OK(loaded.Load(env, file_name));
+  EXPECT_EQ(2, loaded.size());
+  Costs::Duration time;
+  ASSERT_TRUE(loaded.Lookup(DescribeAdd(20), &time));
+  EXPECT_EQ(Costs::Duration(200), time);
+
+  // Loaded ops keep the weight of their past measurements.
+  OpPerformanceList slower;
+  AddMeasurement(DescribeAdd(20), 232, &slower);
+  loaded.AddOpPerformance(slower);
+  ASSERT_TRUE(loaded.Lookup(DescribeAdd(20), &time));
+  EXPECT_EQ(Costs::Duration(201), time);
+
+  EXPECT_FALSE(loaded.Load(env, file_name + ".missing").ok());
+}
+
+TEST(OpCostProfileTest, RecordsStepStats) {
+  const string file_name =
+      io::JoinPath(testing::TmpDir(), "recorded_op_cost_profile.pb");
+  setenv(kOpCostProfileRecordEnvVariableName, file_name.c_str(), 1);
+  ASSERT_TRUE(OpCostProfile::IsRecording());
+
+  const string device = "/job:localhost/replica:0/task:0/device:CPU:0";
+  GraphDef graph;
+  CostGraphDef cost_graph;
+  MakeAddCostGraph(10, 0, device, &graph, &cost_graph);
+  StepStats step_stats;
+  DeviceStepStats* dev_stats = step_stats.add_dev_stats();
+  dev_stats->set_device(device);
+  NodeExecStats* node_stats = dev_stats->add_node_stats();
+  node_stats->set_node_name("add");
+  node_stats->set_op_start_rel_micros(1);
+  node_stats->set_op_end_rel_micros(4);
+  OpCostProfile::Record(step_stats, cost_graph, graph);
+
+  // The first recorded step is written right away.
+  OpCostProfile loaded;
+  TF_ASSERT_OK(loaded.Load(Env::Default(), file_name));
+  EXPECT_EQ(1, loaded.size());
+  OpInfo op_info = DescribeAdd(10);
+  *op_info.mutable_device() = GetDeviceInfo(device);
+  Costs::Duration time;
+  ASSERT_TRUE(loaded.Lookup(op_info, &time));
+  // Only the microseconds were measured.
+  EXPECT_EQ(Costs::Duration(3000), time);
+}
+
+}  // namespace
+}  // namespace grappler
+}  // namespace tensorflow
@@ -655,6 +655,8 @@ OpLevelCostEstimator::OpLevelCostEstimator() {
 
   // By default, use sum of memory_time and compute_time for execution_time.
   compute_memory_overlap_ = false;
+
+  cost_profile_ = OpCostProfile::Global();
 }
 
 Costs OpLevelCostEstimator::PredictCosts(const OpContext& op_context) const {
@@ -693,6 +695,21 @@ Costs OpLevelCostEstimator::PredictCosts(const OpContext& op_context) const {
     costs.num_ops_with_unknown_shapes =
         node_costs.num_nodes_with_unknown_shapes;
     costs.num_ops_total = node_costs.num_nodes;
+
+    // Measured execution times already include the memory accesses.
+    Costs::Duration measured_time;
+    if (cost_profile_ != nullptr &&
+        cost_profile_->Lookup(op_context.op_info, &measured_time)) {
+      VLOG(1) << "Operation " << op_context.op_info.op() << " measured at "
+              << measured_time.count() << " ns.";
+      costs.compute_time = measured_time;
+      costs.execution_time = measured_time;
+      costs.memory_time = 0;
+      costs.intermediate_memory_time = 0;
+      costs.intermediate_memory_read_time = 0;
+      costs.intermediate_memory_write_time = 0;
+      costs.inaccurate = false;
+    }
     return costs;
   }
   // Errors during node cost estimate.
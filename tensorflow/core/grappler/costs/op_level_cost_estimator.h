@@ -26,6 +26,7 @@ limitations under the License.
 #include "absl/status/status.h"
 #include "absl/status/statusor.h"
 #include "tensorflow/core/grappler/costs/cost_estimator.h"
+#include "tensorflow/core/grappler/costs/op_cost_profile.h"
 #include "tensorflow/core/grappler/costs/op_context.h"
 #include "tensorflow/core/grappler/costs/op_performance_data.pb.h"
 #include "tensorflow/core/platform/types.h"
@@ -106,6 +107,13 @@ class OpLevelCostEstimator {
   // Returns basic device performance info.
   virtual DeviceInfo GetDeviceInfo(const DeviceProperties& device) const;
 
+  // Uses the measured execution times in `profile`, when it has some for an
+  // op, in place of the analytical estimates. Defaults to
+  // OpCostProfile::Global(). `profile` must outlive this estimator.
+  void set_cost_profile(const OpCostProfile* profile) {
+    cost_profile_ = profile;
+  }
+
  protected:
   // TODO(dyoon): Consider to remove PredictOpCountBasedCosts() with OpInfo.
   // Naive cost estimate based on the given operations count and total
@@ -335,6 +343,7 @@ class OpLevelCostEstimator {
   // compute_time and memory_time, instead of sum of those two.
   bool compute_memory_overlap_;
   std::set<string> persistent_ops_;
+  const OpCostProfile* cost_profile_;
 
  private:
   friend class OpLevelCostEstimatorTest;
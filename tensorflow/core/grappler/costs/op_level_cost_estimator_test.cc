@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
 #include "tensorflow/core/framework/types.h"
+#include "tensorflow/core/grappler/costs/utils.h"
 #include "tensorflow/core/platform/status_matchers.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/protobuf/device_properties.pb.h"
@@ -685,6 +686,81 @@ TEST_F(OpLevelCostEstimatorTest, TestPersistentOpCosts) {
   }
 }
 
+TEST_F(OpLevelCostEstimatorTest, UsesMeasuredCosts) {
+  const OpContext op_context = DescribeMatMul(2, 4, 7, 7);
+  const Costs analytical = PredictCosts(op_context);
+
+  OpCostProfile profile;
+  OpPerformanceList op_performance;
+  OpPerformance* perf = op_performance.add_op_performance();
+  *perf->mutable_op() = op_context.op_info;
+  perf->set_compute_cost(12345);
+  profile.AddOpPerformance(op_performance);
+
+  estimator_.set_cost_profile(&profile);
+  Costs cost = PredictCosts(op_context);
+  EXPECT_EQ(Costs::Duration(12345), cost.compute_time);
+  EXPECT_EQ(Costs::Duration(0), cost.memory_time);
+  EXPECT_EQ(Costs::Duration(12345), cost.execution_time);
+  EXPECT_FALSE(cost.inaccurate);
+
+  // Ops missing from the profile are still estimated analytically.
+  cost = PredictCosts(DescribeMatMul(2, 4, 7, 8));
+  EXPECT_NE(Costs::Duration(12345), cost.execution_time);
+
+  estimator_.set_cost_profile(nullptr);
+  EXPECT_EQ(analytical.execution_time,
+            PredictCosts(op_context).execution_time);
+}
+
+TEST_F(OpLevelCostEstimatorTest, UsesCostsOfCostGraph) {
+  // A session ran a MatMul of a 2x4 and a 4x7 matrix in 15 microseconds.
+  const string device = "/job:localhost/replica:0/task:0/device:CPU:0";
+  GraphDef graph;
+  CostGraphDef cost_graph;
+  const std::vector<std::pair<string, std::vector<int>>> inputs = {
+      {"a", {2, 4}}, {"b", {4, 7}}};
+  for (const auto& input : inputs) {
+    NodeDef* node = graph.add_node();
+    node->set_name(input.first);
+    node->set_op("Placeholder");
+    CostGraphDef::Node* cost_node = cost_graph.add_node();
+    cost_node->set_name(input.first);
+    cost_node->set_device(device);
+    CostGraphDef::Node::OutputInfo* output = cost_node->add_output_info();
+    output->set_dtype(DT_FLOAT);
+    for (int dim : input.second) {
+      output->mutable_shape()->add_dim()->set_size(dim);
+    }
+  }
+  NodeDef* matmul = graph.add_node();
+  matmul->set_name("matmul");
+  matmul->set_op("MatMul");
+  matmul->add_input("a");
+  matmul->add_input("b");
+  CostGraphDef::Node* cost_node = cost_graph.add_node();
+  cost_node->set_name("matmul");
+  cost_node->set_device(device);
+  cost_node->set_compute_cost(15);
+
+  OpCostProfile profile;
+  profile.AddCostGraph(cost_graph, graph);
+  estimator_.set_cost_profile(&profile);
+
+  // The same op on the same device is predicted to take the measured time.
+  OpContext op_context = DescribeMatMul(2, 7, 4, 4);
+  *op_context.op_info.mutable_device() = GetDeviceInfo(device);
+  const Costs cost = PredictCosts(op_context);
+  EXPECT_EQ(Costs::Duration(15000), cost.execution_time);
+  EXPECT_EQ(Costs::Duration(15000), cost.compute_time);
+  EXPECT_FALSE(cost.inaccurate);
+
+  // Other shapes are estimated analytically.
+  op_context = DescribeMatMul(2, 8, 4, 4);
+  *op_context.op_info.mutable_device() = GetDeviceInfo(device);
+  EXPECT_NE(Costs::Duration(15000), PredictCosts(op_context).execution_time);
+}
+
 TEST_F(OpLevelCostEstimatorTest, TestGatherCosts) {
   std::vector<std::string> gather_ops = {"Gather", "GatherNd", "GatherV2"};
 
@@ -20,6 +20,7 @@ limitations under the License.
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/core/framework/attr_value.pb.h"
@@ -440,6 +441,39 @@ void RecomputeSubgraph(
   }
 }
 
+// Returns true for the nodes whose inputs we may want to recompute. This
+// matches node names that contain `recomputation_targets_name_scope` as a name
+// scope, meaning it either begins with or contains the name scope. Defaults to
+// "gradients/" which will match any node names that begins with "gradients/"
+// or contains "/gradients/".
+bool IsRecomputationTarget(const NodeDef& node,
+                           const string& recomputation_targets_name_scope) {
+  return absl::StartsWith(node.name(), recomputation_targets_name_scope) ||
+         static_cast<int>(
+             node.name().find("/" + recomputation_targets_name_scope)) != -1;
+}
+
+// Duplicates the `recomputed_subgraphs` of `graph`, which must be sorted
+// topologically, and sets up control dependencies so that the copies run
+// during backprop.
+void RecomputeSubgraphs(
+    const std::vector<RecomputedSubGraph>& recomputed_subgraphs,
+    const NodeMap& node_map, GraphDef* graph) {
+  if (recomputed_subgraphs.empty()) {
+    return;
+  }
+  std::unordered_map<const NodeDef*, int> topological_numbering;
+  for (int node_number = 0; node_number < graph->node().size(); ++node_number) {
+    topological_numbering[graph->mutable_node(node_number)] =
+        graph->node().size() - node_number - 1;
+  }
+  // Duplicate the indicated sub-graphs and set up control dependencies
+  for (const RecomputedSubGraph& subgraph : recomputed_subgraphs) {
+    RecomputeSubgraph(subgraph.recomputed_source_nodes, subgraph.target_nodes,
+                      node_map, topological_numbering, graph);
+  }
+}
+
 void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
                                 const string& recomputation_targets_name_scope,
                                 GraphDef* graph, const GrapplerItem& item) {
@@ -461,15 +495,7 @@ void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
   }
   std::function<bool(const NodeDef&)> is_target =
       [&recomputation_targets_name_scope](const NodeDef& node) {
-        // Nodes whose inputs we may want to recompute. This matches node names
-        // that contain recomputation_targets_name_scope as a name scope,
-        // meaning it either begins with or contains the name scope.
-        // Defaults to "gradients/" which will match any node names that begins
-        // with "gradients/" or contains "/gradients/".
-        return absl::StartsWith(node.name(),
-                                recomputation_targets_name_scope) ||
-               static_cast<int>(node.name().find(
-                   "/" + recomputation_targets_name_scope)) != -1;
+        return IsRecomputationTarget(node, recomputation_targets_name_scope);
       };
 
   if (optimization_level == RewriterConfig::RECOMPUTATION_HEURISTICS ||
@@ -497,19 +523,7 @@ void RecomputationRewritingPass(RewriterConfig::MemOptType optimization_level,
         },
         is_target);
   }
-  if (!recomputed_subgraphs.empty()) {
-    std::unordered_map<const NodeDef*, int> topological_numbering;
-    for (int node_number = 0; node_number < graph->node().size();
-         ++node_number) {
-      topological_numbering[graph->mutable_node(node_number)] =
-          graph->node().size() - node_number - 1;
-    }
-    // Duplicate the indicated sub-graphs and set up control dependencies
-    for (const RecomputedSubGraph& subgraph : recomputed_subgraphs) {
-      RecomputeSubgraph(subgraph.recomputed_source_nodes, subgraph.target_nodes,
-                        node_map, topological_numbering, graph);
-    }
-  }
+  RecomputeSubgraphs(recomputed_subgraphs, node_map, graph);
 }
 
 bool SchedulingPass(Cluster* cluster, std::unique_ptr<GraphMemory>* memory_ptr,
@@ -1270,6 +1284,262 @@ bool SwappingPass(RewriterConfig::MemOptType optimization_level,
   return updated_graph;
 }
 
+// The lifetime of an output of a node in a simulated step, in microseconds.
+struct SimulatedTensor {
+  string node;
+  string device;
+  int64_t bytes = 0;
+  int64_t allocation_time = 0;
+  // When the last consumer of the tensor completes.
+  int64_t deallocation_time = 0;
+  // When the last consumer that is not a recomputation target completes, i.e.
+  // when the tensor would be freed if its node were recomputed.
+  int64_t forward_deallocation_time = 0;
+};
+
+// The memory used over time by the tensors of a device in a simulated step.
+// Shortening the lifetime of a tensor updates the usage in place, without
+// simulating the step again.
+class MemoryTimeline {
+ public:
+  explicit MemoryTimeline(const std::vector<const SimulatedTensor*>& tensors) {
+    for (const SimulatedTensor* tensor : tensors) {
+      times_.push_back(tensor->allocation_time);
+      times_.push_back(tensor->deallocation_time);
+      times_.push_back(tensor->forward_deallocation_time);
+    }
+    std::sort(times_.begin(), times_.end());
+    times_.erase(std::unique(times_.begin(), times_.end()), times_.end());
+    // Accumulate the allocations and deallocations at each time.
+    usage_.assign(times_.size(), 0);
+    for (const SimulatedTensor* tensor : tensors) {
+      usage_[Index(tensor->allocation_time)] += tensor->bytes;
+      usage_[Index(tensor->deallocation_time)] -= tensor->bytes;
+    }
+    for (int i = 1; i < usage_.size(); ++i) {
+      usage_[i] += usage_[i - 1];
+    }
+  }
+
+  // Returns the time of the peak usage, and sets `*peak_usage` to it.
+  int64_t PeakTime(int64_t* peak_usage) const {
+    if (usage_.empty()) {
+      *peak_usage = 0;
+      return 0;
+    }
+    const auto peak = std::max_element(usage_.begin(), usage_.end());
+    *peak_usage = *peak;
+    return times_[peak - usage_.begin()];
+  }
+
+  // Stops counting `bytes` from `begin` to `end`.
+  void Release(int64_t begin, int64_t end, int64_t bytes) {
+    for (int i = Index(begin); i < Index(end); ++i) {
+      usage_[i] -= bytes;
+    }
+  }
+
+ private:
+  int Index(int64_t time) const {
+    return std::lower_bound(times_.begin(), times_.end(), time) -
+           times_.begin();
+  }
+
+  // Sorted times of the allocations and deallocations, and the memory in use
+  // from each of them to the next one.
+  std::vector<int64_t> times_;
+  std::vector<int64_t> usage_;
+};
+
+// Picks forward activations live at the peak memory usage of the CPU devices
+// for recomputation until their estimated peak fits within
+// `memory_budget_bytes`. Activations are ranked by the memory they free per
+// nanosecond of recomputation.
+//
+// The step is simulated once, for both the compute times of the nodes and the
+// lifetimes of their outputs. Picking an activation shortens the lifetime of
+// its outputs to their last forward use, and the peak is then updated from
+// the memory timeline rather than by simulating the step again.
+bool BudgetedRecomputationPass(int64_t memory_budget_bytes,
+                               const string& recomputation_targets_name_scope,
+                               Cluster* cluster, GrapplerItem* item) {
+  std::unordered_set<string> cpu_devices;
+  for (const auto& device : cluster->GetDevices()) {
+    if (device.second.type() == "CPU") {
+      cpu_devices.insert(device.first);
+    }
+  }
+  if (cpu_devices.empty()) {
+    return false;
+  }
+
+  VirtualCluster vcluster(cluster->GetDevices());
+  if (!vcluster.Provision().ok()) {
+    return false;
+  }
+  if (!vcluster.Initialize(*item).ok()) {
+    return false;
+  }
+  RunMetadata metadata;
+  Status s = vcluster.Run(item->graph, item->feed, item->fetch, &metadata);
+  // The virtual cluster reports the steps that run out of memory, which is
+  // what the pass is about to fix.
+  if (!s.ok() && s.code() != error::RESOURCE_EXHAUSTED) {
+    return false;
+  }
+
+  NodeMap node_map(&item->graph);
+  std::unordered_map<string, Costs::Duration> compute_times;
+  std::unordered_map<string, SimulatedTensor> tensors;
+  for (const auto& dev_stats : metadata.step_stats().dev_stats()) {
+    for (const auto& node_stats : dev_stats.node_stats()) {
+      compute_times.emplace(
+          node_stats.node_name(),
+          Costs::MicroSeconds(node_stats.op_end_rel_micros() -
+                              node_stats.op_start_rel_micros()));
+      const int64_t end_time =
+          node_stats.all_start_micros() + node_stats.op_end_rel_micros();
+      for (int i = 0; i < node_stats.output_size(); ++i) {
+        SimulatedTensor& tensor =
+            tensors[strings::StrCat(node_stats.node_name(), ":", i)];
+        tensor.node = node_stats.node_name();
+        tensor.device = dev_stats.device();
+        tensor.bytes = node_stats.output(i)
+                           .tensor_description()
+                           .allocation_description()
+                           .allocated_bytes();
+        tensor.allocation_time = node_stats.all_start_micros();
+        tensor.deallocation_time =
+            std::max(tensor.deallocation_time, end_time);
+        tensor.forward_deallocation_time =
+            std::max(tensor.forward_deallocation_time, end_time);
+      }
+      // Tensors are freed once their last consumer completes.
+      const NodeDef* node = node_map.GetNode(node_stats.node_name());
+      if (node == nullptr) {
+        continue;
+      }
+      const bool is_target =
+          IsRecomputationTarget(*node, recomputation_targets_name_scope);
+      for (const string& input : node->input()) {
+        int position;
+        const string input_node = ParseNodeName(input, &position);
+        if (position < 0) {
+          // Skip control dependencies.
+          continue;
+        }
+        SimulatedTensor& tensor =
+            tensors[strings::StrCat(input_node, ":", position)];
+        tensor.deallocation_time =
+            std::max(tensor.deallocation_time, end_time);
+        if (!is_target) {
+          tensor.forward_deallocation_time =
+              std::max(tensor.forward_deallocation_time, end_time);
+        }
+      }
+    }
+  }
+
+  std::unordered_set<string> feeds;
+  for (const auto& feed : item->feed) {
+    feeds.insert(NodeName(feed.first));
+  }
+  const string recomputed_node_prefix =
+      AddPrefixToNodeName("", kRecomputedNodePrefix);
+  auto can_recompute = [&](const string& name) {
+    const NodeDef* node = node_map.GetNode(name);
+    return node != nullptr && node->input_size() > 0 &&
+           compute_times.count(name) > 0 && feeds.count(name) == 0 &&
+           !absl::StartsWith(name, recomputed_node_prefix) &&
+           !IsRecomputationTarget(*node, recomputation_targets_name_scope) &&
+           !IsControlFlow(*node) && !IsPersistent(*node) &&
+           IsFreeOfSideEffect(*node);
+  };
+
+  std::unordered_set<string> nodes_to_recompute;
+  for (const string& device : cpu_devices) {
+    std::vector<const SimulatedTensor*> device_tensors;
+    // The outputs of each candidate node that recomputing it would free.
+    std::unordered_map<string, std::vector<SimulatedTensor*>> candidates;
+    for (auto& tensor : tensors) {
+      SimulatedTensor& t = tensor.second;
+      if (t.device != device) {
+        continue;
+      }
+      device_tensors.push_back(&t);
+      // Don't bother with small tensors, or with tensors that are not kept
+      // alive for backprop.
+      if (t.bytes > 1024 &&
+          t.forward_deallocation_time < t.deallocation_time &&
+          can_recompute(t.node)) {
+        candidates[t.node].push_back(&t);
+      }
+    }
+    MemoryTimeline timeline(device_tensors);
+
+    while (!candidates.empty()) {
+      int64_t peak_usage;
+      const int64_t peak_time = timeline.PeakTime(&peak_usage);
+      if (peak_usage <= memory_budget_bytes) {
+        break;
+      }
+      // Memory that recomputing each candidate node would free at the peak.
+      const string* best = nullptr;
+      double best_savings_per_ns = 0;
+      for (const auto& candidate : candidates) {
+        int64_t savings = 0;
+        for (const SimulatedTensor* t : candidate.second) {
+          if (t->allocation_time <= peak_time &&
+              t->forward_deallocation_time <= peak_time &&
+              peak_time < t->deallocation_time) {
+            savings += t->bytes;
+          }
+        }
+        const double recompute_ns =
+            std::max<double>(1.0, compute_times[candidate.first].count());
+        if (savings / recompute_ns > best_savings_per_ns) {
+          best_savings_per_ns = savings / recompute_ns;
+          best = &candidate.first;
+        }
+      }
+      if (best == nullptr) {
+        VLOG(1) << "Can't recompute enough activations to fit in the memory "
+                << "budget of " << device;
+        break;
+      }
+      VLOG(1) << "Recomputing " << *best << " to fit in the memory budget of "
+              << device;
+      for (SimulatedTensor* t : candidates[*best]) {
+        timeline.Release(t->forward_deallocation_time, t->deallocation_time,
+                         t->bytes);
+        t->deallocation_time = t->forward_deallocation_time;
+      }
+      nodes_to_recompute.insert(*best);
+      candidates.erase(*best);
+    }
+  }
+  if (nodes_to_recompute.empty()) {
+    return false;
+  }
+
+  if (!TopologicalSort(&item->graph).ok()) {
+    return false;
+  }
+  NodeMap sorted_node_map(&item->graph);
+  std::vector<RecomputedSubGraph> recomputed_subgraphs =
+      GetOpGroupsToRecompute(
+          &item->graph, sorted_node_map,
+          [&nodes_to_recompute](const NodeDef& node) {
+            return nodes_to_recompute.count(node.name()) > 0;
+          },
+          [&recomputation_targets_name_scope](const NodeDef& node) {
+            return IsRecomputationTarget(node,
+                                         recomputation_targets_name_scope);
+          });
+  RecomputeSubgraphs(recomputed_subgraphs, sorted_node_map, &item->graph);
+  return !recomputed_subgraphs.empty();
+}
+
 bool CrossesTaskOrCpuGpuBoundary(const NodeDef& node1, const NodeDef& node2) {
   string task1;
   string device1;
@@ -1401,6 +1671,9 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
   }
 
   std::unordered_set<string> skip_list;
+  // BudgetedRecomputationPass() picks all the activations to recompute at
+  // once, so it only runs in the first round.
+  bool ran_budgeted_recomputation = false;
   // Bound the number of rewrite passes to avoid long processing times on graphs
   // that simply won't fit in memory.
   // SchedulingPass() and SwappingPass() rely on defined fetches in order to
@@ -1422,6 +1695,20 @@ Status MemoryOptimizer::Optimize(Cluster* cluster, const GrapplerItem& item,
         }
       }
 
+      GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
+      if ((optimization_level_ == RewriterConfig::RECOMPUTATION_HEURISTICS ||
+           optimization_level_ == RewriterConfig::HEURISTICS) &&
+          recomputation_budget_bytes_ > 0 && !ran_budgeted_recomputation) {
+        ran_budgeted_recomputation = true;
+        if (BudgetedRecomputationPass(recomputation_budget_bytes_,
+                                      recomputation_targets_name_scope_,
+                                      cluster, &optimized_item)) {
+          // Reset the inferred memory usage since the graph changed.
+          memory.reset();
+          updated_graph = true;
+        }
+      }
+
       GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
       if ((optimization_level_ == RewriterConfig::DEFAULT_MEM_OPT ||
            optimization_level_ == RewriterConfig::SWAPPING_HEURISTICS ||
@@ -20,6 +20,7 @@ limitations under the License.
 #include <utility>
 #include <vector>
 
+#include "absl/strings/match.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/framework/graph.pb.h"
 #include "tensorflow/core/framework/node_def.pb.h"
@@ -346,6 +347,61 @@ TEST_F(MemoryOptimizerTest, SwappingHeuristics) {
 #endif
 }
 
+TEST_F(MemoryOptimizerTest, BudgetedRecomputation) {
+  tensorflow::Scope s = tensorflow::Scope::NewRootScope().WithDevice("/cpu:0");
+  Output v = ops::Variable(s.WithOpName("v"), {128, 128, 8}, DT_FLOAT);
+  Output a = ops::Exp(s.WithOpName("a"), v);
+  Output b = ops::Log(s.WithOpName("b"), a);
+  Output c = ops::Tanh(s.WithOpName("c"), b);
+  Output d = ops::AddN(s.WithOpName("gradients/d"), {c});
+  Output e = ops::AddN(s.WithOpName("gradients/e"), {d, b});
+  Output f = ops::AddN(s.WithOpName("gradients/f"), {e, a});
+
+  GrapplerItem item;
+  TF_CHECK_OK(s.ToGraphDef(&item.graph));
+  item.fetch = {"gradients/f"};
+
+  std::unique_ptr<VirtualCluster> cluster(CreateVirtualCluster());
+  auto num_recomputed_nodes = [](const GraphDef& graph) {
+    int num_recomputed = 0;
+    for (const NodeDef& node : graph.node()) {
+      if (absl::StartsWith(node.name(), "Recomputed/")) ++num_recomputed;
+    }
+    return num_recomputed;
+  };
+
+  // None of the forward ops is cheap enough for the static heuristics, and
+  // the graph fits within a large budget.
+  MemoryOptimizer large_budget(RewriterConfig::RECOMPUTATION_HEURISTICS,
+                               "gradients/", 1024 * 1024 * 1024);
+  GraphDef output;
+  TF_EXPECT_OK(large_budget.Optimize(cluster.get(), item, &output));
+  EXPECT_EQ(0, num_recomputed_nodes(output));
+
+  // Each activation takes 512KB, and a, b and c are live at the same time.
+  MemoryOptimizer small_budget(RewriterConfig::RECOMPUTATION_HEURISTICS,
+                               "gradients/", 1024 * 1024);
+  TF_EXPECT_OK(small_budget.Optimize(cluster.get(), item, &output));
+  EXPECT_LT(0, num_recomputed_nodes(output));
+  for (const NodeDef& node : output.node()) {
+    // Forward nodes never consume recomputed activations.
+    if (absl::StartsWith(node.name(), "gradients/") ||
+        absl::StartsWith(node.name(), "Recomputed")) {
+      continue;
+    }
+    for (const string& input : node.input()) {
+      EXPECT_FALSE(absl::StrContains(input, "Recomputed/")) << node.name();
+    }
+  }
+
+  // A budget that can't be met recomputes all the activations it can.
+  MemoryOptimizer tiny_budget(RewriterConfig::RECOMPUTATION_HEURISTICS,
+                              "gradients/", 1);
+  GraphDef tiny_output;
+  TF_EXPECT_OK(tiny_budget.Optimize(cluster.get(), item, &tiny_output));
+  EXPECT_LE(num_recomputed_nodes(output), num_recomputed_nodes(tiny_output));
+}
+
 TEST_F(MemoryOptimizerTest, UnswappableInputs) {
   tensorflow::Scope s = tensorflow::Scope::NewRootScope();
   Output v = ops::Variable(s.WithOpName("v").WithDevice("/gpu:0"),
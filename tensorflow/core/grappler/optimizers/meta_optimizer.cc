@@ -21,6 +21,8 @@ limitations under the License.
 #include <type_traits>
 #include <utility>
 
+#include "absl/container/flat_hash_map.h"
+#include "absl/container/flat_hash_set.h"
 #include "absl/status/status.h"
 #include "absl/strings/match.h"
 #include "absl/strings/str_cat.h"
@@ -62,7 +64,9 @@ limitations under the License.
 #include "tensorflow/core/grappler/verifiers/structure_verifier.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/gtl/map_util.h"
+#include "tensorflow/core/lib/strings/proto_serialization.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/threadpool.h"
 #include "tensorflow/core/util/dump_graph.h"
 #include "tensorflow/core/util/util.h"
 #include "tensorflow/core/util/xla_config_registry.h"
@@ -97,6 +101,11 @@ string PrintSizesBeforeAfter(const GraphDef& before, const GraphDef& after) {
                          NumEdges(after) - NumEdges(before), ")");
 }
 
+// Fingerprint used to detect whether an optimizer changed the graph.
+uint64 GraphFingerprint(const GraphDef& graph) {
+  return DeterministicProtoHash64(graph);
+}
+
 int NumIterations(const RewriterConfig& cfg) {
   return cfg.meta_optimizer_iterations() == RewriterConfig::DEFAULT_NUM_ITERS
              ? kDefaultNumberOfIterations
@@ -471,11 +480,14 @@ Status MetaOptimizer::InitializeOptimizers(
     if (cfg_.memory_optimizer_target_node_name_scope().empty()) {
       optimizers->push_back(
           // Use the default target node name prefix "gradients/"
-          std::make_unique<MemoryOptimizer>(cfg_.memory_optimization()));
+          std::make_unique<MemoryOptimizer>(
+              cfg_.memory_optimization(), "gradients/",
+              cfg_.memory_optimizer_recomputation_budget_bytes()));
     } else {
       optimizers->push_back(std::make_unique<MemoryOptimizer>(
           cfg_.memory_optimization(),
-          cfg_.memory_optimizer_target_node_name_scope()));
+          cfg_.memory_optimizer_target_node_name_scope(),
+          cfg_.memory_optimizer_recomputation_budget_bytes()));
     }
   }
   if (cfg_.auto_parallel().enable() && PLUGIN_IS_ON(auto_parallel)) {
@@ -808,6 +820,13 @@ Status MetaOptimizer::OptimizeGraph(
     CompressConstants(optimized_graph);
   }
 
+  // Optimizers are deterministic, so an optimizer that left the graph
+  // unchanged would leave it unchanged again as long as no other optimizer
+  // changed it since. Maps each such optimizer to the fingerprint of the graph
+  // it last left unchanged.
+  uint64 graph_fingerprint = GraphFingerprint(*optimized_graph);
+  absl::flat_hash_map<const GraphOptimizer*, uint64> unchanged_fingerprints;
+
   for (int iteration = 0; iteration < NumIterations(cfg_); ++iteration) {
     // Don't bother optimizing further if the graph is already tiny.
     if (optimized_graph->node_size() < min_graph_nodes) {
@@ -825,6 +844,7 @@ Status MetaOptimizer::OptimizeGraph(
           *optimized_graph);
     }
 
+    bool changed_in_iteration = false;
     for (const auto& optimizer : optimizers) {
       GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
       // Some optimizers can run only once.
@@ -837,11 +857,30 @@ Status MetaOptimizer::OptimizeGraph(
       }
 #endif
 
+      const auto unchanged = unchanged_fingerprints.find(optimizer.get());
+      if (unchanged != unchanged_fingerprints.end() &&
+          unchanged->second == graph_fingerprint) {
+        VLOG(3) << "Skipping " << optimizer->name()
+                << ", the graph did not change since its last run";
+        tensorflow::metrics::IncrementGraphOptimizationPassCount(
+            kGrapplerCategory, optimizer->name(), "skipped");
+        continue;
+      }
+
+      const uint64 fingerprint_before = graph_fingerprint;
       TF_RETURN_IF_ERROR(RunOptimizer(optimizer.get(), cluster, &item,
-                                      optimized_graph, &optimization_result));
+                                      optimized_graph, &graph_fingerprint,
+                                      &optimization_result));
 
       if (iteration == 0 && optimizer->name() == "model_pruner") {
         CompressConstants(optimized_graph);
+        graph_fingerprint = GraphFingerprint(*optimized_graph);
+      }
+      if (graph_fingerprint == fingerprint_before) {
+        unchanged_fingerprints[optimizer.get()] = graph_fingerprint;
+      } else {
+        unchanged_fingerprints.erase(optimizer.get());
+        changed_in_iteration = true;
       }
 
       if (VLOG_IS_ON(4)) {
@@ -866,12 +905,19 @@ Status MetaOptimizer::OptimizeGraph(
     for (const auto& verifier : post_optimization_verifiers) {
       TF_RETURN_IF_ERROR(verifier->Verify(*optimized_graph));
     }
+    // Further iterations would not change the graph either.
+    if (!changed_in_iteration) {
+      VLOG(3) << "Stopping after iteration " << iteration
+              << ", the graph did not change";
+      break;
+    }
   }
 #ifndef ENABLE_MKL
   // ScopedAllocatorOptimizer must run last.
   if (sa_optimizer != nullptr) {
     TF_RETURN_IF_ERROR(RunOptimizer(sa_optimizer, cluster, &item,
-                                    optimized_graph, &optimization_result));
+                                    optimized_graph, &graph_fingerprint,
+                                    &optimization_result));
     GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
   }
 #endif
@@ -883,7 +929,10 @@ Status MetaOptimizer::OptimizeGraph(
                                    }) != optimization_result.results.end();
 
   // Record graph optimization result.
-  optimization_results_.push_back(optimization_result);
+  {
+    mutex_lock l(optimization_results_mu_);
+    optimization_results_.push_back(optimization_result);
+  }
 
   if (is_optimized) {
     TF_RETURN_IF_ERROR(TopologicalSort(optimized_graph));
@@ -913,7 +962,8 @@ Status MetaOptimizer::OptimizeGraph(Cluster* cluster, GrapplerItem&& item,
 
 Status MetaOptimizer::RunOptimizer(
     GraphOptimizer* optimizer, Cluster* cluster, GrapplerItem* optimized_item,
-    GraphDef* optimized_graph, GraphOptimizationResult* optimization_result) {
+    GraphDef* optimized_graph, uint64* graph_fingerprint,
+    GraphOptimizationResult* optimization_result) {
   // If optimizer doesn't need a function library, we will replace it with a
   // stub before running optimization, and will put it back at the end.
   std::unique_ptr<FunctionDefLibrary> optimized_graph_function_library;
@@ -942,9 +992,11 @@ Status MetaOptimizer::RunOptimizer(
   timings.ReportAndStop();
 
   string message;
+  bool did_nothing = false;
   if (!status.ok()) {
     *optimized_graph = std::move(optimized_item->graph);
     if (absl::IsAborted(status)) {
+      did_nothing = true;
       // By convention we (ab-)use the Aborted error code to signal that the
       // optimizer returned without performing any changes to the graph.
       message = strings::StrCat(optimizer->name(),
@@ -973,7 +1025,22 @@ Status MetaOptimizer::RunOptimizer(
         optimized_graph_function_library.release());
   }
 
-  OptimizerResult optimizer_result{optimizer->name(), message, status};
+  // The original graph was restored if the optimizer failed or did nothing.
+  bool changed = false;
+  if (status.ok() && !did_nothing) {
+    const uint64 fingerprint_before = *graph_fingerprint;
+    *graph_fingerprint = GraphFingerprint(*optimized_graph);
+    changed = *graph_fingerprint != fingerprint_before;
+    if (!changed) absl::StrAppend(&message, " Graph unchanged.");
+  }
+  if (status.ok()) {
+    tensorflow::metrics::IncrementGraphOptimizationPassCount(
+        kGrapplerCategory, optimizer->name(),
+        changed ? "changed" : "unchanged");
+  }
+
+  OptimizerResult optimizer_result{optimizer->name(), message, status,
+                                   changed};
   optimization_result->results.push_back(optimizer_result);
 
   if (!status.ok()) {
@@ -1043,6 +1110,66 @@ void PropagateTFDataAttrs(const FunctionLibraryDefinition& flib,
   }
 }
 
+Status MetaOptimizer::OptimizeFunction(
+    Cluster* cluster, const FunctionDef& func,
+    const FunctionLibraryDefinition& flib, int producer,
+    bool allow_non_differentiable_rewrites, bool is_tpu_graph,
+    GrapplerFunctionItem* func_item, GraphDef* optimized_func_graph) {
+  GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
+
+  // Make a GrapplerItem from a FunctionDef.
+  TF_RETURN_IF_ERROR(MakeGrapplerFunctionItem(func, flib, producer, func_item));
+
+  // If we need to compute the gradient of optimized function at runtime, we
+  // can't perform non-differentiable rewrites.
+  func_item->optimization_options().allow_non_differentiable_rewrites =
+      allow_non_differentiable_rewrites;
+
+  // Device set available to the function is defined only by the runtime,
+  // when we instantiate and execute the function. We can't use all devices
+  // available to the main graph, because after partitioning the function
+  // call node might execute on a remote worker.
+  if (!func_item->devices().empty()) {
+    return errors::Internal("GrapplerFunctionItem devices must be empty.");
+  }
+
+  // We are not allowed to prune certain types of ops from the graph
+  // instantiated by the function definition, because we must guarantee
+  // function execution semantics wrt side effects (see
+  // function_optimizer.cc).
+  func_item->optimization_options().allow_pruning_stateful_and_dataset_ops =
+      false;
+
+  // Optimize function body graph.
+  if (is_tpu_graph) {
+    // Skip optimizing functions if this is a TPU graph. Currently, Grappler
+    // passes do not handle TPU functions correctly in a variety of ways
+    // (Note that due to the pre-placement TPU graph rewriting passes, the
+    // TPU-related ops are encapsulated away into functions). For example,
+    // TPU graphs contain TPUReplicateMetadata node that carries relevant
+    // TPU metadata and Grappler passes could prune that away. Grappler
+    // passes could also cause issues around shape inference. Since the
+    // desired and existing behavior is to not optimize TPU functions with
+    // Grappler, this check preserves that. The only exception is
+    // implementation selector what is required to swap in some TPU specific
+    // lowering code and is verified the work correctly on TPUs.
+    ImplementationSelector implementation_selector;
+
+    // Implementation selector needs to have access to valid function
+    // signature and attributes, and it doesn't need actual function body.
+    std::unique_ptr<FunctionDefLibrary> func_item_function_library(
+        func_item->graph.release_library());
+    *func_item->graph.mutable_library() =
+        GetFunctionDefLibraryStub(*func_item_function_library);
+
+    return implementation_selector.Optimize(cluster, *func_item,
+                                            optimized_func_graph);
+  }
+  GrapplerFunctionItem func_item_copy = *func_item;
+  return OptimizeGraph(cluster, std::move(func_item_copy),
+                       optimized_func_graph);
+}
+
 Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
                                           GraphDef* optimized_graph) {
   tensorflow::metrics::ScopedCounter<2> timings(
@@ -1050,7 +1177,10 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
       {kGrapplerCategory, "*"});
 
   VLOG(1) << "Starting optimization for grappler item: " << item.id;
-  optimization_results_.clear();
+  {
+    mutex_lock l(optimization_results_mu_);
+    optimization_results_.clear();
+  }
 
   // Constructs a FunctionLibraryDefinition with functions that are reachable
   // from the nodes of the graph.
@@ -1159,15 +1289,38 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
   // True if this is a TPU graph using the old bridge.
   bool is_tpu_graph = IsLegacyTPUBridgeGraphDef(*optimized_graph);
 
+  // Adds the function `func_name`, optimized into `optimized_func_graph`, to
+  // `flib`.
+  const auto update_function =
+      [&flib](const string& func_name, GrapplerFunctionItem& func_item,
+              GraphDef&& optimized_func_graph) -> Status {
+    // Function body optimization might have created new specialized
+    // functions for each instantiation context. Add them to the library.
+    for (const FunctionDef& func_def :
+         optimized_func_graph.library().function()) {
+      if (flib.Find(func_def.signature().name()) == nullptr) {
+        TF_RETURN_IF_ERROR(flib.AddFunctionDef(func_def));
+      }
+    }
+
+    // Convert optimized graph back to FunctionDef.
+    FunctionDef optimized_func;
+    func_item.SwapFunctionBody(std::move(optimized_func_graph));
+    TF_RETURN_IF_ERROR(MakeFunctionDef(func_item, flib, &optimized_func));
+
+    // Replace optimized function with a new FunctionDef.
+    return flib.ReplaceFunction(func_name, optimized_func);
+  };
+
+  const int num_function_threads = cfg_.meta_optimizer_function_threads();
+
   // Optimize each function only once.
   absl::flat_hash_set<string> optimized_funcs;
   while (optimize_function_library) {
     optimize_function_library = false;
 
-    int function_idx = 0;
+    std::vector<const FunctionDef*> funcs_to_optimize;
     for (const FunctionDef& func : optimized_graph->library().function()) {
-      GRAPPLER_RETURN_IF_DEADLINE_EXCEEDED();
-
       const string& func_name = func.signature().name();
 
       // Skip functions that are not reachable from the optimized graph.
@@ -1187,87 +1340,58 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
       // and in function instantiation.
       if (data::IsTFDataFunction(func)) continue;
 
-      VLOG(3) << "Optimize function: function=" << func_name << " ["
-              << function_idx++ << " of "
-              << optimized_graph->library().function_size() << "]";
-
       // Function optimization might specialize nested function calls, so we
       // have to reset the flag and do at least one more pass over the library.
       optimize_function_library = true;
       optimized_funcs.insert(func_name);
+      funcs_to_optimize.push_back(&func);
+    }
 
-      // Make a GrapplerItem from a FunctionDef.
-      GrapplerFunctionItem func_item;
-      TF_RETURN_IF_ERROR(
-          MakeGrapplerFunctionItem(func, flib, producer, &func_item));
-
-      // If we need to compute the gradient of optimized function at runtime, we
-      // can't perform non-differentiable rewrites.
-      func_item.optimization_options().allow_non_differentiable_rewrites =
-          !differentiable_functions.contains(func_name);
-
-      // Device set available to the function is defined only by the runtime,
-      // when we instantiate and execute the function. We can't use all devices
-      // available to the main graph, because after partitioning the function
-      // call node might execute on a remote worker.
-      if (!func_item.devices().empty()) {
-        return errors::Internal("GrapplerFunctionItem devices must be empty.");
-      }
-
-      // We are not allowed to prune certain types of ops from the graph
-      // instantiated by the function definition, because we must guarantee
-      // function execution semantics wrt side effects (see
-      // function_optimizer.cc).
-      func_item.optimization_options().allow_pruning_stateful_and_dataset_ops =
-          false;
-
-      // Optimize function body graph.
-      GraphDef optimized_func_graph;
-      if (is_tpu_graph) {
-        // Skip optimizing functions if this is a TPU graph. Currently, Grappler
-        // passes do not handle TPU functions correctly in a variety of ways
-        // (Note that due to the pre-placement TPU graph rewriting passes, the
-        // TPU-related ops are encapsulated away into functions). For example,
-        // TPU graphs contain TPUReplicateMetadata node that carries relevant
-        // TPU metadata and Grappler passes could prune that away. Grappler
-        // passes could also cause issues around shape inference. Since the
-        // desired and existing behavior is to not optimize TPU functions with
-        // Grappler, this check preserves that. The only exception is
-        // implementation selector what is required to swap in some TPU specific
-        // lowering code and is verified the work correctly on TPUs.
-        ImplementationSelector implementation_selector;
-
-        // Implementation selector needs to have access to valid function
-        // signature and attributes, and it doesn't need actual function body.
-        std::unique_ptr<FunctionDefLibrary> func_item_function_library(
-            func_item.graph.release_library());
-        *func_item.graph.mutable_library() =
-            GetFunctionDefLibraryStub(*func_item_function_library);
-
-        TF_RETURN_IF_ERROR(implementation_selector.Optimize(
-            cluster, func_item, &optimized_func_graph));
-      } else {
-        GrapplerFunctionItem func_item_copy = func_item;
-        TF_RETURN_IF_ERROR(OptimizeGraph(cluster, std::move(func_item_copy),
-                                         &optimized_func_graph));
+    if (num_function_threads <= 1 || funcs_to_optimize.size() <= 1) {
+      for (size_t i = 0; i < funcs_to_optimize.size(); ++i) {
+        const FunctionDef& func = *funcs_to_optimize[i];
+        const string& func_name = func.signature().name();
+        VLOG(3) << "Optimize function: function=" << func_name << " [" << i
+                << " of " << funcs_to_optimize.size() << "]";
+
+        GrapplerFunctionItem func_item;
+        GraphDef optimized_func_graph;
+        TF_RETURN_IF_ERROR(OptimizeFunction(
+            cluster, func, flib, producer,
+            !differentiable_functions.contains(func_name), is_tpu_graph,
+            &func_item, &optimized_func_graph));
+        TF_RETURN_IF_ERROR(update_function(func_name, func_item,
+                                           std::move(optimized_func_graph)));
       }
-
-      // Function body optimization might have created new specialized
-      // functions for each instantiation context. Add them to the library.
-      for (const FunctionDef& func_def :
-           optimized_func_graph.library().function()) {
-        if (flib.Find(func_def.signature().name()) == nullptr) {
-          TF_RETURN_IF_ERROR(flib.AddFunctionDef(func_def));
+    } else {
+      // Functions are optimized independently of each other, against the
+      // library as it is now, and then all added to the library in order.
+      const int num_funcs = funcs_to_optimize.size();
+      VLOG(3) << "Optimize " << num_funcs << " functions on "
+              << std::min(num_function_threads, num_funcs) << " threads";
+      std::vector<GrapplerFunctionItem> func_items(num_funcs);
+      std::vector<GraphDef> optimized_func_graphs(num_funcs);
+      std::vector<Status> statuses(num_funcs);
+      {
+        thread::ThreadPool pool(Env::Default(), "meta_optimizer_functions",
+                                std::min(num_function_threads, num_funcs));
+        for (int i = 0; i < num_funcs; ++i) {
+          pool.Schedule([&, i]() {
+            const FunctionDef& func = *funcs_to_optimize[i];
+            statuses[i] = OptimizeFunction(
+                cluster, func, flib, producer,
+                !differentiable_functions.contains(func.signature().name()),
+                is_tpu_graph, &func_items[i], &optimized_func_graphs[i]);
+          });
         }
+        // The pool's destructor waits for all functions to be optimized.
+      }
+      for (int i = 0; i < num_funcs; ++i) {
+        TF_RETURN_IF_ERROR(statuses[i]);
+        TF_RETURN_IF_ERROR(update_function(
+            funcs_to_optimize[i]->signature().name(), func_items[i],
+            std::move(optimized_func_graphs[i])));
       }
-
-      // Convert optimized graph back to FunctionDef.
-      FunctionDef optimized_func;
-      func_item.SwapFunctionBody(std::move(optimized_func_graph));
-      TF_RETURN_IF_ERROR(MakeFunctionDef(func_item, flib, &optimized_func));
-
-      // Replace optimized function with a new FunctionDef.
-      TF_RETURN_IF_ERROR(flib.ReplaceFunction(func_name, optimized_func));
     }
 
     // If optimized at least one function, update the graph library.
@@ -1315,6 +1439,7 @@ Status MetaOptimizer::OptimizeConsumeItem(Cluster* cluster, GrapplerItem&& item,
 }
 
 string MetaOptimizer::GetResultString() const {
+  mutex_lock l(optimization_results_mu_);
   std::string result_string;
   for (const GraphOptimizationResult& graph_result : optimization_results_) {
     absl::StrAppend(&result_string,
@@ -1330,6 +1455,16 @@ string MetaOptimizer::GetResultString() const {
 
 void MetaOptimizer::PrintResult() { VLOG(1) << GetResultString(); }
 
+bool MetaOptimizer::AllOptimizersSucceeded() const {
+  mutex_lock l(optimization_results_mu_);
+  for (const GraphOptimizationResult& graph_result : optimization_results_) {
+    for (const OptimizerResult& result : graph_result.results) {
+      if (!result.status.ok()) return false;
+    }
+  }
+  return true;
+}
+
 bool MetaOptimizerEnabled(const ConfigProto& cfg) {
   const auto& rewrite_cfg = cfg.graph_options().rewrite_options();
   if (rewrite_cfg.disable_meta_optimizer()) {
@@ -1364,11 +1499,22 @@ bool MetaOptimizerEnabled(const ConfigProto& cfg) {
 Status RunMetaOptimizer(GrapplerItem&& item, const ConfigProto& cfg,
                         DeviceBase* cpu_device, Cluster* cluster,
                         GraphDef* optimized_graph) {
+  bool all_optimizers_succeeded;
+  return RunMetaOptimizer(std::move(item), cfg, cpu_device, cluster,
+                          optimized_graph, &all_optimizers_succeeded);
+}
+
+Status RunMetaOptimizer(GrapplerItem&& item, const ConfigProto& cfg,
+                        DeviceBase* cpu_device, Cluster* cluster,
+                        GraphDef* optimized_graph,
+                        bool* all_optimizers_succeeded) {
   MetaOptimizer optimizer(cpu_device, cfg);
   optimizer.set_deadline_usec(
       DeadlineMicroSeconds(cfg.graph_options().rewrite_options()));
-  return optimizer.OptimizeConsumeItem(cluster, std::move(item),
-                                       optimized_graph);
+  Status status =
+      optimizer.OptimizeConsumeItem(cluster, std::move(item), optimized_graph);
+  *all_optimizers_succeeded = status.ok() && optimizer.AllOptimizersSucceeded();
+  return status;
 }
 
 Status OptimizeGraph(
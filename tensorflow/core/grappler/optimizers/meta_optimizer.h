@@ -22,8 +22,11 @@ limitations under the License.
 #include "tensorflow/core/graph/graph.h"
 #include "tensorflow/core/grappler/grappler_item.h"
 #include "tensorflow/core/grappler/optimizers/graph_optimizer.h"
+#include "tensorflow/core/grappler/utils/functions.h"
 #include "tensorflow/core/grappler/verifiers/graph_verifier.h"
 #include "tensorflow/core/lib/core/status.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/protobuf/config.pb.h"
 #include "tensorflow/core/protobuf/rewriter_config.pb.h"
 #include "tensorflow/core/protobuf/verifier_config.pb.h"
@@ -54,6 +57,11 @@ class MetaOptimizer : public GraphOptimizer {
 
   void PrintResult();
 
+  // Returns false if an optimizer of the last run failed without failing the
+  // run, e.g. by exceeding its deadline (see
+  // RewriterConfig.fail_on_optimizer_errors).
+  bool AllOptimizersSucceeded() const;
+
  private:
   std::unique_ptr<GraphOptimizer> MakeNewOptimizer(
       const string& optimizer, const std::set<string>& device_types) const;
@@ -106,6 +114,8 @@ class MetaOptimizer : public GraphOptimizer {
     string optimizer_name;
     string message;
     Status status;
+    // Whether the optimizer changed the graph.
+    bool changed = false;
   };
 
   struct GraphOptimizationResult {
@@ -114,11 +124,25 @@ class MetaOptimizer : public GraphOptimizer {
     std::vector<OptimizerResult> results;
   };
 
+  // Runs `optimizer` on `optimized_graph`, whose fingerprint (see
+  // GraphFingerprint()) is `*graph_fingerprint`, and updates the fingerprint.
   Status RunOptimizer(GraphOptimizer* optimizer, Cluster* cluster,
                       GrapplerItem* optimized_item, GraphDef* optimized_graph,
+                      uint64* graph_fingerprint,
                       GraphOptimizationResult* optimization_result);
 
-  std::vector<GraphOptimizationResult> optimization_results_;
+  // Makes `func_item` from `func` and optimizes its body into
+  // `optimized_func_graph`. Only reads `flib`, so functions can be optimized
+  // concurrently.
+  Status OptimizeFunction(Cluster* cluster, const FunctionDef& func,
+                          const FunctionLibraryDefinition& flib, int producer,
+                          bool allow_non_differentiable_rewrites,
+                          bool is_tpu_graph, GrapplerFunctionItem* func_item,
+                          GraphDef* optimized_func_graph);
+
+  mutable mutex optimization_results_mu_;
+  std::vector<GraphOptimizationResult> optimization_results_
+      TF_GUARDED_BY(optimization_results_mu_);
 };
 
 bool MetaOptimizerEnabled(const ConfigProto& cfg);
@@ -133,6 +157,14 @@ Status RunMetaOptimizer(GrapplerItem&& item, const ConfigProto& cfg,
                         DeviceBase* cpu_device, Cluster* cluster,
                         GraphDef* optimized_graph);
 
+// Same as above, and sets <all_optimizers_succeeded> to whether the optimized
+// graph is the result of a clean run, without errors swallowed by the meta
+// optimizer (see MetaOptimizer::AllOptimizersSucceeded()).
+Status RunMetaOptimizer(GrapplerItem&& item, const ConfigProto& cfg,
+                        DeviceBase* cpu_device, Cluster* cluster,
+                        GraphDef* optimized_graph,
+                        bool* all_optimizers_succeeded);
+
 // Wrapper around RunMetaOptimizer convenient for optimizing
 // function graphs.
 //
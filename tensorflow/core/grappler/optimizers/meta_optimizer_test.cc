@@ -18,6 +18,7 @@ limitations under the License.
 #include <atomic>
 
 #include "absl/strings/match.h"
+#include "absl/strings/str_cat.h"
 #include "absl/strings/substitute.h"
 #include "tensorflow/cc/ops/standard_ops.h"
 #include "tensorflow/core/framework/dataset.h"
@@ -792,6 +793,48 @@ TEST_F(MetaOptimizerTest, OptimizerDoesNotTimeOut) {
   EXPECT_EQ(original_node_size + 2, output.node_size());
 }
 
+class FailingOptimizer : public CustomGraphOptimizer {
+ public:
+  string name() const override { return "failing_optimizer"; }
+  bool UsesFunctionLibrary() const override { return false; }
+
+  Status Init(
+      const tensorflow::RewriterConfig_CustomGraphOptimizer* config) override {
+    return OkStatus();
+  }
+
+  Status Optimize(Cluster* cluster, const GrapplerItem& item,
+                  GraphDef* optimized_graph) override {
+    return errors::Internal("failing_optimizer failed");
+  }
+};
+
+REGISTER_GRAPH_OPTIMIZER(FailingOptimizer);
+
+TEST_F(MetaOptimizerTest, ReportsSwallowedOptimizerErrors) {
+  TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {kDevice});
+  GrapplerItem item;
+  ASSERT_TRUE(fake_input.NextItem(&item));
+  GrapplerItem failing_item = item;
+
+  ConfigProto config;
+  RewriterConfig& rewriter_config =
+      *config.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.add_optimizers("TestOptimizer");
+  rewriter_config.set_min_graph_nodes(-1);
+
+  GraphDef output;
+  bool all_optimizers_succeeded = false;
+  TF_EXPECT_OK(RunMetaOptimizer(std::move(item), config, nullptr, nullptr,
+                                &output, &all_optimizers_succeeded));
+  EXPECT_TRUE(all_optimizers_succeeded);
+
+  rewriter_config.add_optimizers("FailingOptimizer");
+  TF_EXPECT_OK(RunMetaOptimizer(std::move(failing_item), config, nullptr,
+                                nullptr, &output, &all_optimizers_succeeded));
+  EXPECT_FALSE(all_optimizers_succeeded);
+}
+
 TEST_F(MetaOptimizerTest, RunPostOptimizationVerifiersOnValidGraph) {
   TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {kDevice});
   GrapplerItem item;
@@ -1412,6 +1455,71 @@ INSTANTIATE_TEST_SUITE_P(
       return test_name;
     });
 
+TEST_F(MetaOptimizerTest, StopsIteratingWhenGraphIsUnchanged) {
+  TrivialTestGraphInputYielder fake_input(4, 1, 10, false, {kDevice});
+  GrapplerItem item;
+  ASSERT_TRUE(fake_input.NextItem(&item));
+
+  // TfDataTestOptimizer counts its calls and never changes the graph.
+  TfDataTestOptimizer::InitCount();
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.add_optimizers("TfDataTestOptimizer");
+  rewriter_config.set_meta_optimizer_iterations(RewriterConfig::TWO);
+  rewriter_config.set_min_graph_nodes(-1);
+
+  MetaOptimizer optimizer(nullptr, config_proto);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+  EXPECT_EQ(TfDataTestOptimizer::GetCount(), 1);
+  EXPECT_TRUE(
+      absl::StrContains(optimizer.GetResultString(), "Graph unchanged."));
+}
+
+TEST_F(MetaOptimizerTest, OptimizesFunctionsInParallel) {
+  using test::function::NDef;
+
+  constexpr int kNumFunctions = 8;
+  std::vector<FunctionDef> funcs;
+  std::vector<NodeDef> nodes = {
+      NDef("a", "Placeholder", {}, {{"dtype", DT_FLOAT}}, kDevice)};
+  for (int i = 0; i < kNumFunctions; ++i) {
+    const string name = absl::StrCat("func_", i);
+    funcs.push_back(FunctionDefHelper::Create(
+        name, {"x:float"}, {"z:float"}, {},
+        /*node_def=*/
+        {{{"mul"}, "Mul", {"x", "x"}, {{"T", DT_FLOAT}}}},
+        /*ret_def=*/
+        {{"z", "mul:z:0"}}));
+    nodes.push_back(NDef(absl::StrCat("call_", i), name, {"a"}, {}, kDevice));
+  }
+  GrapplerItem item;
+  item.id = "tf_graph";
+  item.graph = test::function::GDef(nodes, funcs);
+
+  TfDataTestOptimizer::InitCount();
+  ConfigProto config_proto;
+  auto& rewriter_config =
+      *config_proto.mutable_graph_options()->mutable_rewrite_options();
+  rewriter_config.add_optimizers("TfDataTestOptimizer");
+  rewriter_config.set_min_graph_nodes(-1);
+  rewriter_config.set_meta_optimizer_function_threads(4);
+
+  MetaOptimizer optimizer(nullptr, config_proto);
+  GraphDef output;
+  TF_EXPECT_OK(optimizer.Optimize(nullptr, item, &output));
+
+  // The main graph and each function are optimized once.
+  EXPECT_EQ(TfDataTestOptimizer::GetCount(), kNumFunctions + 1);
+  FunctionLibraryDefinition flib(OpRegistry::Global(), output.library());
+  for (int i = 0; i < kNumFunctions; ++i) {
+    const FunctionDef* func = flib.Find(absl::StrCat("func_", i));
+    ASSERT_NE(func, nullptr);
+    EXPECT_EQ(func->node_def_size(), 1);
+  }
+}
+
 }  // namespace
 }  // namespace grappler
 }  // namespace tensorflow
@@ -0,0 +1,223 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/async_checkpoint_saver.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "absl/container/flat_hash_set.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/strcat.h"
+
+namespace tensorflow {
+namespace checkpoint {
+
+AsyncCheckpointSaver::AsyncCheckpointSaver(int max_pending_saves)
+    : max_pending_saves_(std::max(max_pending_saves, 1)) {
+  // One thread per pending save, and one for merges.
+  for (int i = 0; i <= max_pending_saves_; ++i) {
+    threads_.emplace_back(Env::Default()->StartThread(
+        ThreadOptions(), "async_checkpoint_saver", [this]() { Run(); }));
+  }
+}
+
+AsyncCheckpointSaver::~AsyncCheckpointSaver() {
+  {
+    mutex_lock l(mu_);
+    shutting_down_ = true;
+    cond_.notify_all();
+  }
+  // Joins the threads, which drain the queue first.
+  threads_.clear();
+  mutex_lock l(mu_);
+  for (const auto& error : errors_) {
+    LOG(ERROR) << "Asynchronous checkpoint operation for " << error.first
+               << " failed: " << error.second;
+  }
+}
+
+namespace {
+
+mutex global_saver_mu(LINKER_INITIALIZED);
+AsyncCheckpointSaver* global_saver TF_GUARDED_BY(global_saver_mu) = nullptr;
+
+void WaitForGlobalSaver() {
+  Status status = AsyncCheckpointSaver::GlobalIfCreated()->WaitForAll();
+  if (!status.ok()) LOG(ERROR) << status;
+}
+
+}  // namespace
+
+AsyncCheckpointSaver* AsyncCheckpointSaver::Global(int max_pending_saves) {
+  mutex_lock l(global_saver_mu);
+  if (global_saver == nullptr) {
+    global_saver = new AsyncCheckpointSaver(max_pending_saves);
+    // The saver is never destroyed, but completes its writes before exit.
+    std::atexit(WaitForGlobalSaver);
+  }
+  return global_saver;
+}
+
+AsyncCheckpointSaver* AsyncCheckpointSaver::GlobalIfCreated() {
+  mutex_lock l(global_saver_mu);
+  return global_saver;
+}
+
+void AsyncCheckpointSaver::Enqueue(Op op) {
+  ++num_pending_[op.prefix];
+  if (op.is_save) ++num_pending_saves_;
+  queue_.push_back(std::move(op));
+  cond_.notify_all();
+}
+
+Status AsyncCheckpointSaver::ScheduleSave(const std::string& prefix,
+                                          std::function<Status()> save_fn) {
+  mutex_lock l(mu_);
+  if (!errors_.empty()) {
+    auto it = errors_.begin();
+    Status error = errors::CreateWithUpdatedMessage(
+        it->second, strings::StrCat("Asynchronous checkpoint operation for ",
+                                    it->first,
+                                    " failed: ", it->second.message()));
+    errors_.erase(it);
+    return error;
+  }
+  while (num_pending_saves_ >= max_pending_saves_) {
+    cond_.wait(l);
+  }
+  Enqueue({prefix, {}, std::move(save_fn), /*is_save=*/true});
+  return OkStatus();
+}
+
+void AsyncCheckpointSaver::ScheduleMerge(
+    const std::vector<std::string>& input_prefixes,
+    const std::string& merged_prefix, std::function<Status()> merge_fn) {
+  mutex_lock l(mu_);
+  Enqueue({merged_prefix, input_prefixes, std::move(merge_fn),
+           /*is_save=*/false});
+}
+
+Status AsyncCheckpointSaver::Wait(absl::string_view prefix) {
+  const std::string prefix_string(prefix);
+  mutex_lock l(mu_);
+  while (num_pending_.contains(prefix_string)) {
+    cond_.wait(l);
+  }
+  Status status;
+  auto it = errors_.find(prefix_string);
+  if (it != errors_.end()) {
+    status = std::move(it->second);
+    errors_.erase(it);
+  }
+  return status;
+}
+
+Status AsyncCheckpointSaver::WaitForAll() {
+  mutex_lock l(mu_);
+  while (!num_pending_.empty()) {
+    cond_.wait(l);
+  }
+  Status status;
+  for (const auto& error : errors_) {
+    status.Update(errors::CreateWithUpdatedMessage(
+        error.second,
+        strings::StrCat("Asynchronous checkpoint operation for ", error.first,
+                        " failed: ", error.second.message())));
+  }
+  errors_.clear();
+  return status;
+}
+
+std::deque<AsyncCheckpointSaver::Op>::iterator
+AsyncCheckpointSaver::FindRunnable() {
+  // Prefixes used by operations queued before the current one.
+  absl::flat_hash_set<absl::string_view> queued_prefixes;
+  auto is_busy = [&](const std::string& prefix) {
+    return num_running_.contains(prefix) || queued_prefixes.contains(prefix);
+  };
+  for (auto it = queue_.begin(); it != queue_.end(); ++it) {
+    bool runnable = !is_busy(it->prefix);
+    for (const std::string& input_prefix : it->input_prefixes) {
+      runnable = runnable && !is_busy(input_prefix);
+    }
+    if (runnable) return it;
+    queued_prefixes.insert(it->prefix);
+    queued_prefixes.insert(it->input_prefixes.begin(),
+                           it->input_prefixes.end());
+  }
+  return queue_.end();
+}
+
+void AsyncCheckpointSaver::Run() {
+  while (true) {
+    Op op;
+    Status status;
+    {
+      mutex_lock l(mu_);
+      auto it = FindRunnable();
+      while (it == queue_.end()) {
+        if (queue_.empty() && shutting_down_) return;
+        cond_.wait(l);
+        it = FindRunnable();
+      }
+      op = std::move(*it);
+      queue_.erase(it);
+      ++num_running_[op.prefix];
+      for (const std::string& input_prefix : op.input_prefixes) {
+        ++num_running_[input_prefix];
+      }
+      // Errors of the inputs are consumed by, and attributed to, the output.
+      for (const std::string& input_prefix : op.input_prefixes) {
+        auto error_it = errors_.find(input_prefix);
+        if (error_it == errors_.end()) continue;
+        status.Update(error_it->second);
+        errors_.erase(error_it);
+      }
+    }
+
+    if (status.ok()) {
+      VLOG(1) << "Running asynchronous checkpoint operation for " << op.prefix;
+      status = op.fn();
+    }
+    // Releases the captured tensors before waking up blocked savers.
+    op.fn = nullptr;
+
+    mutex_lock l(mu_);
+    if (!status.ok()) {
+      LOG(WARNING) << "Asynchronous checkpoint operation for " << op.prefix
+                   << " failed: " << status;
+      errors_[op.prefix].Update(status);
+    }
+    auto release = [this](const std::string& prefix) {
+      auto running_it = num_running_.find(prefix);
+      if (--running_it->second == 0) num_running_.erase(running_it);
+    };
+    release(op.prefix);
+    for (const std::string& input_prefix : op.input_prefixes) {
+      release(input_prefix);
+    }
+    auto it = num_pending_.find(op.prefix);
+    if (--it->second == 0) num_pending_.erase(it);
+    if (op.is_save) --num_pending_saves_;
+    cond_.notify_all();
+  }
+}
+
+}  // namespace checkpoint
+}  // namespace tensorflow
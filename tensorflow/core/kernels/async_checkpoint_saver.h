@@ -0,0 +1,128 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_ASYNC_CHECKPOINT_SAVER_H_
+#define TENSORFLOW_CORE_KERNELS_ASYNC_CHECKPOINT_SAVER_H_
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/container/flat_hash_map.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+namespace checkpoint {
+
+// Writes checkpoints on background threads so that SaveV2 can return as soon
+// as it has captured its inputs.
+//
+// The inputs of SaveV2 are copy-on-write snapshots of the saved variables:
+// while a save holds a reference to a variable's buffer, a dense update of
+// the variable copies the buffer before writing to it (see
+// framework/resource_var.h). Capturing the inputs is therefore free, and the
+// cost of a snapshot is paid only for variables updated before the write
+// completes. The number of outstanding saves is bounded to cap that memory.
+//
+// Operations are tracked by checkpoint prefix. Operations on different
+// prefixes run concurrently, while an operation waits for all the operations
+// scheduled before it on its prefix, and on the input prefixes of a merge. A
+// single saver is shared by all the devices of the process (see Global()), so
+// that a merge waits for the saves of its shards wherever they were written.
+class AsyncCheckpointSaver {
+ public:
+  // Runs operations on "max_pending_saves" + 1 threads, so that a merge can
+  // run while the maximum number of saves is outstanding.
+  explicit AsyncCheckpointSaver(int max_pending_saves);
+
+  // Waits for all scheduled operations to complete.
+  ~AsyncCheckpointSaver();
+
+  AsyncCheckpointSaver(const AsyncCheckpointSaver&) = delete;
+  AsyncCheckpointSaver& operator=(const AsyncCheckpointSaver&) = delete;
+
+  // Returns the saver of the process, creating it with "max_pending_saves" on
+  // first use. Its operations complete before the process exits.
+  static AsyncCheckpointSaver* Global(int max_pending_saves);
+
+  // Returns the saver of the process, or nullptr if nothing created it yet.
+  static AsyncCheckpointSaver* GlobalIfCreated();
+
+  // Schedules "save_fn", which writes the checkpoint at "prefix" from the
+  // tensors it captured. Blocks while "max_pending_saves" saves are
+  // outstanding.
+  //
+  // Returns the first error of an earlier operation that nobody has waited
+  // for yet, in which case "save_fn" is not scheduled.
+  Status ScheduleSave(const std::string& prefix,
+                      std::function<Status()> save_fn);
+
+  // Schedules "merge_fn", which combines the checkpoints at "input_prefixes"
+  // into "merged_prefix", after all the operations already scheduled on these
+  // prefixes. If any input failed to save, "merge_fn" is skipped and the error
+  // is reported for "merged_prefix" instead.
+  void ScheduleMerge(const std::vector<std::string>& input_prefixes,
+                     const std::string& merged_prefix,
+                     std::function<Status()> merge_fn);
+
+  // Blocks until all operations scheduled for "prefix" have completed and
+  // returns the first error among them.
+  Status Wait(absl::string_view prefix);
+
+  // Blocks until all scheduled operations have completed and returns the
+  // first error among those not yet returned by Wait().
+  Status WaitForAll();
+
+ private:
+  struct Op {
+    std::string prefix;
+    std::vector<std::string> input_prefixes;
+    std::function<Status()> fn;
+    bool is_save;
+  };
+
+  void Enqueue(Op op) TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  // Returns the first queued operation whose prefixes are not used by a
+  // running operation or by an operation queued before it, or queue_.end().
+  std::deque<Op>::iterator FindRunnable() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  void Run();
+
+  const int max_pending_saves_;
+
+  mutex mu_;
+  condition_variable cond_;
+  std::deque<Op> queue_ TF_GUARDED_BY(mu_);
+  int num_pending_saves_ TF_GUARDED_BY(mu_) = 0;
+  // Number of queued or running operations per prefix.
+  absl::flat_hash_map<std::string, int> num_pending_ TF_GUARDED_BY(mu_);
+  // Number of running operations using each prefix, as output or input.
+  absl::flat_hash_map<std::string, int> num_running_ TF_GUARDED_BY(mu_);
+  // Errors of completed operations, per prefix, not yet returned by Wait().
+  absl::flat_hash_map<std::string, Status> errors_ TF_GUARDED_BY(mu_);
+  bool shutting_down_ TF_GUARDED_BY(mu_) = false;
+
+  std::vector<std::unique_ptr<Thread>> threads_;
+};
+
+}  // namespace checkpoint
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_ASYNC_CHECKPOINT_SAVER_H_
@@ -0,0 +1,183 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/async_checkpoint_saver.h"
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/strings/match.h"
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/test.h"
+
+namespace tensorflow {
+namespace checkpoint {
+namespace {
+
+TEST(AsyncCheckpointSaverTest, RunsInScheduleOrder) {
+  auto saver = std::make_unique<AsyncCheckpointSaver>(/*max_pending=*/4);
+  mutex mu;
+  std::vector<std::string> order;
+  auto record = [&](const std::string& name) {
+    return [&, name]() {
+      mutex_lock l(mu);
+      order.push_back(name);
+      return OkStatus();
+    };
+  };
+  TF_ASSERT_OK(saver->ScheduleSave("a", record("a")));
+  TF_ASSERT_OK(saver->ScheduleSave("b", record("b")));
+  saver->ScheduleMerge({"a", "b"}, "merged", record("merged"));
+  TF_ASSERT_OK(saver->Wait("merged"));
+  {
+    mutex_lock l(mu);
+    // The saves of different prefixes may run in any order.
+    ASSERT_EQ(order.size(), 3);
+    EXPECT_EQ(order.back(), "merged");
+  }
+}
+
+TEST(AsyncCheckpointSaverTest, RunsSamePrefixInScheduleOrder) {
+  auto saver = std::make_unique<AsyncCheckpointSaver>(/*max_pending=*/4);
+  mutex mu;
+  std::vector<int> order;
+  for (int i = 0; i < 4; ++i) {
+    TF_ASSERT_OK(saver->ScheduleSave("a", [&, i]() {
+      mutex_lock l(mu);
+      order.push_back(i);
+      return OkStatus();
+    }));
+  }
+  TF_ASSERT_OK(saver->Wait("a"));
+  mutex_lock l(mu);
+  EXPECT_EQ(order, std::vector<int>({0, 1, 2, 3}));
+}
+
+TEST(AsyncCheckpointSaverTest, RunsDifferentPrefixesConcurrently) {
+  auto saver = std::make_unique<AsyncCheckpointSaver>(/*max_pending=*/2);
+  // Each save waits for the other one to start, which deadlocks unless they
+  // run concurrently.
+  Notification a_started, b_started;
+  TF_ASSERT_OK(saver->ScheduleSave("a", [&]() {
+    a_started.Notify();
+    b_started.WaitForNotification();
+    return OkStatus();
+  }));
+  TF_ASSERT_OK(saver->ScheduleSave("b", [&]() {
+    b_started.Notify();
+    a_started.WaitForNotification();
+    return OkStatus();
+  }));
+  TF_EXPECT_OK(saver->Wait("a"));
+  TF_EXPECT_OK(saver->Wait("b"));
+}
+
+TEST(AsyncCheckpointSaverTest, MergeWaitsForAllInputs) {
+  auto saver = std::make_unique<AsyncCheckpointSaver>(/*max_pending=*/2);
+  Notification release;
+  bool b_saved = false;
+  bool saved_before_merge = false;
+  TF_ASSERT_OK(saver->ScheduleSave("a", []() { return OkStatus(); }));
+  TF_ASSERT_OK(saver->ScheduleSave("b", [&]() {
+    release.WaitForNotification();
+    b_saved = true;
+    return OkStatus();
+  }));
+  saver->ScheduleMerge({"a", "b"}, "merged", [&]() {
+    saved_before_merge = b_saved;
+    return OkStatus();
+  });
+  TF_ASSERT_OK(saver->Wait("a"));
+  release.Notify();
+  TF_ASSERT_OK(saver->Wait("merged"));
+  EXPECT_TRUE(saved_before_merge);
+}
+
+TEST(AsyncCheckpointSaverTest, GlobalSaverIsShared) {
+  AsyncCheckpointSaver* saver =
+      AsyncCheckpointSaver::Global(/*max_pending=*/2);
+  EXPECT_EQ(AsyncCheckpointSaver::Global(/*max_pending=*/4), saver);
+  EXPECT_EQ(AsyncCheckpointSaver::GlobalIfCreated(), saver);
+}
+
+TEST(AsyncCheckpointSaverTest, WaitReturnsError) {
+  auto saver = std::make_unique<AsyncCheckpointSaver>(/*max_pending=*/2);
+  TF_ASSERT_OK(saver->ScheduleSave(
+      "a", []() { return errors::DataLoss("disk full"); }));
+  EXPECT_TRUE(errors::IsDataLoss(saver->Wait("a")));
+  // The error is reported once.
+  TF_EXPECT_OK(saver->Wait("a"));
+  TF_EXPECT_OK(saver->ScheduleSave("b", []() { return OkStatus(); }));
+  TF_EXPECT_OK(saver->Wait("b"));
+}
+
+TEST(AsyncCheckpointSaverTest, MergeSkippedOnInputError) {
+  auto saver = std::make_unique<AsyncCheckpointSaver>(/*max_pending=*/2);
+  bool merged = false;
+  TF_ASSERT_OK(saver->ScheduleSave(
+      "a", []() { return errors::DataLoss("disk full"); }));
+  TF_ASSERT_OK(saver->ScheduleSave("b", []() { return OkStatus(); }));
+  saver->ScheduleMerge({"a", "b"}, "merged", [&merged]() {
+    merged = true;
+    return OkStatus();
+  });
+  EXPECT_TRUE(errors::IsDataLoss(saver->Wait("merged")));
+  EXPECT_FALSE(merged);
+  TF_EXPECT_OK(saver->Wait("a"));
+}
+
+TEST(AsyncCheckpointSaverTest, UnreportedErrorFailsNextSave) {
+  auto saver = std::make_unique<AsyncCheckpointSaver>(/*max_pending=*/2);
+  TF_ASSERT_OK(saver->ScheduleSave(
+      "a", []() { return errors::DataLoss("disk full"); }));
+  Notification done;
+  TF_ASSERT_OK(saver->ScheduleSave("b", [&done]() {
+    done.Notify();
+    return OkStatus();
+  }));
+  done.WaitForNotification();
+  TF_ASSERT_OK(saver->Wait("b"));
+  Status status = saver->ScheduleSave("c", []() { return OkStatus(); });
+  EXPECT_TRUE(errors::IsDataLoss(status));
+  EXPECT_TRUE(absl::StrContains(status.message(), "operation for a failed"));
+}
+
+TEST(AsyncCheckpointSaverTest, BoundsPendingSaves) {
+  auto saver = std::make_unique<AsyncCheckpointSaver>(/*max_pending=*/1);
+  Notification release;
+  TF_ASSERT_OK(saver->ScheduleSave("a", [&release]() {
+    release.WaitForNotification();
+    return OkStatus();
+  }));
+  Notification scheduled;
+  std::unique_ptr<Thread> thread(Env::Default()->StartThread(
+      ThreadOptions(), "schedule", [&saver, &scheduled]() {
+        TF_EXPECT_OK(saver->ScheduleSave("b", []() { return OkStatus(); }));
+        scheduled.Notify();
+      }));
+  EXPECT_FALSE(
+      scheduled.WaitForNotificationWithTimeout(/*timeout_in_us=*/100000));
+  release.Notify();
+  scheduled.WaitForNotification();
+  thread.reset();
+  TF_EXPECT_OK(saver->Wait("b"));
+}
+
+}  // namespace
+}  // namespace checkpoint
+}  // namespace tensorflow
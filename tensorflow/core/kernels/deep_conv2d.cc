@@ -1079,10 +1079,15 @@ struct DeepConv2D<CPUDevice, T> {
           tile_spatial_size * num_tiles * out_depth * filter_shard_size;
       const int64_t buffer1_size =
           std::max(buffer1_tile_size, buffer1_out_size);
+      // The per-shard buffers below are sized to fit in cache and are
+      // released when the shard returns, so serve them from the worker
+      // thread's scratch arena.
+      AllocatorAttributes scratch_attr;
+      scratch_attr.set_scratch(true);
       Tensor buffer1_tensor;
       OP_REQUIRES_OK(ctx, ctx->allocate_temp(DataTypeToEnum<T>::value,
                                              TensorShape({buffer1_size}),
-                                             &buffer1_tensor));
+                                             &buffer1_tensor, scratch_attr));
       T* buffer1 = buffer1_tensor.template flat<T>().data();
 
       // Allocate temporary buffer 'buffer2', which is first used for
@@ -1098,7 +1103,7 @@ struct DeepConv2D<CPUDevice, T> {
       Tensor buffer2_tensor;
       OP_REQUIRES_OK(ctx, ctx->allocate_temp(DataTypeToEnum<T>::value,
                                              TensorShape({buffer2_size}),
-                                             &buffer2_tensor));
+                                             &buffer2_tensor, scratch_attr));
       T* buffer2 = buffer2_tensor.template flat<T>().data();
 
       // Allocate temporary buffer to store packed tiles for one coordinate.
@@ -1106,7 +1111,8 @@ struct DeepConv2D<CPUDevice, T> {
       Tensor packed_tile_tensor;
       OP_REQUIRES_OK(ctx, ctx->allocate_temp(DataTypeToEnum<T>::value,
                                              TensorShape({num_tiles, in_depth}),
-                                             &packed_tile_tensor));
+                                             &packed_tile_tensor,
+                                             scratch_attr));
       T* packed_tile_buffer = packed_tile_tensor.template flat<T>().data();
 
       // Allocate temporary buffer for gemm output.
@@ -1116,7 +1122,8 @@ struct DeepConv2D<CPUDevice, T> {
                                              TensorShape({num_tiles, out_depth,
                                                           filter_shards_row,
                                                           filter_shards_col}),
-                                             &gemm_output_tensor));
+                                             &gemm_output_tensor,
+                                             scratch_attr));
       T* gemm_output_buffer = gemm_output_tensor.template flat<T>().data();
 
       // Capture state needed for ComputeConv2D inner loop.
@@ -0,0 +1,232 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/lazy_restore_manager.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cerrno>
+#endif
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/framework/metrics.h"
+#include "tensorflow/core/platform/errors.h"
+#include "tensorflow/core/platform/logging.h"
+
+namespace tensorflow {
+namespace checkpoint {
+
+const absl::string_view kLazyRestoreManagerResourceName =
+    "lazy_restore_manager";
+
+namespace {
+
+#if defined(__linux__) || defined(__APPLE__)
+
+#if defined(__APPLE__)
+using MincoreVecType = char;
+#else
+using MincoreVecType = unsigned char;
+#endif
+
+size_t PageSize() {
+  static const size_t page_size = sysconf(_SC_PAGESIZE);
+  return page_size;
+}
+
+// Sets "*resident_bytes" to the number of bytes of [data, data + size) that
+// are resident in memory.
+Status ResidentBytes(const char* data, size_t size, int64_t* resident_bytes) {
+  *resident_bytes = 0;
+  if (size == 0) return OkStatus();
+  const uintptr_t page_size = PageSize();
+  const uintptr_t begin = reinterpret_cast<uintptr_t>(data);
+  const uintptr_t end = begin + size;
+  const uintptr_t first_page = begin & ~(page_size - 1);
+  std::vector<MincoreVecType> resident((end - first_page + page_size - 1) /
+                                       page_size);
+  if (mincore(reinterpret_cast<void*>(first_page), end - first_page,
+              resident.data()) != 0) {
+    return errors::IOError("mincore", errno);
+  }
+  for (size_t i = 0; i < resident.size(); ++i) {
+    if ((resident[i] & 1) == 0) continue;
+    const uintptr_t page_begin = first_page + i * page_size;
+    *resident_bytes += std::min(page_begin + page_size, end) -
+                       std::max(page_begin, begin);
+  }
+  return OkStatus();
+}
+
+#else
+
+size_t PageSize() { return 4096; }
+
+Status ResidentBytes(const char* data, size_t size, int64_t* resident_bytes) {
+  return errors::Unimplemented(
+      "Page residency cannot be queried on this platform.");
+}
+
+#endif
+
+// Returns true if "tensor" holds the only reference to its buffer. Unlike
+// Tensor::RefCountIsOne(), this also holds for buffers that do not own their
+// memory, such as the memory-mapped buffers of the restored tensors.
+bool IsOnlyReference(const Tensor& tensor) {
+  TensorBuffer* buffer = const_cast<TensorBuffer*>(DMAHelper::buffer(&tensor));
+  return buffer != nullptr && buffer->RefCountIsOne() &&
+         buffer->root_buffer()->RefCountIsOne();
+}
+
+}  // namespace
+
+LazyRestoreManager::LazyRestoreManager(const Options& options)
+    : options_(options) {}
+
+void LazyRestoreManager::AddRestored(const std::string& prefix,
+                                     const std::string& tensor_name,
+                                     const Tensor& tensor) {
+  mutex_lock l(mu_);
+  restored_.push_back({prefix, tensor_name, tensor});
+}
+
+void LazyRestoreManager::Start() {
+  // Released by Run() once there is nothing left to do.
+  Ref();
+  Env::Default()->SchedClosure([this]() {
+    Run();
+    Unref();
+  });
+}
+
+int64_t LazyRestoreManager::WaitForPrefetch() {
+  mutex_lock l(mu_);
+  while (!prefetch_done_) {
+    cond_.wait(l);
+  }
+  return prefetched_bytes_;
+}
+
+Status LazyRestoreManager::GetUsage(absl::string_view prefix, Usage* usage) {
+  *usage = Usage();
+  std::vector<Restored> restored;
+  {
+    mutex_lock l(mu_);
+    restored = restored_;
+  }
+  for (const Restored& r : restored) {
+    if (!prefix.empty() && r.prefix != prefix) continue;
+    const StringPiece data = r.tensor.tensor_data();
+    int64_t resident_bytes;
+    TF_RETURN_IF_ERROR(ResidentBytes(data.data(), data.size(),
+                                     &resident_bytes));
+    VLOG(2) << "Lazily restored tensor " << r.tensor_name << " from "
+            << r.prefix << ": " << resident_bytes << " of " << data.size()
+            << " bytes resident";
+    usage->mapped_bytes += data.size();
+    usage->resident_bytes += resident_bytes;
+    ++usage->num_tensors;
+    if (resident_bytes > 0) ++usage->num_touched_tensors;
+  }
+  return OkStatus();
+}
+
+void LazyRestoreManager::ReleaseUnreferenced() {
+  // Tensors being added are still referenced by the outputs of RestoreV2.
+  mutex_lock l(mu_);
+  restored_.erase(std::remove_if(restored_.begin(), restored_.end(),
+                                 [](const Restored& r) {
+                                   return IsOnlyReference(r.tensor);
+                                 }),
+                  restored_.end());
+}
+
+void LazyRestoreManager::Run() {
+  // The outputs of the restore that were not assigned to variables are gone
+  // by now.
+  ReleaseUnreferenced();
+  const int64_t prefetched_bytes =
+      options_.prefetch_bytes > 0 ? Prefetch() : 0;
+  {
+    mutex_lock l(mu_);
+    prefetch_done_ = true;
+    prefetched_bytes_ = prefetched_bytes;
+    if (options_.report_interval_micros <= 0) restored_.clear();
+    cond_.notify_all();
+  }
+  if (options_.report_interval_micros <= 0) return;
+  while (true) {
+    ReleaseUnreferenced();
+    Report();
+    {
+      mutex_lock l(mu_);
+      if (restored_.empty()) return;
+    }
+    Env::Default()->SleepForMicroseconds(options_.report_interval_micros);
+  }
+}
+
+int64_t LazyRestoreManager::Prefetch() {
+  std::vector<Restored> restored;
+  {
+    mutex_lock l(mu_);
+    restored = restored_;
+  }
+  const uint64 start_micros = Env::Default()->NowMicros();
+  const size_t page_size = PageSize();
+  int64_t remaining_bytes = options_.prefetch_bytes;
+  for (const Restored& r : restored) {
+    if (remaining_bytes <= 0) break;
+    const StringPiece data = r.tensor.tensor_data();
+    const size_t size =
+        std::min<size_t>(data.size(), static_cast<size_t>(remaining_bytes));
+    // Reading one byte per page is enough to page it in.
+    volatile char sink = 0;
+    for (size_t offset = 0; offset < size; offset += page_size) {
+      sink = sink ^ data[offset];
+    }
+    remaining_bytes -= size;
+  }
+  const int64_t prefetched_bytes = options_.prefetch_bytes - remaining_bytes;
+  VLOG(1) << "Prefetched " << prefetched_bytes
+          << " lazily restored bytes in "
+          << Env::Default()->NowMicros() - start_micros << " us";
+  return prefetched_bytes;
+}
+
+void LazyRestoreManager::Report() {
+  Usage usage;
+  Status status = GetUsage(/*prefix=*/"", &usage);
+  if (!status.ok()) {
+    VLOG(1) << "Not reporting lazy restore usage: " << status;
+    return;
+  }
+  VLOG(1) << "Lazily restored " << usage.num_tensors << " tensors; "
+          << usage.num_touched_tensors << " were touched, "
+          << usage.resident_bytes << " of " << usage.mapped_bytes
+          << " bytes are resident";
+  metrics::RecordCheckpointLazyRestoreUsage(
+      usage.mapped_bytes, usage.resident_bytes, usage.num_tensors,
+      usage.num_touched_tensors);
+}
+
+}  // namespace checkpoint
+}  // namespace tensorflow
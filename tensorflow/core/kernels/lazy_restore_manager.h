@@ -0,0 +1,134 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_CORE_KERNELS_LAZY_RESTORE_MANAGER_H_
+#define TENSORFLOW_CORE_KERNELS_LAZY_RESTORE_MANAGER_H_
+
+#include <string>
+#include <vector>
+
+#include "absl/base/attributes.h"
+#include "absl/strings/string_view.h"
+#include "tensorflow/core/framework/resource_base.h"
+#include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/status.h"
+
+namespace tensorflow {
+namespace checkpoint {
+
+ABSL_CONST_INIT extern const absl::string_view kLazyRestoreManagerResourceName;
+
+// Restores checkpointed tensors lazily.
+//
+// While a LazyRestoreManager is registered in the default container of the
+// resource manager of a RestoreV2 kernel, the kernel memory-maps the
+// checkpoint data files and outputs tensors aliasing them (see
+// BundleReader::LookupMapped()). Variables assigned from those tensors alias
+// them too, so their contents are read from storage on first access, one page
+// at a time, and the parts of the model that are never accessed never occupy
+// memory.
+//
+// Only tensors whose data is aligned in the data files can be aliased; the
+// others are copied eagerly as usual. SaveV2 aligns the data of the
+// checkpoints it writes when TF_CHECKPOINT_SAVE_ALIGN_FOR_MMAP is set.
+//
+// Once started, the manager optionally pages in a prefix of the restored
+// tensors in the background, and periodically reports how much of the
+// restored tensors was actually touched. The manager only keeps the restored
+// tensors, and thus their mappings, alive for as long as something else
+// (e.g. a variable) still references them. The background work holds a
+// reference on the manager until there is nothing left to prefetch or
+// report, so the manager does not need to stay registered once the restore
+// has completed.
+class LazyRestoreManager : public ResourceBase {
+ public:
+  struct Options {
+    // Whether to validate the checksums of restored tensors. Validation reads
+    // every byte, which pages in the whole checkpoint.
+    bool verify_checksums = false;
+    // Number of bytes to page in from the background thread, taken from the
+    // restored tensors in restore order.
+    int64_t prefetch_bytes = 0;
+    // Interval between usage reports. Zero disables reporting.
+    int64_t report_interval_micros = 60 * 1000 * 1000;
+  };
+
+  // Usage of the restored tensors. Resident bytes are those currently in
+  // memory: paged in by kernels accessing the tensors, by the prefetcher, or
+  // by read-ahead of the file system. A tensor is touched if any of its bytes
+  // are resident.
+  struct Usage {
+    int64_t mapped_bytes = 0;
+    int64_t resident_bytes = 0;
+    int num_tensors = 0;
+    int num_touched_tensors = 0;
+  };
+
+  explicit LazyRestoreManager(const Options& options);
+
+  LazyRestoreManager(const LazyRestoreManager&) = delete;
+  LazyRestoreManager& operator=(const LazyRestoreManager&) = delete;
+
+  std::string DebugString() const override { return "LazyRestoreManager"; }
+
+  const Options& options() const { return options_; }
+
+  // Records "tensor", restored as "tensor_name" from the checkpoint at
+  // "prefix" by aliasing its memory-mapped data file.
+  void AddRestored(const std::string& prefix, const std::string& tensor_name,
+                   const Tensor& tensor);
+
+  // Starts prefetching and reporting in the background. Called once the
+  // restore has completed, and at most once.
+  void Start();
+
+  // Blocks until the background prefetch triggered by Start() is done, and
+  // returns the number of bytes it paged in.
+  int64_t WaitForPrefetch();
+
+  // Computes the usage of the tensors restored from "prefix", or of all the
+  // restored tensors if "prefix" is empty. Returns an Unimplemented error on
+  // platforms that cannot query page residency.
+  Status GetUsage(absl::string_view prefix, Usage* usage);
+
+ private:
+  struct Restored {
+    std::string prefix;
+    std::string tensor_name;
+    Tensor tensor;
+  };
+
+  void Run();
+  int64_t Prefetch();
+  void Report();
+
+  // Drops the restored tensors that are no longer referenced outside of the
+  // manager, unmapping their data.
+  void ReleaseUnreferenced();
+
+  const Options options_;
+
+  mutex mu_;
+  condition_variable cond_;
+  std::vector<Restored> restored_ TF_GUARDED_BY(mu_);
+  bool prefetch_done_ TF_GUARDED_BY(mu_) = false;
+  int64_t prefetched_bytes_ TF_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace checkpoint
+}  // namespace tensorflow
+
+#endif  // TENSORFLOW_CORE_KERNELS_LAZY_RESTORE_MANAGER_H_
@@ -0,0 +1,162 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/core/kernels/lazy_restore_manager.h"
+
+#include <string>
+
+#include "tensorflow/core/common_runtime/dma_helper.h"
+#include "tensorflow/core/framework/allocator.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
+#include "tensorflow/core/lib/core/status_test_util.h"
+#include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
+
+namespace tensorflow {
+namespace checkpoint {
+namespace {
+
+// Tensor::RefCountIsOne() is always false for tensors aliasing a mapping,
+// since their buffers do not own their memory.
+bool IsOnlyReference(const Tensor& tensor) {
+  return DMAHelper::buffer(&tensor)->RefCountIsOne();
+}
+
+class LazyRestoreManagerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    prefix_ = io::JoinPath(testing::TmpDir(), "lazy_restore");
+    BundleWriter::Options options;
+    options.data_alignment = Allocator::kAllocatorAlignment;
+    BundleWriter writer(Env::Default(), prefix_, options);
+    expected_ = Tensor(DT_FLOAT, TensorShape({1 << 18}));  // 1MB.
+    expected_.flat<float>().setConstant(1.5f);
+    TF_ASSERT_OK(writer.Add("big", expected_));
+    TF_ASSERT_OK(writer.Finish());
+  }
+
+  // Restores "big" by aliasing the mapped checkpoint into "manager".
+  void Restore(LazyRestoreManager* manager, Tensor* restored) {
+    BundleReader::Options options;
+    options.use_mmap = true;
+    options.verify_mmap_checksums = false;
+    BundleReader reader(Env::Default(), prefix_, options);
+    TF_ASSERT_OK(reader.status());
+    bool aliased;
+    TF_ASSERT_OK(reader.LookupMapped("big", restored, &aliased));
+    ASSERT_TRUE(aliased);
+    manager->AddRestored(prefix_, "big", *restored);
+  }
+
+  std::string prefix_;
+  Tensor expected_;
+};
+
+TEST_F(LazyRestoreManagerTest, Usage) {
+  LazyRestoreManager* manager = new LazyRestoreManager({});
+  Tensor restored;
+  Restore(manager, &restored);
+  LazyRestoreManager::Usage usage;
+  Status status = manager->GetUsage(prefix_, &usage);
+  if (errors::IsUnimplemented(status)) {
+    manager->Unref();
+    GTEST_SKIP() << status;
+  }
+  TF_ASSERT_OK(status);
+  EXPECT_EQ(1, usage.num_tensors);
+  EXPECT_EQ(expected_.TotalBytes(), usage.mapped_bytes);
+
+  // Touching the tensor pages it in.
+  test::ExpectTensorEqual<float>(restored, expected_);
+  TF_ASSERT_OK(manager->GetUsage(prefix_, &usage));
+  EXPECT_EQ(1, usage.num_touched_tensors);
+  EXPECT_EQ(expected_.TotalBytes(), usage.resident_bytes);
+
+  TF_ASSERT_OK(manager->GetUsage("other", &usage));
+  EXPECT_EQ(0, usage.num_tensors);
+  manager->Unref();
+}
+
+TEST_F(LazyRestoreManagerTest, Prefetch) {
+  LazyRestoreManager::Options options;
+  options.prefetch_bytes = 1 << 30;
+  options.report_interval_micros = 0;
+  LazyRestoreManager* manager = new LazyRestoreManager(options);
+  Tensor restored;
+  Restore(manager, &restored);
+  manager->Start();
+  EXPECT_EQ(expected_.TotalBytes(), manager->WaitForPrefetch());
+  // Without reporting, the manager no longer needs the restored tensors.
+  LazyRestoreManager::Usage usage;
+  Status status = manager->GetUsage(prefix_, &usage);
+  if (!errors::IsUnimplemented(status)) {
+    TF_ASSERT_OK(status);
+    EXPECT_EQ(0, usage.num_tensors);
+  }
+  EXPECT_TRUE(IsOnlyReference(restored));
+  manager->Unref();
+  test::ExpectTensorEqual<float>(restored, expected_);
+}
+
+TEST_F(LazyRestoreManagerTest, PrefetchIsBounded) {
+  LazyRestoreManager::Options options;
+  options.prefetch_bytes = 4096;
+  options.report_interval_micros = 0;
+  LazyRestoreManager* manager = new LazyRestoreManager(options);
+  Tensor restored;
+  Restore(manager, &restored);
+  manager->Start();
+  EXPECT_EQ(4096, manager->WaitForPrefetch());
+  manager->Unref();
+}
+
+TEST_F(LazyRestoreManagerTest, ReleasesUnreferencedTensors) {
+  LazyRestoreManager::Options options;
+  options.report_interval_micros = 1000;
+  LazyRestoreManager* manager = new LazyRestoreManager(options);
+  Tensor assigned;
+  Restore(manager, &assigned);
+  {
+    // Not assigned to a variable: only referenced by the manager once the
+    // restore completes.
+    Tensor dropped;
+    Restore(manager, &dropped);
+  }
+  manager->Start();
+  EXPECT_EQ(0, manager->WaitForPrefetch());
+  LazyRestoreManager::Usage usage;
+  Status status = manager->GetUsage(prefix_, &usage);
+  if (errors::IsUnimplemented(status)) {
+    manager->Unref();
+    GTEST_SKIP() << status;
+  }
+  TF_ASSERT_OK(status);
+  EXPECT_EQ(1, usage.num_tensors);
+  EXPECT_FALSE(IsOnlyReference(assigned));
+
+  // Once the last restored tensor is released, the background work has
+  // nothing left to report and drops its reference on the manager.
+  assigned = Tensor();
+  while (!manager->RefCountIsOne()) {
+    Env::Default()->SleepForMicroseconds(1000);
+  }
+  TF_ASSERT_OK(manager->GetUsage(prefix_, &usage));
+  EXPECT_EQ(0, usage.num_tensors);
+  manager->Unref();
+}
+
+}  // namespace
+}  // namespace checkpoint
+}  // namespace tensorflow
@@ -13,13 +13,20 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <stdlib.h>
+
 #include <string>
 #include <vector>
 
+#include "tensorflow/cc/client/client_session.h"
+#include "tensorflow/cc/framework/scope.h"
+#include "tensorflow/cc/ops/const_op.h"
+#include "tensorflow/cc/ops/io_ops.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
+#include "tensorflow/core/framework/tensor_testutil.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/kernels/ops_testutil.h"
 #include "tensorflow/core/lib/core/status.h"
@@ -29,6 +36,8 @@ limitations under the License.
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/test.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/public/session_options.h"
+#include "tensorflow/core/util/tensor_bundle/naming.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
 namespace tensorflow {
@@ -154,5 +163,72 @@ TEST_F(MergeV2CheckpointsOpTest, MergeAndDeleteWithMissingFiles) {
   RunMergeTest(true /* delete old dirs */, true /* allow missing files */);
 }
 
+// Shards saved asynchronously on one device are merged on another one.
+TEST(MergeV2CheckpointsTest, WaitsForAsyncSavesOnAllDevices) {
+  setenv("TF_CHECKPOINT_ASYNC_SAVE", "1", /*overwrite=*/1);
+  const std::vector<string> prefixes = {
+      io::JoinPath(testing::TmpDir(), "async/shard0"),
+      io::JoinPath(testing::TmpDir(), "async/shard1"),
+      io::JoinPath(testing::TmpDir(), "async/merged")};
+  Scope root = Scope::NewRootScope();
+  std::vector<Operation> saves;
+  for (int device = 0; device < 2; ++device) {
+    Scope scope = root.WithDevice(strings::StrCat("/cpu:", device));
+    auto save = ops::SaveV2(
+        scope, ops::Const(scope, prefixes[device]),
+        ops::Const(scope, {strings::StrCat("tensor", device)}),
+        ops::Const(scope, {""}),
+        {ops::Const(scope, static_cast<float>(device + 1),
+                    TensorShape({1 << 16}))});
+    saves.push_back(save.operation);
+  }
+  Scope cpu0 = root.WithDevice("/cpu:0");
+  auto merge = ops::MergeV2Checkpoints(
+      cpu0.WithControlDependencies(saves),
+      ops::Const(cpu0, {prefixes[0], prefixes[1]}),
+      ops::Const(cpu0, prefixes[2]),
+      ops::MergeV2Checkpoints::DeleteOldDirs(false));
+  Scope cpu1 = root.WithDevice("/cpu:1");
+  auto restore = ops::RestoreV2(cpu1, ops::Const(cpu1, prefixes[2]),
+                                ops::Const(cpu1, {"tensor0", "tensor1"}),
+                                ops::Const(cpu1, {"", ""}),
+                                {DT_FLOAT, DT_FLOAT});
+  TF_ASSERT_OK(root.status());
+
+  SessionOptions options;
+  (*options.config.mutable_device_count())["CPU"] = 2;
+  ClientSession session(root, options);
+  TF_ASSERT_OK(session.Run({}, {}, {merge}, nullptr));
+  // RestoreV2 waits for the merge, which waited for both saves.
+  std::vector<Tensor> outputs;
+  TF_ASSERT_OK(session.Run({restore.tensors[0], restore.tensors[1]},
+                           &outputs));
+  ASSERT_EQ(outputs.size(), 2);
+  test::ExpectTensorEqual<float>(Constant<float>(1, TensorShape({1 << 16})),
+                                 outputs[0]);
+  test::ExpectTensorEqual<float>(Constant<float>(2, TensorShape({1 << 16})),
+                                 outputs[1]);
+  unsetenv("TF_CHECKPOINT_ASYNC_SAVE");
+}
+
+TEST(MergeV2CheckpointsTest, WaitForCheckpointSaves) {
+  setenv("TF_CHECKPOINT_ASYNC_SAVE", "1", /*overwrite=*/1);
+  const string prefix = io::JoinPath(testing::TmpDir(), "async_wait/ckpt");
+  Scope root = Scope::NewRootScope();
+  auto save = ops::SaveV2(root, ops::Const(root, prefix),
+                          ops::Const(root, {string("tensor")}),
+                          ops::Const(root, {string("")}),
+                          {ops::Const(root, 1.0f, TensorShape({1 << 16}))});
+  auto wait = ops::WaitForCheckpointSaves(
+      root.WithControlDependencies({save.operation}),
+      ops::Const(root, {prefix}));
+  TF_ASSERT_OK(root.status());
+
+  ClientSession session(root);
+  TF_ASSERT_OK(session.Run({}, {}, {wait}, nullptr));
+  TF_EXPECT_OK(Env::Default()->FileExists(MetaFilename(prefix)));
+  unsetenv("TF_CHECKPOINT_ASYNC_SAVE");
+}
+
 }  // namespace
 }  // namespace tensorflow
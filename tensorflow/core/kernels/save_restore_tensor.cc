@@ -15,6 +15,9 @@ limitations under the License.
 
 #include "tensorflow/core/kernels/save_restore_tensor.h"
 
+#include <algorithm>
+#include <limits>
+#include <map>
 #include <memory>
 #include <numeric>
 #include <unordered_map>
@@ -22,17 +25,24 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/framework/metrics.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/register_types.h"
+#include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/kernels/lazy_restore_manager.h"
+#include "tensorflow/core/lib/core/refcount.h"
 #include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/strings/str_util.h"
 #include "tensorflow/core/lib/strings/strcat.h"
 #include "tensorflow/core/lib/strings/stringprintf.h"
 #include "tensorflow/core/platform/logging.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_reader_cache.h"
@@ -247,23 +257,25 @@ void RestoreTensor(OpKernelContext* context,
 
 namespace {
 
-// Tensors larger than this threshold will be restored from a thread-pool.
-const int64_t kLargeShapeThreshold = 16 << 20;  // 16M
+using internal::kLargeReadBytes;
+using internal::kMaxReadConcurrency;
+using internal::kReadSectionBytes;
+using internal::ReadConcurrencyController;
+using internal::ReadLocation;
+using internal::ReadTask;
 
-// A restore operation for a single tensor.  Small tensors may be restored
-// directly from the op thread to improve read locality.  Large tensors can be
-// restored from a thread pool: this requires creating a separate BundleReader
-// for each restore.
+// A restore operation for a single tensor.
 struct RestoreOp {
   RestoreOp(OpKernelContext* context, int idx, const string& tensor_name,
             const string& shape_and_slice, const string& reader_prefix,
-            DataType dtype)
+            DataType dtype, const BundleReader::Options& reader_options)
       : context(context),
         idx(idx),
         tensor_name(tensor_name),
         shape_and_slice(shape_and_slice),
         reader_prefix(reader_prefix),
-        dtype(dtype) {}
+        dtype(dtype),
+        reader_options(reader_options) {}
 
   // Move-only. It does not make sense to "run()" a copied RestoreOp.
   RestoreOp(const RestoreOp&) = delete;
@@ -271,28 +283,6 @@ struct RestoreOp {
   RestoreOp(RestoreOp&&) = default;
   RestoreOp& operator=(RestoreOp&&) = default;
 
-  bool should_run_in_pool(BundleReader* reader) const {
-    TensorShape restored_full_shape;
-
-    // Ignore status here; we'll catch the error later.
-    if (!reader->LookupTensorShape(tensor_name, &restored_full_shape).ok()) {
-      return false;
-    }
-
-    return restored_full_shape.num_elements() > kLargeShapeThreshold;
-  }
-
-  // Run this restore operation using a new BundleReader.
-  void run_with_new_reader() {
-    BundleReader reader(Env::Default(), reader_prefix);
-    if (!reader.status().ok()) {
-      status = reader.status();
-      return;
-    }
-
-    status = run(&reader);
-  }
-
   Status run(BundleReader* reader) {
     TensorShape restored_full_shape;
     TF_RETURN_IF_ERROR(
@@ -301,7 +291,20 @@ struct RestoreOp {
     VLOG(1) << "Restoring tensor " << idx << " : " << tensor_name << " : "
             << restored_full_shape.num_elements();
     Tensor* restored_tensor;
-    if (shape_and_slice.empty()) {
+    if (shape_and_slice.empty() && reader_options.use_mmap) {
+      // Let the reader allocate the full tensor, so that it can alias the
+      // memory-mapped checkpoint instead of copying into a new buffer.
+      Tensor restored;
+      bool aliased;
+      TF_RETURN_IF_ERROR(
+          reader->LookupMapped(tensor_name, &restored, &aliased));
+      if (aliased && lazy_restore_manager != nullptr) {
+        lazy_restore_manager->AddRestored(reader_prefix, tensor_name,
+                                          restored);
+      }
+      context->set_output(idx, std::move(restored));
+      restored_tensor = context->mutable_output(idx);
+    } else if (shape_and_slice.empty()) {
       // Lookup the full tensor.
       TF_RETURN_IF_ERROR(
           context->allocate_output(idx, restored_full_shape, &restored_tensor));
@@ -355,10 +358,125 @@ struct RestoreOp {
   string shape_and_slice;
   string reader_prefix;
   DataType dtype;
+  BundleReader::Options reader_options;
+  checkpoint::LazyRestoreManager* lazy_restore_manager = nullptr;
+};
+
+// Runs the restore operations of "task" with "reader".
+Status RunReadTask(const ReadTask& task, std::vector<RestoreOp>& restore_ops,
+                   BundleReader* reader) {
+  for (int index : task.indices) {
+    TF_RETURN_IF_ERROR(restore_ops[index].run(reader));
+  }
+  return OkStatus();
+}
+
+// Hands out BundleReaders to the read tasks, so that the index of the
+// checkpoint is parsed, and its data files opened, once per concurrent task
+// instead of once per task.
+class ReaderPool {
+ public:
+  ReaderPool(Env* env, const string& prefix,
+             const BundleReader::Options& options)
+      : env_(env), prefix_(prefix), options_(options) {}
+
+  // Takes an idle reader, or opens a new one if there is none.
+  Status Get(std::unique_ptr<BundleReader>* reader) {
+    {
+      mutex_lock l(mu_);
+      if (!idle_.empty()) {
+        *reader = std::move(idle_.back());
+        idle_.pop_back();
+        return OkStatus();
+      }
+    }
+    reader->reset(new BundleReader(env_, prefix_, options_));
+    return (*reader)->status();
+  }
+
+  // Returns a reader taken by Get(), or the reader used to plan the tasks.
+  void Put(std::unique_ptr<BundleReader> reader) {
+    mutex_lock l(mu_);
+    idle_.push_back(std::move(reader));
+  }
 
-  ::tensorflow::Status status;
+ private:
+  Env* const env_;
+  const string prefix_;
+  const BundleReader::Options options_;
+
+  mutex mu_;
+  std::vector<std::unique_ptr<BundleReader>> idle_ TF_GUARDED_BY(mu_);
 };
 
+// Accumulates the bytes read from each data file and the time span over which
+// they were read.
+class ShardReadStats {
+ public:
+  void Record(int32_t shard_id, int64_t bytes, uint64 start_micros,
+              uint64 end_micros) {
+    if (shard_id < 0) return;  // Partitioned tensors span several shards.
+    mutex_lock l(mu_);
+    Stats& stats = stats_[shard_id];
+    stats.bytes += bytes;
+    stats.start_micros = std::min(stats.start_micros, start_micros);
+    stats.end_micros = std::max(stats.end_micros, end_micros);
+  }
+
+  void Report(const string& prefix) {
+    mutex_lock l(mu_);
+    for (const auto& it : stats_) {
+      const Stats& stats = it.second;
+      if (stats.end_micros <= stats.start_micros) continue;
+      const double megabytes_per_second =
+          static_cast<double>(stats.bytes) /
+          (stats.end_micros - stats.start_micros);
+      metrics::RecordCheckpointRestoreShardReadBandwidth(megabytes_per_second);
+      VLOG(1) << "Restored " << stats.bytes << " bytes from shard " << it.first
+              << " of " << prefix << " at " << megabytes_per_second
+              << " MB/s";
+    }
+  }
+
+ private:
+  struct Stats {
+    int64_t bytes = 0;
+    uint64 start_micros = std::numeric_limits<uint64>::max();
+    uint64 end_micros = 0;
+  };
+
+  mutex mu_;
+  std::map<int32_t, Stats> stats_ TF_GUARDED_BY(mu_);
+};
+
+// Read-only serving jobs may set TF_CHECKPOINT_RESTORE_USE_MMAP to restore
+// tensors by aliasing the memory-mapped checkpoint data files, bounding cold
+// start by page faults instead of copies. Only checkpoints saved with
+// TF_CHECKPOINT_SAVE_ALIGN_FOR_MMAP have their data aligned for aliasing;
+// the tensors of other checkpoints are copied.
+BundleReader::Options RestoreReaderOptions() {
+  BundleReader::Options options;
+  Status s = ReadBoolFromEnvVar("TF_CHECKPOINT_RESTORE_USE_MMAP",
+                                /*default_val=*/false, &options.use_mmap);
+  if (!s.ok()) LOG(WARNING) << s;
+  s = ReadBoolFromEnvVar("TF_CHECKPOINT_RESTORE_VERIFY_MMAP_CHECKSUMS",
+                         /*default_val=*/true, &options.verify_mmap_checksums);
+  if (!s.ok()) LOG(WARNING) << s;
+  options.parallel_read_threshold_bytes = kLargeReadBytes;
+  options.min_read_section_bytes = kReadSectionBytes;
+  return options;
+}
+
+// TF_CHECKPOINT_RESTORE_NUM_THREADS fixes the number of concurrent read tasks
+// instead of tuning it from the observed throughput.
+int64_t RestoreNumThreads() {
+  int64_t num_threads;
+  Status s = ReadInt64FromEnvVar("TF_CHECKPOINT_RESTORE_NUM_THREADS",
+                                 /*default_val=*/0, &num_threads);
+  if (!s.ok()) LOG(WARNING) << s;
+  return std::min<int64_t>(num_threads, kMaxReadConcurrency);
+}
+
 }  // namespace
 
 Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
@@ -370,25 +488,63 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
   const auto& tensor_names_flat = tensor_names.flat<tstring>();
   const auto& shape_and_slices_flat = shape_and_slices.flat<tstring>();
 
+  static const BundleReader::Options default_reader_options =
+      RestoreReaderOptions();
+  static const int64_t fixed_num_threads = RestoreNumThreads();
+
+  // Restores lazily, by aliasing the memory-mapped checkpoint, if a
+  // LazyRestoreManager is registered; see lazy_restore_manager.h.
+  BundleReader::Options reader_options = default_reader_options;
+  core::RefCountPtr<checkpoint::LazyRestoreManager> lazy_restore_manager;
+  ResourceMgr* resource_manager = context->resource_manager();
+  if (resource_manager != nullptr) {
+    checkpoint::LazyRestoreManager* manager;
+    if (resource_manager
+            ->Lookup(resource_manager->default_container(),
+                     std::string(checkpoint::kLazyRestoreManagerResourceName),
+                     &manager)
+            .ok()) {
+      lazy_restore_manager.reset(manager);
+      reader_options.use_mmap = true;
+      reader_options.verify_mmap_checksums =
+          manager->options().verify_checksums;
+    }
+  }
+
   std::vector<RestoreOp> restore_ops;
   restore_ops.reserve(tensor_names_flat.size());
   for (int i = 0; i < tensor_names_flat.size(); ++i) {
     restore_ops.push_back({context, i, tensor_names_flat(i),
-                           shape_and_slices_flat(i), prefix_string, dtypes[i]});
+                           shape_and_slices_flat(i), prefix_string, dtypes[i],
+                           reader_options});
+    restore_ops.back().lazy_restore_manager = lazy_restore_manager.get();
   }
 
-  BundleReader default_reader(Env::Default(), prefix_string);
-  TF_RETURN_IF_ERROR(default_reader.status());
+  Env* env = Env::Default();
+  auto default_reader =
+      std::make_unique<BundleReader>(env, prefix_string, reader_options);
+  TF_RETURN_IF_ERROR(default_reader->status());
 
-  TF_RETURN_IF_ERROR(default_reader.SortForSequentialAccess<RestoreOp>(
+  TF_RETURN_IF_ERROR(default_reader->SortForSequentialAccess<RestoreOp>(
       restore_ops, [](const RestoreOp& op) { return op.tensor_name; }));
 
   std::vector<string> mismatched_errors;
-  for (const RestoreOp& restore_op : restore_ops) {
+  std::vector<ReadLocation> locations(restore_ops.size());
+  for (int i = 0; i < restore_ops.size(); ++i) {
+    const RestoreOp& restore_op = restore_ops[i];
+    ReadLocation& location = locations[i];
     TensorShape restored_full_shape;
     DataType original_dtype;
-    TF_RETURN_IF_ERROR(default_reader.LookupDtypeAndShape(
+    TF_RETURN_IF_ERROR(default_reader->LookupDtypeAndShape(
         restore_op.tensor_name, &original_dtype, &restored_full_shape));
+    int64_t unused_offset;
+    TF_RETURN_IF_ERROR(default_reader->LookupDataLocation(
+        restore_op.tensor_name, &location.shard_id, &unused_offset,
+        &location.bytes));
+    if (location.shard_id < 0) {
+      location.bytes =
+          restored_full_shape.num_elements() * DataTypeSize(original_dtype);
+    }
     if (restore_op.dtype != original_dtype) {
       string error_msg = strings::StrCat(
           "tensor_name = ", restore_op.tensor_name, "; expected dtype ",
@@ -402,38 +558,55 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
     return errors::InvalidArgument(error_msg);
   }
 
-  std::vector<RestoreOp*> pool_restore_ops;
-  std::vector<RestoreOp*> direct_restore_ops;
-  for (RestoreOp& restore_op : restore_ops) {
-    if (restore_op.should_run_in_pool(&default_reader)) {
-      pool_restore_ops.push_back(&restore_op);
-    } else {
-      direct_restore_ops.push_back(&restore_op);
-    }
-  }
-
-  {
-    // Schedule any threaded operations first, skipping thread pool creation if
-    // we don't have any expensive operations.
-    std::unique_ptr<thread::ThreadPool> reader_pool;
-    if (!pool_restore_ops.empty()) {
-      reader_pool.reset(
-          new thread::ThreadPool(Env::Default(), "restore_tensors", 8));
-      for (auto* op : pool_restore_ops) {
-        reader_pool->Schedule([op]() { op->run_with_new_reader(); });
+  // Plans the reads: small tensors stored next to each other are batched into
+  // sequential reads, and large tensors are read on their own with range
+  // reads. A single task runs from the op thread.
+  const std::vector<ReadTask> tasks = internal::PlanReadTasks(locations);
+  ShardReadStats shard_stats;
+  if (tasks.size() == 1) {
+    const uint64 start_micros = env->NowMicros();
+    TF_RETURN_IF_ERROR(
+        RunReadTask(tasks[0], restore_ops, default_reader.get()));
+    shard_stats.Record(tasks[0].shard_id, tasks[0].bytes, start_micros,
+                       env->NowMicros());
+  } else if (!tasks.empty()) {
+    StringPiece scheme, host, path;
+    io::ParseURI(prefix_string, &scheme, &host, &path);
+    const int max_concurrency = static_cast<int>(
+        std::min<size_t>(tasks.size(), kMaxReadConcurrency));
+    const string storage =
+        scheme.empty() ? "" : strings::StrCat(scheme, "://", host);
+    ReadConcurrencyController controller(env, storage, max_concurrency,
+                                         static_cast<int>(fixed_num_threads));
+    // Tasks reuse the readers of the tasks that completed before them.
+    ReaderPool readers(env, prefix_string, reader_options);
+    readers.Put(std::move(default_reader));
+    std::vector<Status> statuses(tasks.size());
+    {
+      thread::ThreadPool reader_pool(env, "restore_tensors", max_concurrency);
+      for (int i = 0; i < tasks.size(); ++i) {
+        reader_pool.Schedule([&, i]() {
+          const ReadTask& task = tasks[i];
+          controller.Acquire();
+          const uint64 start_micros = env->NowMicros();
+          std::unique_ptr<BundleReader> reader;
+          statuses[i] = readers.Get(&reader);
+          if (statuses[i].ok()) {
+            statuses[i] = RunReadTask(task, restore_ops, reader.get());
+            readers.Put(std::move(reader));
+          }
+          shard_stats.Record(task.shard_id, task.bytes, start_micros,
+                             env->NowMicros());
+          controller.Release(task.bytes);
+        });
       }
     }
-
-    // Read small tensors from the op thread
-    for (auto* op : direct_restore_ops) {
-      TF_RETURN_IF_ERROR(op->run(&default_reader));
+    // Check status of pool tasks; this must come after the pool shuts down.
+    for (const Status& status : statuses) {
+      TF_RETURN_IF_ERROR(status);
     }
   }
-
-  // Check status of pool ops; this must come after the pool shuts down.
-  for (auto* op : pool_restore_ops) {
-    TF_RETURN_IF_ERROR(op->status);
-  }
+  shard_stats.Report(prefix_string);
 
   for (const RestoreOp& restore_op : restore_ops) {
     if (restore_op.dtype != context->mutable_output(restore_op.idx)->dtype()) {
@@ -447,4 +620,131 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
   return OkStatus();
 }
 
+namespace internal {
+
+std::vector<ReadTask> PlanReadTasks(
+    const std::vector<ReadLocation>& locations) {
+  std::vector<ReadTask> tasks;
+  ReadTask batch;
+  auto flush_batch = [&]() {
+    if (!batch.indices.empty()) tasks.push_back(std::move(batch));
+    batch = ReadTask();
+  };
+  for (int i = 0; i < locations.size(); ++i) {
+    const ReadLocation& location = locations[i];
+    if (location.bytes >= kLargeReadBytes) {
+      ReadTask task;
+      task.indices.push_back(i);
+      task.shard_id = location.shard_id;
+      task.bytes = location.bytes;
+      tasks.push_back(std::move(task));
+      continue;
+    }
+    if (!batch.indices.empty() &&
+        (batch.shard_id != location.shard_id ||
+         batch.bytes + location.bytes > kCoalescedReadBytes)) {
+      flush_batch();
+    }
+    batch.indices.push_back(i);
+    batch.shard_id = location.shard_id;
+    batch.bytes += location.bytes;
+  }
+  flush_batch();
+  return tasks;
+}
+
+namespace {
+
+mutex* LearnedLimitsMu() {
+  static mutex* mu = new mutex();
+  return mu;
+}
+
+// Best bound found so far, per storage.
+std::unordered_map<string, int>* LearnedLimits() {
+  static auto* limits = new std::unordered_map<string, int>();
+  return limits;
+}
+
+}  // namespace
+
+ReadConcurrencyController::ReadConcurrencyController(Env* env,
+                                                     const string& storage,
+                                                     int max_limit,
+                                                     int fixed_limit)
+    : env_(env), storage_(storage), max_limit_(std::max(max_limit, 1)) {
+  mutex_lock l(mu_);
+  if (fixed_limit > 0) {
+    limit_ = fixed_limit;
+    settled_ = true;
+    return;
+  }
+  {
+    mutex_lock learned_l(*LearnedLimitsMu());
+    auto it = LearnedLimits()->find(storage_);
+    limit_ = it == LearnedLimits()->end() ? kDefaultReadConcurrency
+                                          : it->second;
+  }
+  limit_ = std::min(limit_, max_limit_);
+  best_limit_ = limit_;
+  epoch_start_micros_ = env_->NowMicros();
+}
+
+ReadConcurrencyController::~ReadConcurrencyController() {
+  mutex_lock l(mu_);
+  if (best_bandwidth_ == 0) return;  // Nothing learned.
+  VLOG(1) << "Settled on " << best_limit_ << " concurrent reads from "
+          << (storage_.empty() ? "local storage" : storage_) << " at "
+          << best_bandwidth_ / 1e6 << " MB/s";
+  mutex_lock learned_l(*LearnedLimitsMu());
+  (*LearnedLimits())[storage_] = best_limit_;
+}
+
+void ReadConcurrencyController::Acquire() {
+  mutex_lock l(mu_);
+  while (in_flight_ >= limit_) {
+    cond_.wait(l);
+  }
+  ++in_flight_;
+}
+
+void ReadConcurrencyController::Release(int64_t bytes) {
+  mutex_lock l(mu_);
+  --in_flight_;
+  epoch_bytes_ += bytes;
+  ++epoch_tasks_;
+  if (!settled_ && epoch_tasks_ >= limit_) MaybeAdjust();
+  cond_.notify_all();
+}
+
+int ReadConcurrencyController::limit() const {
+  mutex_lock l(mu_);
+  return limit_;
+}
+
+void ReadConcurrencyController::MaybeAdjust() {
+  const uint64 now_micros = env_->NowMicros();
+  if (epoch_bytes_ < kMinEpochBytes || now_micros <= epoch_start_micros_) {
+    return;
+  }
+  const double bandwidth =
+      1e6 * epoch_bytes_ / (now_micros - epoch_start_micros_);
+  if (bandwidth > 1.1 * best_bandwidth_) {
+    best_bandwidth_ = bandwidth;
+    best_limit_ = limit_;
+    if (limit_ < max_limit_) {
+      limit_ = std::min(2 * limit_, max_limit_);
+    } else {
+      settled_ = true;
+    }
+  } else {
+    limit_ = best_limit_;
+    settled_ = true;
+  }
+  epoch_bytes_ = 0;
+  epoch_tasks_ = 0;
+  epoch_start_micros_ = now_micros;
+}
+
+}  // namespace internal
 }  // namespace tensorflow
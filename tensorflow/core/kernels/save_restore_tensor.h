@@ -16,6 +16,13 @@ limitations under the License.
 #ifndef TENSORFLOW_CORE_KERNELS_SAVE_RESTORE_TENSOR_H_
 #define TENSORFLOW_CORE_KERNELS_SAVE_RESTORE_TENSOR_H_
 
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/mutex.h"
+#include "tensorflow/core/platform/thread_annotations.h"
 #include "tensorflow/core/util/tensor_slice_reader.h"
 #include "tensorflow/core/util/tensor_slice_writer.h"
 
@@ -68,6 +75,85 @@ Status RestoreTensorsV2(OpKernelContext* context, const Tensor& prefix,
                         const Tensor& shape_and_slices,
                         gtl::ArraySlice<DataType> dtypes);
 
+// Implementation details of RestoreTensorsV2, exposed for testing.
+namespace internal {
+
+// Tensors stored next to each other in the same data file are read by one
+// task, sequentially, up to this many bytes.
+constexpr int64_t kCoalescedReadBytes = 64 << 20;  // 64MB
+// Tensors at least this large are read by a task of their own, with
+// concurrent range reads of kReadSectionBytes.
+constexpr int64_t kLargeReadBytes = 256 << 20;  // 256MB
+constexpr int64_t kReadSectionBytes = 64 << 20;  // 64MB
+// Number of read tasks run concurrently when nothing is known about the
+// storage yet, and upper bound on it.
+constexpr int kDefaultReadConcurrency = 8;
+constexpr int kMaxReadConcurrency = 64;
+
+// Where a tensor to restore is stored; see BundleReader::LookupDataLocation().
+struct ReadLocation {
+  int32_t shard_id = -1;
+  int64_t bytes = 0;
+};
+
+// A batch of tensors read by one thread with one BundleReader.
+struct ReadTask {
+  // Indices of the tensors, in the locations passed to PlanReadTasks().
+  std::vector<int> indices;
+  int32_t shard_id = -1;
+  int64_t bytes = 0;
+};
+
+// Groups the tensors at "locations", sorted for sequential access, into read
+// tasks.
+std::vector<ReadTask> PlanReadTasks(const std::vector<ReadLocation>& locations);
+
+// Bounds the number of read tasks in flight, and tunes the bound from the
+// observed throughput: starting from the best bound previously found for the
+// same storage, it doubles the bound while doing so raises throughput by at
+// least 10%, and otherwise settles on the best bound seen.
+class ReadConcurrencyController {
+ public:
+  // "storage" identifies the file system holding the checkpoint.  If
+  // "fixed_limit" is positive, it is used as the bound and never tuned.
+  ReadConcurrencyController(Env* env, const string& storage, int max_limit,
+                            int fixed_limit);
+  ~ReadConcurrencyController();
+
+  ReadConcurrencyController(const ReadConcurrencyController&) = delete;
+  void operator=(const ReadConcurrencyController&) = delete;
+
+  void Acquire();
+
+  // Releases a slot taken by Acquire() after reading "bytes".
+  void Release(int64_t bytes);
+
+  // The current bound.
+  int limit() const;
+
+ private:
+  // Minimum number of bytes read at a given bound before measuring it.
+  static constexpr int64_t kMinEpochBytes = 64 << 20;  // 64MB
+
+  void MaybeAdjust() TF_EXCLUSIVE_LOCKS_REQUIRED(mu_);
+
+  Env* const env_;
+  const string storage_;
+  const int max_limit_;
+
+  mutable mutex mu_;
+  condition_variable cond_;
+  int limit_ TF_GUARDED_BY(mu_);
+  int in_flight_ TF_GUARDED_BY(mu_) = 0;
+  bool settled_ TF_GUARDED_BY(mu_) = false;
+  int best_limit_ TF_GUARDED_BY(mu_) = 0;
+  double best_bandwidth_ TF_GUARDED_BY(mu_) = 0;
+  int64_t epoch_bytes_ TF_GUARDED_BY(mu_) = 0;
+  int epoch_tasks_ TF_GUARDED_BY(mu_) = 0;
+  uint64 epoch_start_micros_ TF_GUARDED_BY(mu_) = 0;
+};
+
+}  // namespace internal
 }  // namespace tensorflow
 
 #endif  // TENSORFLOW_CORE_KERNELS_SAVE_RESTORE_TENSOR_H_
@@ -0,0 +1,142 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/core/kernels/save_restore_tensor.h"
+
+#include <memory>
+#include <vector>
+
+#include "tensorflow/core/lib/core/notification.h"
+#include "tensorflow/core/platform/env.h"
+#include "tensorflow/core/platform/test.h"
+#include "tensorflow/core/util/fake_clock_env.h"
+
+namespace tensorflow {
+namespace internal {
+namespace {
+
+using ::testing::ElementsAre;
+
+constexpr int64_t kMB = 1 << 20;
+
+TEST(PlanReadTasksTest, Empty) { EXPECT_TRUE(PlanReadTasks({}).empty()); }
+
+TEST(PlanReadTasksTest, CoalescesTensorsOfTheSameShard) {
+  const std::vector<ReadTask> tasks =
+      PlanReadTasks({{0, kMB}, {0, 2 * kMB}, {1, kMB}, {-1, kMB}});
+  ASSERT_EQ(3, tasks.size());
+  EXPECT_THAT(tasks[0].indices, ElementsAre(0, 1));
+  EXPECT_EQ(0, tasks[0].shard_id);
+  EXPECT_EQ(3 * kMB, tasks[0].bytes);
+  EXPECT_THAT(tasks[1].indices, ElementsAre(2));
+  EXPECT_EQ(1, tasks[1].shard_id);
+  EXPECT_THAT(tasks[2].indices, ElementsAre(3));
+  EXPECT_EQ(-1, tasks[2].shard_id);
+}
+
+TEST(PlanReadTasksTest, SplitsAtCoalescedReadBytes) {
+  const int64_t bytes = kCoalescedReadBytes / 2;
+  const std::vector<ReadTask> tasks =
+      PlanReadTasks({{0, bytes}, {0, bytes}, {0, 1}});
+  ASSERT_EQ(2, tasks.size());
+  EXPECT_THAT(tasks[0].indices, ElementsAre(0, 1));
+  EXPECT_EQ(kCoalescedReadBytes, tasks[0].bytes);
+  EXPECT_THAT(tasks[1].indices, ElementsAre(2));
+  EXPECT_EQ(1, tasks[1].bytes);
+}
+
+TEST(PlanReadTasksTest, ReadsLargeTensorsOnTheirOwn) {
+  const std::vector<ReadTask> tasks =
+      PlanReadTasks({{0, kMB}, {0, kLargeReadBytes}, {0, kMB}});
+  ASSERT_EQ(2, tasks.size());
+  EXPECT_THAT(tasks[0].indices, ElementsAre(1));
+  EXPECT_EQ(kLargeReadBytes, tasks[0].bytes);
+  // The small tensors around it are still read together.
+  EXPECT_THAT(tasks[1].indices, ElementsAre(0, 2));
+  EXPECT_EQ(2 * kMB, tasks[1].bytes);
+}
+
+// Runs "num_tasks" tasks reading "bytes" each, concurrently, over "micros".
+void RunEpoch(ReadConcurrencyController* controller, FakeClockEnv* env,
+              int num_tasks, int64_t bytes, int64_t micros) {
+  for (int i = 0; i < num_tasks; ++i) controller->Acquire();
+  env->AdvanceByMicroseconds(micros);
+  for (int i = 0; i < num_tasks; ++i) controller->Release(bytes);
+}
+
+TEST(ReadConcurrencyControllerTest, TunesAndRemembersLimit) {
+  FakeClockEnv env(Env::Default());
+  {
+    ReadConcurrencyController controller(&env, "test://tunes", 64,
+                                         /*fixed_limit=*/0);
+    EXPECT_EQ(kDefaultReadConcurrency, controller.limit());
+    // 64MB/s, then 128MB/s: doubling the limit pays off.
+    RunEpoch(&controller, &env, 8, 8 * kMB, 1000000);
+    EXPECT_EQ(16, controller.limit());
+    RunEpoch(&controller, &env, 16, 8 * kMB, 1000000);
+    EXPECT_EQ(32, controller.limit());
+    // Still 128MB/s: settles back on the best limit.
+    RunEpoch(&controller, &env, 32, 8 * kMB, 2000000);
+    EXPECT_EQ(16, controller.limit());
+    RunEpoch(&controller, &env, 16, 64 * kMB, 1);
+    EXPECT_EQ(16, controller.limit());
+  }
+  ReadConcurrencyController same_storage(&env, "test://tunes", 64,
+                                         /*fixed_limit=*/0);
+  EXPECT_EQ(16, same_storage.limit());
+  ReadConcurrencyController fewer_tasks(&env, "test://tunes", 4,
+                                        /*fixed_limit=*/0);
+  EXPECT_EQ(4, fewer_tasks.limit());
+  ReadConcurrencyController other_storage(&env, "test://other", 64,
+                                          /*fixed_limit=*/0);
+  EXPECT_EQ(kDefaultReadConcurrency, other_storage.limit());
+}
+
+TEST(ReadConcurrencyControllerTest, WaitsForMinEpochBytes) {
+  FakeClockEnv env(Env::Default());
+  ReadConcurrencyController controller(&env, "test://min_bytes", 64,
+                                       /*fixed_limit=*/0);
+  RunEpoch(&controller, &env, 8, kMB, 1000000);
+  EXPECT_EQ(kDefaultReadConcurrency, controller.limit());
+}
+
+TEST(ReadConcurrencyControllerTest, FixedLimit) {
+  FakeClockEnv env(Env::Default());
+  ReadConcurrencyController controller(&env, "test://fixed", 64,
+                                       /*fixed_limit=*/2);
+  EXPECT_EQ(2, controller.limit());
+  RunEpoch(&controller, &env, 2, 64 * kMB, 1000000);
+  EXPECT_EQ(2, controller.limit());
+
+  controller.Acquire();
+  controller.Acquire();
+  Notification acquired;
+  std::unique_ptr<Thread> thread(
+      Env::Default()->StartThread(ThreadOptions(), "acquire", [&]() {
+        controller.Acquire();
+        acquired.Notify();
+      }));
+  Env::Default()->SleepForMicroseconds(10000);
+  EXPECT_FALSE(acquired.HasBeenNotified());
+  controller.Release(kMB);
+  acquired.WaitForNotification();
+  thread.reset();
+  controller.Release(kMB);
+  controller.Release(kMB);
+}
+
+}  // namespace
+}  // namespace internal
+}  // namespace tensorflow
@@ -15,24 +15,32 @@ limitations under the License.
 
 // See docs in ../ops/io_ops.cc.
 
+#include <algorithm>
 #include <cstddef>
 #include <limits>
+#include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
+#include "tensorflow/core/framework/allocator.h"
 #include "tensorflow/core/framework/bounds_check.h"
+#include "tensorflow/core/framework/node_def_util.h"
 #include "tensorflow/core/framework/op_kernel.h"
 #include "tensorflow/core/framework/resource_mgr.h"
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
+#include "tensorflow/core/kernels/async_checkpoint_saver.h"
 #include "tensorflow/core/kernels/checkpoint_callback_manager.h"
 #include "tensorflow/core/kernels/save_restore_tensor.h"
 #include "tensorflow/core/lib/core/status.h"
 #include "tensorflow/core/lib/io/path.h"
+#include "tensorflow/core/platform/cpu_info.h"
 #include "tensorflow/core/platform/env.h"
 #include "tensorflow/core/platform/logging.h"  // IWYU pragma: keep
 #include "tensorflow/core/platform/types.h"
+#include "tensorflow/core/util/env_var.h"
 #include "tensorflow/core/util/saved_tensor_slice_util.h"
 #include "tensorflow/core/util/tensor_bundle/naming.h"
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
@@ -90,12 +98,112 @@ void ValidateInputs(bool is_save_op, OpKernelContext* context,
   }
 }
 
+// A tensor to save, captured from the inputs of SaveV2.
+struct SaveItem {
+  string name;
+  Tensor tensor;
+  bool is_slice = false;
+  TensorShape full_shape;
+  TensorSlice slice;
+};
+
+// Writes "items" to a tensor bundle at "prefix".
+Status WriteSaveItems(const string& prefix,
+                      const BundleWriter::Options& options,
+                      const std::vector<SaveItem>& items) {
+  BundleWriter writer(Env::Default(), prefix, options);
+  TF_RETURN_IF_ERROR(writer.status());
+  VLOG(1) << "BundleWriter, prefix_string: " << prefix;
+
+  for (const SaveItem& item : items) {
+    const Tensor& tensor = item.tensor;
+    VLOG(2) << "Starting save of " << item.name;
+    if (item.is_slice) {
+      TF_RETURN_IF_ERROR(
+          writer.AddSlice(item.name, item.full_shape, item.slice, tensor));
+    } else {
+      TF_RETURN_IF_ERROR(writer.Add(item.name, tensor));
+    }
+
+    if (VLOG_IS_ON(5)) {
+      if (tensor.dtype() == DT_FLOAT) {
+        const float* t_data = tensor.flat<float>().data();
+        float min = std::numeric_limits<float>::infinity();
+        float max = -std::numeric_limits<float>::infinity();
+        double avg = 0.0;
+        for (int i = 0; i < tensor.NumElements(); ++i) {
+          if (t_data[i] < min) min = t_data[i];
+          if (t_data[i] > max) max = t_data[i];
+          avg += t_data[i];
+        }
+        VLOG(5) << " min " << min << " max " << max << " avg "
+                << avg / tensor.NumElements() << " total elts "
+                << tensor.NumElements();
+      }
+    }
+
+    VLOG(2) << "Done save of " << item.name;
+  }
+  TF_RETURN_IF_ERROR(writer.Finish());
+  VLOG(1) << "Done BundleWriter, prefix_string: " << prefix;
+  return OkStatus();
+}
+
+Status GetCheckpointCallbackManager(
+    ResourceMgr* resource_manager,
+    checkpoint::CheckpointCallbackManager** checkpoint_callback_manager) {
+  return resource_manager
+      ->LookupOrCreate<checkpoint::CheckpointCallbackManager>(
+          resource_manager->default_container(),
+          std::string(checkpoint::kCheckpointCallbackManagerResourceName),
+          checkpoint_callback_manager,
+          [](checkpoint::CheckpointCallbackManager** out) {
+            *out = new checkpoint::CheckpointCallbackManager();
+            return OkStatus();
+          });
+}
+
 }  // namespace
 
 // Saves a list of named tensors using the tensor bundle library.
 class SaveV2 : public OpKernel {
  public:
-  explicit SaveV2(OpKernelConstruction* context) : OpKernel(context) {}
+  explicit SaveV2(OpKernelConstruction* context) : OpKernel(context) {
+    // Striping a save across several data files lets large checkpoints use
+    // more than one write stream per device.
+    int64_t num_stripes;
+    OP_REQUIRES_OK(context,
+                   ReadInt64FromEnvVar("TF_CHECKPOINT_SAVE_NUM_STRIPES",
+                                       /*default_val=*/1, &num_stripes));
+    writer_options_.num_stripes = static_cast<int>(std::max<int64_t>(
+        1, std::min<int64_t>(num_stripes, port::MaxParallelism())));
+
+    // Restores with TF_CHECKPOINT_RESTORE_USE_MMAP can only alias tensor data
+    // aligned for the allocator, which costs up to 63 bytes of padding per
+    // tensor.
+    bool align_for_mmap;
+    OP_REQUIRES_OK(context,
+                   ReadBoolFromEnvVar("TF_CHECKPOINT_SAVE_ALIGN_FOR_MMAP",
+                                      /*default_val=*/false, &align_for_mmap));
+    if (align_for_mmap) {
+      writer_options_.data_alignment = Allocator::kAllocatorAlignment;
+    }
+
+    // In asynchronous mode the kernel returns once its inputs are captured
+    // and the bundle is written in the background. RestoreV2 and
+    // MergeV2Checkpoints wait for pending saves of their prefixes. This
+    // relies on the inputs being copy-on-write snapshots, so the mode is
+    // opt-in and granted by CheckpointSaveModePass (see
+    // common_runtime/checkpoint_save_mode_pass.h) only to saves that do not
+    // read reference variables.
+    if (!TryGetNodeAttr(context->def(), "_async_checkpoint_save",
+                        &async_save_)) {
+      async_save_ = false;
+    }
+    OP_REQUIRES_OK(context,
+                   ReadInt64FromEnvVar("TF_CHECKPOINT_ASYNC_SAVE_MAX_PENDING",
+                                       /*default_val=*/2, &max_pending_saves_));
+  }
 
   void Compute(OpKernelContext* context) override {
     const Tensor& prefix = context->input(0);
@@ -111,77 +219,78 @@ class SaveV2 : public OpKernel {
     const auto& tensor_names_flat = tensor_names.flat<tstring>();
     const auto& shape_and_slices_flat = shape_and_slices.flat<tstring>();
 
-    BundleWriter writer(Env::Default(), prefix_string);
-    OP_REQUIRES_OK(context, writer.status());
-    VLOG(1) << "BundleWriter, prefix_string: " << prefix_string;
-
+    std::vector<SaveItem> items(num_tensors);
     for (int i = 0; i < num_tensors; ++i) {
-      const string& tensor_name = tensor_names_flat(i);
-      const Tensor& tensor = context->input(i + kFixedInputs);
-      VLOG(2) << "Starting save of " << tensor_name;
+      SaveItem& item = items[i];
+      item.name = tensor_names_flat(i);
+      item.tensor = context->input(i + kFixedInputs);
+      const Tensor& tensor = item.tensor;
 
       if (!shape_and_slices_flat(i).empty()) {
         const string& shape_spec = shape_and_slices_flat(i);
-        TensorShape shape;
         TensorSlice slice(tensor.dims());
         TensorShape slice_shape;
 
-        OP_REQUIRES_OK(context, checkpoint::ParseShapeAndSlice(
-                                    shape_spec, &shape, &slice, &slice_shape));
+        OP_REQUIRES_OK(context,
+                       checkpoint::ParseShapeAndSlice(shape_spec,
+                                                      &item.full_shape, &slice,
+                                                      &slice_shape));
         OP_REQUIRES(context, slice_shape.IsSameSize(tensor.shape()),
                     errors::InvalidArgument("Slice in shape_and_slice "
                                             "specification does not match the "
                                             "shape of the tensor to  save: ",
                                             shape_spec, ", tensor: ",
                                             tensor.shape().DebugString()));
-
-        OP_REQUIRES_OK(context,
-                       writer.AddSlice(tensor_name, shape, slice, tensor));
-      } else {
-        OP_REQUIRES_OK(context, writer.Add(tensor_name, tensor));
+        item.is_slice = true;
+        item.slice = std::move(slice);
       }
-
-      if (VLOG_IS_ON(5)) {
-        if (tensor.dtype() == DT_FLOAT) {
-          const float* t_data = tensor.flat<float>().data();
-          float min = std::numeric_limits<float>::infinity();
-          float max = -std::numeric_limits<float>::infinity();
-          double avg = 0.0;
-          for (int i = 0; i < tensor.NumElements(); ++i) {
-            if (t_data[i] < min) min = t_data[i];
-            if (t_data[i] > max) max = t_data[i];
-            avg += t_data[i];
-          }
-          VLOG(5) << " min " << min << " max " << max << " avg "
-                  << avg / tensor.NumElements() << " total elts "
-                  << tensor.NumElements();
-        }
-      }
-
-      VLOG(2) << "Done save of " << tensor_name;
     }
-    OP_REQUIRES_OK(context, writer.Finish());
-    VLOG(1) << "Done BundleWriter, prefix_string: " << prefix_string;
 
     ResourceMgr* resource_manager = context->resource_manager();
-    if (resource_manager != nullptr) {
+    if (async_save_ && resource_manager != nullptr) {
+      // The saver is shared by all devices, so that MergeV2Checkpoints waits
+      // for the shards saved on other devices.
+      checkpoint::AsyncCheckpointSaver* saver =
+          checkpoint::AsyncCheckpointSaver::Global(
+              static_cast<int>(max_pending_saves_));
       checkpoint::CheckpointCallbackManager* checkpoint_callback_manager;
+      OP_REQUIRES_OK(
+          context, GetCheckpointCallbackManager(resource_manager,
+                                                &checkpoint_callback_manager));
+      std::shared_ptr<checkpoint::CheckpointCallbackManager> callback_manager(
+          checkpoint_callback_manager,
+          [](checkpoint::CheckpointCallbackManager* m) { m->Unref(); });
       OP_REQUIRES_OK(
           context,
-          resource_manager
-              ->LookupOrCreate<checkpoint::CheckpointCallbackManager>(
-                  resource_manager->default_container(),
-                  std::string(
-                      checkpoint::kCheckpointCallbackManagerResourceName),
-                  &checkpoint_callback_manager,
-                  [](checkpoint::CheckpointCallbackManager** out) {
-                    *out = new checkpoint::CheckpointCallbackManager();
-                    return OkStatus();
-                  }));
+          saver->ScheduleSave(
+              prefix_string,
+              [prefix_string, options = writer_options_,
+               items = std::move(items), callback_manager]() {
+                TF_RETURN_IF_ERROR(
+                    WriteSaveItems(prefix_string, options, items));
+                callback_manager->Save(prefix_string);
+                return OkStatus();
+              }));
+      return;
+    }
+
+    OP_REQUIRES_OK(context,
+                   WriteSaveItems(prefix_string, writer_options_, items));
+
+    if (resource_manager != nullptr) {
+      checkpoint::CheckpointCallbackManager* checkpoint_callback_manager;
+      OP_REQUIRES_OK(
+          context, GetCheckpointCallbackManager(resource_manager,
+                                                &checkpoint_callback_manager));
       checkpoint_callback_manager->Save(prefix_string);
       checkpoint_callback_manager->Unref();
     }
   }
+
+ private:
+  BundleWriter::Options writer_options_;
+  bool async_save_ = false;
+  int64_t max_pending_saves_ = 2;
 };
 REGISTER_KERNEL_BUILDER(Name("SaveV2").Device(DEVICE_CPU), SaveV2);
 
@@ -206,6 +315,12 @@ class RestoreV2 : public OpKernel {
 
     const string& prefix_string = prefix.scalar<tstring>()();
 
+    checkpoint::AsyncCheckpointSaver* saver =
+        checkpoint::AsyncCheckpointSaver::GlobalIfCreated();
+    if (saver != nullptr) {
+      OP_REQUIRES_OK(context, saver->Wait(prefix_string));
+    }
+
     VLOG(2) << "Started Restore at prefix: " << prefix_string;
     // Intention: we plan to use the RestoreV2 op as a backward-compatible
     // reader as we upgrade to the V2 format.  This allows transparent upgrade.
@@ -236,17 +351,8 @@ class RestoreV2 : public OpKernel {
     if (resource_manager != nullptr) {
       checkpoint::CheckpointCallbackManager* checkpoint_callback_manager;
       OP_REQUIRES_OK(
-          context,
-          resource_manager
-              ->LookupOrCreate<checkpoint::CheckpointCallbackManager>(
-                  resource_manager->default_container(),
-                  std::string(
-                      checkpoint::kCheckpointCallbackManagerResourceName),
-                  &checkpoint_callback_manager,
-                  [](checkpoint::CheckpointCallbackManager** out) {
-                    *out = new checkpoint::CheckpointCallbackManager();
-                    return OkStatus();
-                  }));
+          context, GetCheckpointCallbackManager(resource_manager,
+                                                &checkpoint_callback_manager));
       checkpoint_callback_manager->Restore(prefix_string);
       checkpoint_callback_manager->Unref();
     }
@@ -283,15 +389,44 @@ class MergeV2Checkpoints : public OpKernel {
                     "Input destination_prefix should be a scalar tensor, got ",
                     destination_prefix.shape().DebugString(), " instead."));
 
-    const gtl::ArraySlice<tstring> input_prefixes =
-        gtl::ArraySlice<tstring>(checkpoint_prefixes.flat<tstring>());
-    Env* env = Env::Default();
+    const auto& input_prefixes_flat = checkpoint_prefixes.flat<tstring>();
+    std::vector<string> input_prefixes(input_prefixes_flat.data(),
+                                       input_prefixes_flat.data() +
+                                           input_prefixes_flat.size());
     const string& merged_prefix = destination_prefix.scalar<tstring>()();
-    OP_REQUIRES_OK(context,
-                   tensorflow::MergeBundles(env, input_prefixes, merged_prefix,
-                                            allow_missing_files_));
 
-    if (delete_old_dirs_) {
+    // Pending asynchronous saves of the inputs, on any device, complete
+    // before the merge runs. The kernel still returns only once the merged
+    // checkpoint is written, with the errors of the saves it waited for.
+    checkpoint::AsyncCheckpointSaver* saver =
+        checkpoint::AsyncCheckpointSaver::GlobalIfCreated();
+    if (saver != nullptr) {
+      saver->ScheduleMerge(
+          input_prefixes, merged_prefix,
+          [input_prefixes, merged_prefix,
+           allow_missing_files = allow_missing_files_,
+           delete_old_dirs = delete_old_dirs_]() {
+            return Merge(input_prefixes, merged_prefix, allow_missing_files,
+                         delete_old_dirs);
+          });
+      OP_REQUIRES_OK(context, saver->Wait(merged_prefix));
+      return;
+    }
+    OP_REQUIRES_OK(context, Merge(input_prefixes, merged_prefix,
+                                  allow_missing_files_, delete_old_dirs_));
+  }
+
+ private:
+  static Status Merge(const std::vector<string>& input_prefixes,
+                      const string& merged_prefix, bool allow_missing_files,
+                      bool delete_old_dirs) {
+    Env* env = Env::Default();
+    std::vector<tstring> prefixes(input_prefixes.begin(),
+                                  input_prefixes.end());
+    TF_RETURN_IF_ERROR(tensorflow::MergeBundles(env, prefixes, merged_prefix,
+                                                allow_missing_files));
+
+    if (delete_old_dirs) {
       const string merged_dir(io::Dirname(merged_prefix));
       for (const string& input_prefix : input_prefixes) {
         const string dirname(io::Dirname(input_prefix));
@@ -302,9 +437,9 @@ class MergeV2Checkpoints : public OpKernel {
         if (!status.ok()) VLOG(1) << status;
       }
     }
+    return OkStatus();
   }
 
- private:
   // On merge, whether or not to delete the input (temporary) directories.
   bool delete_old_dirs_;
 
@@ -315,4 +450,35 @@ class MergeV2Checkpoints : public OpKernel {
 REGISTER_KERNEL_BUILDER(Name("MergeV2Checkpoints").Device(DEVICE_CPU),
                         MergeV2Checkpoints);
 
+// Waits for the pending asynchronous saves and merges of the given prefixes,
+// or of all prefixes if none are given, and reports their errors.
+class WaitForCheckpointSaves : public OpKernel {
+ public:
+  explicit WaitForCheckpointSaves(OpKernelConstruction* context)
+      : OpKernel(context) {}
+
+  void Compute(OpKernelContext* context) override {
+    const Tensor& checkpoint_prefixes = context->input(0);
+    OP_REQUIRES(context,
+                TensorShapeUtils::IsVector(checkpoint_prefixes.shape()),
+                errors::InvalidArgument(
+                    "Input checkpoint_prefixes should be a 1-D tensor, got ",
+                    checkpoint_prefixes.shape().DebugString(), " instead."));
+    checkpoint::AsyncCheckpointSaver* saver =
+        checkpoint::AsyncCheckpointSaver::GlobalIfCreated();
+    if (saver == nullptr) return;
+    if (checkpoint_prefixes.NumElements() == 0) {
+      OP_REQUIRES_OK(context, saver->WaitForAll());
+      return;
+    }
+    Status status;
+    for (const tstring& prefix : checkpoint_prefixes.flat<tstring>()) {
+      status.Update(saver->Wait(prefix));
+    }
+    OP_REQUIRES_OK(context, status);
+  }
+};
+REGISTER_KERNEL_BUILDER(Name("WaitForCheckpointSaves").Device(DEVICE_CPU),
+                        WaitForCheckpointSaves);
+
 }  // namespace tensorflow
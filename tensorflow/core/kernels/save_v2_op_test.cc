@@ -13,12 +13,16 @@ See the License for the specific language governing permissions and
 limitations under the License.
 ==============================================================================*/
 
+#include <stdlib.h>
+
 #include <complex>
 #include <string>
 
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/fake_input.h"
 #include "tensorflow/core/framework/node_def_builder.h"
 #include "tensorflow/core/framework/tensor.h"
+#include "tensorflow/core/framework/tensor_description.pb.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/types.h"
 #include "tensorflow/core/framework/types.pb.h"
@@ -340,5 +344,53 @@ TEST_F(SaveV2OpTest, Simple) {
   }
 }
 
+TEST_F(SaveV2OpTest, AlignsDataForMmap) {
+  const string prefix = io::JoinPath(testing::TmpDir(), "tensor_mmap");
+  setenv("TF_CHECKPOINT_SAVE_ALIGN_FOR_MMAP", "1", /*overwrite=*/1);
+  TF_ASSERT_OK(NodeDefBuilder("myop", "SaveV2")
+                   .Input(FakeInput())  // prefix
+                   .Input(FakeInput())  // tensor_names
+                   .Input(FakeInput())  // shape_and_slices
+                   .Input(FakeInput({DT_FLOAT, DT_INT8}))  // tensors
+                   .Finalize(node_def()));
+  TF_ASSERT_OK(InitOp());
+  unsetenv("TF_CHECKPOINT_SAVE_ALIGN_FOR_MMAP");
+  AddInput<tstring>(TensorShape({}),
+                    [&prefix](int x) -> tstring { return prefix; });
+  AddInput<tstring>(TensorShape({2}), [](int x) -> tstring {
+    return x == 0 ? "tensor_float" : "tensor_int8";
+  });
+  AddInput<tstring>(TensorShape({2}), [](int x) -> tstring { return ""; });
+  // Neither size is a multiple of the alignment.
+  AddInput<float>(TensorShape({3}), [](int x) -> float { return x + 0.5f; });
+  AddInput<int8>(TensorShape({5}), [](int x) -> int8 { return x - 2; });
+  TF_ASSERT_OK(RunOpKernel());
+
+  BundleReader::Options options;
+  options.use_mmap = true;
+  BundleReader reader(Env::Default(), prefix, options);
+  TF_ASSERT_OK(reader.status());
+  Tensor val_float, val_int8;
+  TF_ASSERT_OK(reader.LookupMapped("tensor_float", &val_float));
+  TF_ASSERT_OK(reader.LookupMapped("tensor_int8", &val_int8));
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(i + 0.5f, val_float.flat<float>()(i));
+  }
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_EQ(i - 2, val_int8.flat<int8>()(i));
+  }
+  // Both tensors alias the data file.
+  for (const Tensor* val : {&val_float, &val_int8}) {
+    TensorDescription description;
+    val->FillDescription(&description);
+    const AllocationDescription& allocation =
+        description.allocation_description();
+    EXPECT_EQ(allocation.allocator_name(), "mmap");
+    EXPECT_EQ(allocation.requested_bytes(), val->TotalBytes());
+    EXPECT_EQ(allocation.allocated_bytes(), val->TotalBytes());
+    EXPECT_FALSE(val->RefCountIsOne());
+  }
+}
+
 }  // namespace
 }  // namespace tensorflow
@@ -29,7 +29,6 @@ class SendOp : public OpKernel {
   string TraceString(const OpKernelContext& ctx, bool verbose) const override;
 
  private:
-  string key_prefix_;
   Rendezvous::ParsedKey parsed_key_;
   bool hostmem_sendrecv_;
 
@@ -45,7 +44,6 @@ class RecvOp : public AsyncOpKernel {
   string TraceString(const OpKernelContext& ctx, bool verbose) const override;
 
  private:
-  string key_prefix_;
   Rendezvous::ParsedKey parsed_key_;
   bool hostmem_sendrecv_;
 
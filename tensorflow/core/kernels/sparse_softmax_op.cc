@@ -80,8 +80,11 @@ class SparseSoftmaxOp : public OpKernel {
     typename TTypes<T>::Flat output_flat = output_values->flat<T>();
 
     Tensor tmp_t;
+    AllocatorAttributes scratch_attr;
+    scratch_attr.set_scratch(true);
     OP_REQUIRES_OK(context, context->allocate_temp(DataTypeToEnum<T>::value,
-                                                   TensorShape({}), &tmp_t));
+                                                   TensorShape({}), &tmp_t,
+                                                   scratch_attr));
     typename TTypes<T>::Scalar tmp_scalar = tmp_t.scalar<T>();
 
     gtl::InlinedVector<int64_t, 4> dims(rank);
@@ -147,6 +147,15 @@ REGISTER_OP("MergeV2Checkpoints")
       return OkStatus();
     });
 
+REGISTER_OP("WaitForCheckpointSaves")
+    .Input("checkpoint_prefixes: string")
+    .SetIsStateful()
+    .SetShapeFn([](InferenceContext* c) {
+      ShapeHandle unused;
+      TF_RETURN_IF_ERROR(c->WithRank(c->input(0), 1, &unused));
+      return OkStatus();
+    });
+
 REGISTER_OP("Save")
     .Input("filename: string")
     .Input("tensor_names: string")
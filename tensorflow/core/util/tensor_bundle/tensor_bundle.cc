@@ -15,11 +15,13 @@ limitations under the License.
 
 #include "tensorflow/core/util/tensor_bundle/tensor_bundle.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <cstring>
 #include <memory>
 #include <utility>
 
+#include "tensorflow/core/framework/allocation_description.pb.h"
 #include "tensorflow/core/framework/register_types.h"
 #include "tensorflow/core/framework/tensor.pb.h"
 #include "tensorflow/core/framework/tensor_shape.pb.h"
@@ -41,6 +43,7 @@ limitations under the License.
 #include "tensorflow/core/platform/cord.h"
 #include "tensorflow/core/platform/errors.h"
 #include "tensorflow/core/platform/mem.h"
+#include "tensorflow/core/platform/mutex.h"
 #include "tensorflow/core/platform/path.h"
 #include "tensorflow/core/platform/random.h"
 #include "tensorflow/core/platform/status.h"
@@ -73,12 +76,8 @@ static const int kBufferSize = 1024 * 1024;
 // bundle.
 const char* const kHeaderEntryKey = "";
 
-// The size threshold for multi-threaded tensor loading.
-const int64_t kLargeTensorThreshold = static_cast<int64_t>(1) << 32;
 // Maximum number of threads to load the tensor from the file.
 const int kMaxFileReadThreads = 8;
-// Minimum size of a file section handled by each thread.
-const int64_t kMinSectionSize = static_cast<int64_t>(1) << 31;
 
 namespace {
 
@@ -424,15 +423,61 @@ Status PadAlignment(tsl::BufferedWritableFile* out, int alignment,
 
 }  // namespace
 
+struct BundleWriter::Stripe {
+  Stripe(int index, std::string data_path,
+         std::unique_ptr<tsl::BufferedWritableFile> out)
+      : index(index), data_path(std::move(data_path)), out(std::move(out)) {}
+
+  // Appends "val" to the data file and fills in the location, size and
+  // checksum of "entry".
+  Status Write(const Tensor& val, BundleEntryProto* entry, int alignment) {
+    mutex_lock l(mu);
+    if (!status.ok()) return status;
+    entry->set_shard_id(index);
+    entry->set_offset(size);
+
+    size_t data_bytes_written = 0;
+    uint32 crc32c = 0;
+    out->reset_crc32();
+    if (val.dtype() == DT_STRING) {
+      status = WriteStringTensor(val, out.get(), &data_bytes_written, &crc32c);
+    } else if (val.dtype() == DT_VARIANT) {
+      status = WriteVariantTensor(val, out.get(), &data_bytes_written, &crc32c);
+    } else {
+      status = WriteTensor(val, out.get(), &data_bytes_written);
+      crc32c = out->crc32();
+    }
+
+    if (status.ok()) {
+      entry->set_size(data_bytes_written);
+      entry->set_crc32c(crc32c::Mask(crc32c));
+      size += data_bytes_written;
+      status = PadAlignment(out.get(), alignment, &size);
+    }
+    return status;
+  }
+
+  // Index of this stripe among all stripes; shard id until FinishDataFiles().
+  const int index;
+  const std::string data_path;
+
+  // Only accessed from the thread calling Add().
+  std::vector<BundleEntryProto*> entries;
+  int64_t assigned_bytes = 0;
+
+  mutex mu;
+  std::unique_ptr<tsl::BufferedWritableFile> out TF_GUARDED_BY(mu);
+  int64_t size TF_GUARDED_BY(mu) = 0;  // Number of bytes written into out.
+  Status status TF_GUARDED_BY(mu);
+};
+
 BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
-    : env_(env), options_(options), prefix_(prefix), out_(nullptr), size_(0) {
+    : env_(env), options_(options), prefix_(prefix) {
   status_ = env_->HasAtomicMove(prefix_, &use_temp_file_);
   if (!status_.ok()) return;
 
-  data_path_ = DataFilename(prefix_, 0, 1);
   metadata_path_ = MetaFilename(prefix_);
   if (use_temp_file_) {
-    data_path_ = strings::StrCat(data_path_, ".tempstate", random::New64());
     metadata_path_ =
         strings::StrCat(metadata_path_, ".tempstate", random::New64());
   }
@@ -442,13 +487,39 @@ BundleWriter::BundleWriter(Env* env, StringPiece prefix, const Options& options)
     return;
   }
 
-  std::unique_ptr<WritableFile> wrapper;
-  status_ = env_->NewWritableFile(data_path_, &wrapper);
-  if (!status_.ok()) return;
-  out_ = std::make_unique<tsl::BufferedWritableFile>(
-      std::move(wrapper), 8 << 20 /* 8MB write buffer */);
+  const int num_stripes = std::max(options_.num_stripes, 1);
+  for (int i = 0; i < num_stripes; ++i) {
+    string data_path = DataFilename(prefix_, i, num_stripes);
+    if (use_temp_file_) {
+      data_path = strings::StrCat(data_path, ".tempstate", random::New64());
+    }
+    std::unique_ptr<WritableFile> wrapper;
+    status_ = env_->NewWritableFile(data_path, &wrapper);
+    if (!status_.ok()) return;
+    stripes_.push_back(std::make_unique<Stripe>(
+        i, data_path,
+        std::make_unique<tsl::BufferedWritableFile>(
+            std::move(wrapper), 8 << 20 /* 8MB write buffer */)));
+    VLOG(1) << "Writing to file " << data_path;
+  }
+  if (num_stripes > 1) {
+    write_pool_ = std::make_unique<thread::ThreadPool>(
+        env_, "bundle_writer", num_stripes);
+  }
+}
 
-  VLOG(1) << "Writing to file " << data_path_;
+BundleWriter::~BundleWriter() {
+  // Waits for pending writes, which reference the stripes.
+  write_pool_.reset();
+}
+
+BundleWriter::Stripe* BundleWriter::NextStripe(int64_t bytes) {
+  Stripe* next = stripes_[0].get();
+  for (const auto& stripe : stripes_) {
+    if (stripe->assigned_bytes < next->assigned_bytes) next = stripe.get();
+  }
+  next->assigned_bytes += bytes;
+  return next;
 }
 
 Status BundleWriter::Add(StringPiece key, const Tensor& val) {
@@ -463,29 +534,23 @@ Status BundleWriter::Add(StringPiece key, const Tensor& val) {
   BundleEntryProto* entry = &entries_[key_string];
   entry->set_dtype(val.dtype());
   val.shape().AsProto(entry->mutable_shape());
-  entry->set_shard_id(0);
-  entry->set_offset(size_);
-
-  // Updates the data file.
-  size_t data_bytes_written = 0;
-  uint32 crc32c = 0;
-  out_->reset_crc32();
-  if (val.dtype() == DT_STRING) {
-    status_ = WriteStringTensor(val, out_.get(), &data_bytes_written, &crc32c);
-  } else if (val.dtype() == DT_VARIANT) {
-    status_ = WriteVariantTensor(val, out_.get(), &data_bytes_written, &crc32c);
-  } else {
-    status_ = WriteTensor(val, out_.get(), &data_bytes_written);
-    crc32c = out_->crc32();
-  }
 
-  if (status_.ok()) {
-    entry->set_size(data_bytes_written);
-    entry->set_crc32c(crc32c::Mask(crc32c));
-    size_ += data_bytes_written;
-    status_ = PadAlignment(out_.get(), options_.data_alignment, &size_);
+  Stripe* stripe = NextStripe(val.TotalBytes());
+  stripe->entries.push_back(entry);
+  if (write_pool_ == nullptr) {
+    status_ = stripe->Write(val, entry, options_.data_alignment);
+    return status_;
   }
-  return status_;
+  // Surface errors from earlier asynchronous writes to this stripe.
+  {
+    mutex_lock l(stripe->mu);
+    status_ = stripe->status;
+  }
+  if (!status_.ok()) return status_;
+  write_pool_->Schedule([stripe, entry, val, this]() {
+    stripe->Write(val, entry, options_.data_alignment).IgnoreError();
+  });
+  return OkStatus();
 }
 
 Status BundleWriter::AddSlice(StringPiece full_tensor_key,
@@ -529,20 +594,54 @@ Status BundleWriter::AddSlice(StringPiece full_tensor_key,
   return status_;
 }
 
+Status BundleWriter::FinishDataFiles() {
+  Status status = status_;
+  for (const auto& stripe : stripes_) {
+    mutex_lock l(stripe->mu);
+    status.Update(stripe->status);
+    status.Update(stripe->out->Close());
+    stripe->out = nullptr;
+  }
+  if (!status.ok()) {
+    for (const auto& stripe : stripes_) {
+      env_->DeleteFile(stripe->data_path).IgnoreError();
+    }
+    return status;
+  }
+
+  // Drops the stripes that received no tensors, so that every shard counted
+  // in the header has a data file; MergeBundles() relies on this.  The first
+  // stripe is always kept, even for an empty bundle.
+  std::vector<Stripe*> used;
+  for (const auto& stripe : stripes_) {
+    if (stripe->index == 0 || !stripe->entries.empty()) {
+      used.push_back(stripe.get());
+    } else {
+      TF_RETURN_IF_ERROR(env_->DeleteFile(stripe->data_path));
+    }
+  }
+  num_shards_ = static_cast<int>(used.size());
+  for (int shard_id = 0; shard_id < num_shards_; ++shard_id) {
+    Stripe* stripe = used[shard_id];
+    const string data_path = DataFilename(prefix_, shard_id, num_shards_);
+    if (stripe->data_path != data_path) {
+      TF_RETURN_IF_ERROR(env_->RenameFile(stripe->data_path, data_path));
+    }
+    for (BundleEntryProto* entry : stripe->entries) {
+      entry->set_shard_id(shard_id);
+    }
+  }
+  return OkStatus();
+}
+
 // TODO(zongheng): on metadata write failure or !status_.ok(), consider removing
 // the orphaned data file.
 Status BundleWriter::Finish() {
-  if (out_) {
-    status_.Update(out_->Close());
-    out_ = nullptr;
-    if (status_.ok()) {
-      if (use_temp_file_) {
-        status_ =
-            Env::Default()->RenameFile(data_path_, DataFilename(prefix_, 0, 1));
-      }
-    } else {
-      Env::Default()->DeleteFile(data_path_).IgnoreError();
-    }
+  if (!stripes_.empty()) {
+    // Waits for all pending writes.
+    write_pool_.reset();
+    status_.Update(FinishDataFiles());
+    stripes_.clear();
   }
   if (!status_.ok()) return status_;
   // Build key -> BundleEntryProto table.
@@ -557,7 +656,7 @@ Status BundleWriter::Finish() {
     table::TableBuilder builder(options, file.get());
     // Header entry.
     BundleHeaderProto header;
-    header.set_num_shards(1);
+    header.set_num_shards(num_shards_);
     header.set_endianness(BundleHeaderProto::LITTLE);
     if (!port::kLittleEndian) header.set_endianness(BundleHeaderProto::BIG);
     VersionDef* version = header.mutable_version();
@@ -770,6 +869,12 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
 BundleReader::BundleReader(
     Env* env, StringPiece prefix,
     bool enable_multi_threading_for_testing /* = false */)
+    : BundleReader(env, prefix, Options()) {
+  enable_multi_threading_for_testing_ = enable_multi_threading_for_testing;
+}
+
+BundleReader::BundleReader(Env* env, StringPiece prefix,
+                           const Options& options)
     : env_(env),
       prefix_(prefix),
       metadata_(nullptr),
@@ -777,7 +882,7 @@ BundleReader::BundleReader(
       index_cache_(nullptr),
       iter_(nullptr),
       need_to_swap_bytes_(false),
-      enable_multi_threading_for_testing_(enable_multi_threading_for_testing) {
+      options_(options) {
   const string filename = MetaFilename(prefix_);
   uint64 file_size;
   status_ = env_->GetFileSize(filename, &file_size);
@@ -919,16 +1024,17 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
     if (entry.size() > kBufferSize) {
       StringPiece sp;
       if (!enable_multi_threading_for_testing_ &&
-          entry.size() < kLargeTensorThreshold) {
+          entry.size() < options_.parallel_read_threshold_bytes) {
         TF_RETURN_IF_ERROR(buffered_file->file()->Read(
             entry.offset(), entry.size(), &sp, backing_buffer));
         if (sp.data() != backing_buffer) {
           memmove(backing_buffer, sp.data(), entry.size());
         }
       } else {
-        int64_t section_size = kMinSectionSize;
+        int64_t section_size =
+            std::max<int64_t>(options_.min_read_section_bytes, 1);
         int64_t thread_pool_size =
-            (entry.size() + kMinSectionSize - 1) / kMinSectionSize;
+            (entry.size() + section_size - 1) / section_size;
         if (thread_pool_size > kMaxFileReadThreads ||
             enable_multi_threading_for_testing_) {
           thread_pool_size = kMaxFileReadThreads;
@@ -1010,6 +1116,120 @@ Status BundleReader::GetValue(const BundleEntryProto& entry, Tensor* val) {
   return OkStatus();
 }
 
+namespace {
+
+// A read-only tensor buffer pointing into a memory-mapped data file.
+class MappedTensorBuffer : public TensorBuffer {
+ public:
+  MappedTensorBuffer(std::shared_ptr<ReadOnlyMemoryRegion> region,
+                     const char* data, size_t size)
+      : TensorBuffer(const_cast<char*>(data)),
+        region_(std::move(region)),
+        size_(size) {}
+
+  size_t size() const override { return size_; }
+  TensorBuffer* root_buffer() override { return this; }
+  void FillAllocationDescription(AllocationDescription* proto) const override {
+    proto->set_requested_bytes(size_);
+    proto->set_allocated_bytes(size_);
+    proto->set_allocator_name("mmap");
+  }
+  // The mapping is read-only, so the buffer must never be forwarded to a
+  // kernel that would update it in place.
+  bool OwnsMemory() const override { return false; }
+
+ private:
+  const std::shared_ptr<ReadOnlyMemoryRegion> region_;
+  const size_t size_;
+};
+
+}  // namespace
+
+std::shared_ptr<ReadOnlyMemoryRegion> BundleReader::GetMappedDataFile(
+    int32_t shard_id) {
+  auto it = mapped_data_.find(shard_id);
+  if (it != mapped_data_.end()) return it->second;
+
+  const string filename = DataFilename(prefix_, shard_id, num_shards_);
+  std::unique_ptr<ReadOnlyMemoryRegion> region;
+  Status s = env_->NewReadOnlyMemoryRegionFromFile(filename, &region);
+  if (!s.ok()) {
+    VLOG(1) << "Unable to memory-map " << filename
+            << ", falling back to buffered reads: " << s;
+    region.reset();
+  }
+  std::shared_ptr<ReadOnlyMemoryRegion>& mapped = mapped_data_[shard_id];
+  mapped = std::move(region);
+  return mapped;
+}
+
+Status BundleReader::GetMappedValue(const BundleEntryProto& entry, Tensor* val,
+                                    bool* aliased) {
+  *aliased = false;
+  if (!options_.use_mmap || need_to_swap_bytes_ ||
+      !DataTypeCanUseMemcpy(entry.dtype()) || entry.size() == 0) {
+    return OkStatus();
+  }
+  const TensorShape stored_shape(entry.shape());
+  if (entry.size() !=
+      stored_shape.num_elements() * DataTypeSize(entry.dtype())) {
+    // Let GetValue() report the corrupted entry.
+    return OkStatus();
+  }
+  std::shared_ptr<ReadOnlyMemoryRegion> region =
+      GetMappedDataFile(entry.shard_id());
+  if (region == nullptr) return OkStatus();
+  if (entry.offset() + entry.size() > region->length()) {
+    return errors::DataLoss("TensorBundle at ", prefix_, " shard ",
+                            entry.shard_id(), ": entry at offset ",
+                            entry.offset(), " (", entry.size(),
+                            " bytes) extends past the end of the file (",
+                            region->length(), " bytes)");
+  }
+  const char* data =
+      static_cast<const char*>(region->data()) + entry.offset();
+  if (reinterpret_cast<uintptr_t>(data) % Allocator::kAllocatorAlignment != 0) {
+    return OkStatus();
+  }
+  if (options_.verify_mmap_checksums) {
+    const uint32 actual_crc32c = crc32c::Value(data, entry.size());
+    if (crc32c::Unmask(entry.crc32c()) != actual_crc32c) {
+      return errors::DataLoss(
+          "TensorBundle at ", prefix_, " shard ", entry.shard_id(), " (",
+          entry.size(), " bytes): Checksum does not match: stored ",
+          strings::Printf("%08u", crc32c::Unmask(entry.crc32c())),
+          " vs. calculated on the mapped bytes ", actual_crc32c);
+    }
+  }
+  auto* buf = new MappedTensorBuffer(std::move(region), data, entry.size());
+  *val = Tensor(entry.dtype(), stored_shape, buf);
+  buf->Unref();
+  *aliased = true;
+  return OkStatus();
+}
+
+Status BundleReader::LookupMapped(StringPiece key, Tensor* val,
+                                  bool* aliased) {
+  CHECK(val != nullptr);
+  BundleEntryProto entry;
+  TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
+
+  bool mapped = false;
+  if (entry.slices().empty()) {
+    TF_RETURN_IF_ERROR(GetMappedValue(entry, val, &mapped));
+  }
+  if (aliased != nullptr) *aliased = mapped;
+  if (mapped) return OkStatus();
+  *val = Tensor(entry.dtype(), TensorShape(entry.shape()));
+  if (entry.slices().empty()) {
+    return GetValue(entry, val);
+  } else {
+    return GetSliceValue(
+        key, entry,
+        /* a full slice */ TensorSlice(TensorShape(entry.shape()).dims()), val);
+  }
+}
+
 Status BundleReader::Lookup(StringPiece key, Tensor* val) {
   CHECK(val != nullptr);
   BundleEntryProto entry;
@@ -1193,6 +1413,22 @@ Status BundleReader::LookupDtypeAndShape(StringPiece key, DataType* dtype,
   return OkStatus();
 }
 
+Status BundleReader::LookupDataLocation(StringPiece key, int32_t* shard_id,
+                                        int64_t* offset, int64_t* size) {
+  BundleEntryProto entry;
+  TF_RETURN_IF_ERROR(GetBundleEntryProto(key, &entry));
+  if (entry.slices().empty()) {
+    *shard_id = entry.shard_id();
+    *offset = entry.offset();
+    *size = entry.size();
+  } else {
+    *shard_id = -1;
+    *offset = 0;
+    *size = 0;
+  }
+  return OkStatus();
+}
+
 Status BundleReader::LookupTensorShape(StringPiece key, TensorShape* shape) {
   DataType ignored;
   return LookupDtypeAndShape(key, &ignored, shape);
@@ -75,6 +75,7 @@ limitations under the License.
 #include "tensorflow/core/framework/tensor.h"
 #include "tensorflow/core/framework/tensor_shape.h"
 #include "tensorflow/core/framework/tensor_slice.h"
+#include "tensorflow/core/lib/core/threadpool.h"
 #include "tensorflow/core/lib/gtl/array_slice.h"
 #include "tensorflow/core/lib/io/cache.h"
 #include "tensorflow/core/lib/io/inputbuffer.h"
@@ -119,12 +120,24 @@ class BundleWriter {
     // Alignment, in bytes, for tensor data.
     // Must be >= 1. The default size of 1 densely packs tensors.
     int data_alignment{1};
+    // Number of data files to stripe tensor data across.  Each tensor is
+    // written whole to the least loaded stripe, and the stripes are written
+    // concurrently from a pool of this many threads.  Stripes that receive no
+    // tensors are dropped, so the finished bundle has between 1 and
+    // num_stripes data shards and can be read by any BundleReader.
+    int num_stripes{1};
   };
   BundleWriter(Env* env, absl::string_view prefix,
                const Options& options = Options());
+  ~BundleWriter();
 
   // Adds the tensor "val" under key "key".
   // Across calls "key" must be unique but can be added in any order.
+  //
+  // If options.num_stripes > 1, the write happens asynchronously: "val" is
+  // referenced (not copied) until it has been written, so its contents must
+  // not be modified before Finish() returns.  Write errors are reported by a
+  // later Add() or by Finish().
   Status Add(absl::string_view key, const Tensor& val);
 
   // Partitioned variables support.
@@ -153,14 +166,25 @@ class BundleWriter {
   Status status() const { return status_; }
 
  private:
+  // A data file that a subset of the tensors is written to.
+  struct Stripe;
+
+  // Returns the stripe that the next tensor of "bytes" bytes is assigned to.
+  Stripe* NextStripe(int64_t bytes);
+
+  // Closes the data files, drops unused stripes and moves the remaining ones
+  // to their final names.  Sets "num_shards_".
+  Status FinishDataFiles();
+
   Env* const env_;  // Not owned.
   const Options options_;
   const std::string prefix_;
   std::string metadata_path_;
-  std::string data_path_;
   bool use_temp_file_;
-  std::unique_ptr<tsl::BufferedWritableFile> out_;
-  int64_t size_;  // Number of bytes written into out_.
+  // Destroyed after "write_pool_", which drains all pending writes.
+  std::vector<std::unique_ptr<Stripe>> stripes_;
+  std::unique_ptr<thread::ThreadPool> write_pool_;
+  int num_shards_ = 1;
   std::map<std::string, BundleEntryProto> entries_;
   Status status_;
 
@@ -200,8 +224,32 @@ Status MergeBundles(Env* env, gtl::ArraySlice<tstring> prefixes,
 // All threads accessing the same BundleReader must synchronize.
 class BundleReader {
  public:
+  struct Options {
+    Options() {}
+    // If true, data files are memory-mapped (when the file system supports
+    // it) and LookupMapped() returns tensors that alias the mapped bytes
+    // instead of copying them.  Only non-string, non-variant entries whose
+    // data is aligned to Allocator::kAllocatorAlignment within the file can
+    // be aliased, which requires writing the bundle with that
+    // BundleWriter::Options::data_alignment (SaveV2 does so when
+    // TF_CHECKPOINT_SAVE_ALIGN_FOR_MMAP is set).  Other entries are copied.
+    bool use_mmap{false};
+    // Whether to validate checksums of aliased tensors.  Validation reads
+    // every byte, so disabling it leaves pages to be faulted in lazily on
+    // first access.
+    bool verify_mmap_checksums{true};
+    // Non-string, non-variant entries of at least this many bytes are read
+    // with concurrent range reads of at least "min_read_section_bytes" each,
+    // on up to 8 threads.  Storage that only reaches its bandwidth with
+    // several reads in flight benefits from lowering both.
+    int64_t parallel_read_threshold_bytes{int64_t{1} << 32};
+    int64_t min_read_section_bytes{int64_t{1} << 31};
+  };
+
   BundleReader(Env* const env, absl::string_view prefix,
                bool enable_multi_threading_for_testing = false);
+  BundleReader(Env* const env, absl::string_view prefix,
+               const Options& options);
   ~BundleReader();
 
   // Is ok() iff the reader construction is successful (completed the read of
@@ -231,6 +279,14 @@ class BundleReader {
   Status LookupDtypeAndShape(absl::string_view key, DataType* dtype,
                              TensorShape* shape) TF_MUST_USE_RESULT;
 
+  // Looks up the data file and the byte range storing the tensor keyed by
+  // "key".  A partitioned tensor stores its contents in its slices, so
+  // "shard_id" is set to -1 and "offset" and "size" to 0.
+  // REQUIRES: status().ok()
+  Status LookupDataLocation(absl::string_view key, int32_t* shard_id,
+                            int64_t* offset,
+                            int64_t* size) TF_MUST_USE_RESULT;
+
   // Looks up the shape of the tensor keyed by "key".
   // Clears "shape" if not found.
   // REQUIRES: status().ok()
@@ -251,6 +307,18 @@ class BundleReader {
   // REQUIRES: status().ok()
   Status Lookup(absl::string_view key, Tensor* val) TF_MUST_USE_RESULT;
 
+  // Looks up the tensor keyed by "key" into a newly allocated "val".  If the
+  // reader was created with Options::use_mmap and the entry can be aliased,
+  // "val" points directly into the memory-mapped data file, which stays
+  // mapped until every such tensor is released.  Aliased tensors are
+  // read-only: they never report RefCountIsOne(), so kernels that update
+  // their inputs in place copy them first.  If "aliased" is not null, it is
+  // set to whether "val" aliases the mapped file.
+  //
+  // REQUIRES: status().ok()
+  Status LookupMapped(absl::string_view key, Tensor* val,
+                      bool* aliased = nullptr) TF_MUST_USE_RESULT;
+
   // Looks up the tensor pointed to by the internal iterator.
   //
   // On error, "val" may contain nonsense data.
@@ -317,6 +385,16 @@ class BundleReader {
                        const TensorSlice& slice_spec,
                        Tensor* val) TF_MUST_USE_RESULT;
 
+  // Sets "*val" to a tensor aliasing the memory-mapped bytes of "entry" and
+  // "*aliased" to true, or leaves "*val" untouched and sets "*aliased" to
+  // false if the entry cannot be aliased.
+  Status GetMappedValue(const BundleEntryProto& entry, Tensor* val,
+                        bool* aliased) TF_MUST_USE_RESULT;
+
+  // Returns the mapped region of data file "shard_id", or nullptr if the
+  // file system does not support memory-mapping it.
+  std::shared_ptr<ReadOnlyMemoryRegion> GetMappedDataFile(int32_t shard_id);
+
   Env* env_;  // Not owned.
   const std::string prefix_;
 
@@ -327,6 +405,10 @@ class BundleReader {
   table::Iterator* iter_;
   // Owned the InputBuffer objects and their underlying RandomAccessFile's.
   std::unordered_map<int32_t, io::InputBuffer*> data_;
+  // Memory-mapped data files, shared with the tensors aliasing them.  A null
+  // entry records that the shard could not be mapped.
+  std::unordered_map<int32_t, std::shared_ptr<ReadOnlyMemoryRegion>>
+      mapped_data_;
 
   // Maps each partitioned tensor's key to its stored slices (represented in a
   // TensorSliceSet).  Populated on-demand.
@@ -344,6 +426,8 @@ class BundleReader {
 
   bool enable_multi_threading_for_testing_ = false;
 
+  const Options options_;
+
   BundleReader(const BundleReader&) = delete;
   void operator=(const BundleReader&) = delete;
 };
@@ -1201,6 +1201,134 @@ TEST_F(TensorBundleAlignmentTest, AlignmentTest) {
   }
 }
 
+TEST(TensorBundleTest, StripedWriter) {
+  BundleWriter::Options opts;
+  opts.num_stripes = 4;
+  {
+    BundleWriter writer(Env::Default(), Prefix("striped"), opts);
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_100x100<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<float>(1)));
+    TF_EXPECT_OK(writer.Add("foo_002", Constant_100x100<float>(2)));
+    TF_EXPECT_OK(writer.Add("foo_003", Constant_2x3<float>(3)));
+    TF_EXPECT_OK(writer.Add("strs", Constant<tstring>("x", TensorShape({3}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  for (int i = 0; i < 4; ++i) {
+    TF_EXPECT_OK(
+        Env::Default()->FileExists(DataFilename(Prefix("striped"), i, 4)));
+  }
+  {
+    BundleReader reader(Env::Default(), Prefix("striped"));
+    TF_ASSERT_OK(reader.status());
+    Expect<float>(&reader, "foo_000", Constant_100x100<float>(0));
+    Expect<float>(&reader, "foo_001", Constant_2x3<float>(1));
+    Expect<float>(&reader, "foo_002", Constant_100x100<float>(2));
+    Expect<float>(&reader, "foo_003", Constant_2x3<float>(3));
+    Expect<tstring>(&reader, "strs", Constant<tstring>("x", TensorShape({3})));
+  }
+
+  // Stripes that receive no tensors are dropped.
+  {
+    BundleWriter writer(Env::Default(), Prefix("sparse_striped"), opts);
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_2x3<float>(1)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  TF_EXPECT_OK(
+      Env::Default()->FileExists(DataFilename(Prefix("sparse_striped"), 0, 2)));
+  TF_EXPECT_OK(
+      Env::Default()->FileExists(DataFilename(Prefix("sparse_striped"), 1, 2)));
+  EXPECT_FALSE(
+      Env::Default()->FileExists(DataFilename(Prefix("sparse_striped"), 0, 4))
+          .ok());
+  {
+    BundleReader reader(Env::Default(), Prefix("sparse_striped"));
+    TF_ASSERT_OK(reader.status());
+    Expect<float>(&reader, "foo_000", Constant_2x3<float>(0));
+    Expect<float>(&reader, "foo_001", Constant_2x3<float>(1));
+  }
+}
+
+TEST(TensorBundleTest, LookupMapped) {
+  {
+    BundleWriter::Options opts;
+    opts.data_alignment = Allocator::kAllocatorAlignment;
+    BundleWriter writer(Env::Default(), Prefix("mapped"), opts);
+    TF_EXPECT_OK(writer.Add("foo_000", Constant_2x3<float>(0)));
+    TF_EXPECT_OK(writer.Add("foo_001", Constant_100x100<float>(1)));
+    TF_EXPECT_OK(writer.Add("strs", Constant<tstring>("x", TensorShape({3}))));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  Tensor aliased;
+  {
+    BundleReader::Options opts;
+    opts.use_mmap = true;
+    BundleReader reader(Env::Default(), Prefix("mapped"), opts);
+    TF_ASSERT_OK(reader.status());
+    Tensor val;
+    TF_ASSERT_OK(reader.LookupMapped("foo_000", &val));
+    test::ExpectTensorEqual<float>(val, Constant_2x3<float>(0));
+    // Aliased tensors must never be updated in place.
+    EXPECT_FALSE(val.RefCountIsOne());
+
+    bool is_aliased;
+    TF_ASSERT_OK(reader.LookupMapped("foo_001", &aliased, &is_aliased));
+    test::ExpectTensorEqual<float>(aliased, Constant_100x100<float>(1));
+    EXPECT_FALSE(aliased.RefCountIsOne());
+    EXPECT_TRUE(is_aliased);
+
+    // Strings cannot be aliased and are copied out as usual.
+    TF_ASSERT_OK(reader.LookupMapped("strs", &val, &is_aliased));
+    EXPECT_FALSE(is_aliased);
+    test::ExpectTensorEqual<tstring>(val,
+                                     Constant<tstring>("x", TensorShape({3})));
+    EXPECT_TRUE(val.RefCountIsOne());
+  }
+  // The mapping outlives the reader while tensors still alias it.
+  test::ExpectTensorEqual<float>(aliased, Constant_100x100<float>(1));
+
+  {
+    // Without use_mmap, LookupMapped() returns a private copy.
+    BundleReader reader(Env::Default(), Prefix("mapped"));
+    TF_ASSERT_OK(reader.status());
+    Tensor val;
+    TF_ASSERT_OK(reader.LookupMapped("foo_001", &val));
+    test::ExpectTensorEqual<float>(val, Constant_100x100<float>(1));
+    EXPECT_TRUE(val.RefCountIsOne());
+  }
+}
+
+TEST(TensorBundleTest, ParallelRangeReads) {
+  const Tensor big = Constant(1.5f, TensorShape({300000}));  // > 1MB.
+  {
+    BundleWriter writer(Env::Default(), Prefix("range_reads"));
+    TF_EXPECT_OK(writer.Add("big", big));
+    TF_EXPECT_OK(writer.Add("small", Constant_2x3<float>(2)));
+    TF_ASSERT_OK(writer.Finish());
+  }
+  BundleReader::Options opts;
+  opts.parallel_read_threshold_bytes = 1 << 20;
+  opts.min_read_section_bytes = 100000;
+  BundleReader reader(Env::Default(), Prefix("range_reads"), opts);
+  TF_ASSERT_OK(reader.status());
+
+  Tensor val(DT_FLOAT, big.shape());
+  TF_ASSERT_OK(reader.Lookup("big", &val));
+  test::ExpectTensorEqual<float>(val, big);
+
+  int32_t shard_id;
+  int64_t offset, size;
+  TF_ASSERT_OK(reader.LookupDataLocation("big", &shard_id, &offset, &size));
+  EXPECT_EQ(0, shard_id);
+  EXPECT_EQ(0, offset);
+  EXPECT_EQ(big.TotalBytes(), size);
+  TF_ASSERT_OK(reader.LookupDataLocation("small", &shard_id, &offset, &size));
+  EXPECT_EQ(big.TotalBytes(), offset);
+  EXPECT_EQ(6 * sizeof(float), size);
+  EXPECT_TRUE(errors::IsNotFound(
+      reader.LookupDataLocation("missing", &shard_id, &offset, &size)));
+}
+
 static void BM_BundleAlignment(::testing::benchmark::State& state) {
   {
     const int alignment = state.range(0);
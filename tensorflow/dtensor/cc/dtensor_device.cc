@@ -1328,6 +1328,9 @@ std::unordered_map<std::string, int> DTensorDevice::GetStats(
       {"eager_pure_optimization.hit", stats_.eager_pure_optimization_hits},
       {"device_cache.size", eager_stats.device_cache_size},
       {"kernel_cache.size", eager_stats.kernel_cache_size},
+      {"kernel_cache.hit", eager_stats.kernel_cache_hits},
+      {"kernel_cache.miss", eager_stats.kernel_cache_misses},
+      {"kernel_cache.eviction", eager_stats.kernel_cache_evictions},
       {"local_rendezvous_cache.active.size",
        eager_stats.local_rendezvous_cache_active_size},
   };
@@ -24,6 +24,7 @@ limitations under the License.
 #include <vector>
 
 #include "tensorflow/lite/builtin_ops.h"
+#include "tensorflow/lite/core/api/profiler.h"
 #include "tensorflow/lite/core/c/common.h"
 #include "tensorflow/lite/graph_info.h"
 #include "tensorflow/lite/simple_memory_arena.h"
@@ -201,6 +202,7 @@ TfLiteStatus ArenaPlanner::PlanAllocations() {
   // Invalidate any existing data.
   const size_t num_tensors = graph_info_->num_tensors();
   TF_LITE_ENSURE_STATUS(ResetAllocations());
+  plan_cache_.clear();
   // Maybe other verb instead of 'Assigned'
   alloc_node_.assign(num_tensors, kNodeNotAssigned);
   dealloc_node_.assign(num_tensors, kNodeNotAssigned);
@@ -329,6 +331,18 @@ TfLiteStatus ArenaPlanner::PlanAllocations() {
   }
   // Note that graph outputs will never be scheduled for deallocation. We
   // could do that here for completeness, but it won't have any effect.
+
+  // Nodes of the same group may be executed concurrently, so the tensors of
+  // any of them must not share memory with the tensors of the others.
+  for (size_t i = 0; i < num_tensors; ++i) {
+    if (alloc_node_[i] != kNodeNotAssigned) {
+      alloc_node_[i] = graph_info_->parallel_node_group(alloc_node_[i]).first;
+    }
+    if (dealloc_node_[i] != kNodeNotAssigned) {
+      dealloc_node_[i] =
+          graph_info_->parallel_node_group(dealloc_node_[i]).second;
+    }
+  }
   return kTfLiteOk;
 }
 
@@ -346,12 +360,13 @@ TfLiteStatus ArenaPlanner::ExecuteAllocations(int first_node, int last_node) {
        i <= static_cast<size_t>(last_node) && i < num_execution_nodes; ++i) {
     const TfLiteNode& node = graph_info_->node(i);
     TfLiteIntArray* node_temporaries = node.temporaries;
+    const std::pair<size_t, size_t> group = graph_info_->parallel_node_group(i);
     for (int j = 0; j < node_temporaries->size; ++j) {
       int tensor_index = node_temporaries->data[j];
-      alloc_node_[tensor_index] = i;
+      alloc_node_[tensor_index] = group.first;
       nodes_to_tensors_[i].insert(tensor_index);
       if (!preserve_all_tensors_) {
-        dealloc_node_[tensor_index] = i;
+        dealloc_node_[tensor_index] = group.second;
       }
     }
   }
@@ -502,6 +517,36 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(
     last_active_node_ = last_node;
     return kTfLiteOk;
   }
+
+  // Only plans of the whole graph starting from scratch are cached, as the
+  // plans of later nodes depend on the allocs of the earlier ones.
+  const bool cacheable = first_node == 0 &&
+                         last_active_node_ == kLastActiveNodeUndefined &&
+                         !preserve_all_tensors_;
+  Profiler* profiler = reinterpret_cast<Profiler*>(context_->profiler);
+  std::vector<size_t> plan_key;
+  if (cacheable) {
+    plan_key = GetPlanCacheKey(last_node, *tensors_allocated);
+    auto it = plan_cache_.find(plan_key);
+    if (it != plan_cache_.end()) {
+      TFLITE_SCOPED_TAGGED_DEFAULT_PROFILE(profiler, "ArenaPlanCacheHit");
+      const CachedPlan& plan = it->second;
+      for (const auto& alloc : plan.allocs) {
+        allocs_[alloc.tensor] = alloc;
+      }
+      for (int32_t tensor_index : plan.unshared_tensors) {
+        actual_tensor_id_.erase(tensor_index);
+      }
+      arena_.RestorePlan(plan.arena_plan);
+      persistent_arena_.RestorePlan(plan.persistent_arena_plan);
+      last_active_node_ = last_node;
+      return kTfLiteOk;
+    }
+  }
+  TFLITE_SCOPED_TAGGED_DEFAULT_PROFILE(cacheable ? profiler : nullptr,
+                                       "ArenaPlanCacheMiss");
+  std::vector<int32_t> unshared_tensors;
+
   if (first_node < last_active_node_) {
     arena_.ResetAllocs();
     last_active_node_ = first_node;
@@ -527,6 +572,7 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(
           tensors[it->second].allocation_type;
       if (allocation_type != kTfLiteArenaRw ||
           tensors[it->second].bytes != tensors[it->first].bytes) {
+        unshared_tensors.push_back(it->first);
         actual_tensor_id_.erase(it);
       } else {
         // Don't allocate the tensor, it can safely share the input buffer.
@@ -553,9 +599,39 @@ TfLiteStatus ArenaPlanner::CalculateAllocations(
     }
   }
   last_active_node_ = last_node;
+
+  if (cacheable && plan_cache_.size() < kMaxCachedPlans) {
+    CachedPlan& plan = plan_cache_[std::move(plan_key)];
+    for (const auto& tensor_index : *tensors_allocated) {
+      if (allocs_[tensor_index].size > 0 &&
+          actual_tensor_id_.find(tensor_index) == actual_tensor_id_.end()) {
+        plan.allocs.push_back(allocs_[tensor_index]);
+      }
+    }
+    plan.unshared_tensors = std::move(unshared_tensors);
+    plan.arena_plan = arena_.GetPlan();
+    plan.persistent_arena_plan = persistent_arena_.GetPlan();
+  }
   return kTfLiteOk;
 }
 
+std::vector<size_t> ArenaPlanner::GetPlanCacheKey(
+    int last_node, const std::vector<int32_t>& tensors_to_allocate) {
+  std::vector<int32_t> sorted_tensors = tensors_to_allocate;
+  std::sort(sorted_tensors.begin(), sorted_tensors.end());
+  const TfLiteTensor* tensors = graph_info_->tensors();
+  std::vector<size_t> key;
+  key.reserve(1 + 4 * sorted_tensors.size());
+  key.push_back(last_node);
+  for (int32_t tensor_index : sorted_tensors) {
+    key.push_back(tensor_index);
+    key.push_back(tensors[tensor_index].bytes);
+    key.push_back(tensors[tensor_index].allocation_type);
+    key.push_back(FindSharedTensor(tensor_index));
+  }
+  return key;
+}
+
 bool AreTensorsAllocatedInSameArena(int32_t root_tensor_index,
                                     int32_t tensor_index,
                                     const TfLiteTensor* tensors) {
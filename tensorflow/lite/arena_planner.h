@@ -16,6 +16,7 @@ limitations under the License.
 #define TENSORFLOW_LITE_ARENA_PLANNER_H_
 
 #include <cstdint>
+#include <map>
 #include <memory>
 #include <unordered_map>
 #include <unordered_set>
@@ -45,6 +46,10 @@ struct AllocationInfo;
 // execution. Since dynamic tensors don't have sizes until after the
 // corresponding operation is executed, this class supports incremental
 // planning.
+//
+// The plans of the whole graph are cached by the sizes of the tensors, which
+// follow from the input shapes. Models whose inputs alternate between a few
+// shapes reuse the plan of each shape instead of calculating it again.
 class ArenaPlanner : public MemoryPlanner {
  public:
   // Ownership of 'context' is not taken and it must remain util the
@@ -120,6 +125,11 @@ class ArenaPlanner : public MemoryPlanner {
   // Return the index of the tensor owing `tensor_index's` buffer.
   int FindSharedTensor(int tensor_index);
 
+  // Returns the key of the plan of `tensors_to_allocate` for the nodes up to
+  // `last_node`: the size, allocation type and buffer owner of each tensor.
+  std::vector<size_t> GetPlanCacheKey(
+      int last_node, const std::vector<int32_t>& tensors_to_allocate);
+
   TfLiteContext* context_;
   std::unique_ptr<GraphInfo> graph_info_;
 
@@ -164,6 +174,24 @@ class ArenaPlanner : public MemoryPlanner {
 
   // Store number of references to each tensor.
   std::vector<int> refcounts_;
+
+  // Maximum number of plans in `plan_cache_`.
+  static constexpr int kMaxCachedPlans = 16;
+
+  // A plan calculated for the whole graph.
+  struct CachedPlan {
+    // The allocs of the tensors allocated in `arena_` and
+    // `persistent_arena_`.
+    std::vector<ArenaAllocWithUsageInterval> allocs;
+    // Tensors which were found not to share the buffer of another one.
+    std::vector<int32_t> unshared_tensors;
+    SimpleMemoryArena::Plan arena_plan;
+    SimpleMemoryArena::Plan persistent_arena_plan;
+  };
+
+  // Plans of the whole graph, keyed by GetPlanCacheKey(). Cleared when the
+  // graph is planned again.
+  std::map<std::vector<size_t>, CachedPlan> plan_cache_;
 };
 
 }  // namespace tflite
@@ -18,6 +18,7 @@ limitations under the License.
 #include <cstdarg>
 #include <cstddef>
 #include <cstdint>
+#include <cstring>
 #include <initializer_list>
 #include <memory>
 #include <set>
@@ -27,6 +28,7 @@ limitations under the License.
 #include <gtest/gtest.h>
 #include "tensorflow/core/platform/logging.h"
 #include "tensorflow/lite/builtin_ops.h"
+#include "tensorflow/lite/core/api/profiler.h"
 #include "tensorflow/lite/core/c/common.h"
 #include "tensorflow/lite/graph_info.h"
 #include "tensorflow/lite/testing/util.h"
@@ -209,6 +211,7 @@ class ArenaPlannerTest : public ::testing::Test {
   void SetGraph(TestGraph* graph, bool preserve_all_tensors = false) {
     graph_ = graph;
     context_.ReportError = ReportError;
+    context_.profiler = nullptr;
     planner_ = std::make_unique<ArenaPlanner>(
         &context_, std::unique_ptr<GraphInfo>(new TestGraphInfo(graph)),
         preserve_all_tensors, kTensorAlignment);
@@ -368,6 +371,75 @@ TEST_F(ArenaPlannerTest, AllocsCorrectlyReset) {
   EXPECT_EQ(GetOffset(1), 4);
 }
 
+// Counts the events with a given tag.
+class CountingProfiler : public Profiler {
+ public:
+  explicit CountingProfiler(const char* tag) : tag_(tag) {}
+
+  uint32_t BeginEvent(const char* tag, EventType event_type,
+                      int64_t event_metadata1,
+                      int64_t event_metadata2) override {
+    if (strcmp(tag, tag_) == 0) ++count_;
+    return 0;
+  }
+  void EndEvent(uint32_t event_handle) override {}
+
+  int count() const { return count_; }
+
+ private:
+  const char* tag_;
+  int count_ = 0;
+};
+
+TEST_F(ArenaPlannerTest, CachedPlanIsReused) {
+  TestGraph graph({0, 1},
+                  {
+                      /* in, out, tmp */
+                      {{0, 1}, {2}, {}},     // First op
+                      {{2, 0}, {4, 5}, {}},  // Second op
+                      {{4, 5}, {3}, {}}      // Third op
+                  },
+                  {3});
+  SetGraph(&graph);
+  CountingProfiler profiler("ArenaPlanCacheHit");
+  context_.profiler = &profiler;
+  Execute(0, graph.nodes().size() - 1);
+  std::vector<std::ptrdiff_t> offsets;
+  for (int i = 0; i < 6; ++i) {
+    offsets.push_back(GetOffset(i));
+  }
+
+  // Resize the tensors, as if the inputs changed shape.
+  std::vector<TfLiteTensor>& tensors = *graph.tensors();
+  for (int i = 0; i < 6; ++i) {
+    tensors[i].bytes *= 4;
+  }
+  ResetAllocations();
+  Execute(0, graph.nodes().size() - 1);
+  EXPECT_EQ(profiler.count(), 0);
+  EXPECT_NE(GetOffset(1), offsets[1]);
+
+  // Going back to the original shapes reuses their plan.
+  for (int i = 0; i < 6; ++i) {
+    tensors[i].bytes /= 4;
+  }
+  ResetAllocations();
+  Execute(0, graph.nodes().size() - 1);
+  EXPECT_EQ(profiler.count(), 1);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(GetOffset(i), offsets[i]);
+  }
+
+  // Planning the graph again drops the cached plans.
+  CHECK(planner_->PlanAllocations() == kTfLiteOk);
+  Execute(0, graph.nodes().size() - 1);
+  EXPECT_EQ(profiler.count(), 1);
+  for (int i = 0; i < 6; ++i) {
+    EXPECT_EQ(GetOffset(i), offsets[i]);
+  }
+  context_.profiler = nullptr;
+}
+
 TEST_F(ArenaPlannerTest, SimpleGraphInputsPreserved) {
   TestGraph graph({0, 1},
                   {
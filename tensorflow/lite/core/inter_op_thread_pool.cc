@@ -0,0 +1,88 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/core/inter_op_thread_pool.h"
+
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <functional>
+#include <mutex>  // NOLINT(build/c++11)
+#include <thread>  // NOLINT(build/c++11)
+
+namespace tflite {
+
+InterOpThreadPool::InterOpThreadPool(int num_threads) {
+  for (int i = 1; i < num_threads; ++i) {
+    workers_.emplace_back([this, i]() { WorkerLoop(i); });
+  }
+}
+
+InterOpThreadPool::~InterOpThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+void InterOpThreadPool::ParallelFor(int n,
+                                    const std::function<void(int, int)>& fn) {
+  if (n <= 0) return;
+  if (workers_.empty() || n == 1) {
+    for (int i = 0; i < n; ++i) {
+      fn(0, i);
+    }
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    fn_ = &fn;
+    n_ = n;
+    next_ = 0;
+    active_workers_ = workers_.size();
+    ++generation_;
+  }
+  work_available_.notify_all();
+  RunCalls(0);
+  std::unique_lock<std::mutex> lock(mutex_);
+  work_done_.wait(lock, [this]() { return active_workers_ == 0; });
+  fn_ = nullptr;
+}
+
+void InterOpThreadPool::WorkerLoop(int thread_index) {
+  int generation = 0;
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      work_available_.wait(lock, [this, generation]() {
+        return stopping_ || generation_ != generation;
+      });
+      if (stopping_) return;
+      generation = generation_;
+    }
+    RunCalls(thread_index);
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--active_workers_ == 0) work_done_.notify_one();
+  }
+}
+
+void InterOpThreadPool::RunCalls(int thread_index) {
+  for (int i = next_.fetch_add(1); i < n_; i = next_.fetch_add(1)) {
+    (*fn_)(thread_index, i);
+  }
+}
+
+}  // namespace tflite
@@ -0,0 +1,73 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_CORE_INTER_OP_THREAD_POOL_H_
+#define TENSORFLOW_LITE_CORE_INTER_OP_THREAD_POOL_H_
+
+#include <atomic>
+#include <condition_variable>  // NOLINT(build/c++11)
+#include <functional>
+#include <mutex>  // NOLINT(build/c++11)
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+namespace tflite {
+
+// A fixed set of threads that executes the independent nodes of a subgraph
+// concurrently. The thread calling ParallelFor() takes part in the work, so
+// a pool of `num_threads` threads starts `num_threads - 1` workers.
+//
+// ParallelFor() must not be called concurrently or from within `fn`.
+class InterOpThreadPool {
+ public:
+  explicit InterOpThreadPool(int num_threads);
+  ~InterOpThreadPool();
+
+  InterOpThreadPool(const InterOpThreadPool&) = delete;
+  InterOpThreadPool& operator=(const InterOpThreadPool&) = delete;
+
+  // Number of threads, including the calling thread.
+  int num_threads() const { return workers_.size() + 1; }
+
+  // Calls `fn(thread_index, i)` for every `i` in [0, n) and returns when all
+  // the calls have returned. `thread_index` is 0 for the calling thread and
+  // between 1 and num_threads() - 1 for the workers.
+  void ParallelFor(int n, const std::function<void(int, int)>& fn);
+
+ private:
+  void WorkerLoop(int thread_index);
+
+  // Runs the calls of the current ParallelFor() until none is left.
+  void RunCalls(int thread_index);
+
+  std::vector<std::thread> workers_;
+
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable work_done_;
+  // Incremented for every ParallelFor(), so that workers take part in each
+  // call once.
+  int generation_ = 0;
+  int active_workers_ = 0;
+  bool stopping_ = false;
+
+  // The current ParallelFor() call.
+  const std::function<void(int, int)>* fn_ = nullptr;
+  int n_ = 0;
+  std::atomic<int> next_{0};
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_CORE_INTER_OP_THREAD_POOL_H_
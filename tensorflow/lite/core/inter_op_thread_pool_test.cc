@@ -0,0 +1,53 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/core/inter_op_thread_pool.h"
+
+#include <atomic>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+namespace tflite {
+namespace {
+
+TEST(InterOpThreadPoolTest, SingleThreadRunsOnCaller) {
+  InterOpThreadPool pool(1);
+  EXPECT_EQ(pool.num_threads(), 1);
+  std::vector<int> calls(5, 0);
+  pool.ParallelFor(calls.size(), [&calls](int thread_index, int i) {
+    EXPECT_EQ(thread_index, 0);
+    ++calls[i];
+  });
+  EXPECT_EQ(calls, std::vector<int>(5, 1));
+}
+
+TEST(InterOpThreadPoolTest, CallsEachIndexOnce) {
+  InterOpThreadPool pool(4);
+  EXPECT_EQ(pool.num_threads(), 4);
+  for (int n : {0, 1, 2, 3, 17, 100}) {
+    std::vector<std::atomic<int>> calls(n);
+    pool.ParallelFor(n, [&calls, &pool](int thread_index, int i) {
+      EXPECT_GE(thread_index, 0);
+      EXPECT_LT(thread_index, pool.num_threads());
+      ++calls[i];
+    });
+    for (const auto& count : calls) {
+      EXPECT_EQ(count, 1);
+    }
+  }
+}
+
+}  // namespace
+}  // namespace tflite
@@ -15,12 +15,43 @@ limitations under the License.
 
 #include "tensorflow/lite/core/signature_runner.h"
 
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/lite/core/c/c_api_types.h"
+#include "tensorflow/lite/util.h"
 
 namespace tflite {
 namespace impl {
+namespace {
+
+// Copies `src` of shape `src_dims` into `dst` of shape `dst_dims`, from
+// dimension `d` on. Both shapes have the same rank, and `dst_dims` is at least
+// as large as `src_dims` along every dimension after the first.
+void CopyPadded(const char* src, const std::vector<int>& src_dims, char* dst,
+                const std::vector<int>& dst_dims, size_t element_size,
+                size_t d) {
+  if (d == src_dims.size() - 1) {
+    std::memcpy(dst, src, src_dims[d] * element_size);
+    return;
+  }
+  size_t src_stride = element_size;
+  size_t dst_stride = element_size;
+  for (size_t i = d + 1; i < src_dims.size(); ++i) {
+    src_stride *= src_dims[i];
+    dst_stride *= dst_dims[i];
+  }
+  for (int i = 0; i < src_dims[d]; ++i) {
+    CopyPadded(src + i * src_stride, src_dims, dst + i * dst_stride, dst_dims,
+               element_size, d + 1);
+  }
+}
+
+}  // namespace
 
 SignatureRunner::SignatureRunner(const internal::SignatureDef* signature_def,
                                  Subgraph* subgraph)
@@ -73,6 +104,49 @@ TfLiteStatus SignatureRunner::ResizeInputTensorStrict(
   return subgraph_->ResizeInputTensorStrict(it->second, new_size);
 }
 
+TfLiteStatus SignatureRunner::AllocateTensors() {
+  for (StreamingState& state : streaming_states_) {
+    // The size of the state is that of the input, which is known before the
+    // graph is prepared. Binding the buffers first keeps the state out of the
+    // arena.
+    const size_t bytes = subgraph_->tensor(state.input_index)->bytes;
+    // Buffers are aligned, and never empty.
+    const size_t buffer_bytes =
+        bytes > 0 ? (bytes + kDefaultTensorAlignment - 1) /
+                        kDefaultTensorAlignment * kDefaultTensorAlignment
+                  : kDefaultTensorAlignment;
+    if (state.storage == nullptr || state.tensor_bytes != bytes) {
+      state.storage.reset(
+          new char[2 * buffer_bytes + kDefaultTensorAlignment - 1]);
+      const uintptr_t base = reinterpret_cast<uintptr_t>(state.storage.get());
+      const uintptr_t aligned_base =
+          (base + kDefaultTensorAlignment - 1) / kDefaultTensorAlignment *
+          kDefaultTensorAlignment;
+      state.buffers[0] = state.storage.get() + (aligned_base - base);
+      state.buffers[1] = state.buffers[0] + buffer_bytes;
+      state.tensor_bytes = bytes;
+      state.bytes = buffer_bytes;
+      state.current = 0;
+      std::memset(state.buffers[0], 0, buffer_bytes);
+    }
+    TF_LITE_ENSURE_STATUS(BindStreamingState(state));
+  }
+  TF_LITE_ENSURE_STATUS(subgraph_->AllocateTensors());
+  for (const StreamingState& state : streaming_states_) {
+    const TfLiteTensor* input = subgraph_->tensor(state.input_index);
+    const TfLiteTensor* output = subgraph_->tensor(state.output_index);
+    if (input->type != output->type ||
+        !TfLiteIntArrayEqual(input->dims, output->dims)) {
+      subgraph_->ReportError(
+          "Streaming state %s and its update %s have different types or "
+          "shapes.",
+          input->name ? input->name : "", output->name ? output->name : "");
+      return kTfLiteError;
+    }
+  }
+  return kTfLiteOk;
+}
+
 TfLiteStatus SignatureRunner::Invoke() {
   // "Resets" cancellation flag so cancellation happens before this invoke will
   // not take effect.
@@ -88,9 +162,188 @@ TfLiteStatus SignatureRunner::Invoke() {
           subgraph_->EnsureTensorDataIsReadable(tensor_index));
     }
   }
+
+  // The updated states become the inputs of the next invocation.
+  for (StreamingState& state : streaming_states_) {
+    state.current = 1 - state.current;
+    TF_LITE_ENSURE_STATUS(BindStreamingState(state));
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus SignatureRunner::AddStreamingState(const char* state_input_name,
+                                                const char* state_output_name) {
+  const auto& input_it = signature_def_->inputs.find(state_input_name);
+  if (input_it == signature_def_->inputs.end()) {
+    subgraph_->ReportError("Input name %s was not found", state_input_name);
+    return kTfLiteError;
+  }
+  const auto& output_it = signature_def_->outputs.find(state_output_name);
+  if (output_it == signature_def_->outputs.end()) {
+    subgraph_->ReportError("Output name %s was not found", state_output_name);
+    return kTfLiteError;
+  }
+  for (const StreamingState& state : streaming_states_) {
+    if (state.input_index == input_it->second ||
+        state.output_index == output_it->second) {
+      subgraph_->ReportError("Streaming state %s is already designated",
+                             state_input_name);
+      return kTfLiteError;
+    }
+  }
+  StreamingState state;
+  state.input_index = input_it->second;
+  state.output_index = output_it->second;
+  streaming_states_.push_back(std::move(state));
+  return kTfLiteOk;
+}
+
+TfLiteStatus SignatureRunner::ResetStreamingStates() {
+  for (StreamingState& state : streaming_states_) {
+    if (state.storage == nullptr) continue;
+    std::memset(state.buffers[state.current], 0, state.bytes);
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus SignatureRunner::InvokeBatch(
+    const std::vector<BatchRequest>& requests,
+    std::vector<BatchResponse>* responses) {
+  // The number of rows of each request, and the packed shape of each input.
+  std::vector<int> rows(requests.size(), -1);
+  std::vector<std::vector<int>> packed_dims(input_names_.size());
+  for (size_t i = 0; i < input_names_.size(); ++i) {
+    std::vector<int>& dims = packed_dims[i];
+    size_t element_size;
+    TF_LITE_ENSURE_STATUS(GetSizeOfType(subgraph_->context(),
+                                        input_tensor(input_names_[i])->type,
+                                        &element_size));
+    for (size_t r = 0; r < requests.size(); ++r) {
+      const auto it = requests[r].find(input_names_[i]);
+      if (it == requests[r].end() || it->second.data == nullptr ||
+          it->second.dims.empty()) {
+        subgraph_->ReportError("Request %d does not set input %s",
+                               static_cast<int>(r), input_names_[i]);
+        return kTfLiteError;
+      }
+      const std::vector<int>& request_dims = it->second.dims;
+      if (rows[r] < 0) rows[r] = request_dims[0];
+      size_t request_bytes = element_size;
+      for (int dim : request_dims) {
+        request_bytes *= std::max(dim, 0);
+      }
+      if (*std::min_element(request_dims.begin(), request_dims.end()) < 0 ||
+          request_dims[0] != rows[r] ||
+          (!dims.empty() && request_dims.size() != dims.size())) {
+        subgraph_->ReportError(
+            "Input %s of request %d has an inconsistent shape",
+            input_names_[i], static_cast<int>(r));
+        return kTfLiteError;
+      }
+      if (it->second.bytes != request_bytes) {
+        subgraph_->ReportError(
+            "Input %s of request %d has %d bytes instead of %d",
+            input_names_[i], static_cast<int>(r),
+            static_cast<int>(it->second.bytes),
+            static_cast<int>(request_bytes));
+        return kTfLiteError;
+      }
+      if (dims.empty()) dims = request_dims;
+      for (size_t d = 1; d < dims.size(); ++d) {
+        dims[d] = std::max(dims[d], request_dims[d]);
+      }
+    }
+  }
+
+  std::vector<int> offsets(requests.size());
+  int total_rows = 0;
+  for (size_t r = 0; r < requests.size(); ++r) {
+    offsets[r] = total_rows;
+    total_rows += rows[r];
+  }
+  if (total_rows <= 0) {
+    subgraph_->ReportError("InvokeBatch requires at least one row");
+    return kTfLiteError;
+  }
+  const auto allowed_it = std::lower_bound(
+      allowed_batch_sizes_.begin(), allowed_batch_sizes_.end(), total_rows);
+  const int batch_size =
+      allowed_it != allowed_batch_sizes_.end() ? *allowed_it : total_rows;
+
+  // Resizing to the current shape is a no-op, and so is AllocateTensors then.
+  for (size_t i = 0; i < input_names_.size(); ++i) {
+    packed_dims[i][0] = batch_size;
+    TF_LITE_ENSURE_STATUS(ResizeInputTensor(input_names_[i], packed_dims[i]));
+  }
+  TF_LITE_ENSURE_STATUS(AllocateTensors());
+
+  for (size_t i = 0; i < input_names_.size(); ++i) {
+    TfLiteTensor* input = input_tensor(input_names_[i]);
+    size_t element_size;
+    TF_LITE_ENSURE_STATUS(
+        GetSizeOfType(subgraph_->context(), input->type, &element_size));
+    const std::vector<int>& dims = packed_dims[i];
+    const size_t row_bytes = input->bytes / batch_size;
+    char* data = input->data.raw;
+    std::memset(data + total_rows * row_bytes, 0,
+                (batch_size - total_rows) * row_bytes);
+    for (size_t r = 0; r < requests.size(); ++r) {
+      const RequestTensor& request_tensor = requests[r].at(input_names_[i]);
+      const char* src = static_cast<const char*>(request_tensor.data);
+      char* dst = data + offsets[r] * row_bytes;
+      if (std::equal(dims.begin() + 1, dims.end(),
+                     request_tensor.dims.begin() + 1)) {
+        std::memcpy(dst, src, rows[r] * row_bytes);
+      } else {
+        std::memset(dst, 0, rows[r] * row_bytes);
+        CopyPadded(src, request_tensor.dims, dst, dims, element_size, 0);
+      }
+    }
+  }
+
+  TF_LITE_ENSURE_STATUS(Invoke());
+
+  // The rows of each request are contiguous in the outputs.
+  responses->assign(requests.size(), BatchResponse());
+  for (const char* output_name : output_names_) {
+    const TfLiteTensor* output = output_tensor(output_name);
+    if (output->dims->size < 1 || output->dims->data[0] != batch_size) {
+      subgraph_->ReportError("Output %s is not batched", output_name);
+      return kTfLiteError;
+    }
+    const size_t row_bytes = output->bytes / batch_size;
+    std::vector<int> dims(output->dims->data,
+                          output->dims->data + output->dims->size);
+    for (size_t r = 0; r < requests.size(); ++r) {
+      ResponseTensor& response = (*responses)[r][output_name];
+      response.data = output->data.raw + offsets[r] * row_bytes;
+      response.bytes = rows[r] * row_bytes;
+      dims[0] = rows[r];
+      response.dims = dims;
+    }
+  }
   return kTfLiteOk;
 }
 
+TfLiteStatus SignatureRunner::SetAllowedBatchSizes(
+    std::vector<int> batch_sizes) {
+  std::sort(batch_sizes.begin(), batch_sizes.end());
+  if (!batch_sizes.empty() && batch_sizes[0] <= 0) {
+    subgraph_->ReportError("Batch sizes must be positive, got %d",
+                           batch_sizes[0]);
+    return kTfLiteError;
+  }
+  allowed_batch_sizes_ = std::move(batch_sizes);
+  return kTfLiteOk;
+}
+
+TfLiteStatus SignatureRunner::BindStreamingState(const StreamingState& state) {
+  TF_LITE_ENSURE_STATUS(subgraph_->SetCustomAllocationForTensor(
+      state.input_index, {state.buffers[state.current], state.bytes}));
+  return subgraph_->SetCustomAllocationForTensor(
+      state.output_index, {state.buffers[1 - state.current], state.bytes});
+}
+
 TfLiteStatus SignatureRunner::SetCustomAllocationForInputTensor(
     const char* input_name, const TfLiteCustomAllocation& allocation,
     int64_t flags) {
@@ -27,6 +27,8 @@ limitations under the License.
 
 #include <cstddef>
 #include <cstdint>
+#include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -140,12 +142,99 @@ class SignatureRunner {
                                        const std::vector<int>& new_size);
 
   /// Updates allocations for all tensors, related to the given signature.
-  TfLiteStatus AllocateTensors() { return subgraph_->AllocateTensors(); }
+  /// Also (re)allocates the buffers of streaming states, see
+  /// `AddStreamingState`.
+  TfLiteStatus AllocateTensors();
 
   /// Invokes the signature runner (run the graph identified by the given
   /// signature in dependency order).
+  /// On success, the outputs of streaming states become their inputs for the
+  /// next invocation, see `AddStreamingState`.
   TfLiteStatus Invoke();
 
+  /// \brief Designates a streaming state, for models that run step by step
+  /// over a sequence (e.g. streaming speech recognition), and carry a state
+  /// from one step to the next.
+  ///
+  /// The state is read from the input `state_input_name` and its update is
+  /// written to the output `state_output_name`, which must have the same type
+  /// and shape. The runner keeps the state outside of the arena, in two
+  /// buffers that it owns: one is bound to the input, the other one to the
+  /// output. After each successful `Invoke`, the buffers are swapped, so that
+  /// the updated state becomes the input of the next step without any copy,
+  /// and clients only set the per-step inputs.
+  ///
+  /// The current state is readable and writable through
+  /// `input_tensor(state_input_name)`; the data pointer of both tensors
+  /// changes after each `Invoke`. States are zero-initialized by the
+  /// first `AllocateTensors`, and again when their size changes.
+  ///
+  /// NOTE: User needs to call AllocateTensors() after this.
+  /// Delegates that keep the data pointers of the state tensors across
+  /// invocations are not supported.
+  /// \warning This is an experimental API and subject to change. \n
+  TfLiteStatus AddStreamingState(const char* state_input_name,
+                                 const char* state_output_name);
+
+  /// Zeroes the streaming states, e.g. to start a new sequence.
+  /// \warning This is an experimental API and subject to change. \n
+  TfLiteStatus ResetStreamingStates();
+
+  /// The data of an input of one request of `InvokeBatch`. The first
+  /// dimension is the number of batch rows of the request, e.g. 1. `bytes`
+  /// is the size of `data`, which must match `dims` and the type of the
+  /// input.
+  struct RequestTensor {
+    const void* data = nullptr;
+    size_t bytes = 0;
+    std::vector<int> dims;
+  };
+
+  /// A view of the rows of an output that belong to one request of
+  /// `InvokeBatch`, in the output tensor.
+  struct ResponseTensor {
+    const void* data = nullptr;
+    size_t bytes = 0;
+    std::vector<int> dims;
+  };
+
+  /// The inputs of a request, and the outputs of its response, by name.
+  using BatchRequest = std::map<std::string, RequestTensor>;
+  using BatchResponse = std::map<std::string, ResponseTensor>;
+
+  /// \brief Runs the signature once for several independent requests, by
+  /// packing their inputs along the first (batch) dimension.
+  ///
+  /// Each request sets all the inputs of the signature, with the same number
+  /// of rows. Requests whose inputs have a smaller shape than others (except
+  /// along the batch dimension) are padded with zeros, and so are their
+  /// outputs. Inputs are resized when the packed shape changes, so the graph
+  /// is only prepared again for new shapes, see `SetAllowedBatchSizes`.
+  ///
+  /// On success, `responses` holds a response for each request, which views
+  /// its rows of each output without a copy. Each output must have the
+  /// packed batch size as first dimension. The views are valid until the
+  /// next call that invokes or resizes the signature.
+  /// \warning This is an experimental API and subject to change. \n
+  TfLiteStatus InvokeBatch(const std::vector<BatchRequest>& requests,
+                           std::vector<BatchResponse>* responses);
+
+  /// Sets the batch sizes that `InvokeBatch` packs requests into: the batch
+  /// is padded with zero rows up to the smallest allowed size that fits it,
+  /// so that batches of varying sizes reuse the same few prepared shapes
+  /// instead of resizing the inputs on every call. Larger batches keep their
+  /// size. By default, batches are not padded. Returns kTfLiteError, and
+  /// keeps the current sizes, if a size is not positive.
+  ///
+  /// Only one shape is prepared at a time: the signature is not planned for
+  /// each allowed size. A batch whose padded size differs from that of the
+  /// previous call resizes the inputs and prepares the graph again, so
+  /// batches that alternate between allowed sizes are prepared on every call.
+  /// Allowing fewer sizes trades that cost for more padding; with a single
+  /// size no smaller than every batch, the graph is prepared once.
+  /// \warning This is an experimental API and subject to change. \n
+  TfLiteStatus SetAllowedBatchSizes(std::vector<int> batch_sizes);
+
   /// Attempts to cancel in flight invocation if any.
   /// This will not affect calls to `Invoke` that happened after this.
   /// Non blocking and thread safe.
@@ -237,7 +326,30 @@ class SignatureRunner {
   // The list of output tensor names.
   std::vector<const char*> output_names_;
 
+  // A state carried across invocations, see AddStreamingState.
+  struct StreamingState {
+    int input_index;
+    int output_index;
+    // Size of the state tensors, and of each buffer.
+    size_t tensor_bytes = 0;
+    size_t bytes = 0;
+    // Storage of the two buffers, aligned to kDefaultTensorAlignment.
+    std::unique_ptr<char[]> storage;
+    char* buffers[2] = {nullptr, nullptr};
+    // Index of the buffer that holds the current state.
+    int current = 0;
+  };
+
+  // Binds the current buffer of `state` to its input, and the other one to
+  // its output.
+  TfLiteStatus BindStreamingState(const StreamingState& state);
+
   bool allow_buffer_handle_output_ = false;
+
+  std::vector<StreamingState> streaming_states_;
+
+  // Sorted batch sizes of InvokeBatch, see SetAllowedBatchSizes.
+  std::vector<int> allowed_batch_sizes_;
 };
 
 }  // namespace impl
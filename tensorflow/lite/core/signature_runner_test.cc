@@ -96,6 +96,127 @@ TEST(SignatureRunnerTest, TestMultiSignatures) {
   ASSERT_EQ(sub_output->data.f[2], 3);
 }
 
+TEST(SignatureRunnerTest, TestStreamingState) {
+  TestErrorReporter reporter;
+  auto model = FlatBufferModel::BuildFromFile(
+      "tensorflow/lite/testdata/multi_signatures.bin", &reporter);
+  ASSERT_TRUE(model);
+  ops::builtin::BuiltinOpResolver resolver;
+  InterpreterBuilder builder(*model, resolver);
+  std::unique_ptr<Interpreter> interpreter;
+  ASSERT_EQ(builder(&interpreter), kTfLiteOk);
+  ASSERT_NE(interpreter, nullptr);
+
+  // The "add" signature computes x + 2, so that each step adds 2 to the state.
+  SignatureRunner* runner = interpreter->GetSignatureRunner("add");
+  ASSERT_NE(runner, nullptr);
+  ASSERT_EQ(runner->AddStreamingState("dummy", "output_0"), kTfLiteError);
+  ASSERT_EQ(runner->AddStreamingState("x", "dummy"), kTfLiteError);
+  ASSERT_EQ(runner->AddStreamingState("x", "output_0"), kTfLiteOk);
+  ASSERT_EQ(runner->AddStreamingState("x", "output_0"), kTfLiteError);
+  ASSERT_EQ(runner->ResizeInputTensor("x", {2}), kTfLiteOk);
+  ASSERT_EQ(runner->AllocateTensors(), kTfLiteOk);
+
+  const TfLiteTensor* state = runner->input_tensor("x");
+  ASSERT_NE(state, nullptr);
+  EXPECT_EQ(state->allocation_type, kTfLiteCustom);
+  EXPECT_EQ(state->data.f[0], 0);
+  EXPECT_EQ(state->data.f[1], 0);
+  for (int step = 1; step <= 3; ++step) {
+    const void* input_data = state->data.raw;
+    const void* output_data = runner->output_tensor("output_0")->data.raw;
+    ASSERT_EQ(runner->Invoke(), kTfLiteOk);
+    // The buffers are swapped instead of copied.
+    EXPECT_EQ(state->data.raw, output_data);
+    EXPECT_EQ(runner->output_tensor("output_0")->data.raw, input_data);
+    EXPECT_EQ(state->data.f[0], 2 * step);
+    EXPECT_EQ(state->data.f[1], 2 * step);
+  }
+
+  ASSERT_EQ(runner->ResetStreamingStates(), kTfLiteOk);
+  EXPECT_EQ(state->data.f[0], 0);
+  ASSERT_EQ(runner->Invoke(), kTfLiteOk);
+  EXPECT_EQ(state->data.f[0], 2);
+
+  // Resizing the state starts a new sequence.
+  ASSERT_EQ(runner->ResizeInputTensor("x", {3}), kTfLiteOk);
+  ASSERT_EQ(runner->AllocateTensors(), kTfLiteOk);
+  ASSERT_EQ(runner->Invoke(), kTfLiteOk);
+  EXPECT_EQ(state->data.f[0], 2);
+  EXPECT_EQ(state->data.f[2], 2);
+}
+
+TEST(SignatureRunnerTest, TestInvokeBatch) {
+  TestErrorReporter reporter;
+  auto model = FlatBufferModel::BuildFromFile(
+      "tensorflow/lite/testdata/multi_signatures.bin", &reporter);
+  ASSERT_TRUE(model);
+  ops::builtin::BuiltinOpResolver resolver;
+  InterpreterBuilder builder(*model, resolver);
+  std::unique_ptr<Interpreter> interpreter;
+  ASSERT_EQ(builder(&interpreter), kTfLiteOk);
+  ASSERT_NE(interpreter, nullptr);
+
+  // The "add" signature computes x + 2.
+  SignatureRunner* runner = interpreter->GetSignatureRunner("add");
+  ASSERT_NE(runner, nullptr);
+  const float first_data[] = {1, 2, 3, 4};
+  const float second_data[] = {10};
+  std::vector<SignatureRunner::BatchRequest> requests(2);
+  requests[0]["x"] = {first_data, sizeof(first_data), {2, 2}};
+  requests[1]["x"] = {second_data, sizeof(second_data), {1, 1}};
+  std::vector<SignatureRunner::BatchResponse> responses;
+  ASSERT_EQ(runner->InvokeBatch(requests, &responses), kTfLiteOk);
+
+  // The second request is padded to the shape of the first one.
+  const TfLiteTensor* input = runner->input_tensor("x");
+  ASSERT_EQ(input->dims->size, 2);
+  EXPECT_EQ(input->dims->data[0], 3);
+  EXPECT_EQ(input->dims->data[1], 2);
+  const TfLiteTensor* output = runner->output_tensor("output_0");
+  ASSERT_EQ(responses.size(), 2);
+  const SignatureRunner::ResponseTensor& first = responses[0]["output_0"];
+  const SignatureRunner::ResponseTensor& second = responses[1]["output_0"];
+  // Responses view the output tensor.
+  EXPECT_EQ(first.data, output->data.f);
+  EXPECT_EQ(second.data, output->data.f + 4);
+  EXPECT_EQ(first.bytes, 4 * sizeof(float));
+  EXPECT_EQ(first.dims, std::vector<int>({2, 2}));
+  EXPECT_EQ(second.dims, std::vector<int>({1, 2}));
+  const float* first_output = static_cast<const float*>(first.data);
+  EXPECT_EQ(first_output[0], 3);
+  EXPECT_EQ(first_output[3], 6);
+  const float* second_output = static_cast<const float*>(second.data);
+  EXPECT_EQ(second_output[0], 12);
+  EXPECT_EQ(second_output[1], 2);
+
+  // Batches are padded up to the allowed sizes.
+  ASSERT_EQ(runner->SetAllowedBatchSizes({8, 4}), kTfLiteOk);
+  ASSERT_EQ(runner->InvokeBatch(requests, &responses), kTfLiteOk);
+  EXPECT_EQ(runner->input_tensor("x")->dims->data[0], 4);
+  EXPECT_EQ(static_cast<const float*>(responses[1]["output_0"].data)[0], 12);
+  EXPECT_EQ(runner->output_tensor("output_0")->data.f[6], 2);
+
+  // Batch sizes must be positive.
+  EXPECT_EQ(runner->SetAllowedBatchSizes({4, 0}), kTfLiteError);
+  EXPECT_EQ(runner->SetAllowedBatchSizes({-1}), kTfLiteError);
+  ASSERT_EQ(runner->InvokeBatch(requests, &responses), kTfLiteOk);
+  EXPECT_EQ(runner->input_tensor("x")->dims->data[0], 4);
+
+  // The data of requests must match their shape.
+  requests[1]["x"].bytes = 2 * sizeof(float);
+  EXPECT_EQ(runner->InvokeBatch(requests, &responses), kTfLiteError);
+  requests[1]["x"] = {second_data, sizeof(second_data), {1, -1}};
+  EXPECT_EQ(runner->InvokeBatch(requests, &responses), kTfLiteError);
+
+  // All requests must set all inputs, with the same rank.
+  requests[1]["x"] = {second_data, sizeof(second_data), {1}};
+  EXPECT_EQ(runner->InvokeBatch(requests, &responses), kTfLiteError);
+  requests[1].clear();
+  EXPECT_EQ(runner->InvokeBatch(requests, &responses), kTfLiteError);
+  EXPECT_EQ(runner->InvokeBatch({}, &responses), kTfLiteError);
+}
+
 }  // namespace
 }  // namespace impl
 }  // namespace tflite
@@ -24,6 +24,8 @@ limitations under the License.
 #include <cstring>
 #include <iterator>
 #include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <numeric>
 #include <string>
 #include <unordered_set>
 #include <utility>
@@ -39,7 +41,9 @@ limitations under the License.
 #include "tensorflow/lite/core/api/tensor_utils.h"
 #include "tensorflow/lite/core/c/c_api_types.h"
 #include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/inter_op_thread_pool.h"
 #include "tensorflow/lite/experimental/resource/resource_base.h"
+#include "tensorflow/lite/external_cpu_backend_context.h"
 #include "tensorflow/lite/graph_info.h"
 #include "tensorflow/lite/memory_planner.h"
 #include "tensorflow/lite/minimal_logging.h"
@@ -190,6 +194,14 @@ TfLiteStatus VerifyCustomAllocationForTensor(
   return kTfLiteOk;
 }
 
+// The CPU backend context used by the ops that a thread of the inter-op thread
+// pool of `subgraph` executes, in place of the one of the subgraph.
+struct InterOpThreadContext {
+  const Subgraph* subgraph;
+  TfLiteExternalContext* cpu_backend_context;
+};
+thread_local InterOpThreadContext inter_op_thread_context = {nullptr, nullptr};
+
 }  // namespace
 
 // A trivial implementation of GraphInfo around the Interpreter.
@@ -241,6 +253,13 @@ class InterpreterInfo : public GraphInfo {
     return subgraph_->variables();
   }
 
+  std::pair<size_t, size_t> parallel_node_group(size_t index) const override {
+    if (index < subgraph_->parallel_node_groups_.size()) {
+      return subgraph_->parallel_node_groups_[index];
+    }
+    return {index, index};
+  }
+
  public:
   Subgraph* subgraph_;
 };
@@ -615,6 +634,10 @@ TfLiteStatus Subgraph::ReplaceNodeSubsetsWithDelegateKernels(
 
 TfLiteExternalContext* Subgraph::GetExternalContext(
     TfLiteExternalContextType type) {
+  if (type == kTfLiteCpuBackendContext &&
+      inter_op_thread_context.subgraph == this) {
+    return inter_op_thread_context.cpu_backend_context;
+  }
   if (static_cast<int>(type) >= 0 && type < kTfLiteMaxExternalContexts) {
     return external_contexts_[type];
   }
@@ -1525,6 +1548,7 @@ TfLiteStatus Subgraph::PrepareOpsAndTensors() {
         &context_, CreateGraphInfo(), ShouldPreserveAllTensors(),
         kDefaultTensorAlignment, subgraph_index_);
 #endif
+    ComputeParallelNodeGroups();
     memory_planner_->PlanAllocations();
   }
 
@@ -1577,6 +1601,303 @@ TfLiteStatus Subgraph::RemoveUnusedInputs() {
   return kTfLiteOk;
 }
 
+TfLiteStatus Subgraph::EnsureNodeInputsAreReadable(
+    const TfLiteNode& node, const TfLiteRegistration& registration) {
+  for (int i = 0; i < node.inputs->size; ++i) {
+    int tensor_index = node.inputs->data[i];
+    if (tensor_index == kTfLiteOptionalTensor) {
+      continue;
+    }
+    TfLiteTensor* tensor = &tensors_[tensor_index];
+    if (tensor->delegate && tensor->delegate != node.delegate &&
+        tensor->data_is_stale) {
+      TF_LITE_ENSURE_STATUS(EnsureTensorDataIsReadable(tensor_index));
+    }
+    if (tensor->data.raw == nullptr && tensor->bytes > 0) {
+      if (registration.builtin_code == kTfLiteBuiltinReshape && i == 1 &&
+          tensor->dims->size != 1) {
+        // In general, having a tensor here with no buffer will be an error.
+        // However, for the reshape operator, the second input tensor is
+        // sometimes only used for the shape, not for the data. Thus, null
+        // buffer is ok in this situation.
+        // The situation where null buffer is not ok for reshape operator is
+        // only when there are 2 inputs given to the node and the one
+        // corresponding to the shape (i == 1) is a vector that contains all
+        // dimensions. See `GetOutputShape()` function in
+        // `tensorflow/lite/kernels/reshape.cc`
+        continue;
+      } else {
+        // In all other cases, we need to return an error as otherwise we will
+        // trigger a null pointer dereference (likely).
+        ReportError("Input tensor %d lacks data", tensor_index);
+        return kTfLiteError;
+      }
+    }
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus Subgraph::CheckCancelled() {
+  if (check_cancelled_func_ != nullptr &&
+      check_cancelled_func_(cancellation_data_)) {
+    ReportError("Client requested cancel during Invoke()");
+    return kTfLiteError;
+  }
+
+  if (continue_invocation_ && !continue_invocation_->test_and_set()) {
+    // `Cancel` is called and cancellation flag is flipped.
+    ReportError("Client requested cancel during Invoke()");
+    return kTfLiteCancelled;
+  }
+  return kTfLiteOk;
+}
+
+bool Subgraph::IsParallelizableNode(
+    const TfLiteNode& node, const TfLiteRegistration& registration) const {
+  // Delegate kernels may share state between them.
+  if (node.delegate != nullptr) return false;
+  switch (registration.builtin_code) {
+    // Control flow ops invoke other subgraphs, which are not thread-safe.
+    case kTfLiteBuiltinCallOnce:
+    case kTfLiteBuiltinIf:
+    case kTfLiteBuiltinWhile:
+    case kTfLiteBuiltinStablehloWhile:
+      return false;
+    default:
+      break;
+  }
+  for (const TfLiteIntArray* tensors : {node.inputs, node.outputs}) {
+    for (int tensor_index : TfLiteIntArrayView(tensors)) {
+      if (tensor_index == kTfLiteOptionalTensor) continue;
+      const TfLiteTensor& tensor = tensors_[tensor_index];
+      // Variables and resources are state shared with other nodes, which are
+      // not ordered by data dependencies.
+      if (tensor.is_variable || tensor.type == kTfLiteResource ||
+          tensor.type == kTfLiteVariant) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+void Subgraph::ComputeParallelNodeGroups() {
+  parallel_node_groups_.clear();
+  parallel_node_groups_plan_.clear();
+  if (options_ == nullptr || options_->GetInterOpNumThreads() <= 1) return;
+  const int num_nodes = execution_plan_.size();
+  // Nodes are prepared in execution order, so the plan is only reordered once
+  // all of them are.
+  if (next_execution_plan_index_to_prepare_ != num_nodes) return;
+
+  const int num_total_nodes = nodes_and_registration_.size();
+  std::vector<int> node_positions(num_total_nodes, -1);
+  for (int i = 0; i < num_nodes; ++i) {
+    node_positions[execution_plan_[i]] = i;
+  }
+  // Execution plan index of the node producing each tensor.
+  std::vector<int> producers(tensors_.size(), -1);
+  // Execution plan indices of the nodes each node has control dependencies
+  // on.
+  std::vector<std::vector<int>> control_inputs(num_nodes);
+  if (control_edges_ != nullptr) {
+    for (const ControlEdge& edge : *control_edges_) {
+      if (edge.first < 0 || edge.first >= num_total_nodes ||
+          edge.second < 0 || edge.second >= num_total_nodes) {
+        continue;
+      }
+      const int from = node_positions[edge.first];
+      const int to = node_positions[edge.second];
+      if (from >= 0 && to >= 0) control_inputs[to].push_back(from);
+    }
+  }
+
+  // Nodes that cannot run concurrently with others split the execution plan
+  // into segments, and keep their position. Within a segment, the level of a
+  // node is the length of the longest chain of nodes of the segment it
+  // depends on, so nodes at the same level are independent. Each segment is
+  // reordered by level, and each level becomes a group.
+  std::vector<int> levels(num_nodes, 0);
+  std::vector<int> plan;
+  plan.reserve(num_nodes);
+  parallel_node_groups_.resize(num_nodes);
+  int segment_start = 0;
+  auto add_segment = [&](int segment_end) {
+    std::vector<int> positions(segment_end - segment_start);
+    std::iota(positions.begin(), positions.end(), segment_start);
+    std::stable_sort(positions.begin(), positions.end(),
+                     [&levels](int a, int b) { return levels[a] < levels[b]; });
+    int group_start = plan.size();
+    for (size_t k = 0; k < positions.size(); ++k) {
+      plan.push_back(execution_plan_[positions[k]]);
+      if (k + 1 < positions.size() &&
+          levels[positions[k + 1]] == levels[positions[k]]) {
+        continue;
+      }
+      const int group_end = plan.size() - 1;
+      for (int j = group_start; j <= group_end; ++j) {
+        parallel_node_groups_[j] = {group_start, group_end};
+      }
+      group_start = group_end + 1;
+    }
+  };
+  for (int i = 0; i < num_nodes; ++i) {
+    const auto& node_and_registration =
+        nodes_and_registration_[execution_plan_[i]];
+    const TfLiteNode& node = node_and_registration.first;
+    if (IsParallelizableNode(node, node_and_registration.second)) {
+      for (int tensor_index : TfLiteIntArrayView(node.inputs)) {
+        if (tensor_index == kTfLiteOptionalTensor) continue;
+        const int producer = producers[tensor_index];
+        if (producer >= segment_start) {
+          levels[i] = std::max(levels[i], levels[producer] + 1);
+        }
+      }
+      for (int from : control_inputs[i]) {
+        if (from >= segment_start) {
+          levels[i] = std::max(levels[i], levels[from] + 1);
+        }
+      }
+    } else {
+      add_segment(i);
+      const int position = plan.size();
+      parallel_node_groups_[position] = {position, position};
+      plan.push_back(execution_plan_[i]);
+      segment_start = i + 1;
+    }
+    for (int tensor_index : TfLiteIntArrayView(node.outputs)) {
+      if (tensor_index != kTfLiteOptionalTensor) {
+        producers[tensor_index] = i;
+      }
+    }
+  }
+  add_segment(num_nodes);
+  // The new plan is another topological order of the nodes, which were all
+  // prepared already. The memory planner then allocates tensors in that
+  // order.
+  execution_plan_ = std::move(plan);
+  parallel_node_groups_plan_ = execution_plan_;
+}
+
+bool Subgraph::CanInvokeInParallel() const {
+  // Nodes that resize tensors while executing change the memory plan, and the
+  // profilers are not thread-safe.
+  return !parallel_node_groups_.empty() &&
+         parallel_node_groups_plan_ == execution_plan_ &&
+         !has_dynamic_tensors_ &&
+         next_execution_plan_index_to_prepare_ ==
+             static_cast<int>(execution_plan_.size()) &&
+         profiler_ == nullptr;
+}
+
+TfLiteStatus Subgraph::InvokeInParallel() {
+  const int num_threads = options_->GetInterOpNumThreads();
+  if (inter_op_thread_pool_ == nullptr ||
+      inter_op_thread_pool_->num_threads() != num_threads ||
+      inter_op_recommended_num_threads_ != context_.recommended_num_threads) {
+    ConfigureInterOpThreads(num_threads);
+  }
+
+  // Kernels create the backend of a CPU backend context on their first use of
+  // it, with recommended_num_threads threads, so the first invocation after
+  // configuring lowers it for them.
+  const int recommended_num_threads = context_.recommended_num_threads;
+  const bool first_invocation = !inter_op_cpu_backend_contexts_used_;
+  if (first_invocation && inter_op_num_threads_per_op_ > 0) {
+    context_.recommended_num_threads = inter_op_num_threads_per_op_;
+  }
+  const TfLiteStatus status = InvokeParallelNodeGroups();
+  context_.recommended_num_threads = recommended_num_threads;
+  inter_op_cpu_backend_contexts_used_ = true;
+  // Configures the backends created during this invocation.
+  ConfigureInterOpCpuBackendContexts();
+  return status;
+}
+
+void Subgraph::ConfigureInterOpThreads(int num_threads) {
+  if (inter_op_thread_pool_ == nullptr ||
+      inter_op_thread_pool_->num_threads() != num_threads) {
+    inter_op_thread_pool_ = std::make_unique<InterOpThreadPool>(num_threads);
+    // Ops are not thread-safe with respect to their CpuBackendContext, so
+    // each thread has its own. The calling thread does not use the context
+    // of the subgraph either, which may be shared with other interpreters.
+    inter_op_cpu_backend_contexts_.clear();
+    for (int i = 0; i < num_threads; ++i) {
+      inter_op_cpu_backend_contexts_.push_back(
+          std::make_unique<ExternalCpuBackendContext>());
+    }
+  }
+  // The intra-op threads are split among the nodes executed concurrently.
+  inter_op_recommended_num_threads_ = context_.recommended_num_threads;
+  inter_op_num_threads_per_op_ =
+      inter_op_recommended_num_threads_ > 0
+          ? std::max(1, inter_op_recommended_num_threads_ / num_threads)
+          : -1;
+  inter_op_cpu_backend_contexts_configured_.assign(num_threads, false);
+  inter_op_cpu_backend_contexts_used_ = false;
+  ConfigureInterOpCpuBackendContexts();
+}
+
+void Subgraph::ConfigureInterOpCpuBackendContexts() {
+  for (size_t i = 0; i < inter_op_cpu_backend_contexts_.size(); ++i) {
+    TfLiteInternalBackendContext* backend_context =
+        inter_op_cpu_backend_contexts_[i]->internal_backend_context();
+    if (inter_op_cpu_backend_contexts_configured_[i] ||
+        backend_context == nullptr) {
+      continue;
+    }
+    if (inter_op_num_threads_per_op_ > 0) {
+      backend_context->SetMaxNumThreads(inter_op_num_threads_per_op_);
+    }
+    inter_op_cpu_backend_contexts_configured_[i] = true;
+  }
+}
+
+TfLiteStatus Subgraph::InvokeParallelNodeGroups() {
+  EnsureTensorsVectorCapacity();
+  tensor_resized_since_op_invoke_ = false;
+
+  std::vector<TfLiteStatus> statuses;
+  const int num_nodes = execution_plan_.size();
+  int group_start = 0;
+  while (group_start < num_nodes) {
+    const int group_end = parallel_node_groups_[group_start].second;
+    for (int i = group_start; i <= group_end; ++i) {
+      const auto& node_and_registration =
+          nodes_and_registration_[execution_plan_[i]];
+      TF_LITE_ENSURE_STATUS(EnsureNodeInputsAreReadable(
+          node_and_registration.first, node_and_registration.second));
+    }
+    TF_LITE_ENSURE_STATUS(CheckCancelled());
+
+    statuses.assign(group_end - group_start + 1, kTfLiteOk);
+    inter_op_thread_pool_->ParallelFor(
+        statuses.size(), [this, group_start, &statuses](int thread_index,
+                                                        int i) {
+          inter_op_thread_context = {
+              this, inter_op_cpu_backend_contexts_[thread_index].get()};
+          auto& node_and_registration =
+              nodes_and_registration_[execution_plan_[group_start + i]];
+          statuses[i] = OpInvoke(node_and_registration.second,
+                                 &node_and_registration.first);
+          inter_op_thread_context = {nullptr, nullptr};
+        });
+    for (int i = group_start; i <= group_end; ++i) {
+      const TfLiteStatus status = statuses[i - group_start];
+      if (status != kTfLiteOk) {
+        const int node_index = execution_plan_[i];
+        auto err = ReportOpError(&context_,
+                                 nodes_and_registration_[node_index].first,
+                                 nodes_and_registration_[node_index].second,
+                                 node_index, "failed to invoke");
+        return status == kTfLiteCancelled ? status : err;
+      }
+    }
+    group_start = group_end + 1;
+  }
+  return kTfLiteOk;
+}
+
 TfLiteStatus Subgraph::Invoke() {
   auto status = InvokeImpl();
   telemetry::TelemetryReportEvent(&context_, "Invoke", status);
@@ -1596,6 +1917,7 @@ TfLiteStatus Subgraph::InvokeImpl() {
     ReportError("Non-persistent memory is not available.");
     return kTfLiteError;
   }
+  if (CanInvokeInParallel()) return InvokeInParallel();
   TFLITE_SCOPED_TAGGED_DEFAULT_PROFILE(profiler_.get(), "Invoke");
 #ifdef TF_LITE_TENSORFLOW_PROFILER
   tensorflow::profiler::TraceMe* trace_subgraph =
@@ -1636,52 +1958,12 @@ TfLiteStatus Subgraph::InvokeImpl() {
     TFLITE_SCOPED_TAGGED_OPERATOR_PROFILE(
         profile_op ? profiler_.get() : nullptr, op_name, node_index);
 
-    for (int i = 0; i < node.inputs->size; ++i) {
-      int tensor_index = node.inputs->data[i];
-      if (tensor_index == kTfLiteOptionalTensor) {
-        continue;
-      }
-      TfLiteTensor* tensor = &tensors_[tensor_index];
-      if (tensor->delegate && tensor->delegate != node.delegate &&
-          tensor->data_is_stale) {
-        TF_LITE_ENSURE_STATUS(EnsureTensorDataIsReadable(tensor_index));
-      }
-      if (tensor->data.raw == nullptr && tensor->bytes > 0) {
-        if (registration.builtin_code == kTfLiteBuiltinReshape && i == 1 &&
-            tensor->dims->size != 1) {
-          // In general, having a tensor here with no buffer will be an error.
-          // However, for the reshape operator, the second input tensor is
-          // sometimes only used for the shape, not for the data. Thus, null
-          // buffer is ok in this situation.
-          // The situation where null buffer is not ok for reshape operator is
-          // only when there are 2 inputs given to the node and the one
-          // corresponding to the shape (i == 1) is a vector that contains all
-          // dimensions. See `GetOutputShape()` function in
-          // `tensorflow/lite/kernels/reshape.cc`
-          continue;
-        } else {
-          // In all other cases, we need to return an error as otherwise we will
-          // trigger a null pointer dereference (likely).
-          ReportError("Input tensor %d lacks data", tensor_index);
-          return kTfLiteError;
-        }
-      }
-    }
+    TF_LITE_ENSURE_STATUS(EnsureNodeInputsAreReadable(node, registration));
     // Allocate dynamic tensors which memory is required to be allocated
     // before executing the node.
     MayAllocateOpOutput(&node);
 
-    if (check_cancelled_func_ != nullptr &&
-        check_cancelled_func_(cancellation_data_)) {
-      ReportError("Client requested cancel during Invoke()");
-      return kTfLiteError;
-    }
-
-    if (continue_invocation_ && !continue_invocation_->test_and_set()) {
-      // `Cancel` is called and cancellation flag is flipped.
-      ReportError("Client requested cancel during Invoke()");
-      return kTfLiteCancelled;
-    }
+    TF_LITE_ENSURE_STATUS(CheckCancelled());
 
     EnsureTensorsVectorCapacity();
     tensor_resized_since_op_invoke_ = false;
@@ -1752,6 +2034,10 @@ TfLiteStatus Subgraph::ResizeTensor(TfLiteContext* context,
 }
 
 void Subgraph::ReportErrorImpl(const char* format, va_list args) {
+  // Nodes executed concurrently may report errors at the same time, to an
+  // error reporter that is usually shared by all subgraphs.
+  static std::mutex* report_error_mutex = new std::mutex;
+  std::lock_guard<std::mutex> lock(*report_error_mutex);
   error_reporter_->Report(format, args);
 }
 
@@ -2187,6 +2473,7 @@ void Subgraph::EnsureTensorsVectorCapacity() {
 TfLiteStatus Subgraph::EnsureMemoryAllocations() {
   if (memory_planner_) {
     state_ = kStateUninvokable;
+    ComputeParallelNodeGroups();
     TF_LITE_ENSURE_OK(&context_, memory_planner_->PlanAllocations());
   }
   TF_LITE_ENSURE_OK(&context_, AllocateTensors());
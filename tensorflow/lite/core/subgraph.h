@@ -33,9 +33,11 @@ limitations under the License.
 #include "tensorflow/lite/core/api/op_resolver.h"
 #include "tensorflow/lite/core/api/profiler.h"
 #include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/inter_op_thread_pool.h"
 #include "tensorflow/lite/core/macros.h"
 #include "tensorflow/lite/experimental/resource/initialization_status.h"
 #include "tensorflow/lite/experimental/resource/resource_base.h"
+#include "tensorflow/lite/external_cpu_backend_context.h"
 #include "tensorflow/lite/graph_info.h"
 #include "tensorflow/lite/interpreter_options.h"
 #include "tensorflow/lite/memory_planner.h"
@@ -44,7 +46,8 @@ limitations under the License.
 namespace tflite {
 
 #ifndef DOXYGEN_SKIP
-class SingleOpModel;  // Class for friend declarations.
+class InterpreterInfo;  // Class for friend declarations.
+class SingleOpModel;    // Class for friend declarations.
 
 namespace internal {
 class CommonOpaqueConversionUtil;  // Class for friend declarations.
@@ -72,6 +75,7 @@ class Subgraph {
 #ifndef DOXYGEN_SKIP
   friend class ::tflite::impl::Interpreter;
   friend class ::tflite::impl::SignatureRunner;
+  friend class InterpreterInfo;
   friend class SingleOpModel;
   friend class internal::CommonOpaqueConversionUtil;
 #endif  // DOXYGEN_SKIP
@@ -689,6 +693,46 @@ class Subgraph {
   // Does not report invoke status through profiler.
   TfLiteStatus InvokeImpl();
 
+  // Makes sure that the inputs of `node` can be read by its kernel.
+  TfLiteStatus EnsureNodeInputsAreReadable(
+      const TfLiteNode& node, const TfLiteRegistration& registration);
+
+  // Returns an error if the client requested to cancel the invocation.
+  TfLiteStatus CheckCancelled();
+
+  // True if `node` may be executed concurrently with the nodes it does not
+  // depend on.
+  bool IsParallelizableNode(const TfLiteNode& node,
+                            const TfLiteRegistration& registration) const;
+
+  // Reorders the execution plan by dependency level and groups the nodes of
+  // each level into `parallel_node_groups_`, if the options ask for inter-op
+  // parallelism and all the nodes are prepared. Must be called before the
+  // memory planner plans allocations, which keeps the tensors of the nodes of
+  // a group apart.
+  void ComputeParallelNodeGroups();
+
+  // True if the groups of `parallel_node_groups_` can be executed on the
+  // inter-op thread pool.
+  bool CanInvokeInParallel() const;
+
+  // Invokes each group of `parallel_node_groups_` in turn, executing the
+  // nodes of a group concurrently and sharing the intra-op threads among
+  // them.
+  TfLiteStatus InvokeInParallel();
+
+  // The part of InvokeInParallel() that executes the groups.
+  TfLiteStatus InvokeParallelNodeGroups();
+
+  // Creates the inter-op thread pool and the CPU backend contexts of its
+  // threads if `num_threads` changed, and splits the intra-op threads of the
+  // subgraph among them.
+  void ConfigureInterOpThreads(int num_threads);
+
+  // Sets the number of threads of the backends of the inter-op CPU backend
+  // contexts created since they were last configured.
+  void ConfigureInterOpCpuBackendContexts();
+
   // Allow a delegate to look at the graph and modify the graph to handle
   // parts of the graph themselves. After this is called, the graph may
   // contain new nodes that replace 1 more nodes.
@@ -1038,6 +1082,38 @@ class Subgraph {
 
   std::unique_ptr<MemoryPlanner> memory_planner_;
 
+  // For each node of `parallel_node_groups_plan_`, the first and last
+  // execution plan indices of the group of independent nodes containing it.
+  // Empty if nodes are executed one at a time.
+  std::vector<std::pair<int, int>> parallel_node_groups_;
+
+  // The execution plan `parallel_node_groups_` was computed for.
+  std::vector<int> parallel_node_groups_plan_;
+
+  // Threads executing the nodes of a group concurrently, created on the first
+  // invocation that uses them.
+  std::unique_ptr<InterOpThreadPool> inter_op_thread_pool_;
+
+  // The CPU backend context of each thread of `inter_op_thread_pool_`, the
+  // calling thread first. Owned by the subgraph, so that configuring them
+  // leaves the CPU backend context of the subgraph alone.
+  std::vector<std::unique_ptr<ExternalCpuBackendContext>>
+      inter_op_cpu_backend_contexts_;
+
+  // Whether the number of threads of the backend of each of
+  // `inter_op_cpu_backend_contexts_` has been set.
+  std::vector<bool> inter_op_cpu_backend_contexts_configured_;
+
+  // Whether the inter-op CPU backend contexts have been used since they were
+  // configured.
+  bool inter_op_cpu_backend_contexts_used_ = false;
+
+  // The `recommended_num_threads` the inter-op threads were configured for,
+  // and the number of threads of each op they execute, or -1 to let the
+  // backends decide.
+  int inter_op_recommended_num_threads_ = -1;
+  int inter_op_num_threads_per_op_ = -1;
+
   // Maps tensor index to custom allocation for all applicable tensors.
   std::map<int, TfLiteCustomAllocation> custom_allocations_;
 
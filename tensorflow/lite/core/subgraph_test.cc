@@ -26,6 +26,7 @@ limitations under the License.
 #include <gmock/gmock.h>
 #include <gtest/gtest.h>
 #include "tensorflow/lite/core/interpreter.h"
+#include "tensorflow/lite/interpreter_options.h"
 #include "tensorflow/lite/stderr_reporter.h"
 #include "tensorflow/lite/testing/util.h"
 #include "tensorflow/lite/util.h"
@@ -124,6 +125,90 @@ TEST(MarkSubgraphAsDelegationSkippable, MarkSubgraphAsDelegationSkippable) {
   ASSERT_TRUE(subgraphs[1]->IsDelegationSkippable());
 }
 
+int num_cpu_backend_context_refreshes = 0;
+
+TfLiteStatus CountCpuBackendContextRefresh(TfLiteContext* context) {
+  ++num_cpu_backend_context_refreshes;
+  return kTfLiteOk;
+}
+
+TEST(InterOpParallelism, InvokesIndependentNodesConcurrently) {
+  Interpreter interpreter;
+  InterpreterOptions options;
+  options.SetInterOpNumThreads(2);
+  ASSERT_EQ(interpreter.ApplyOptions(&options), kTfLiteOk);
+  auto& subgraph = interpreter.primary_subgraph();
+  subgraph.context()->recommended_num_threads = 4;
+  // Two independent chains, added one after the other: 0 -> 2 -> 4 and
+  // 1 -> 3 -> 5.
+  subgraph.AddTensors(6);
+  for (int i = 0; i < 6; ++i) {
+    subgraph.SetTensorParametersReadWrite(i, kTfLiteFloat32, "", {3}, {});
+  }
+  subgraph.SetInputs({0, 1});
+  subgraph.SetOutputs({4, 5});
+  TfLiteRegistration* neg_op = tflite::ops::builtin::Register_NEG();
+  subgraph.AddNodeWithParameters({0}, {2}, {}, nullptr, 0, nullptr, neg_op);
+  subgraph.AddNodeWithParameters({2}, {4}, {}, nullptr, 0, nullptr, neg_op);
+  subgraph.AddNodeWithParameters({1}, {3}, {}, nullptr, 0, nullptr, neg_op);
+  subgraph.AddNodeWithParameters({3}, {5}, {}, nullptr, 0, nullptr, neg_op);
+  ASSERT_EQ(subgraph.AllocateTensors(), kTfLiteOk);
+  // The plan is reordered by dependency level, so that the first nodes of
+  // both chains, then the second ones, are executed concurrently.
+  EXPECT_THAT(subgraph.execution_plan(), ElementsAreArray({0, 2, 1, 3}));
+  // A CPU backend context that may be shared with other interpreters.
+  TfLiteExternalContext shared_cpu_backend_context = {
+      kTfLiteCpuBackendContext, CountCpuBackendContextRefresh};
+  subgraph.SetExternalContext(kTfLiteCpuBackendContext,
+                              &shared_cpu_backend_context);
+  num_cpu_backend_context_refreshes = 0;
+
+  for (int run = 0; run < 3; ++run) {
+    for (int i = 0; i < 3; ++i) {
+      subgraph.tensor(0)->data.f[i] = run + i;
+      subgraph.tensor(1)->data.f[i] = -(run + i);
+    }
+    ASSERT_EQ(subgraph.Invoke(), kTfLiteOk);
+    for (int i = 0; i < 3; ++i) {
+      EXPECT_EQ(subgraph.tensor(4)->data.f[i], run + i);
+      EXPECT_EQ(subgraph.tensor(5)->data.f[i], -(run + i));
+    }
+  }
+  // The intermediate tensors of the first level are used at the same time,
+  // so they must not share memory.
+  EXPECT_NE(subgraph.tensor(2)->data.raw, subgraph.tensor(3)->data.raw);
+  // The intra-op threads are split in the contexts of the inter-op threads,
+  // not in the one of the subgraph.
+  EXPECT_EQ(subgraph.context()->recommended_num_threads, 4);
+  EXPECT_EQ(num_cpu_backend_context_refreshes, 0);
+}
+
+TEST(InterOpParallelism, KeepsStatefulNodesInPlace) {
+  Interpreter interpreter;
+  InterpreterOptions options;
+  options.SetInterOpNumThreads(2);
+  ASSERT_EQ(interpreter.ApplyOptions(&options), kTfLiteOk);
+  auto& subgraph = interpreter.primary_subgraph();
+  // 0 -> 1 -> 2 and 3 -> 4 -> 5, where the node reading the variable 6 is
+  // executed alone and stays between the two chains.
+  subgraph.AddTensors(8);
+  for (int i = 0; i < 8; ++i) {
+    subgraph.SetTensorParametersReadWrite(i, kTfLiteFloat32, "", {3}, {},
+                                          /*is_variable=*/i == 6);
+  }
+  subgraph.SetInputs({0, 3});
+  subgraph.SetOutputs({2, 5, 7});
+  TfLiteRegistration* neg_op = tflite::ops::builtin::Register_NEG();
+  subgraph.AddNodeWithParameters({0}, {1}, {}, nullptr, 0, nullptr, neg_op);
+  subgraph.AddNodeWithParameters({1}, {2}, {}, nullptr, 0, nullptr, neg_op);
+  subgraph.AddNodeWithParameters({6}, {7}, {}, nullptr, 0, nullptr, neg_op);
+  subgraph.AddNodeWithParameters({3}, {4}, {}, nullptr, 0, nullptr, neg_op);
+  subgraph.AddNodeWithParameters({4}, {5}, {}, nullptr, 0, nullptr, neg_op);
+  ASSERT_EQ(subgraph.AllocateTensors(), kTfLiteOk);
+  EXPECT_THAT(subgraph.execution_plan(), ElementsAreArray({0, 1, 2, 3, 4}));
+  ASSERT_EQ(subgraph.Invoke(), kTfLiteOk);
+}
+
 // Helper to get the minimal buffer size to allocate for a buffer of given
 // shape.
 size_t BytesFor(const TfLiteType type, const int* const data,
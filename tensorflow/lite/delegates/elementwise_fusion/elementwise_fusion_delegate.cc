@@ -0,0 +1,463 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/delegates/elementwise_fusion/elementwise_fusion_delegate.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/lite/builtin_ops.h"
+#include "tensorflow/lite/context_util.h"
+#include "tensorflow/lite/core/c/builtin_op_data.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/delegates/utils/simple_delegate.h"
+#include "tensorflow/lite/kernels/internal/optimized/optimized_ops.h"
+#include "tensorflow/lite/kernels/internal/tensor_ctypes.h"
+#include "tensorflow/lite/kernels/internal/types.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+
+namespace tflite {
+namespace elementwise_fusion {
+namespace {
+
+// Number of elements the whole chain is applied to at a time. The tiles of
+// the intermediate tensors of a chain then stay in the L1 cache.
+constexpr int kTileSize = 1024;
+
+bool IsBinaryOp(int builtin_code) {
+  switch (builtin_code) {
+    case kTfLiteBuiltinAdd:
+    case kTfLiteBuiltinSub:
+    case kTfLiteBuiltinMul:
+    case kTfLiteBuiltinDiv:
+    case kTfLiteBuiltinMaximum:
+    case kTfLiteBuiltinMinimum:
+      return true;
+    default:
+      return false;
+  }
+}
+
+bool IsUnaryOp(int builtin_code) {
+  switch (builtin_code) {
+    case kTfLiteBuiltinAbs:
+    case kTfLiteBuiltinNeg:
+    case kTfLiteBuiltinSquare:
+    case kTfLiteBuiltinRelu:
+    case kTfLiteBuiltinRelu6:
+    case kTfLiteBuiltinReluN1To1:
+    case kTfLiteBuiltinLogistic:
+    case kTfLiteBuiltinTanh:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// Returns the activation fused into the node, which must be a supported
+// binary op.
+TfLiteFusedActivation GetFusedActivation(int builtin_code,
+                                         const TfLiteNode* node) {
+  if (node->builtin_data == nullptr) return kTfLiteActNone;
+  switch (builtin_code) {
+    case kTfLiteBuiltinAdd:
+      return static_cast<const TfLiteAddParams*>(node->builtin_data)
+          ->activation;
+    case kTfLiteBuiltinSub:
+      return static_cast<const TfLiteSubParams*>(node->builtin_data)
+          ->activation;
+    case kTfLiteBuiltinMul:
+      return static_cast<const TfLiteMulParams*>(node->builtin_data)
+          ->activation;
+    case kTfLiteBuiltinDiv:
+      return static_cast<const TfLiteDivParams*>(node->builtin_data)
+          ->activation;
+    default:
+      return kTfLiteActNone;
+  }
+}
+
+// True if `input` can be an operand of an op producing `output`: it has the
+// shape of the output, or it is a constant scalar broadcast to it.
+bool IsSupportedOperand(const TfLiteTensor& input, const TfLiteTensor& output) {
+  if (input.type != kTfLiteFloat32) return false;
+  if (TfLiteIntArrayEqual(input.dims, output.dims)) return true;
+  return IsConstantTensor(&input) && NumElements(&input) == 1 &&
+         input.dims->size <= output.dims->size;
+}
+
+// One of the fused ops.
+struct FusedOp {
+  int builtin_code;
+  std::vector<int> inputs;
+  int output;
+  // Index in `inputs` of the operand whose shape is the shape of the output.
+  int shape_input;
+  // Range the result is clamped to.
+  float output_min;
+  float output_max;
+};
+
+// Fused ops that apply to the same number of elements, and can therefore be
+// applied tile by tile.
+struct OpGroup {
+  int64_t num_elements;
+  std::vector<int> ops;
+};
+
+// Clamps `fn` applied to each pair of elements of the tiles `a` and `b`,
+// either of which may be a scalar.
+template <typename Fn>
+void ApplyBinary(const float* a, bool a_is_scalar, const float* b,
+                 bool b_is_scalar, int size, float output_min,
+                 float output_max, float* output, Fn fn) {
+  if (a_is_scalar) {
+    const float a_value = *a;
+    for (int i = 0; i < size; ++i) {
+      output[i] =
+          std::min(std::max(fn(a_value, b[i]), output_min), output_max);
+    }
+  } else if (b_is_scalar) {
+    const float b_value = *b;
+    for (int i = 0; i < size; ++i) {
+      output[i] =
+          std::min(std::max(fn(a[i], b_value), output_min), output_max);
+    }
+  } else {
+    for (int i = 0; i < size; ++i) {
+      output[i] = std::min(std::max(fn(a[i], b[i]), output_min), output_max);
+    }
+  }
+}
+
+template <typename Fn>
+void ApplyUnary(const float* input, int size, float* output, Fn fn) {
+  for (int i = 0; i < size; ++i) {
+    output[i] = fn(input[i]);
+  }
+}
+
+// Applies a chain of fused elementwise ops tile by tile.
+class ElementwiseFusionKernel : public SimpleDelegateKernelInterface {
+ public:
+  TfLiteStatus Init(TfLiteContext* context,
+                    const TfLiteDelegateParams* params) override {
+    std::vector<bool> is_partition_output(context->tensors_size, false);
+    for (int tensor_index : TfLiteIntArrayView(params->output_tensors)) {
+      is_partition_output[tensor_index] = true;
+    }
+    std::vector<bool> is_produced(context->tensors_size, false);
+    for (int node_index : TfLiteIntArrayView(params->nodes_to_replace)) {
+      TfLiteNode* node = nullptr;
+      TfLiteRegistration* registration = nullptr;
+      TF_LITE_ENSURE_STATUS(context->GetNodeAndRegistration(
+          context, node_index, &node, &registration));
+      FusedOp op;
+      op.builtin_code = registration->builtin_code;
+      op.inputs.assign(node->inputs->data,
+                       node->inputs->data + node->inputs->size);
+      op.output = node->outputs->data[0];
+      op.shape_input = 0;
+      const TfLiteTensor& output = context->tensors[op.output];
+      for (int i = 0; i < static_cast<int>(op.inputs.size()); ++i) {
+        const TfLiteTensor& input = context->tensors[op.inputs[i]];
+        if (TfLiteIntArrayEqual(input.dims, output.dims) &&
+            !IsConstantTensor(&input)) {
+          op.shape_input = i;
+          break;
+        }
+      }
+      switch (op.builtin_code) {
+        case kTfLiteBuiltinRelu:
+          op.output_min = 0;
+          op.output_max = std::numeric_limits<float>::infinity();
+          break;
+        case kTfLiteBuiltinRelu6:
+          op.output_min = 0;
+          op.output_max = 6;
+          break;
+        case kTfLiteBuiltinReluN1To1:
+          op.output_min = -1;
+          op.output_max = 1;
+          break;
+        default:
+          CalculateActivationRange(
+              GetFusedActivation(op.builtin_code, node), &op.output_min,
+              &op.output_max);
+      }
+      is_produced[op.output] = true;
+      ops_.push_back(std::move(op));
+    }
+
+    // Intermediate tensors only live in a tile of the scratch buffer.
+    scratch_slots_.assign(context->tensors_size, -1);
+    int num_slots = 0;
+    for (const FusedOp& op : ops_) {
+      if (is_produced[op.output] && !is_partition_output[op.output]) {
+        scratch_slots_[op.output] = num_slots++;
+      }
+    }
+    scratch_.resize(static_cast<size_t>(num_slots) * kTileSize);
+    return kTfLiteOk;
+  }
+
+  TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) override {
+    // Propagates the shapes through the chain, as the replaced ops would.
+    std::map<int64_t, int> group_by_num_elements;
+    groups_.clear();
+    for (int i = 0; i < static_cast<int>(ops_.size()); ++i) {
+      const FusedOp& op = ops_[i];
+      const TfLiteTensor& shape_input =
+          context->tensors[op.inputs[op.shape_input]];
+      TfLiteTensor& output = context->tensors[op.output];
+      if (!TfLiteIntArrayEqual(shape_input.dims, output.dims)) {
+        TF_LITE_ENSURE_STATUS(context->ResizeTensor(
+            context, &output, TfLiteIntArrayCopy(shape_input.dims)));
+      }
+      for (int input_index : op.inputs) {
+        TF_LITE_ENSURE(context, IsSupportedOperand(
+                                    context->tensors[input_index], output));
+      }
+
+      const int64_t num_elements = NumElements(&output);
+      auto group = group_by_num_elements.find(num_elements);
+      if (group == group_by_num_elements.end()) {
+        group = group_by_num_elements.emplace(num_elements, groups_.size())
+                    .first;
+        groups_.push_back({num_elements, {}});
+      }
+      groups_[group->second].ops.push_back(i);
+    }
+    return kTfLiteOk;
+  }
+
+  TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) override {
+    // Only constant scalars are broadcast, so ops only consume the results of
+    // ops of the same group: each group can be applied on its own.
+    for (const OpGroup& group : groups_) {
+      for (int64_t start = 0; start < group.num_elements; start += kTileSize) {
+        const int size = static_cast<int>(
+            std::min<int64_t>(kTileSize, group.num_elements - start));
+        for (int op_index : group.ops) {
+          TF_LITE_ENSURE_STATUS(
+              EvalTile(context, ops_[op_index], group.num_elements, start,
+                       size));
+        }
+      }
+    }
+    return kTfLiteOk;
+  }
+
+ private:
+  // Returns the tile of `tensor_index` starting at `start`, or its only
+  // element if it is broadcast.
+  float* GetTile(TfLiteContext* context, int tensor_index, int64_t start,
+                 bool is_scalar) {
+    const int slot = scratch_slots_[tensor_index];
+    if (slot >= 0) return scratch_.data() + slot * kTileSize;
+    float* data = GetTensorData<float>(&context->tensors[tensor_index]);
+    return is_scalar ? data : data + start;
+  }
+
+  TfLiteStatus EvalTile(TfLiteContext* context, const FusedOp& op,
+                        int64_t num_elements, int64_t start, int size) {
+    float* output = GetTile(context, op.output, start, /*is_scalar=*/false);
+    const TfLiteTensor& input0_tensor = context->tensors[op.inputs[0]];
+    const bool input0_is_scalar =
+        num_elements > 1 && NumElements(&input0_tensor) == 1;
+    const float* input0 =
+        GetTile(context, op.inputs[0], start, input0_is_scalar);
+    if (IsUnaryOp(op.builtin_code)) {
+      const RuntimeShape shape({size});
+      switch (op.builtin_code) {
+        case kTfLiteBuiltinAbs:
+          ApplyUnary(input0, size, output,
+                     [](float x) { return std::abs(x); });
+          break;
+        case kTfLiteBuiltinNeg:
+          ApplyUnary(input0, size, output, [](float x) { return -x; });
+          break;
+        case kTfLiteBuiltinSquare:
+          ApplyUnary(input0, size, output, [](float x) { return x * x; });
+          break;
+        case kTfLiteBuiltinRelu:
+        case kTfLiteBuiltinRelu6:
+        case kTfLiteBuiltinReluN1To1: {
+          const float output_min = op.output_min;
+          const float output_max = op.output_max;
+          ApplyUnary(input0, size, output, [=](float x) {
+            return std::min(std::max(x, output_min), output_max);
+          });
+          break;
+        }
+        case kTfLiteBuiltinLogistic:
+          optimized_ops::Logistic(shape, input0, shape, output);
+          break;
+        case kTfLiteBuiltinTanh:
+          optimized_ops::Tanh(shape, input0, shape, output);
+          break;
+        default:
+          return kTfLiteError;
+      }
+      return kTfLiteOk;
+    }
+
+    const TfLiteTensor& input1_tensor = context->tensors[op.inputs[1]];
+    const bool input1_is_scalar =
+        num_elements > 1 && NumElements(&input1_tensor) == 1;
+    const float* input1 =
+        GetTile(context, op.inputs[1], start, input1_is_scalar);
+    switch (op.builtin_code) {
+      case kTfLiteBuiltinAdd:
+        ApplyBinary(input0, input0_is_scalar, input1, input1_is_scalar, size,
+                    op.output_min, op.output_max, output,
+                    [](float a, float b) { return a + b; });
+        break;
+      case kTfLiteBuiltinSub:
+        ApplyBinary(input0, input0_is_scalar, input1, input1_is_scalar, size,
+                    op.output_min, op.output_max, output,
+                    [](float a, float b) { return a - b; });
+        break;
+      case kTfLiteBuiltinMul:
+        ApplyBinary(input0, input0_is_scalar, input1, input1_is_scalar, size,
+                    op.output_min, op.output_max, output,
+                    [](float a, float b) { return a * b; });
+        break;
+      case kTfLiteBuiltinDiv:
+        ApplyBinary(input0, input0_is_scalar, input1, input1_is_scalar, size,
+                    op.output_min, op.output_max, output,
+                    [](float a, float b) { return a / b; });
+        break;
+      case kTfLiteBuiltinMaximum:
+        ApplyBinary(input0, input0_is_scalar, input1, input1_is_scalar, size,
+                    op.output_min, op.output_max, output,
+                    [](float a, float b) { return std::max(a, b); });
+        break;
+      case kTfLiteBuiltinMinimum:
+        ApplyBinary(input0, input0_is_scalar, input1, input1_is_scalar, size,
+                    op.output_min, op.output_max, output,
+                    [](float a, float b) { return std::min(a, b); });
+        break;
+      default:
+        return kTfLiteError;
+    }
+    return kTfLiteOk;
+  }
+
+  std::vector<FusedOp> ops_;
+  std::vector<OpGroup> groups_;
+  // For each tensor, its slot in `scratch_` if it is an intermediate tensor
+  // of the chain, or -1.
+  std::vector<int> scratch_slots_;
+  std::vector<float> scratch_;
+};
+
+class ElementwiseFusionDelegate : public SimpleDelegateInterface {
+ public:
+  explicit ElementwiseFusionDelegate(
+      const TfLiteElementwiseFusionDelegateOptions& options)
+      : options_(options) {}
+
+  bool IsNodeSupportedByDelegate(const TfLiteRegistration* registration,
+                                 const TfLiteNode* node,
+                                 TfLiteContext* context) const override {
+    const int builtin_code = registration->builtin_code;
+    int num_inputs;
+    if (IsUnaryOp(builtin_code)) {
+      num_inputs = 1;
+    } else if (IsBinaryOp(builtin_code)) {
+      num_inputs = 2;
+      switch (GetFusedActivation(builtin_code, node)) {
+        case kTfLiteActNone:
+        case kTfLiteActRelu:
+        case kTfLiteActReluN1To1:
+        case kTfLiteActRelu6:
+          break;
+        default:
+          return false;
+      }
+    } else {
+      return false;
+    }
+    if (node->inputs->size != num_inputs || node->outputs->size != 1) {
+      return false;
+    }
+
+    const TfLiteTensor& output = context->tensors[node->outputs->data[0]];
+    if (output.type != kTfLiteFloat32 || output.is_variable ||
+        IsDynamicTensor(&output)) {
+      return false;
+    }
+    bool has_shape_input = false;
+    for (int input_index : TfLiteIntArrayView(node->inputs)) {
+      if (input_index == kTfLiteOptionalTensor) return false;
+      const TfLiteTensor& input = context->tensors[input_index];
+      if (!IsSupportedOperand(input, output)) return false;
+      has_shape_input |= TfLiteIntArrayEqual(input.dims, output.dims);
+    }
+    return has_shape_input;
+  }
+
+  TfLiteStatus Initialize(TfLiteContext* context) override { return kTfLiteOk; }
+
+  const char* Name() const override {
+    static constexpr char kName[] = "ElementwiseFusionDelegate";
+    return kName;
+  }
+
+  std::unique_ptr<SimpleDelegateKernelInterface> CreateDelegateKernelInterface()
+      override {
+    return std::make_unique<ElementwiseFusionKernel>();
+  }
+
+  SimpleDelegateInterface::Options DelegateOptions() const override {
+    SimpleDelegateInterface::Options options;
+    options.min_nodes_per_partition = options_.min_nodes_per_partition;
+    return options;
+  }
+
+ private:
+  const TfLiteElementwiseFusionDelegateOptions options_;
+};
+
+}  // namespace
+}  // namespace elementwise_fusion
+}  // namespace tflite
+
+TfLiteElementwiseFusionDelegateOptions
+TfLiteElementwiseFusionDelegateOptionsDefault() {
+  TfLiteElementwiseFusionDelegateOptions options = {0};
+  options.min_nodes_per_partition = 2;
+  return options;
+}
+
+TfLiteDelegate* TfLiteElementwiseFusionDelegateCreate(
+    const TfLiteElementwiseFusionDelegateOptions* options) {
+  std::unique_ptr<tflite::elementwise_fusion::ElementwiseFusionDelegate>
+      delegate(new tflite::elementwise_fusion::ElementwiseFusionDelegate(
+          options ? *options
+                  : TfLiteElementwiseFusionDelegateOptionsDefault()));
+  return tflite::TfLiteDelegateFactory::CreateSimpleDelegate(
+      std::move(delegate));
+}
+
+void TfLiteElementwiseFusionDelegateDelete(TfLiteDelegate* delegate) {
+  tflite::TfLiteDelegateFactory::DeleteSimpleDelegate(delegate);
+}
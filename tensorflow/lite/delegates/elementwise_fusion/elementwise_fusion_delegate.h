@@ -0,0 +1,66 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_DELEGATES_ELEMENTWISE_FUSION_ELEMENTWISE_FUSION_DELEGATE_H_
+#define TENSORFLOW_LITE_DELEGATES_ELEMENTWISE_FUSION_ELEMENTWISE_FUSION_DELEGATE_H_
+
+#include <memory>
+
+#include "tensorflow/lite/core/c/common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+// A delegate that fuses chains of float32 elementwise builtin ops (ADD, SUB,
+// MUL, DIV, MAXIMUM, MINIMUM, ABS, NEG, SQUARE, RELU, RELU6, RELU_N1_TO_1,
+// LOGISTIC and TANH) into a single kernel. The kernel applies the whole chain
+// to one cache-sized tile of the tensors at a time, so that the intermediate
+// tensors of the chain are never written to the arena.
+//
+// Operands must have the shape of the output, except for constant scalars.
+typedef struct {
+  // The minimum number of ops fused into a single kernel. Values <= 1 also
+  // replace isolated ops, which brings no benefit.
+  int min_nodes_per_partition;
+} TfLiteElementwiseFusionDelegateOptions;
+
+// Returns a structure with the default delegate options.
+TfLiteElementwiseFusionDelegateOptions
+TfLiteElementwiseFusionDelegateOptionsDefault();
+
+// Creates a new delegate instance that needs to be destroyed with
+// `TfLiteElementwiseFusionDelegateDelete` when delegate is no longer used by
+// TFLite. When `options` is set to `nullptr`, the default values are used.
+TfLiteDelegate* TfLiteElementwiseFusionDelegateCreate(
+    const TfLiteElementwiseFusionDelegateOptions* options);
+
+// Destroys a delegate created with `TfLiteElementwiseFusionDelegateCreate`.
+void TfLiteElementwiseFusionDelegateDelete(TfLiteDelegate* delegate);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+// A convenient wrapper that returns C++ std::unique_ptr for automatic memory
+// management.
+inline std::unique_ptr<TfLiteDelegate, void (*)(TfLiteDelegate*)>
+TfLiteElementwiseFusionDelegateCreateUnique(
+    const TfLiteElementwiseFusionDelegateOptions* options) {
+  return std::unique_ptr<TfLiteDelegate, void (*)(TfLiteDelegate*)>(
+      TfLiteElementwiseFusionDelegateCreate(options),
+      TfLiteElementwiseFusionDelegateDelete);
+}
+
+#endif  // TENSORFLOW_LITE_DELEGATES_ELEMENTWISE_FUSION_ELEMENTWISE_FUSION_DELEGATE_H_
@@ -0,0 +1,145 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/delegates/elementwise_fusion/elementwise_fusion_delegate.h"
+
+#include <cmath>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/lite/builtin_ops.h"
+#include "tensorflow/lite/core/c/builtin_op_data.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/kernels/builtin_op_kernels.h"
+#include "tensorflow/lite/interpreter.h"
+
+namespace tflite {
+namespace {
+
+// Spans several tiles of the fused kernel, the last one partial.
+constexpr int kNumElements = 2500;
+
+// Builds
+//   t2 = relu(t0 + t1)
+//   t4 = t2 * t3, with t3 a constant scalar
+//   t5 = tanh(t4)
+// where t5, and optionally t2, are graph outputs.
+class ElementwiseFusionDelegateTest : public ::testing::Test {
+ protected:
+  void BuildGraph(Interpreter* interpreter, bool intermediate_is_output) {
+    const std::vector<int> dims = {1, kNumElements};
+    TfLiteQuantizationParams quant;
+    interpreter->AddTensors(6);
+    interpreter->SetInputs({0, 1});
+    if (intermediate_is_output) {
+      interpreter->SetOutputs({5, 2});
+    } else {
+      interpreter->SetOutputs({5});
+    }
+    for (int tensor : {0, 1, 2, 4, 5}) {
+      interpreter->SetTensorParametersReadWrite(tensor, kTfLiteFloat32, "",
+                                                dims, quant);
+    }
+    interpreter->SetTensorParametersReadOnly(
+        3, kTfLiteFloat32, "", {}, quant,
+        reinterpret_cast<const char*>(&scale_), sizeof(scale_));
+
+    auto* add_params =
+        static_cast<TfLiteAddParams*>(malloc(sizeof(TfLiteAddParams)));
+    *add_params = {};
+    add_params->activation = kTfLiteActRelu;
+    interpreter->AddNodeWithParameters({0, 1}, {2}, nullptr, 0, add_params,
+                                       ops::builtin::Register_ADD());
+    auto* mul_params =
+        static_cast<TfLiteMulParams*>(malloc(sizeof(TfLiteMulParams)));
+    *mul_params = {};
+    mul_params->activation = kTfLiteActNone;
+    interpreter->AddNodeWithParameters({2, 3}, {4}, nullptr, 0, mul_params,
+                                       ops::builtin::Register_MUL());
+    interpreter->AddNodeWithParameters({4}, {5}, nullptr, 0, nullptr,
+                                       ops::builtin::Register_TANH());
+  }
+
+  // Runs the graph, with or without the delegate, and returns its outputs.
+  std::vector<std::vector<float>> Run(bool delegate,
+                                      bool intermediate_is_output) {
+    Interpreter interpreter;
+    BuildGraph(&interpreter, intermediate_is_output);
+    if (delegate) {
+      EXPECT_EQ(interpreter.ModifyGraphWithDelegate(
+                    TfLiteElementwiseFusionDelegateCreateUnique(nullptr)),
+                kTfLiteOk);
+      EXPECT_EQ(interpreter.execution_plan().size(), 1);
+      const auto* node_and_reg =
+          interpreter.node_and_registration(interpreter.execution_plan()[0]);
+      EXPECT_STREQ("ElementwiseFusionDelegate",
+                   node_and_reg->second.custom_name);
+    }
+    EXPECT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+    float* input0 = interpreter.typed_input_tensor<float>(0);
+    float* input1 = interpreter.typed_input_tensor<float>(1);
+    for (int i = 0; i < kNumElements; ++i) {
+      input0[i] = std::sin(0.01f * i);
+      input1[i] = std::cos(0.02f * i) - 0.5f;
+    }
+    EXPECT_EQ(interpreter.Invoke(), kTfLiteOk);
+    std::vector<std::vector<float>> outputs;
+    for (int i = 0; i < interpreter.outputs().size(); ++i) {
+      const float* output = interpreter.typed_output_tensor<float>(i);
+      outputs.emplace_back(output, output + kNumElements);
+    }
+    return outputs;
+  }
+
+  void ExpectSameOutputs(bool intermediate_is_output) {
+    const auto expected = Run(/*delegate=*/false, intermediate_is_output);
+    const auto actual = Run(/*delegate=*/true, intermediate_is_output);
+    ASSERT_EQ(actual.size(), expected.size());
+    for (int i = 0; i < expected.size(); ++i) {
+      ASSERT_EQ(actual[i].size(), expected[i].size());
+      for (int j = 0; j < expected[i].size(); ++j) {
+        EXPECT_NEAR(actual[i][j], expected[i][j], 1e-5)
+            << "output " << i << ", element " << j;
+      }
+    }
+  }
+
+  const float scale_ = 1.5f;
+};
+
+TEST_F(ElementwiseFusionDelegateTest, FusesChain) {
+  ExpectSameOutputs(/*intermediate_is_output=*/false);
+}
+
+TEST_F(ElementwiseFusionDelegateTest, FusesChainWithIntermediateOutput) {
+  ExpectSameOutputs(/*intermediate_is_output=*/true);
+}
+
+TEST_F(ElementwiseFusionDelegateTest, SkipsPartitionsBelowMinimumSize) {
+  Interpreter interpreter;
+  BuildGraph(&interpreter, /*intermediate_is_output=*/false);
+  TfLiteElementwiseFusionDelegateOptions options =
+      TfLiteElementwiseFusionDelegateOptionsDefault();
+  options.min_nodes_per_partition = 4;
+  ASSERT_EQ(interpreter.ModifyGraphWithDelegate(
+                TfLiteElementwiseFusionDelegateCreateUnique(&options)),
+            kTfLiteOk);
+  EXPECT_EQ(interpreter.execution_plan().size(), 3);
+}
+
+}  // namespace
+}  // namespace tflite
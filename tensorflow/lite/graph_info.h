@@ -70,6 +70,14 @@ class GraphInfo {
 
   // Returns the indices of the variable tensors.
   virtual const std::vector<int>& variables() const = 0;
+
+  // Returns the first and last execution-plan indices of the group of nodes
+  // that may be executed concurrently with the node at execution-plan index
+  // `index`. The tensors used by any node of a group must stay allocated while
+  // the whole group executes. By default, nodes are executed one at a time.
+  virtual std::pair<size_t, size_t> parallel_node_group(size_t index) const {
+    return {index, index};
+  }
 };
 
 // Represents a subset of nodes in a TensorFlow Lite graph.
@@ -29,7 +29,8 @@ class InterpreterOptions {
       : experimental_preserve_all_tensors_(false),
         experimental_ensure_dynamic_tensors_are_released_(false),
         experimental_optimize_memory_for_large_tensors_(0),
-        experimental_disable_delegate_clustering_(false) {}
+        experimental_disable_delegate_clustering_(false),
+        experimental_inter_op_num_threads_(1) {}
 
   /// Preserving all intermediates tensors for debugging.
   /// WARNING: This is an experimental API and subject to change.
@@ -93,11 +94,33 @@ class InterpreterOptions {
     experimental_disable_delegate_clustering_ = value;
   }
 
+  /// Executes independent nodes of each subgraph concurrently on up to
+  /// `value` threads, including the one calling `Invoke`. The threads set by
+  /// `SetNumThreads` are split among the nodes running at the same time. Only
+  /// nodes that are not delegated, do not use variables or resources and do
+  /// not invoke other subgraphs are executed concurrently, and only when the
+  /// subgraph has no dynamic tensors and no profiler is installed. This is
+  /// useful for models with several independent branches, such as
+  /// multi-tower models. `AllocateTensors` reorders the execution plan by
+  /// dependency level, and the memory planner keeps the tensors of nodes that
+  /// may run concurrently apart, so the arena may grow. Must be set before
+  /// `AllocateTensors`.
+  /// WARNING: This is an experimental API and subject to change.
+  void SetInterOpNumThreads(int value) {
+    experimental_inter_op_num_threads_ = value;
+  }
+
+  /// Returns the number of threads used to execute independent nodes
+  /// concurrently. 1 (the default) executes nodes one at a time.
+  /// WARNING: This is an experimental API and subject to change.
+  int GetInterOpNumThreads() { return experimental_inter_op_num_threads_; }
+
  private:
   bool experimental_preserve_all_tensors_;
   bool experimental_ensure_dynamic_tensors_are_released_;
   int experimental_optimize_memory_for_large_tensors_;
   bool experimental_disable_delegate_clustering_;
+  int experimental_inter_op_num_threads_;
 };
 
 }  // namespace tflite
@@ -0,0 +1,138 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/interpreter_pool.h"
+
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <utility>
+
+#include "tensorflow/lite/core/api/error_reporter.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/interpreter_builder.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+
+namespace tflite {
+
+InterpreterPool::InterpreterPool(const FlatBufferModel& model,
+                                 const OpResolver& op_resolver,
+                                 const Options& options)
+    : model_(model),
+      op_resolver_(op_resolver),
+      options_(options),
+      weights_cache_(nullptr, TfLiteXNNPackDelegateWeightsCacheDelete) {}
+
+std::unique_ptr<InterpreterPool> InterpreterPool::Create(
+    const FlatBufferModel& model, const OpResolver& op_resolver,
+    const Options& options) {
+  std::unique_ptr<InterpreterPool> pool(
+      new InterpreterPool(model, op_resolver, options));
+  if (options.use_xnnpack) {
+    pool->weights_cache_.reset(TfLiteXNNPackDelegateWeightsCacheCreate());
+    if (pool->weights_cache_ == nullptr) {
+      TF_LITE_REPORT_ERROR(model.error_reporter(),
+                           "Failed to create the XNNPACK weights cache.");
+      return nullptr;
+    }
+  }
+
+  // The first interpreter packs the weights into the cache, which has to be
+  // finalized before any interpreter runs. Soft finalization lets the later
+  // interpreters look the packed weights up.
+  std::unique_ptr<Interpreter> interpreter = pool->NewInterpreter();
+  if (interpreter == nullptr) return nullptr;
+  if (pool->weights_cache_ != nullptr &&
+      !TfLiteXNNPackDelegateWeightsCacheFinalizeSoft(
+          pool->weights_cache_.get())) {
+    TF_LITE_REPORT_ERROR(model.error_reporter(),
+                         "Failed to finalize the XNNPACK weights cache.");
+    return nullptr;
+  }
+  if (interpreter->AllocateTensors() != kTfLiteOk) return nullptr;
+  pool->idle_interpreters_.push_back(std::move(interpreter));
+
+  for (int i = 1; i < options.num_initial_interpreters; ++i) {
+    interpreter = pool->NewInterpreter();
+    if (interpreter == nullptr ||
+        interpreter->AllocateTensors() != kTfLiteOk) {
+      return nullptr;
+    }
+    pool->idle_interpreters_.push_back(std::move(interpreter));
+  }
+  return pool;
+}
+
+std::unique_ptr<Interpreter> InterpreterPool::NewInterpreter() {
+  std::unique_ptr<Interpreter> interpreter;
+  InterpreterBuilder builder(model_, op_resolver_);
+  if (builder.SetNumThreads(options_.num_threads) != kTfLiteOk ||
+      builder(&interpreter) != kTfLiteOk) {
+    return nullptr;
+  }
+  if (weights_cache_ != nullptr) {
+    TfLiteXNNPackDelegateOptions delegate_options =
+        TfLiteXNNPackDelegateOptionsDefault();
+    delegate_options.num_threads = options_.num_threads;
+    delegate_options.weights_cache = weights_cache_.get();
+    Interpreter::TfLiteDelegatePtr delegate(
+        TfLiteXNNPackDelegateCreate(&delegate_options),
+        TfLiteXNNPackDelegateDelete);
+    // Other failures leave the graph as it was, to run without XNNPACK.
+    if (interpreter->ModifyGraphWithDelegate(std::move(delegate)) ==
+        kTfLiteError) {
+      return nullptr;
+    }
+  }
+  return interpreter;
+}
+
+InterpreterPool::InterpreterPtr InterpreterPool::Acquire() {
+  std::unique_ptr<Interpreter> interpreter;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!idle_interpreters_.empty()) {
+      interpreter = std::move(idle_interpreters_.back());
+      idle_interpreters_.pop_back();
+    }
+  }
+  if (interpreter == nullptr) {
+    // Built outside of the lock, so that requests which find an idle
+    // interpreter do not wait for it.
+    interpreter = NewInterpreter();
+    if (interpreter == nullptr ||
+        interpreter->AllocateTensors() != kTfLiteOk) {
+      return InterpreterPtr(nullptr, [](Interpreter*) {});
+    }
+  }
+  return InterpreterPtr(interpreter.release(),
+                        [this](Interpreter* interpreter) {
+                          Release(interpreter);
+                        });
+}
+
+void InterpreterPool::Release(Interpreter* interpreter) {
+  std::unique_ptr<Interpreter> owned_interpreter(interpreter);
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (static_cast<int>(idle_interpreters_.size()) <
+      options_.max_idle_interpreters) {
+    idle_interpreters_.push_back(std::move(owned_interpreter));
+  }
+}
+
+int InterpreterPool::num_idle_interpreters() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return idle_interpreters_.size();
+}
+
+}  // namespace tflite
@@ -0,0 +1,128 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+/// \file
+///
+/// Runs concurrent requests over one model.
+///
+#ifndef TENSORFLOW_LITE_INTERPRETER_POOL_H_
+#define TENSORFLOW_LITE_INTERPRETER_POOL_H_
+
+#include <functional>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <vector>
+
+#include "tensorflow/lite/core/api/op_resolver.h"
+#include "tensorflow/lite/core/interpreter.h"
+#include "tensorflow/lite/core/model_builder.h"
+#include "tensorflow/lite/delegates/xnnpack/xnnpack_delegate.h"
+
+namespace tflite {
+
+/// A pool of interpreters of one model, for serving concurrent requests.
+///
+/// An `Interpreter` can only run one request at a time, so concurrent requests
+/// need one interpreter each. The interpreters of a pool share the read-only
+/// state of the model: its flatbuffer and constant tensors, and the weights
+/// packed by the XNNPACK delegate, which are kept in one weights cache. Each
+/// interpreter then only owns its activations and the per-op state of the
+/// kernels that are not delegated.
+///
+/// Released interpreters are kept and handed out again, so that acquiring an
+/// interpreter once the pool has warmed up costs no more than a lock.
+///
+/// The pool does not share a compiled model between its interpreters: the
+/// execution plan, the prepared state of the kernels, the memory plan and the
+/// XNNPACK runtime are still built for each interpreter. Only reuse amortizes
+/// them, so `Acquire` is cheap only while an idle interpreter is available; a
+/// cold `Acquire` builds, delegates and allocates a whole interpreter, and
+/// only skips packing the weights for XNNPACK. Size the pool for the expected concurrency
+/// with `Options::num_initial_interpreters` and
+/// `Options::max_idle_interpreters` to keep such builds off the request path.
+///
+/// The model and the op resolver must outlive the pool, and the pool must
+/// outlive the interpreters acquired from it. All methods are thread-safe.
+///
+/// WARNING: This is an experimental API and subject to change.
+class InterpreterPool {
+ public:
+  struct Options {
+    /// Number of threads used by each interpreter. -1 lets TFLite decide.
+    int num_threads = 1;
+    /// Whether to apply the XNNPACK delegate, with packed weights shared by
+    /// all the interpreters. The op resolver should not apply XNNPACK by
+    /// default as well, see `BuiltinOpResolverWithoutDefaultDelegates`.
+    bool use_xnnpack = true;
+    /// Maximum number of released interpreters kept for reuse. Interpreters
+    /// released when the pool already holds that many are destroyed.
+    int max_idle_interpreters = 8;
+    /// Number of interpreters built by `Create`, at least one, so that that
+    /// many concurrent requests do not build interpreters.
+    int num_initial_interpreters = 1;
+  };
+
+  /// An interpreter acquired from the pool. Destroying it returns the
+  /// interpreter to the pool.
+  using InterpreterPtr =
+      std::unique_ptr<Interpreter, std::function<void(Interpreter*)>>;
+
+  /// Creates a pool and its first `Options::num_initial_interpreters`
+  /// interpreters. Returns nullptr and reports the error to the model's error
+  /// reporter if an interpreter cannot be created.
+  static std::unique_ptr<InterpreterPool> Create(const FlatBufferModel& model,
+                                                 const OpResolver& op_resolver,
+                                                 const Options& options);
+
+  InterpreterPool(const InterpreterPool&) = delete;
+  InterpreterPool& operator=(const InterpreterPool&) = delete;
+
+  /// Returns an interpreter with its tensors allocated, which the caller may
+  /// use from one thread at a time until it destroys the returned pointer.
+  /// A released interpreter keeps the input shapes and tensor values of the
+  /// last request it ran. Returns nullptr if a new interpreter was needed
+  /// and could not be created. A new interpreter is needed when none is idle,
+  /// and is built while the caller waits.
+  InterpreterPtr Acquire();
+
+  /// Returns the number of released interpreters kept for reuse.
+  int num_idle_interpreters() const;
+
+ private:
+  InterpreterPool(const FlatBufferModel& model, const OpResolver& op_resolver,
+                  const Options& options);
+
+  // Builds a new interpreter and applies the XNNPACK delegate to it. Does not
+  // allocate its tensors.
+  std::unique_ptr<Interpreter> NewInterpreter();
+
+  void Release(Interpreter* interpreter);
+
+  const FlatBufferModel& model_;
+  const OpResolver& op_resolver_;
+  const Options options_;
+
+  // Packed weights shared by the XNNPACK delegates of all the interpreters.
+  // Declared before `idle_interpreters_` so that it outlives them.
+  std::unique_ptr<TfLiteXNNPackDelegateWeightsCache,
+                  decltype(&TfLiteXNNPackDelegateWeightsCacheDelete)>
+      weights_cache_;
+
+  mutable std::mutex mutex_;
+  std::vector<std::unique_ptr<Interpreter>> idle_interpreters_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_INTERPRETER_POOL_H_
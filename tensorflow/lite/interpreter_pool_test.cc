@@ -0,0 +1,132 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/interpreter_pool.h"
+
+#include <memory>
+#include <thread>  // NOLINT(build/c++11)
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/interpreter.h"
+#include "tensorflow/lite/core/kernels/register.h"
+#include "tensorflow/lite/core/model_builder.h"
+#include "tensorflow/lite/kernels/kernel_util.h"
+
+namespace tflite {
+namespace {
+
+constexpr char kModelPath[] = "tensorflow/lite/testdata/multi_add.bin";
+
+// Fills the four inputs of the multi_add model with `value` and checks that
+// each of its two outputs, the sum of three of the inputs, is 3 * `value`.
+void RunMultiAdd(Interpreter* interpreter, float value) {
+  ASSERT_EQ(interpreter->inputs().size(), 4);
+  for (int input : interpreter->inputs()) {
+    TfLiteTensor* tensor = interpreter->tensor(input);
+    for (int i = 0; i < NumElements(tensor); ++i) {
+      tensor->data.f[i] = value;
+    }
+  }
+  ASSERT_EQ(interpreter->Invoke(), kTfLiteOk);
+  ASSERT_EQ(interpreter->outputs().size(), 2);
+  for (int output : interpreter->outputs()) {
+    const TfLiteTensor* tensor = interpreter->tensor(output);
+    for (int i = 0; i < NumElements(tensor); ++i) {
+      EXPECT_EQ(tensor->data.f[i], 3 * value);
+    }
+  }
+}
+
+class InterpreterPoolTest : public ::testing::TestWithParam<bool> {
+ protected:
+  void SetUp() override {
+    model_ = FlatBufferModel::BuildFromFile(kModelPath);
+    ASSERT_NE(model_, nullptr);
+    options_.use_xnnpack = GetParam();
+  }
+
+  std::unique_ptr<FlatBufferModel> model_;
+  ops::builtin::BuiltinOpResolverWithoutDefaultDelegates op_resolver_;
+  InterpreterPool::Options options_;
+};
+
+TEST_P(InterpreterPoolTest, ReusesReleasedInterpreters) {
+  options_.max_idle_interpreters = 1;
+  auto pool = InterpreterPool::Create(*model_, op_resolver_, options_);
+  ASSERT_NE(pool, nullptr);
+  EXPECT_EQ(pool->num_idle_interpreters(), 1);
+
+  auto first = pool->Acquire();
+  ASSERT_NE(first, nullptr);
+  auto second = pool->Acquire();
+  ASSERT_NE(second, nullptr);
+  EXPECT_NE(first.get(), second.get());
+  EXPECT_EQ(pool->num_idle_interpreters(), 0);
+  RunMultiAdd(first.get(), 1.f);
+  RunMultiAdd(second.get(), 2.f);
+
+  Interpreter* released = first.get();
+  first.reset();
+  // Only one interpreter is kept.
+  second.reset();
+  EXPECT_EQ(pool->num_idle_interpreters(), 1);
+  auto third = pool->Acquire();
+  EXPECT_EQ(third.get(), released);
+  RunMultiAdd(third.get(), 3.f);
+}
+
+TEST_P(InterpreterPoolTest, BuildsInitialInterpreters) {
+  options_.num_initial_interpreters = 3;
+  auto pool = InterpreterPool::Create(*model_, op_resolver_, options_);
+  ASSERT_NE(pool, nullptr);
+  EXPECT_EQ(pool->num_idle_interpreters(), 3);
+
+  auto first = pool->Acquire();
+  auto second = pool->Acquire();
+  auto third = pool->Acquire();
+  EXPECT_EQ(pool->num_idle_interpreters(), 0);
+  RunMultiAdd(first.get(), 1.f);
+  RunMultiAdd(second.get(), 2.f);
+  RunMultiAdd(third.get(), 3.f);
+}
+
+TEST_P(InterpreterPoolTest, ConcurrentRequests) {
+  auto pool = InterpreterPool::Create(*model_, op_resolver_, options_);
+  ASSERT_NE(pool, nullptr);
+
+  constexpr int kNumThreads = 4;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&pool, t]() {
+      for (int i = 0; i < 10; ++i) {
+        auto interpreter = pool->Acquire();
+        ASSERT_NE(interpreter, nullptr);
+        RunMultiAdd(interpreter.get(), t * 10 + i);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  EXPECT_GE(pool->num_idle_interpreters(), 1);
+  EXPECT_LE(pool->num_idle_interpreters(), kNumThreads);
+}
+
+INSTANTIATE_TEST_SUITE_P(InterpreterPoolTest, InterpreterPoolTest,
+                         ::testing::Bool());
+
+}  // namespace
+}  // namespace tflite
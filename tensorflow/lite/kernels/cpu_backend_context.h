@@ -31,6 +31,9 @@ limitations under the License.
 
 namespace tflite {
 
+class PackedWeightCache;
+class SharedConstantCache;
+
 class CpuBackendContext final : public TfLiteInternalBackendContext {
  public:
   static CpuBackendContext* GetFromContext(TfLiteContext* context);
@@ -56,6 +59,28 @@ class CpuBackendContext final : public TfLiteInternalBackendContext {
 
   pthreadpool_t get_xnnpack_threadpool();
 
+  // Sets the cache in which kernels look up and record the constant weights
+  // they repack, or nullptr to disable it. The cache is not owned and must
+  // outlive this context.
+  void SetPackedWeightCache(PackedWeightCache* cache) {
+    packed_weight_cache_ = cache;
+  }
+
+  PackedWeightCache* packed_weight_cache() const {
+    return packed_weight_cache_;
+  }
+
+  // Sets the cache in which kernels share the constant buffers they derive
+  // from constant tensors, or nullptr to disable it. The cache is not owned
+  // and must outlive the interpreters using this context.
+  void SetSharedConstantCache(SharedConstantCache* cache) {
+    shared_constant_cache_ = cache;
+  }
+
+  SharedConstantCache* shared_constant_cache() const {
+    return shared_constant_cache_;
+  }
+
   void ClearCaches() override { ruy_context_->ClearPrepackedCache(); }
 
   // Gemmlowp on x86 is a deprecated path but some clients may still use
@@ -118,6 +143,12 @@ class CpuBackendContext final : public TfLiteInternalBackendContext {
   // (currently the Ruy library only).
   bool use_caching_;
 
+  // Persistent cache of repacked constant weights. Not owned.
+  PackedWeightCache* packed_weight_cache_ = nullptr;
+
+  // Cache of constant buffers derived by kernels. Not owned.
+  SharedConstantCache* shared_constant_cache_ = nullptr;
+
   // A smart pointer for the xnnpack threadpool. Is created by a call from the
   // interpreter, and then consumed by xnnpack, possibly via a TFLite kernel.
   std::unique_ptr<pthreadpool, decltype(&pthreadpool_destroy)>
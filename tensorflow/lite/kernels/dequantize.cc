@@ -16,9 +16,17 @@ limitations under the License.
 
 #include <stddef.h>
 
+#include <cstdint>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/lite/allocation.h"
 #include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/kernels/cpu_backend_context.h"
 #include "tensorflow/lite/kernels/internal/optimized/neon_check.h"
 #include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/kernels/shared_constant_cache.h"
 
 namespace tflite {
 namespace ops {
@@ -37,6 +45,9 @@ struct OpContext {
 struct OpData {
   // This boolean value is only used when the input tensor is constant.
   bool float_dequantized_weights_initialized;
+  // The mapping of the dequantized weights in the shared constant cache, when
+  // the input tensor is constant and the cache is set.
+  std::shared_ptr<const Allocation> shared_output;
 };
 
 void* Init(TfLiteContext* context, const char* buffer, size_t length) {
@@ -49,11 +60,78 @@ void Free(TfLiteContext* context, void* buffer) {
   delete reinterpret_cast<OpData*>(buffer);
 }
 
+// Identifies the dequantization in the keys of the shared constant cache.
+// Bump the version whenever the dequantized values change.
+constexpr char kSharedOutputTransform[] = "dequantize/1";
+
+// Returns the key of the dequantized values of the constant `input` in the
+// shared constant cache.
+uint64_t GetSharedOutputKey(const TfLiteTensor* input) {
+  std::vector<uint64_t> fingerprints = {
+      SharedConstantCache::Fingerprint(kSharedOutputTransform,
+                                       sizeof(kSharedOutputTransform) - 1),
+      SharedConstantCache::Fingerprint(input->data.raw, input->bytes),
+      SharedConstantCache::Fingerprint(&input->type, sizeof(input->type)),
+      SharedConstantCache::Fingerprint(input->dims->data,
+                                       input->dims->size * sizeof(int)),
+      SharedConstantCache::Fingerprint(&input->params, sizeof(input->params))};
+  if (IsQuantizedPerChannel(input)) {
+    const auto* quantization_params =
+        reinterpret_cast<const TfLiteAffineQuantization*>(
+            input->quantization.params);
+    fingerprints.push_back(SharedConstantCache::Fingerprint(
+        quantization_params->scale->data,
+        quantization_params->scale->size * sizeof(float)));
+    fingerprints.push_back(SharedConstantCache::Fingerprint(
+        quantization_params->zero_point->data,
+        quantization_params->zero_point->size * sizeof(int)));
+    fingerprints.push_back(quantization_params->quantized_dimension);
+  }
+  uint64_t key = 0;
+  for (uint64_t fingerprint : fingerprints) {
+    key = SharedConstantCache::CombineFingerprints(key, fingerprint);
+  }
+  return key;
+}
+
+// Points the output at the dequantized values of the constant input in
+// `cache`, dequantizing and storing them first if they are not cached yet.
+// Leaves the output in the arena if they cannot be stored.
+template <KernelType kernel_type>
+TfLiteStatus PrepareSharedOutput(TfLiteContext* context, TfLiteNode* node,
+                                 const OpContext& op_context, OpData* op_data,
+                                 SharedConstantCache* cache) {
+  const TfLiteTensor* input = op_context.input;
+  TfLiteTensor* output = op_context.output;
+  if (output->bytes == 0) return kTfLiteOk;
+  const uint64_t key = GetSharedOutputKey(input);
+  std::shared_ptr<const Allocation> shared_output =
+      cache->Find(key, output->bytes);
+  if (shared_output == nullptr) {
+    std::vector<float> dequantized(NumElements(input));
+    TfLiteTensor dequantized_tensor = *output;
+    dequantized_tensor.data.f = dequantized.data();
+    TF_LITE_ENSURE_STATUS(DequantizeImpl<kernel_type>(context, node, input,
+                                                      &dequantized_tensor));
+    shared_output = cache->Insert(key, dequantized.data(), output->bytes);
+    if (shared_output == nullptr) return kTfLiteOk;
+  }
+  op_data->shared_output = std::move(shared_output);
+  op_data->float_dequantized_weights_initialized = true;
+  output->allocation_type = kTfLiteMmapRo;
+  output->allocation = op_data->shared_output.get();
+  output->data.raw = const_cast<char*>(
+      static_cast<const char*>(op_data->shared_output->base()));
+  return kTfLiteOk;
+}
+
+template <KernelType kernel_type>
 TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   TF_LITE_ENSURE_EQ(context, NumInputs(node), 1);
   TF_LITE_ENSURE_EQ(context, NumOutputs(node), 1);
 
   OpContext op_context(context, node);
+  OpData* op_data = reinterpret_cast<OpData*>(node->user_data);
 
   TF_LITE_ENSURE(context, op_context.input->type == kTfLiteUInt8 ||
                               op_context.input->type == kTfLiteInt8 ||
@@ -68,10 +146,22 @@ TfLiteStatus Prepare(TfLiteContext* context, TfLiteNode* node) {
   // If the input tensor is constant, we can persist the dequantized value in
   // the output tensor. Otherwise we run dequantize upon each eval.
   if (IsConstantTensor(op_context.input)) {
+    // The output already points at the shared dequantized values.
+    if (op_data->shared_output != nullptr) return kTfLiteOk;
     op_context.output->allocation_type = kTfLiteArenaRwPersistent;
   }
-  return context->ResizeTensor(context, op_context.output,
-                               TfLiteIntArrayCopy(op_context.input->dims));
+  TF_LITE_ENSURE_OK(context, context->ResizeTensor(
+                                 context, op_context.output,
+                                 TfLiteIntArrayCopy(op_context.input->dims)));
+  SharedConstantCache* cache =
+      IsConstantTensor(op_context.input)
+          ? CpuBackendContext::GetFromContext(context)->shared_constant_cache()
+          : nullptr;
+  if (cache != nullptr) {
+    return PrepareSharedOutput<kernel_type>(context, node, op_context,
+                                            op_data, cache);
+  }
+  return kTfLiteOk;
 }
 
 template <KernelType kernel_type>
@@ -99,14 +189,15 @@ TfLiteStatus Eval(TfLiteContext* context, TfLiteNode* node) {
 
 TfLiteRegistration* Register_DEQUANTIZE_OPT() {
   static TfLiteRegistration r = {
-      dequantize::Init, dequantize::Free, dequantize::Prepare,
+      dequantize::Init, dequantize::Free,
+      dequantize::Prepare<dequantize::kGenericOptimized>,
       dequantize::Eval<dequantize::kGenericOptimized>};
   return &r;
 }
 
 TfLiteRegistration* Register_DEQUANTIZE_REF() {
   static TfLiteRegistration r = {dequantize::Init, dequantize::Free,
-                                 dequantize::Prepare,
+                                 dequantize::Prepare<dequantize::kReference>,
                                  dequantize::Eval<dequantize::kReference>};
   return &r;
 }
@@ -24,7 +24,10 @@ limitations under the License.
 #include "flatbuffers/flatbuffers.h"  // from @flatbuffers
 #include "tensorflow/lite/core/api/op_resolver.h"
 #include "tensorflow/lite/core/interpreter.h"
+#include "tensorflow/lite/external_cpu_backend_context.h"
+#include "tensorflow/lite/kernels/cpu_backend_context.h"
 #include "tensorflow/lite/kernels/internal/types.h"
+#include "tensorflow/lite/kernels/shared_constant_cache.h"
 #include "tensorflow/lite/kernels/test_util.h"
 #include "tensorflow/lite/schema/schema_generated.h"
 
@@ -166,5 +169,59 @@ TEST(DequantizePerChannelOpTest, Int8) {
                   {-63.5, -63, -62.5, -62, -61.5, 62, 62.5, 63, 63.5, 64})));
 }
 
+class ConstantDequantizeOpModel : public SingleOpModel {
+ public:
+  ConstantDequantizeOpModel(const std::vector<int8_t>& data,
+                            ExternalCpuBackendContext* cpu_backend_context) {
+    input_ = AddConstInput(TensorData{TensorType_INT8, {2, 5}, 0, 0, 0.5, -1},
+                           data.data(), data.size());
+    output_ = AddOutput({TensorType_FLOAT32, {2, 5}});
+    SetBuiltinOp(BuiltinOperator_DEQUANTIZE, BuiltinOptions_DequantizeOptions,
+                 CreateDequantizeOptions(builder_).Union());
+
+    resolver_ = std::make_unique<SingleOpResolver>(
+        BuiltinOperator_DEQUANTIZE, ops::builtin::Register_DEQUANTIZE(), 2);
+
+    BuildInterpreter({{}}, /*num_threads=*/-1,
+                     /*allow_fp32_relax_to_fp16=*/false,
+                     /*apply_delegate=*/false, /*allocate_and_delegate=*/false);
+    interpreter_->SetExternalContext(kTfLiteCpuBackendContext,
+                                     cpu_backend_context);
+    AllocateAndDelegate(/*apply_delegate=*/false);
+  }
+
+  std::vector<float> GetOutput() { return ExtractVector<float>(output_); }
+
+  const TfLiteTensor* output_tensor() { return interpreter_->tensor(output_); }
+
+ private:
+  int input_;
+  int output_;
+};
+
+TEST(DequantizeOpTest, SharesConstantOutput) {
+  SharedConstantCache cache(::testing::TempDir());
+  auto* cpu_backend_context = new CpuBackendContext();
+  cpu_backend_context->SetSharedConstantCache(&cache);
+  ExternalCpuBackendContext external_context;
+  external_context.set_internal_backend_context(
+      std::unique_ptr<TfLiteInternalBackendContext>(cpu_backend_context));
+
+  const std::vector<int8_t> data = {-128, -127, -126, -125, -124,
+                                    123,  124,  125,  126,  127};
+  ConstantDequantizeOpModel m1(data, &external_context);
+  ConstantDequantizeOpModel m2(data, &external_context);
+  ASSERT_EQ(m1.Invoke(), kTfLiteOk);
+  ASSERT_EQ(m2.Invoke(), kTfLiteOk);
+  const std::vector<float> expected = {-63.5, -63, -62.5, -62, -61.5,
+                                       62,    62.5, 63,  63.5, 64};
+  EXPECT_THAT(m1.GetOutput(), ElementsAreArray(ArrayFloatNear(expected)));
+  EXPECT_THAT(m2.GetOutput(), ElementsAreArray(ArrayFloatNear(expected)));
+
+  // Both interpreters read the dequantized values from the same mapping.
+  EXPECT_EQ(m1.output_tensor()->allocation_type, kTfLiteMmapRo);
+  EXPECT_EQ(m1.output_tensor()->data.raw, m2.output_tensor()->data.raw);
+}
+
 }  // namespace
 }  // namespace tflite
@@ -19,6 +19,7 @@ limitations under the License.
 #include <cstddef>
 #include <cstdint>
 #include <memory>
+#include <string>
 #include <vector>
 
 #include "tensorflow/lite/core/c/builtin_op_data.h"
@@ -36,6 +37,7 @@ limitations under the License.
 #include "tensorflow/lite/kernels/internal/tensor_utils.h"
 #include "tensorflow/lite/kernels/internal/types.h"
 #include "tensorflow/lite/kernels/kernel_util.h"
+#include "tensorflow/lite/kernels/packed_weight_cache.h"
 #include "tensorflow/lite/minimal_logging.h"
 
 #ifdef TFLITE_HAVE_CPUINFO
@@ -242,6 +244,71 @@ TfLiteStatus UpdateOutputSize(TfLiteContext* context,
   return context->ResizeTensor(context, output, output_size_array);
 }
 
+// Packs the 4-bit weights of `filter` into the layout of the optimized
+// kernel. When a `cache` is given, adopts the weights packed by an earlier
+// load of the model if it has them, and records them otherwise.
+void Prepack4Bit(const TfLiteTensor* filter, OpData* data,
+                 PackedWeightCache* cache) {
+  const int output_depth = filter->dims->data[0];
+  const int cols = filter->dims->data[1];
+  const int depth = optimized_4bit::FilterDepth;
+  const int lhs_width = optimized_4bit::FilterWidth;
+  const int lhs_layout_rows =
+      (output_depth + (lhs_width - 1)) & ~(lhs_width - 1);
+  const int lhs_layout_cols = (cols + (depth - 1)) & ~(depth - 1);
+  const int weight_size = lhs_layout_rows * lhs_layout_cols / 2;
+  const int8_t* weight_ptr = GetTensorData<int8_t>(filter);
+  std::string packing;
+  if (cache != nullptr) {
+    packing = "fully_connected_4bit/" + std::to_string(lhs_width) + "x" +
+              std::to_string(depth) + "/" + std::to_string(output_depth) +
+              "x" + std::to_string(cols);
+    const uint8_t* packed =
+        cache->Find(weight_ptr, filter->bytes, packing, weight_size);
+    if (packed != nullptr) {
+      // The packed weights are only read by the kernel.
+      data->op_data_4bit->prepacked_cache = const_cast<uint8_t*>(packed);
+      data->op_data_4bit->prepacked_cache_buffer.reset();
+      data->op_data_4bit->needs_prepack = false;
+      return;
+    }
+  }
+  const int required_size =
+      optimized_4bit::kDefaultAlignmentPadding + weight_size;
+  data->op_data_4bit->AllocatePackedRegion(required_size);
+  optimized_4bit::api::Prepack(data->op_data_4bit->prepacked_cache,
+                               weight_ptr, lhs_layout_rows, lhs_layout_cols,
+                               output_depth, cols, lhs_width, depth);
+  data->op_data_4bit->needs_prepack = false;
+  if (cache != nullptr) {
+    cache->Insert(weight_ptr, filter->bytes, packing,
+                  data->op_data_4bit->prepacked_cache, weight_size);
+  }
+#ifdef MADV_PAGEOUT
+  // After prepacking, we will never use the weights from the model file. Mark
+  // them with MADV_PAGEOUT so the kernel can reclaim the pages, decreasing
+  // the resident memory size.
+  //
+  // This is Linux specific. There is no effect on other platforms (e.g. on
+  // Windows, but possibly other POSIX platforms!). It requires a minimum
+  // Kernel version of 5.4 - on older kernels the call will return with an
+  // error, but we ignore it. The kernel might also ignore this hint.
+  //
+  // Note, due to rounding the pointer up (which is necessary due to madvise
+  // requiring an address that aligns with the page size), the first partial
+  // page will not be reclaimed. Madvise also rounds the end of the hinted
+  // range down, so the last partial page is also unaffected. Because of this
+  // behavior, on average one memory page (usually 4 kiB) per buffer holding 4
+  // bit data will not be paged out.
+  static const uintptr_t pagesize = sysconf(_SC_PAGESIZE);
+  int8_t* up_aligned_ptr = reinterpret_cast<int8_t*>(
+      ((reinterpret_cast<uintptr_t>(weight_ptr) + pagesize - 1) / pagesize) *
+      pagesize);
+  const auto rounding_size = up_aligned_ptr - weight_ptr;
+  madvise(up_aligned_ptr, weight_size - rounding_size, MADV_PAGEOUT);
+#endif
+}
+
 TfLiteStatus PrepareImpl4Bit(TfLiteContext* context, TfLiteNode* node,
                              int lhs_width, int rhs_width, int depth,
                              int batch_size, int cols, int output_depth) {
@@ -497,6 +564,12 @@ TfLiteStatus PrepareImpl(TfLiteContext* context, TfLiteNode* node,
       if (!data->op_data_4bit) {
         data->op_data_4bit = std::make_unique<optimized_4bit::OpData4Bit>();
       }
+      // Without a cache, the weights are packed by the first invocation.
+      PackedWeightCache* packed_weight_cache =
+          CpuBackendContext::GetFromContext(context)->packed_weight_cache();
+      if (data->op_data_4bit->needs_prepack && packed_weight_cache) {
+        Prepack4Bit(filter, data, packed_weight_cache);
+      }
       if (data->op_data_4bit->batch_size == batch_size) {
         return kTfLiteOk;
       }
@@ -908,38 +981,7 @@ TfLiteStatus EvalHybridDense4Bit(
   const int dst_layout_rows = rhs_layout_rows;
   const int dst_layout_cols = lhs_layout_rows;
   if (data->op_data_4bit->needs_prepack) {
-    const int weight_size = lhs_layout_rows * lhs_layout_cols / 2;
-    const int required_size =
-        optimized_4bit::kDefaultAlignmentPadding + weight_size;
-    data->op_data_4bit->AllocatePackedRegion(required_size);
-    const int8_t* weight_ptr = GetTensorData<int8_t>(filter);
-    optimized_4bit::api::Prepack(data->op_data_4bit->prepacked_cache,
-                                 weight_ptr, lhs_layout_rows, lhs_layout_cols,
-                                 output_depth, cols, lhs_width, depth);
-    data->op_data_4bit->needs_prepack = false;
-#ifdef MADV_PAGEOUT
-    // After prepacking, we will never use the weights from the model file. Mark
-    // them with MADV_PAGEOUT so the kernel can reclaim the pages, decreasing
-    // the resident memory size.
-    //
-    // This is Linux specific. There is no effect on other platforms (e.g. on
-    // Windows, but possibly other POSIX platforms!). It requires a minimum
-    // Kernel version of 5.4 - on older kernels the call will return with an
-    // error, but we ignore it. The kernel might also ignore this hint.
-    //
-    // Note, due to rounding the pointer up (which is necessary due to madvise
-    // requiring an address that aligns with the page size), the first partial
-    // page will not be reclaimed. Madvise also rounds the end of the hinted
-    // range down, so the last partial page is also unaffected. Because of this
-    // behavior, on average one memory page (usually 4 kiB) per buffer holding 4
-    // bit data will not be paged out.
-    static const uintptr_t pagesize = sysconf(_SC_PAGESIZE);
-    int8_t* up_aligned_ptr = reinterpret_cast<int8_t*>(
-        ((reinterpret_cast<uintptr_t>(weight_ptr) + pagesize - 1) / pagesize) *
-        pagesize);
-    const auto rounding_size = up_aligned_ptr - weight_ptr;
-    madvise(up_aligned_ptr, weight_size - rounding_size, MADV_PAGEOUT);
-#endif
+    Prepack4Bit(filter, data, /*cache=*/nullptr);
   }
 
   std::vector<float> filter_scales(lhs_layout_rows, filter->params.scale);
@@ -20,6 +20,7 @@ limitations under the License.
 #include <stdint.h>
 
 #include <algorithm>
+#include <cstdio>
 #include <initializer_list>
 #include <limits>
 #include <map>
@@ -32,11 +33,16 @@ limitations under the License.
 #include <gtest/gtest.h>
 #include "absl/memory/memory.h"
 #include "flatbuffers/flatbuffers.h"  // from @flatbuffers
+#include "tensorflow/lite/allocation.h"
 #include "tensorflow/lite/core/api/op_resolver.h"
 #include "tensorflow/lite/core/interpreter.h"
+#include "tensorflow/lite/external_cpu_backend_context.h"
+#include "tensorflow/lite/kernels/cpu_backend_context.h"
 #include "tensorflow/lite/kernels/internal/tensor_utils.h"
+#include "tensorflow/lite/kernels/packed_weight_cache.h"
 #include "tensorflow/lite/kernels/test_util.h"
 #include "tensorflow/lite/schema/schema_generated.h"
+#include "tensorflow/lite/stderr_reporter.h"
 #include "tensorflow/lite/string_type.h"
 
 namespace tflite {
@@ -1440,6 +1446,122 @@ TEST(HybridFullyConnectedOpTest, SimpleTestQuantizedInt4) {
                                  /*max_abs_error=*/1.3f)));
 }
 
+// A hybrid FULLY_CONNECTED with 4-bit weights, whose kernel packs the weights
+// when tensors are allocated if a packed weight cache is set.
+class PackedInt4FullyConnectedOpModel : public SingleOpModel {
+ public:
+  PackedInt4FullyConnectedOpModel(int units, int batches, int cols) {
+    input_ = AddInput({TensorType_FLOAT32, {batches, cols}});
+    std::vector<int8_t> packed_weights(units * cols / 2);
+    for (int i = 0; i < units * cols; ++i) {
+      const uint8_t value = ((i % 15) - 7) & UINT8_C(15);
+      packed_weights[i / 2] |= i % 2 == 0 ? value : value << 4;
+    }
+    weights_ = AddConstInput<int8_t>(
+        {TensorType_INT4, {units, cols}, 0.0, 7.0, 1.0}, packed_weights.data(),
+        packed_weights.size());
+    bias_ = AddInput({TensorType_FLOAT32, {units}});
+    output_ = AddOutput({TensorType_FLOAT32, {batches, units}});
+    SetBuiltinOp(BuiltinOperator_FULLY_CONNECTED,
+                 BuiltinOptions_FullyConnectedOptions,
+                 CreateFullyConnectedOptions(
+                     builder_, ActivationFunctionType_NONE,
+                     FullyConnectedOptionsWeightsFormat_DEFAULT,
+                     /*keep_num_dims=*/false, /*asymmetric_quantize_inputs=*/
+                     true)
+                     .Union());
+    resolver_ = std::make_unique<SingleOpResolver>(
+        BuiltinOperator_FULLY_CONNECTED,
+        ops::builtin::Register_FULLY_CONNECTED_GENERIC_OPT());
+    BuildInterpreter({GetShape(input_), GetShape(weights_), GetShape(bias_)},
+                     /*num_threads=*/-1, /*allow_fp32_relax_to_fp16=*/false,
+                     /*apply_delegate=*/false, /*allocate_and_delegate=*/false);
+    TfLiteTensor* t = interpreter_->tensor(weights_);
+    t->type = kTfLiteInt4;
+    t->params.scale = 1.0;
+    auto* filter_params =
+        reinterpret_cast<TfLiteAffineQuantization*>(t->quantization.params);
+    if (filter_params && filter_params->scale) {
+      for (int i = 0; i < filter_params->scale->size; ++i) {
+        filter_params->scale->data[i] = 1.0;
+      }
+    }
+  }
+
+  // Returns the model, whose weights the cache keeps the packing of.
+  std::unique_ptr<MemoryAllocation> CreateModelAllocation() {
+    return std::make_unique<MemoryAllocation>(
+        GetModelBuffer(), builder_.GetSize(), DefaultErrorReporter());
+  }
+
+  // Allocates the tensors, using `context` for the CPU backend.
+  void Allocate(ExternalCpuBackendContext* context) {
+    if (context != nullptr) {
+      interpreter_->SetExternalContext(kTfLiteCpuBackendContext, context);
+    }
+    AllocateAndDelegate(/*apply_delegate=*/false);
+  }
+
+  void SetInput(const std::vector<float>& f) { PopulateTensor(input_, f); }
+  void SetBias(const std::vector<float>& f) { PopulateTensor(bias_, f); }
+  std::vector<float> GetOutput() { return ExtractVector<float>(output_); }
+
+ private:
+  int input_;
+  int weights_;
+  int bias_;
+  int output_;
+};
+
+TEST(HybridFullyConnectedOpTest, ReusesPackedInt4WeightsOfCache) {
+  constexpr int kUnits = 5;
+  constexpr int kBatches = 4;
+  constexpr int kCols = 40;
+  std::vector<float> input(kBatches * kCols);
+  for (int i = 0; i < input.size(); ++i) input[i] = (i % 21) - 10;
+  const std::vector<float> bias = {1, 2, 3, 1, 2};
+
+  std::vector<float> expected_output;
+  {
+    PackedInt4FullyConnectedOpModel m(kUnits, kBatches, kCols);
+    m.Allocate(/*context=*/nullptr);
+    m.SetInput(input);
+    m.SetBias(bias);
+    ASSERT_EQ(m.Invoke(), kTfLiteOk);
+    expected_output = m.GetOutput();
+  }
+
+  const std::string path = ::testing::TempDir() + "/fully_connected.packed";
+  std::remove(path.c_str());
+  for (int load = 0; load < 2; ++load) {
+    // The interpreter of the model uses the context and the packed weights of
+    // the cache until it is destroyed, so the model is declared last.
+    std::unique_ptr<MemoryAllocation> allocation;
+    std::unique_ptr<PackedWeightCache> cache;
+    ExternalCpuBackendContext context;
+    PackedInt4FullyConnectedOpModel m(kUnits, kBatches, kCols);
+    allocation = m.CreateModelAllocation();
+    cache = PackedWeightCache::Create(path, *allocation, "model");
+    if (cache == nullptr) {
+      GTEST_SKIP() << "The features of the CPU are unknown.";
+    }
+    auto* cpu_backend_context = new CpuBackendContext();
+    cpu_backend_context->SetPackedWeightCache(cache.get());
+    context.set_internal_backend_context(
+        std::unique_ptr<TfLiteInternalBackendContext>(cpu_backend_context));
+    m.Allocate(&context);
+    // The first load packs the weights, and the second maps them.
+    EXPECT_EQ(cache->num_mapped_entries(), load);
+    EXPECT_EQ(cache->num_found(), load);
+
+    m.SetInput(input);
+    m.SetBias(bias);
+    ASSERT_EQ(m.Invoke(), kTfLiteOk);
+    EXPECT_THAT(m.GetOutput(), ElementsAreArray(expected_output));
+    ASSERT_EQ(cache->Save(), kTfLiteOk);
+  }
+}
+
 TEST_P(FloatFullyConnectedOpTest, SimpleTest4DInput) {
   // Note that it is not required that the first dimension be the number of
   // batches. All we care is that the input can be evenly distributed in
@@ -0,0 +1,340 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/kernels/packed_weight_cache.h"
+
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <farmhash.h>
+#include "tensorflow/lite/allocation.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/kernels/internal/optimized/cpu_check.h"
+#include "tensorflow/lite/minimal_logging.h"
+#include "tensorflow/lite/stderr_reporter.h"
+
+#ifdef TFLITE_HAVE_CPUINFO
+#include "include/cpuinfo.h"
+#endif
+
+namespace tflite {
+namespace {
+
+// Identifies the file format. Bump the version whenever the format or a
+// packing changes.
+constexpr char kMagic[8] = {'T', 'F', 'L', 'P', 'W', 'C', 0, 1};
+
+struct FileHeader {
+  char magic[8];
+  uint64_t model_fingerprint;
+  uint64_t cpu_fingerprint;
+  uint64_t num_entries;
+};
+
+// Followed by the data of the entries, each aligned to kAlignment.
+struct FileEntry {
+  uint64_t key;
+  uint64_t offset;
+  uint64_t size;
+};
+
+// Murmur-inspired combination of two fingerprints.
+uint64_t CombineFingerprints(uint64_t l, uint64_t h) {
+  const uint64_t kMul = 0x9ddfea08eb382d69ULL;
+  uint64_t a = (l ^ h) * kMul;
+  a ^= (a >> 47);
+  uint64_t b = (h ^ a) * kMul;
+  b ^= (b >> 44);
+  b *= kMul;
+  return b;
+}
+
+uint64_t Fingerprint(const std::string& s) {
+  return ::util::Fingerprint64(s.data(), s.size());
+}
+
+// Returns the fingerprint of the architecture and of the instruction set
+// extensions of the CPU that packings may depend on, or 0 if they cannot be
+// determined.
+uint64_t GetCpuFingerprint() {
+  std::string cpu;
+#if defined(__aarch64__)
+  cpu = "aarch64";
+#elif defined(__arm__)
+  cpu = "arm";
+#elif defined(__x86_64__) || defined(_M_X64)
+  cpu = "x86_64";
+#elif defined(__i386__) || defined(_M_IX86)
+  cpu = "x86";
+#else
+  return 0;
+#endif
+#ifdef TFLITE_HAVE_CPUINFO
+  // cpuinfo is not deinitialized, as other parts of the program may use it.
+  if (!cpuinfo_initialize()) return 0;
+  // The features of other architectures are reported as missing.
+  const std::pair<const char*, bool> features[] = {
+      {"ssse3", cpuinfo_has_x86_ssse3()},
+      {"sse4.1", cpuinfo_has_x86_sse4_1()},
+      {"avx", cpuinfo_has_x86_avx()},
+      {"avx2", cpuinfo_has_x86_avx2()},
+      {"fma3", cpuinfo_has_x86_fma3()},
+      {"f16c", cpuinfo_has_x86_f16c()},
+      {"avx512f", cpuinfo_has_x86_avx512f()},
+      {"avx512cd", cpuinfo_has_x86_avx512cd()},
+      {"avx512bw", cpuinfo_has_x86_avx512bw()},
+      {"avx512dq", cpuinfo_has_x86_avx512dq()},
+      {"avx512vl", cpuinfo_has_x86_avx512vl()},
+      {"avx512vnni", cpuinfo_has_x86_avx512vnni()},
+      {"neon", cpuinfo_has_arm_neon()},
+      {"fp16arith", cpuinfo_has_arm_neon_fp16_arith()},
+      {"dotprod", cpuinfo_has_arm_neon_dot()},
+      {"i8mm", cpuinfo_has_arm_i8mm()},
+      {"sve", cpuinfo_has_arm_sve()},
+  };
+  for (const auto& feature : features) {
+    if (feature.second) {
+      cpu += "+";
+      cpu += feature.first;
+    }
+  }
+#elif defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || \
+    defined(_M_IX86)
+  // The instruction set extensions of x86 CPUs are only known from cpuinfo.
+  return 0;
+#else
+  CpuFlags cpu_flags;
+  GetCpuFlags(&cpu_flags);
+  if (cpu_flags.neon_dotprod) cpu += "+dotprod";
+#endif
+  return Fingerprint(cpu);
+}
+
+size_t AlignTo(size_t alignment, size_t offset) {
+  return (offset + alignment - 1) / alignment * alignment;
+}
+
+// Returns a temporary path next to `path`, unique across processes and
+// threads.
+std::string GetTempPath(const std::string& path) {
+  static std::atomic<int> counter(0);
+  return path + "." + std::to_string(getpid()) + "." +
+         std::to_string(counter++) + ".tmp";
+}
+
+}  // namespace
+
+std::unique_ptr<PackedWeightCache> PackedWeightCache::Create(
+    const std::string& path, const Allocation& model_allocation,
+    const std::string& model_token) {
+  const uint64_t cpu_fingerprint = GetCpuFingerprint();
+  if (cpu_fingerprint == 0) {
+    TFLITE_LOG_PROD_ONCE(TFLITE_LOG_INFO,
+                         "Not caching packed weights: the features of the "
+                         "CPU are unknown.");
+    return nullptr;
+  }
+  const uint64_t model_fingerprint =
+      model_token.empty()
+          ? ::util::Fingerprint64(
+                static_cast<const char*>(model_allocation.base()),
+                model_allocation.bytes())
+          : Fingerprint(model_token);
+  std::unique_ptr<PackedWeightCache> cache(
+      new PackedWeightCache(path, model_allocation, model_fingerprint,
+                            cpu_fingerprint));
+  cache->MapFile();
+  return cache;
+}
+
+PackedWeightCache::PackedWeightCache(const std::string& path,
+                                     const Allocation& model_allocation,
+                                     uint64_t model_fingerprint,
+                                     uint64_t cpu_fingerprint)
+    : path_(path),
+      model_allocation_(model_allocation),
+      model_fingerprint_(model_fingerprint),
+      cpu_fingerprint_(cpu_fingerprint) {}
+
+bool PackedWeightCache::MapFile() {
+  if (!MMAPAllocation::IsSupported() || !std::ifstream(path_).good()) {
+    return false;
+  }
+  auto file_allocation =
+      std::make_unique<MMAPAllocation>(path_.c_str(), DefaultErrorReporter());
+  if (!file_allocation->valid() ||
+      file_allocation->bytes() < sizeof(FileHeader)) {
+    return false;
+  }
+  const uint8_t* base = static_cast<const uint8_t*>(file_allocation->base());
+  const size_t file_size = file_allocation->bytes();
+  FileHeader header;
+  std::memcpy(&header, base, sizeof(header));
+  if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+      header.model_fingerprint != model_fingerprint_ ||
+      header.cpu_fingerprint != cpu_fingerprint_ ||
+      header.num_entries >
+          (file_size - sizeof(FileHeader)) / sizeof(FileEntry)) {
+    TFLITE_LOG_PROD(TFLITE_LOG_INFO,
+                    "Ignoring packed weight cache %s written for another "
+                    "model or CPU.",
+                    path_.c_str());
+    return false;
+  }
+  std::unordered_map<uint64_t, Entry> mapped_entries;
+  for (uint64_t i = 0; i < header.num_entries; ++i) {
+    FileEntry entry;
+    std::memcpy(&entry, base + sizeof(FileHeader) + i * sizeof(FileEntry),
+                sizeof(entry));
+    if (entry.offset % kAlignment != 0 || entry.offset > file_size ||
+        entry.size > file_size - entry.offset) {
+      TFLITE_LOG_PROD(TFLITE_LOG_WARNING, "Corrupted packed weight cache %s.",
+                      path_.c_str());
+      return false;
+    }
+    mapped_entries[entry.key] = {base + entry.offset, entry.size};
+  }
+  mapped_entries_ = std::move(mapped_entries);
+  if (file_allocation_) {
+    replaced_file_allocations_.push_back(std::move(file_allocation_));
+  }
+  file_allocation_ = std::move(file_allocation);
+  return true;
+}
+
+bool PackedWeightCache::GetKey(const void* weights, size_t weights_size,
+                               const std::string& packing,
+                               uint64_t* key) const {
+  const char* model_begin = static_cast<const char*>(model_allocation_.base());
+  const char* model_end = model_begin + model_allocation_.bytes();
+  const char* weights_begin = static_cast<const char*>(weights);
+  if (weights_begin < model_begin || weights_begin > model_end ||
+      weights_size > static_cast<size_t>(model_end - weights_begin)) {
+    return false;
+  }
+  // The model fingerprint and CPU are those of the file, so the location and
+  // size of the weights in the model and the packing identify the entry.
+  const uint64_t location[2] = {
+      static_cast<uint64_t>(weights_begin - model_begin), weights_size};
+  *key = CombineFingerprints(
+      ::util::Fingerprint64(reinterpret_cast<const char*>(location),
+                            sizeof(location)),
+      Fingerprint(packing));
+  return true;
+}
+
+const uint8_t* PackedWeightCache::Find(const void* weights,
+                                       size_t weights_size,
+                                       const std::string& packing,
+                                       size_t packed_size) {
+  uint64_t key;
+  if (!GetKey(weights, weights_size, packing, &key)) return nullptr;
+  std::lock_guard<std::mutex> lock(mutex_);
+  const auto it = mapped_entries_.find(key);
+  if (it == mapped_entries_.end() || it->second.size != packed_size) {
+    return nullptr;
+  }
+  ++num_found_;
+  return it->second.data;
+}
+
+void PackedWeightCache::Insert(const void* weights, size_t weights_size,
+                               const std::string& packing, const void* packed,
+                               size_t packed_size) {
+  uint64_t key;
+  if (!GetKey(weights, weights_size, packing, &key)) return;
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (mapped_entries_.count(key)) return;
+  inserted_entries_[key].assign(static_cast<const char*>(packed),
+                                packed_size);
+}
+
+TfLiteStatus PackedWeightCache::Save() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (inserted_entries_.empty()) return kTfLiteOk;
+
+  std::vector<std::pair<uint64_t, Entry>> entries(mapped_entries_.begin(),
+                                                  mapped_entries_.end());
+  for (const auto& key_and_data : inserted_entries_) {
+    entries.push_back(
+        {key_and_data.first,
+         {reinterpret_cast<const uint8_t*>(key_and_data.second.data()),
+          key_and_data.second.size()}});
+  }
+  FileHeader header;
+  std::memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.model_fingerprint = model_fingerprint_;
+  header.cpu_fingerprint = cpu_fingerprint_;
+  header.num_entries = entries.size();
+  std::vector<FileEntry> file_entries;
+  size_t offset = sizeof(FileHeader) + entries.size() * sizeof(FileEntry);
+  for (const auto& key_and_entry : entries) {
+    offset = AlignTo(kAlignment, offset);
+    file_entries.push_back(
+        {key_and_entry.first, offset, key_and_entry.second.size});
+    offset += key_and_entry.second.size;
+  }
+
+  // Renaming is atomic on most systems, so that concurrent readers see either
+  // the old or the new file. The name of the temporary file is unique to this
+  // process, which may be one of several replicas saving the same cache.
+  const std::string temp_path = GetTempPath(path_);
+  std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  file.write(reinterpret_cast<const char*>(file_entries.data()),
+             file_entries.size() * sizeof(FileEntry));
+  size_t position = sizeof(FileHeader) + entries.size() * sizeof(FileEntry);
+  const char padding[kAlignment] = {};
+  for (size_t i = 0; i < entries.size(); ++i) {
+    file.write(padding, file_entries[i].offset - position);
+    file.write(reinterpret_cast<const char*>(entries[i].second.data),
+               entries[i].second.size);
+    position = file_entries[i].offset + entries[i].second.size;
+  }
+  file.close();
+  if (file.fail()) {
+    TFLITE_LOG_PROD(TFLITE_LOG_ERROR, "Failed to write %s.",
+                    temp_path.c_str());
+    std::remove(temp_path.c_str());
+    return kTfLiteError;
+  }
+  if (std::rename(temp_path.c_str(), path_.c_str()) != 0) {
+    TFLITE_LOG_PROD(TFLITE_LOG_ERROR, "Failed to rename %s to %s.",
+                    temp_path.c_str(), path_.c_str());
+    std::remove(temp_path.c_str());
+    return kTfLiteError;
+  }
+  TFLITE_LOG_PROD(TFLITE_LOG_INFO,
+                  "Wrote %d packed weights to packed weight cache %s.",
+                  static_cast<int>(entries.size()), path_.c_str());
+  // Another replica may have replaced the file since, in which case the
+  // entries missing from its file are packed again on the next load.
+  if (MapFile()) inserted_entries_.clear();
+  return kTfLiteOk;
+}
+
+}  // namespace tflite
@@ -0,0 +1,135 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_KERNELS_PACKED_WEIGHT_CACHE_H_
+#define TENSORFLOW_LITE_KERNELS_PACKED_WEIGHT_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "tensorflow/lite/allocation.h"
+#include "tensorflow/lite/core/c/common.h"
+
+namespace tflite {
+
+// A persistent cache of the constant weights that kernels repack into a
+// layout optimized for the CPU, so that later loads of the same model adopt
+// the packed weights instead of packing them again.
+//
+// The cache of a model is stored in a single file, which is mapped read-only
+// when the cache is created. Interpreters of the same model in several
+// processes thus share one physical copy of the packed weights, instead of
+// allocating a private copy each. Weights packed on a cache miss are only
+// written to the file by `Save`.
+//
+// Entries are keyed by the fingerprint of the model, the location of the
+// weights in the model, the packing and the CPU the weights were packed on. A
+// file written for another model or CPU is ignored, and overwritten by the
+// next `Save`.
+//
+// Kernels find the cache through their CpuBackendContext:
+//
+//   auto cache = PackedWeightCache::Create(path, *model->allocation());
+//   auto* cpu_backend_context = new CpuBackendContext();
+//   cpu_backend_context->SetPackedWeightCache(cache.get());
+//   ExternalCpuBackendContext external_context;
+//   external_context.set_internal_backend_context(
+//       std::unique_ptr<TfLiteInternalBackendContext>(cpu_backend_context));
+//   interpreter->SetExternalContext(kTfLiteCpuBackendContext,
+//                                   &external_context);
+//   ... Invoke the interpreter ...
+//   cache->Save();
+//
+// This class is thread-safe.
+class PackedWeightCache {
+ public:
+  // Alignment of the packed weights returned by `Find`.
+  static constexpr size_t kAlignment = 64;
+
+  // Opens the cache stored at `path` for the model whose flatbuffer is held
+  // by `model_allocation`, which must outlive the cache. `model_token`
+  // identifies the model contents. When empty, the fingerprint of the whole
+  // flatbuffer is used, which reads all of it. Returns nullptr if the
+  // instruction set extensions of the CPU cannot be determined, in which case
+  // kernels pack the weights on every load.
+  static std::unique_ptr<PackedWeightCache> Create(
+      const std::string& path, const Allocation& model_allocation,
+      const std::string& model_token = "");
+
+  // Returns the weights at `weights`, of `weights_size` bytes, packed with
+  // `packing` into `packed_size` bytes, or nullptr if they are not cached.
+  // `packing` identifies the packing function and its parameters. The
+  // returned data is aligned to `kAlignment` and lives as long as the cache.
+  const uint8_t* Find(const void* weights, size_t weights_size,
+                      const std::string& packing, size_t packed_size);
+
+  // Records the packed weights of `weights`, to be written by the next
+  // `Save`. Weights that are not part of the model are not cached.
+  void Insert(const void* weights, size_t weights_size,
+              const std::string& packing, const void* packed,
+              size_t packed_size);
+
+  // Writes the cached entries to the file of the cache, replacing it
+  // atomically, and maps the new file. Entries inserted so far are then found
+  // by `Find`, and no longer held in memory. Does nothing if no entry was
+  // inserted since the last `Save`.
+  TfLiteStatus Save();
+
+  // Returns the number of entries found in the file of the cache.
+  int num_mapped_entries() const { return mapped_entries_.size(); }
+
+  // Returns the number of calls to `Find` that returned packed weights.
+  int num_found() const { return num_found_; }
+
+ private:
+  struct Entry {
+    const uint8_t* data;
+    size_t size;
+  };
+
+  PackedWeightCache(const std::string& path, const Allocation& model_allocation,
+                    uint64_t model_fingerprint, uint64_t cpu_fingerprint);
+
+  // Maps the entries of the file of the cache, if it was written for the
+  // same model and CPU. Returns false, keeping the entries mapped so far, if
+  // it was not.
+  bool MapFile();
+
+  // Returns the key of an entry, or false if `weights` are not in the model.
+  bool GetKey(const void* weights, size_t weights_size,
+              const std::string& packing, uint64_t* key) const;
+
+  const std::string path_;
+  const Allocation& model_allocation_;
+  const uint64_t model_fingerprint_;
+  const uint64_t cpu_fingerprint_;
+
+  std::mutex mutex_;
+  std::unique_ptr<MMAPAllocation> file_allocation_;
+  // Files replaced by `Save`, which kernels may still read weights from.
+  std::vector<std::unique_ptr<MMAPAllocation>> replaced_file_allocations_;
+  std::unordered_map<uint64_t, Entry> mapped_entries_;
+  std::unordered_map<uint64_t, std::string> inserted_entries_;
+  std::atomic<int> num_found_{0};
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_KERNELS_PACKED_WEIGHT_CACHE_H_
@@ -0,0 +1,141 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/kernels/packed_weight_cache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/lite/allocation.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/stderr_reporter.h"
+
+namespace tflite {
+namespace {
+
+class PackedWeightCacheTest : public ::testing::Test {
+ protected:
+  PackedWeightCacheTest()
+      : model_data_(1024),
+        model_(model_data_.data(), model_data_.size(), DefaultErrorReporter()),
+        path_(::testing::TempDir() + "/" +
+              ::testing::UnitTest::GetInstance()->current_test_info()->name() +
+              ".packed_weights"),
+        packed_(100) {
+    for (int i = 0; i < model_data_.size(); ++i) model_data_[i] = i;
+    for (int i = 0; i < packed_.size(); ++i) packed_[i] = 3 * i;
+    std::remove(path_.c_str());
+  }
+
+  void SetUp() override {
+    if (PackedWeightCache::Create(path_, model_) == nullptr) {
+      GTEST_SKIP() << "The features of the CPU are unknown.";
+    }
+  }
+
+  // Weights inside of the model.
+  const void* weights() const { return model_data_.data() + 256; }
+
+  std::vector<uint8_t> model_data_;
+  MemoryAllocation model_;
+  const std::string path_;
+  std::vector<uint8_t> packed_;
+};
+
+TEST_F(PackedWeightCacheTest, AdoptsSavedWeights) {
+  auto cache = PackedWeightCache::Create(path_, model_, "model");
+  EXPECT_EQ(cache->num_mapped_entries(), 0);
+  EXPECT_EQ(cache->Find(weights(), 128, "packing", packed_.size()), nullptr);
+  cache->Insert(weights(), 128, "packing", packed_.data(), packed_.size());
+  // Inserted weights are only found once saved, which maps them.
+  EXPECT_EQ(cache->Find(weights(), 128, "packing", packed_.size()), nullptr);
+  ASSERT_EQ(cache->Save(), kTfLiteOk);
+  EXPECT_EQ(cache->num_mapped_entries(), 1);
+  EXPECT_NE(cache->Find(weights(), 128, "packing", packed_.size()), nullptr);
+  EXPECT_EQ(cache->num_found(), 1);
+
+  cache = PackedWeightCache::Create(path_, model_, "model");
+  EXPECT_EQ(cache->num_mapped_entries(), 1);
+  const uint8_t* packed =
+      cache->Find(weights(), 128, "packing", packed_.size());
+  ASSERT_NE(packed, nullptr);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(packed) %
+                PackedWeightCache::kAlignment,
+            0);
+  EXPECT_EQ(std::memcmp(packed, packed_.data(), packed_.size()), 0);
+
+  // Other weights, packings or sizes miss.
+  EXPECT_EQ(cache->Find(model_data_.data(), 128, "packing", packed_.size()),
+            nullptr);
+  EXPECT_EQ(cache->Find(weights(), 64, "packing", packed_.size()), nullptr);
+  EXPECT_EQ(cache->Find(weights(), 128, "other", packed_.size()), nullptr);
+  EXPECT_EQ(cache->Find(weights(), 128, "packing", 10), nullptr);
+}
+
+TEST_F(PackedWeightCacheTest, KeepsMappedEntriesWhenSaving) {
+  auto cache = PackedWeightCache::Create(path_, model_);
+  cache->Insert(weights(), 128, "first", packed_.data(), packed_.size());
+  ASSERT_EQ(cache->Save(), kTfLiteOk);
+
+  cache = PackedWeightCache::Create(path_, model_);
+  cache->Insert(weights(), 128, "second", packed_.data(), 7);
+  ASSERT_EQ(cache->Save(), kTfLiteOk);
+
+  cache = PackedWeightCache::Create(path_, model_);
+  EXPECT_EQ(cache->num_mapped_entries(), 2);
+  EXPECT_NE(cache->Find(weights(), 128, "first", packed_.size()), nullptr);
+  EXPECT_NE(cache->Find(weights(), 128, "second", 7), nullptr);
+}
+
+TEST_F(PackedWeightCacheTest, SavesOnlyOnceInserted) {
+  auto cache = PackedWeightCache::Create(path_, model_, "model");
+  cache->Insert(weights(), 128, "packing", packed_.data(), packed_.size());
+  ASSERT_EQ(cache->Save(), kTfLiteOk);
+  // Nothing was inserted since, so the file is not written again.
+  std::remove(path_.c_str());
+  ASSERT_EQ(cache->Save(), kTfLiteOk);
+  EXPECT_EQ(PackedWeightCache::Create(path_, model_, "model")
+                ->num_mapped_entries(),
+            0);
+  // Weights saved before remain mapped.
+  EXPECT_NE(cache->Find(weights(), 128, "packing", packed_.size()), nullptr);
+}
+
+TEST_F(PackedWeightCacheTest, IgnoresFileOfOtherModel) {
+  auto cache = PackedWeightCache::Create(path_, model_, "model");
+  cache->Insert(weights(), 128, "packing", packed_.data(), packed_.size());
+  ASSERT_EQ(cache->Save(), kTfLiteOk);
+
+  cache = PackedWeightCache::Create(path_, model_, "other_model");
+  EXPECT_EQ(cache->num_mapped_entries(), 0);
+  EXPECT_EQ(cache->Find(weights(), 128, "packing", packed_.size()), nullptr);
+}
+
+TEST_F(PackedWeightCacheTest, IgnoresWeightsOutsideOfModel) {
+  auto cache = PackedWeightCache::Create(path_, model_, "model");
+  const std::vector<uint8_t> other_weights(128);
+  cache->Insert(other_weights.data(), other_weights.size(), "packing",
+                packed_.data(), packed_.size());
+  ASSERT_EQ(cache->Save(), kTfLiteOk);
+  EXPECT_EQ(PackedWeightCache::Create(path_, model_, "model")
+                ->num_mapped_entries(),
+            0);
+}
+
+}  // namespace
+}  // namespace tflite
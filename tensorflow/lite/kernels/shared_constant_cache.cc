@@ -0,0 +1,209 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/kernels/shared_constant_cache.h"
+
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <atomic>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <farmhash.h>
+#include "tensorflow/lite/allocation.h"
+#include "tensorflow/lite/minimal_logging.h"
+#include "tensorflow/lite/stderr_reporter.h"
+
+namespace tflite {
+namespace {
+
+constexpr char kBufferSuffix[] = ".constant";
+constexpr char kTempSuffix[] = ".tmp";
+
+// Temporary files older than this were left by a process that failed to
+// store a buffer.
+constexpr time_t kStaleTempSeconds = 3600;
+
+bool EndsWith(const std::string& name, const char* suffix) {
+  const size_t length = strlen(suffix);
+  return name.size() >= length &&
+         name.compare(name.size() - length, length, suffix) == 0;
+}
+
+}  // namespace
+
+SharedConstantCache::SharedConstantCache(const std::string& directory,
+                                         size_t max_bytes)
+    : directory_(directory), max_bytes_(max_bytes) {}
+
+uint64_t SharedConstantCache::Fingerprint(const void* data, size_t size) {
+  return ::util::Fingerprint64(static_cast<const char*>(data), size);
+}
+
+uint64_t SharedConstantCache::CombineFingerprints(uint64_t a, uint64_t b) {
+  // Murmur-inspired hashing.
+  const uint64_t kMul = 0x9ddfea08eb382d69ULL;
+  uint64_t x = (a ^ b) * kMul;
+  x ^= (x >> 47);
+  uint64_t y = (b ^ x) * kMul;
+  y ^= (y >> 44);
+  y *= kMul;
+  return y;
+}
+
+std::string SharedConstantCache::GetPath(uint64_t key) const {
+  char name[32];
+  snprintf(name, sizeof(name), "%016" PRIx64 "%s", key, kBufferSuffix);
+  return directory_ + "/" + name;
+}
+
+std::shared_ptr<const Allocation> SharedConstantCache::MapLocked(uint64_t key,
+                                                                 size_t size) {
+  const auto it = mappings_.find(key);
+  if (it != mappings_.end()) {
+    std::shared_ptr<const Allocation> mapping = it->second.lock();
+    if (mapping != nullptr) {
+      return mapping->bytes() == size ? mapping : nullptr;
+    }
+  }
+  const std::string path = GetPath(key);
+  if (!MMAPAllocation::IsSupported() || !std::ifstream(path).good()) {
+    return nullptr;
+  }
+  auto file_mapping =
+      std::make_shared<MMAPAllocation>(path.c_str(), DefaultErrorReporter());
+  if (!file_mapping->valid() || file_mapping->bytes() != size) {
+    return nullptr;
+  }
+  mappings_[key] = file_mapping;
+  return file_mapping;
+}
+
+std::shared_ptr<const Allocation> SharedConstantCache::Find(uint64_t key,
+                                                            size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return MapLocked(key, size);
+}
+
+std::shared_ptr<const Allocation> SharedConstantCache::Insert(
+    uint64_t key, const void* data, size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::shared_ptr<const Allocation> mapping = MapLocked(key, size);
+  if (mapping != nullptr) return mapping;
+
+  // Renaming is atomic on most systems, so that other processes see either
+  // no file or the complete one. Processes that store the same buffer
+  // concurrently write the same contents, each to its own temporary file.
+  static std::atomic<int> counter(0);
+  const std::string path = GetPath(key);
+  const std::string temp_path = path + "." + std::to_string(getpid()) + "." +
+                                std::to_string(counter++) + kTempSuffix;
+  std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+  file.write(static_cast<const char*>(data), size);
+  file.close();
+  if (file.fail() || std::rename(temp_path.c_str(), path.c_str()) != 0) {
+    TFLITE_LOG_PROD(TFLITE_LOG_WARNING,
+                    "Failed to store %s in the shared constant cache.",
+                    path.c_str());
+    std::remove(temp_path.c_str());
+    return nullptr;
+  }
+  mapping = MapLocked(key, size);
+  if (max_bytes_ > 0) TrimLocked(max_bytes_);
+  return mapping;
+}
+
+size_t SharedConstantCache::Trim(size_t max_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return TrimLocked(max_bytes);
+}
+
+size_t SharedConstantCache::TrimLocked(size_t max_bytes) {
+#if defined(_WIN32)
+  return 0;
+#else
+  struct BufferFile {
+    std::string path;
+    time_t mtime;
+    size_t size;
+    bool mapped;
+  };
+  DIR* dir = opendir(directory_.c_str());
+  if (dir == nullptr) return 0;
+  const time_t now = time(nullptr);
+  std::vector<BufferFile> files;
+  size_t total_bytes = 0;
+  size_t removed_bytes = 0;
+  while (const struct dirent* ent = readdir(dir)) {
+    const std::string name = ent->d_name;
+    const std::string path = directory_ + "/" + name;
+    struct stat file_stat;
+    if (stat(path.c_str(), &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+      continue;
+    }
+    if (EndsWith(name, kTempSuffix)) {
+      if (now - file_stat.st_mtime > kStaleTempSeconds &&
+          std::remove(path.c_str()) == 0) {
+        removed_bytes += file_stat.st_size;
+      }
+      continue;
+    }
+    uint64_t key;
+    if (!EndsWith(name, kBufferSuffix) ||
+        sscanf(name.c_str(), "%" SCNx64, &key) != 1) {
+      continue;
+    }
+    const auto it = mappings_.find(key);
+    const bool mapped = it != mappings_.end() && !it->second.expired();
+    files.push_back({path, file_stat.st_mtime,
+                     static_cast<size_t>(file_stat.st_size), mapped});
+    total_bytes += file_stat.st_size;
+  }
+  closedir(dir);
+
+  std::sort(files.begin(), files.end(),
+            [](const BufferFile& a, const BufferFile& b) {
+              return a.mtime < b.mtime;
+            });
+  for (const BufferFile& file : files) {
+    if (total_bytes <= max_bytes) break;
+    if (file.mapped || std::remove(file.path.c_str()) != 0) continue;
+    total_bytes -= file.size;
+    removed_bytes += file.size;
+  }
+  if (removed_bytes > 0) {
+    TFLITE_LOG_PROD(TFLITE_LOG_INFO,
+                    "Removed %zu bytes from the shared constant cache %s.",
+                    removed_bytes, directory_.c_str());
+  }
+  return removed_bytes;
+#endif
+}
+
+}  // namespace tflite
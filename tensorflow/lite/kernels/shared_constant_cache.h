@@ -0,0 +1,103 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_KERNELS_SHARED_CONSTANT_CACHE_H_
+#define TENSORFLOW_LITE_KERNELS_SHARED_CONSTANT_CACHE_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>  // NOLINT(build/c++11)
+#include <string>
+#include <unordered_map>
+
+#include "tensorflow/lite/allocation.h"
+
+namespace tflite {
+
+// A cache of the constant buffers that kernels derive from constant tensors
+// when they are prepared, such as dequantized weights, shared by all the
+// interpreters of a host.
+//
+// Each buffer is stored in its own file of the cache directory, named after
+// its key. Kernels derive the key from the contents of the source tensor and
+// from the transformation, so that identical constants of different models
+// share one file. The files are mapped read-only: interpreters that use the
+// same directory, in any process, reference one physical copy of each buffer
+// instead of a private copy each. Within a process, the mapping of a buffer
+// is reference-counted, and released with the last kernel that uses it.
+//
+// Kernels find the cache through their CpuBackendContext, see
+// CpuBackendContext::SetSharedConstantCache.
+//
+// The files are trusted as they are: they are only checked to have the
+// expected size, not the expected contents. Any process that can write to
+// the directory can therefore change the constants, e.g. the dequantized
+// weights, of every model that uses the cache. The directory must only be
+// writable by the processes that run the models.
+//
+// The cache does not bound the size of the directory by itself, see `Trim`
+// and the `max_bytes` of the constructor.
+//
+// This class is thread-safe.
+class SharedConstantCache {
+ public:
+  // Creates a cache that stores its files in `directory`, which must exist.
+  // If `max_bytes` is not 0, the cache trims the directory to `max_bytes`
+  // whenever it stores a buffer.
+  explicit SharedConstantCache(const std::string& directory,
+                               size_t max_bytes = 0);
+
+  // Returns a stable fingerprint of `size` bytes at `data`, to build keys.
+  static uint64_t Fingerprint(const void* data, size_t size);
+
+  // Returns a fingerprint that depends on both `a` and `b`.
+  static uint64_t CombineFingerprints(uint64_t a, uint64_t b);
+
+  // Returns the mapping of the buffer `key` of `size` bytes, or nullptr if it
+  // is not cached.
+  std::shared_ptr<const Allocation> Find(uint64_t key, size_t size);
+
+  // Stores `size` bytes at `data` as the buffer `key`, and returns their
+  // mapping, or nullptr if they could not be stored.
+  std::shared_ptr<const Allocation> Insert(uint64_t key, const void* data,
+                                           size_t size);
+
+  // Removes the least recently stored buffers of the directory, other than
+  // those mapped by this cache, until the buffers total at most `max_bytes`,
+  // as well as temporary files left by processes that failed to store a
+  // buffer. Processes that mapped a removed buffer keep their mapping.
+  // Returns the number of bytes removed. Does nothing on Windows.
+  size_t Trim(size_t max_bytes);
+
+ private:
+  std::string GetPath(uint64_t key) const;
+
+  // Returns the mapping of the file of buffer `key` if it holds `size` bytes.
+  // Requires `mutex_`.
+  std::shared_ptr<const Allocation> MapLocked(uint64_t key, size_t size);
+
+  // Requires `mutex_`.
+  size_t TrimLocked(size_t max_bytes);
+
+  const std::string directory_;
+  const size_t max_bytes_;
+
+  std::mutex mutex_;
+  std::unordered_map<uint64_t, std::weak_ptr<const Allocation>> mappings_;
+};
+
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_KERNELS_SHARED_CONSTANT_CACHE_H_
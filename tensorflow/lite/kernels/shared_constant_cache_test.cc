@@ -0,0 +1,144 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/kernels/shared_constant_cache.h"
+
+#include <sys/stat.h>
+#include <utime.h>
+
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+#include "tensorflow/lite/allocation.h"
+
+namespace tflite {
+namespace {
+
+class SharedConstantCacheTest : public ::testing::Test {
+ protected:
+  SharedConstantCacheTest() : data_(1000) {
+    for (int i = 0; i < data_.size(); ++i) data_[i] = 0.5f * i;
+    // Keys are unique per test run, as the directory may be shared.
+    const uint64_t seed = std::random_device()();
+    key_ = SharedConstantCache::Fingerprint(&seed, sizeof(seed));
+  }
+
+  size_t size() const { return data_.size() * sizeof(float); }
+
+  // Returns a new directory for the test.
+  std::string MakeDirectory(const std::string& name) const {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s_%016" PRIx64, directory_.c_str(),
+             name.c_str(), key_);
+    mkdir(path, 0755);
+    return path;
+  }
+
+  // Sets the modification time of the file of buffer `key` in `directory`.
+  void SetStoreTime(const std::string& directory, uint64_t key,
+                    time_t mtime) const {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%016" PRIx64 ".constant",
+             directory.c_str(), key);
+    const struct utimbuf times = {mtime, mtime};
+    ASSERT_EQ(utime(path, &times), 0);
+  }
+
+  const std::string directory_ = ::testing::TempDir();
+  std::vector<float> data_;
+  uint64_t key_;
+};
+
+TEST_F(SharedConstantCacheTest, MapsInsertedBuffer) {
+  SharedConstantCache cache(directory_);
+  EXPECT_EQ(cache.Find(key_, size()), nullptr);
+  std::shared_ptr<const Allocation> mapping =
+      cache.Insert(key_, data_.data(), size());
+  ASSERT_NE(mapping, nullptr);
+  ASSERT_EQ(mapping->bytes(), size());
+  EXPECT_EQ(std::memcmp(mapping->base(), data_.data(), size()), 0);
+
+  // Users of the same cache share one mapping.
+  EXPECT_EQ(cache.Find(key_, size()), mapping);
+  EXPECT_EQ(cache.Insert(key_, data_.data(), size()), mapping);
+  EXPECT_EQ(cache.Find(key_, size() / 2), nullptr);
+}
+
+TEST_F(SharedConstantCacheTest, FindsBufferStoredByOtherCache) {
+  ASSERT_NE(SharedConstantCache(directory_).Insert(key_, data_.data(), size()),
+            nullptr);
+
+  SharedConstantCache cache(directory_);
+  std::shared_ptr<const Allocation> mapping = cache.Find(key_, size());
+  ASSERT_NE(mapping, nullptr);
+  EXPECT_EQ(std::memcmp(mapping->base(), data_.data(), size()), 0);
+  EXPECT_EQ(cache.Find(key_ + 1, size()), nullptr);
+}
+
+TEST_F(SharedConstantCacheTest, ReleasesUnusedMapping) {
+  SharedConstantCache cache(directory_);
+  std::weak_ptr<const Allocation> mapping =
+      cache.Insert(key_, data_.data(), size());
+  EXPECT_TRUE(mapping.expired());
+  // The buffer is mapped again on demand.
+  EXPECT_NE(cache.Find(key_, size()), nullptr);
+}
+
+TEST_F(SharedConstantCacheTest, TrimsLeastRecentlyStoredBuffers) {
+  const std::string directory = MakeDirectory("trim");
+  SharedConstantCache cache(directory);
+  std::shared_ptr<const Allocation> mapping =
+      cache.Insert(key_, data_.data(), size());
+  ASSERT_NE(mapping, nullptr);
+  ASSERT_NE(cache.Insert(key_ + 1, data_.data(), size()), nullptr);
+  ASSERT_NE(cache.Insert(key_ + 2, data_.data(), size()), nullptr);
+  SetStoreTime(directory, key_, 1000);
+  SetStoreTime(directory, key_ + 1, 2000);
+  SetStoreTime(directory, key_ + 2, 3000);
+
+  // The oldest buffer is still mapped, so the next one is removed.
+  EXPECT_EQ(cache.Trim(2 * size()), size());
+  EXPECT_EQ(cache.Find(key_ + 1, size()), nullptr);
+  EXPECT_NE(cache.Find(key_ + 2, size()), nullptr);
+  EXPECT_EQ(cache.Trim(2 * size()), 0);
+  EXPECT_EQ(cache.Trim(0), size());
+  EXPECT_EQ(cache.Find(key_ + 2, size()), nullptr);
+  EXPECT_EQ(cache.Find(key_, size()), mapping);
+}
+
+TEST_F(SharedConstantCacheTest, BoundsDirectorySize) {
+  const std::string directory = MakeDirectory("bounded");
+  SharedConstantCache cache(directory, /*max_bytes=*/size());
+  ASSERT_NE(cache.Insert(key_, data_.data(), size()), nullptr);
+  std::shared_ptr<const Allocation> mapping =
+      cache.Insert(key_ + 1, data_.data(), size());
+  ASSERT_NE(mapping, nullptr);
+  EXPECT_EQ(cache.Find(key_, size()), nullptr);
+  EXPECT_EQ(cache.Find(key_ + 1, size()), mapping);
+}
+
+TEST_F(SharedConstantCacheTest, FailsToStoreInMissingDirectory) {
+  SharedConstantCache cache(directory_ + "/missing");
+  EXPECT_EQ(cache.Insert(key_, data_.data(), size()), nullptr);
+}
+
+}  // namespace
+}  // namespace tflite
@@ -0,0 +1,165 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/profiling/memory_timeline_profiler.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <utility>
+#include <vector>
+
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/subgraph.h"
+
+namespace tflite::profiling {
+namespace {
+
+void MarkUse(const TfLiteIntArray* tensors, int position,
+             std::vector<int>* first_use, std::vector<int>* last_use) {
+  if (tensors == nullptr) return;
+  for (int i = 0; i < tensors->size; ++i) {
+    const int tensor_index = tensors->data[i];
+    if (tensor_index < 0 ||
+        static_cast<size_t>(tensor_index) >= first_use->size()) {
+      continue;
+    }
+    int& first = (*first_use)[tensor_index];
+    first = first < 0 ? position : std::min(first, position);
+    (*last_use)[tensor_index] = std::max((*last_use)[tensor_index], position);
+  }
+}
+
+bool IsArenaTensor(const TfLiteTensor* tensor) {
+  return tensor->allocation_type == kTfLiteArenaRw &&
+         tensor->data.raw != nullptr;
+}
+
+}  // namespace
+
+MemoryTimelineProfiler::MemoryTimelineProfiler(const Interpreter& interpreter)
+    : interpreter_(interpreter) {}
+
+uint32_t MemoryTimelineProfiler::BeginEvent(const char* tag,
+                                            EventType event_type,
+                                            int64_t event_metadata1,
+                                            int64_t event_metadata2) {
+  // The "Invoke" event triggered by Subgraph::InvokeImpl() precedes the
+  // operators of the subgraph, whose allocations are then final.
+  if (event_type == EventType::DEFAULT && !strcmp(tag, "Invoke")) {
+    ComputeLifetimes(/*subgraph_index=*/event_metadata2);
+    return 0;
+  }
+  if (event_type != EventType::OPERATOR_INVOKE_EVENT) return 0;
+  MemorySnapshot snapshot;
+  snapshot.subgraph_index = event_metadata2;
+  snapshot.node_index = event_metadata1;
+  snapshot.op_name = tag;
+  timeline_.push_back(std::move(snapshot));
+  return timeline_.size();
+}
+
+void MemoryTimelineProfiler::EndEvent(uint32_t event_handle) {
+  if (!event_handle || timeline_.size() < event_handle) return;
+  TakeSnapshot(&timeline_[event_handle - 1]);
+}
+
+void MemoryTimelineProfiler::ComputeLifetimes(int subgraph_index) {
+  const Subgraph* subgraph = interpreter_.subgraph(subgraph_index);
+  if (subgraph == nullptr) return;
+  const std::vector<int>& execution_plan = subgraph->execution_plan();
+  const int end = static_cast<int>(execution_plan.size()) - 1;
+
+  Lifetimes& lifetimes = lifetimes_[subgraph_index];
+  lifetimes.node_positions.assign(subgraph->nodes_size(), -1);
+  lifetimes.first_use.assign(subgraph->tensors_size(), -1);
+  lifetimes.last_use.assign(subgraph->tensors_size(), -1);
+  // Inputs and variables are live from the beginning, outputs and variables
+  // until the end.
+  for (int tensor_index : subgraph->inputs()) {
+    if (tensor_index >= 0) lifetimes.first_use[tensor_index] = 0;
+  }
+  for (int tensor_index : subgraph->variables()) {
+    lifetimes.first_use[tensor_index] = 0;
+    lifetimes.last_use[tensor_index] = end;
+  }
+  for (int tensor_index : subgraph->outputs()) {
+    if (tensor_index >= 0) lifetimes.last_use[tensor_index] = end;
+  }
+  for (int position = 0; position <= end; ++position) {
+    const int node_index = execution_plan[position];
+    lifetimes.node_positions[node_index] = position;
+    const TfLiteNode& node = subgraph->node_and_registration(node_index)->first;
+    MarkUse(node.inputs, position, &lifetimes.first_use, &lifetimes.last_use);
+    MarkUse(node.outputs, position, &lifetimes.first_use, &lifetimes.last_use);
+    MarkUse(node.intermediates, position, &lifetimes.first_use,
+            &lifetimes.last_use);
+    MarkUse(node.temporaries, position, &lifetimes.first_use,
+            &lifetimes.last_use);
+  }
+
+  lifetimes.arena_base = UINTPTR_MAX;
+  const int num_tensors = static_cast<int>(subgraph->tensors_size());
+  for (int i = 0; i < num_tensors; ++i) {
+    const TfLiteTensor* tensor = subgraph->tensor(i);
+    if (IsArenaTensor(tensor)) {
+      lifetimes.arena_base = std::min(
+          lifetimes.arena_base, reinterpret_cast<uintptr_t>(tensor->data.raw));
+    }
+  }
+}
+
+void MemoryTimelineProfiler::TakeSnapshot(MemorySnapshot* snapshot) const {
+  const Subgraph* subgraph = interpreter_.subgraph(snapshot->subgraph_index);
+  const auto it = lifetimes_.find(snapshot->subgraph_index);
+  if (subgraph == nullptr || it == lifetimes_.end()) return;
+  const Lifetimes& lifetimes = it->second;
+  if (snapshot->node_index < 0 ||
+      static_cast<size_t>(snapshot->node_index) >=
+          lifetimes.node_positions.size()) {
+    return;
+  }
+  const int position = lifetimes.node_positions[snapshot->node_index];
+
+  Subgraph::SubgraphAllocInfo alloc_info;
+  subgraph->GetMemoryAllocInfo(&alloc_info);
+  snapshot->persistent_bytes =
+      alloc_info.arena_persist_size + alloc_info.resource_size;
+  snapshot->dynamic_bytes = alloc_info.dynamic_size;
+
+  uintptr_t arena_end = lifetimes.arena_base;
+  const int num_tensors = static_cast<int>(subgraph->tensors_size());
+  const int num_tracked_tensors = static_cast<int>(lifetimes.first_use.size());
+  for (int i = 0; i < num_tensors; ++i) {
+    const TfLiteTensor* tensor = subgraph->tensor(i);
+    if (tensor->allocation_type == kTfLiteDynamic &&
+        tensor->data.raw != nullptr) {
+      snapshot->live_tensors.push_back(i);
+      continue;
+    }
+    if (!IsArenaTensor(tensor) || i >= num_tracked_tensors ||
+        lifetimes.first_use[i] < 0 || lifetimes.first_use[i] > position ||
+        lifetimes.last_use[i] < position) {
+      continue;
+    }
+    snapshot->live_tensors.push_back(i);
+    snapshot->arena_live_bytes += tensor->bytes;
+    arena_end = std::max(
+        arena_end, reinterpret_cast<uintptr_t>(tensor->data.raw) +
+                       tensor->bytes);
+  }
+  snapshot->arena_high_water_bytes = arena_end - lifetimes.arena_base;
+}
+
+}  // namespace tflite::profiling
@@ -0,0 +1,103 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#ifndef TENSORFLOW_LITE_PROFILING_MEMORY_TIMELINE_PROFILER_H_
+#define TENSORFLOW_LITE_PROFILING_MEMORY_TIMELINE_PROFILER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tensorflow/lite/core/api/profiler.h"
+#include "tensorflow/lite/interpreter.h"
+
+namespace tflite::profiling {
+
+// The memory used by a subgraph right after one of its operators ran.
+struct MemorySnapshot {
+  int subgraph_index = 0;
+  int node_index = 0;
+  // The tag of the operator event, i.e. the name of the operator.
+  std::string op_name;
+  // Total size of the arena tensors that are live at the operator.
+  size_t arena_live_bytes = 0;
+  // Extent of the arena used by the tensors that are live at the operator,
+  // from the beginning of the arena to the end of the last live tensor. Its
+  // maximum over the timeline is the high-water mark of the arena.
+  size_t arena_high_water_bytes = 0;
+  // Bytes allocated outside of the arena: the persistent arena (persistent
+  // tensors and kernel buffers) and resource variables, then dynamic tensors.
+  size_t persistent_bytes = 0;
+  size_t dynamic_bytes = 0;
+  // Indices of the arena and dynamic tensors that are live at the operator.
+  std::vector<int> live_tensors;
+
+  size_t total_bytes() const {
+    return arena_high_water_bytes + persistent_bytes + dynamic_bytes;
+  }
+};
+
+// The MemoryTimelineProfiler records the memory used by each subgraph after
+// each operator invocation, to find which operators and tensors make up the
+// peak memory usage of a model. See ProfileSummarizer::GetMemoryReport to
+// format the timeline.
+//
+// Tensors are live from the first to the last operator of the execution plan
+// that uses them, which is how the arena planner assigns memory.
+class MemoryTimelineProfiler : public tflite::Profiler {
+ public:
+  explicit MemoryTimelineProfiler(const Interpreter& interpreter);
+
+  uint32_t BeginEvent(const char* tag, EventType event_type,
+                      int64_t event_metadata1,
+                      int64_t event_metadata2) override;
+
+  void EndEvent(uint32_t event_handle) override;
+
+  // Returns the snapshots recorded since the last Reset, in execution order.
+  const std::vector<MemorySnapshot>& timeline() const { return timeline_; }
+
+  void Reset() { timeline_.clear(); }
+
+ private:
+  // The positions in the execution plan where the tensors of a subgraph are
+  // live, computed at the beginning of each invocation of the subgraph.
+  struct Lifetimes {
+    // Position of each node in the execution plan, or -1.
+    std::vector<int> node_positions;
+    // First and last positions where each tensor is live, or -1.
+    std::vector<int> first_use;
+    std::vector<int> last_use;
+    // Lowest address of the arena tensors.
+    uintptr_t arena_base = 0;
+  };
+
+  void ComputeLifetimes(int subgraph_index);
+
+  // Fills the memory usage of `snapshot`, whose operator just ran.
+  void TakeSnapshot(MemorySnapshot* snapshot) const;
+
+  // A handle to the active TFLite interpreter.
+  const Interpreter& interpreter_;
+
+  std::map<int, Lifetimes> lifetimes_;
+
+  std::vector<MemorySnapshot> timeline_;
+};
+
+}  // namespace tflite::profiling
+
+#endif  // TENSORFLOW_LITE_PROFILING_MEMORY_TIMELINE_PROFILER_H_
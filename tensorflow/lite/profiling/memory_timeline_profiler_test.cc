@@ -0,0 +1,116 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+#include "tensorflow/lite/profiling/memory_timeline_profiler.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <gmock/gmock.h>
+#include <gtest/gtest.h>
+#include "tensorflow/lite/core/c/builtin_op_data.h"
+#include "tensorflow/lite/core/c/common.h"
+#include "tensorflow/lite/core/kernels/builtin_op_kernels.h"
+#include "tensorflow/lite/interpreter.h"
+
+namespace tflite::profiling {
+namespace {
+
+using ::testing::ElementsAre;
+
+constexpr int kNumElements = 100;
+constexpr size_t kTensorBytes = kNumElements * sizeof(float);
+
+// Builds
+//   t2 = t0 + t1
+//   t3 = t2 + t2
+//   t4 = t3 + t1
+// where t0 and t1 are inputs, and t4 the output.
+void BuildGraph(Interpreter* interpreter) {
+  TfLiteQuantizationParams quant;
+  interpreter->AddTensors(5);
+  interpreter->SetInputs({0, 1});
+  interpreter->SetOutputs({4});
+  const char* names[] = {"t0", "t1", "t2", "t3", "t4"};
+  for (int tensor = 0; tensor < 5; ++tensor) {
+    interpreter->SetTensorParametersReadWrite(tensor, kTfLiteFloat32,
+                                              names[tensor], {kNumElements},
+                                              quant);
+  }
+  for (const std::vector<int>& inputs_and_output :
+       std::vector<std::vector<int>>{{0, 1, 2}, {2, 2, 3}, {3, 1, 4}}) {
+    auto* params =
+        static_cast<TfLiteAddParams*>(malloc(sizeof(TfLiteAddParams)));
+    *params = {};
+    params->activation = kTfLiteActNone;
+    interpreter->AddNodeWithParameters(
+        {inputs_and_output[0], inputs_and_output[1]}, {inputs_and_output[2]},
+        nullptr, 0, params, ops::builtin::Register_ADD());
+  }
+}
+
+TEST(MemoryTimelineProfilerTest, RecordsLiveTensorsPerNode) {
+  Interpreter interpreter;
+  BuildGraph(&interpreter);
+  ASSERT_EQ(interpreter.AllocateTensors(), kTfLiteOk);
+  MemoryTimelineProfiler profiler(interpreter);
+  interpreter.SetProfiler(&profiler);
+  ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+
+  const std::vector<MemorySnapshot>& timeline = profiler.timeline();
+  ASSERT_EQ(timeline.size(), 3);
+  for (int node = 0; node < 3; ++node) {
+    EXPECT_EQ(timeline[node].subgraph_index, 0);
+    EXPECT_EQ(timeline[node].node_index, node);
+    EXPECT_EQ(timeline[node].op_name, "ADD");
+    EXPECT_EQ(timeline[node].dynamic_bytes, 0);
+  }
+  // t0 is only used by the first node, and t4 only produced by the last one.
+  EXPECT_THAT(timeline[0].live_tensors, ElementsAre(0, 1, 2));
+  EXPECT_THAT(timeline[1].live_tensors, ElementsAre(1, 2, 3));
+  EXPECT_THAT(timeline[2].live_tensors, ElementsAre(1, 3, 4));
+  EXPECT_EQ(timeline[1].arena_live_bytes, 3 * kTensorBytes);
+
+  Subgraph::SubgraphAllocInfo alloc_info;
+  interpreter.primary_subgraph().GetMemoryAllocInfo(&alloc_info);
+  size_t high_water_bytes = 0;
+  for (const MemorySnapshot& snapshot : timeline) {
+    EXPECT_GE(snapshot.arena_high_water_bytes, snapshot.arena_live_bytes);
+    high_water_bytes =
+        std::max(high_water_bytes, snapshot.arena_high_water_bytes);
+  }
+  EXPECT_LE(high_water_bytes, alloc_info.arena_size);
+
+  ASSERT_EQ(interpreter.Invoke(), kTfLiteOk);
+  EXPECT_EQ(profiler.timeline().size(), 6);
+  profiler.Reset();
+  EXPECT_TRUE(profiler.timeline().empty());
+}
+
+TEST(MemoryTimelineProfilerTest, IgnoresOtherEvents) {
+  Interpreter interpreter;
+  BuildGraph(&interpreter);
+  MemoryTimelineProfiler profiler(interpreter);
+  EXPECT_EQ(profiler.BeginEvent("Invoke", Profiler::EventType::DEFAULT, 0, 0),
+            0);
+  EXPECT_EQ(profiler.BeginEvent("AllocateTensors",
+                                Profiler::EventType::DEFAULT, 0, 0),
+            0);
+  EXPECT_TRUE(profiler.timeline().empty());
+}
+
+}  // namespace
+}  // namespace tflite::profiling
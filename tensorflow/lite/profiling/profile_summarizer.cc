@@ -15,6 +15,7 @@ limitations under the License.
 
 #include "tensorflow/lite/profiling/profile_summarizer.h"
 
+#include <algorithm>
 #include <memory>
 #include <sstream>
 #include <string>
@@ -203,6 +204,57 @@ void ProfileSummarizer::ProcessProfiles(
   }
 }
 
+std::string ProfileSummarizer::GetMemoryReport(
+    const std::vector<MemorySnapshot>& timeline,
+    const tflite::Interpreter& interpreter) const {
+  std::stringstream stream;
+  stream << "Memory timeline:" << std::endl;
+  stream << "subgraph,node,op,arena_live_bytes,arena_high_water_bytes,"
+            "persistent_bytes,dynamic_bytes,total_bytes"
+         << std::endl;
+  const MemorySnapshot* peak = nullptr;
+  for (const MemorySnapshot& snapshot : timeline) {
+    stream << snapshot.subgraph_index << "," << snapshot.node_index << ","
+           << snapshot.op_name << "," << snapshot.arena_live_bytes << ","
+           << snapshot.arena_high_water_bytes << ","
+           << snapshot.persistent_bytes << "," << snapshot.dynamic_bytes << ","
+           << snapshot.total_bytes() << std::endl;
+    if (peak == nullptr || snapshot.total_bytes() > peak->total_bytes()) {
+      peak = &snapshot;
+    }
+  }
+  if (peak == nullptr) return stream.str();
+
+  stream << "Peak memory: " << peak->total_bytes() << " bytes after node "
+         << peak->node_index << " (" << peak->op_name << ") of subgraph "
+         << peak->subgraph_index << std::endl;
+  stream << "  arena high-water: " << peak->arena_high_water_bytes
+         << " bytes, persistent: " << peak->persistent_bytes
+         << " bytes, dynamic: " << peak->dynamic_bytes << " bytes"
+         << std::endl;
+
+  const Subgraph* subgraph = interpreter.subgraph(peak->subgraph_index);
+  if (subgraph == nullptr) return stream.str();
+  std::vector<const TfLiteTensor*> live_tensors;
+  for (int tensor_index : peak->live_tensors) {
+    live_tensors.push_back(subgraph->tensor(tensor_index));
+  }
+  std::stable_sort(live_tensors.begin(), live_tensors.end(),
+                   [](const TfLiteTensor* a, const TfLiteTensor* b) {
+                     return a->bytes > b->bytes;
+                   });
+  stream << "Live tensors at the peak, by size:" << std::endl;
+  for (const TfLiteTensor* tensor : live_tensors) {
+    const double share =
+        100.0 * tensor->bytes / std::max<size_t>(peak->total_bytes(), 1);
+    stream << "  " << (tensor->name ? tensor->name : "Unknown") << ": "
+           << tensor->bytes << " bytes (" << share << "%, "
+           << (tensor->allocation_type == kTfLiteDynamic ? "dynamic" : "arena")
+           << ")" << std::endl;
+  }
+  return stream.str();
+}
+
 tensorflow::StatsCalculator* ProfileSummarizer::GetStatsCalculator(
     uint32_t subgraph_index) {
   if (stats_calculator_map_.count(subgraph_index) == 0) {
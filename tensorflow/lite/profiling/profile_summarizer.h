@@ -24,6 +24,7 @@ limitations under the License.
 
 #include "tensorflow/core/util/stats_calculator.h"
 #include "tensorflow/lite/core/interpreter.h"
+#include "tensorflow/lite/profiling/memory_timeline_profiler.h"
 #include "tensorflow/lite/profiling/profile_buffer.h"
 #include "tensorflow/lite/profiling/profile_summary_formatter.h"
 
@@ -54,8 +55,20 @@ class ProfileSummarizer {
                                                *delegate_stats_calculator_);
   }
 
+  // Returns a report of the memory timeline recorded by a
+  // MemoryTimelineProfiler: the memory used after each operator, as CSV, then
+  // the operator at the peak and the live tensors that make it up.
+  std::string GetMemoryReport(const std::vector<MemorySnapshot>& timeline,
+                              const tflite::Interpreter& interpreter) const;
+
   tensorflow::StatsCalculator* GetStatsCalculator(uint32_t subgraph_index);
 
+  // Returns the stats of each subgraph, keyed by subgraph index.
+  const std::map<uint32_t, std::unique_ptr<tensorflow::StatsCalculator>>&
+  GetStatsCalculatorMap() const {
+    return stats_calculator_map_;
+  }
+
   bool HasProfiles() {
     for (auto& stats_calc : stats_calculator_map_) {
       auto subgraph_stats = stats_calc.second.get();
@@ -26,6 +26,7 @@ limitations under the License.
 #include "tensorflow/lite/kernels/subgraph_test_util.h"
 #include "tensorflow/lite/kernels/test_util.h"
 #include "tensorflow/lite/profiling/buffered_profiler.h"
+#include "tensorflow/lite/profiling/memory_timeline_profiler.h"
 #include "tensorflow/lite/version.h"
 
 namespace tflite {
@@ -149,6 +150,23 @@ TEST(ProfileSummarizerTest, InterpreterPlusProfilingDetails) {
       << output;
 }
 
+TEST(ProfileSummarizerTest, MemoryReport) {
+  SimpleOpModel m;
+  m.Init(RegisterSimpleOp);
+  auto interpreter = m.GetInterpreter();
+  MemoryTimelineProfiler profiler(*interpreter);
+  interpreter->SetProfiler(&profiler);
+  m.SetInputs(1, 2);
+  ASSERT_EQ(m.Invoke(), kTfLiteOk);
+  ASSERT_EQ(profiler.timeline().size(), 1);
+  ProfileSummarizer summarizer;
+  auto output = summarizer.GetMemoryReport(profiler.timeline(), *interpreter);
+  ASSERT_TRUE(output.find("0,0,SimpleOpEval,") != std::string::npos)
+      << output;
+  ASSERT_TRUE(output.find("Peak memory") != std::string::npos) << output;
+  ASSERT_TRUE(output.find("(SimpleOpEval)") != std::string::npos) << output;
+}
+
 // A simple test that performs `ADD` if condition is true, and `MUL` otherwise.
 // The computation is: `cond ? a + b : a * b`.
 class ProfileSummarizerIfOpTest : public subgraph_test_util::ControlFlowOpTest {
@@ -112,6 +112,24 @@ class SimpleMemoryArena {
                             const ArenaAllocWithUsageInterval& alloc,
                             char** output_ptr);
 
+  // The allocation plan calculated by Allocate(): the allocs that are active
+  // and the required buffer size.
+  struct Plan {
+    size_t high_water_mark = 0;
+    std::vector<ArenaAllocWithUsageInterval> active_allocs;
+  };
+
+  // Returns the current allocation plan.
+  Plan GetPlan() const { return {high_water_mark_, active_allocs_}; }
+
+  // Replaces the allocation plan with one previously returned by GetPlan().
+  // The arena must be committed and the allocations resolved again.
+  void RestorePlan(const Plan& plan) {
+    committed_ = false;
+    high_water_mark_ = plan.high_water_mark;
+    active_allocs_ = plan.active_allocs;
+  }
+
   // This clears allocation details but does not release the underlying buffer.
   // New allocations should be committed & resolved before using this arena
   // again.
@@ -30,6 +30,7 @@ limitations under the License.
 #include "tensorflow/lite/profiling/memory_info.h"
 #include "tensorflow/lite/profiling/memory_usage_monitor.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_params.h"
+#include "tensorflow/lite/tools/benchmark/op_latency_regression.h"
 #include "tensorflow/lite/tools/command_line_flags.h"
 
 namespace tflite {
@@ -200,6 +201,10 @@ class BenchmarkModel {
 
   BenchmarkParams* mutable_params() { return &params_; }
 
+  // Returns the latency of each op over the regular runs of the last Run(),
+  // if op profiling is enabled and supported by the model.
+  virtual OpLatencies MayGetOpLatencies() const { return {}; }
+
   // Unparsable flags will remain in 'argv' in the original order and 'argc'
   // will be updated accordingly.
   TfLiteStatus ParseFlags(int* argc, char** argv);
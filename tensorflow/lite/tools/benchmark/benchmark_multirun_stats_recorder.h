@@ -17,9 +17,11 @@ limitations under the License.
 
 #include <memory>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "tensorflow/lite/tools/benchmark/benchmark_model.h"
+#include "tensorflow/lite/tools/benchmark/op_latency_regression.h"
 
 namespace tflite {
 namespace benchmark {
@@ -44,13 +46,22 @@ class MultiRunStatsRecorder : public BenchmarkListener {
     current.metrics = results;
   }
 
+  // Records the op latencies of the current run, if op profiling is enabled.
+  void MarkOpLatencies(OpLatencies op_latencies) {
+    results_.back().op_latencies = std::move(op_latencies);
+  }
+
   virtual void OutputStats();
 
+  // Returns the op latencies of the completed runs, keyed by RunName().
+  OpLatencyBaseline GetOpLatencyBaseline() const;
+
  protected:
   struct EachRunResult {
     bool completed = false;
     std::unique_ptr<BenchmarkParams> params;
     BenchmarkResults metrics;
+    OpLatencies op_latencies;
   };
   std::vector<EachRunResult> results_;
 
@@ -67,6 +78,9 @@ class MultiRunStatsRecorder : public BenchmarkListener {
   };
 
   virtual std::string PerfOptionName(const BenchmarkParams& params) const;
+
+  // Identifies a run across benchmarks by its model and performance options.
+  virtual std::string RunName(const BenchmarkParams& params) const;
 };
 }  // namespace benchmark
 }  // namespace tflite
@@ -22,6 +22,7 @@ limitations under the License.
 #include <sstream>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "tensorflow/core/util/stats_calculator.h"
 #include "tensorflow/lite/core/c/c_api_types.h"
@@ -120,6 +121,21 @@ void MultiRunStatsRecorder::OutputStats() {
   }
 }
 
+std::string MultiRunStatsRecorder::RunName(
+    const BenchmarkParams& params) const {
+  if (!params.HasParam("graph")) return PerfOptionName(params);
+  return params.Get<std::string>("graph") + ": " + PerfOptionName(params);
+}
+
+OpLatencyBaseline MultiRunStatsRecorder::GetOpLatencyBaseline() const {
+  OpLatencyBaseline baseline;
+  for (const auto& run_stats : results_) {
+    if (!run_stats.completed || run_stats.op_latencies.empty()) continue;
+    baseline[RunName(*run_stats.params)] = run_stats.op_latencies;
+  }
+  return baseline;
+}
+
 BenchmarkPerformanceOptions::BenchmarkPerformanceOptions(
     BenchmarkModel* single_option_run,
     std::unique_ptr<MultiRunStatsRecorder> all_run_stats)
@@ -144,6 +160,13 @@ BenchmarkParams BenchmarkPerformanceOptions::DefaultParams() {
                   BenchmarkParam::Create<float>(-1.0f));
   params.AddParam("random_shuffle_benchmark_runs",
                   BenchmarkParam::Create<bool>(true));
+  params.AddParam("graphs", BenchmarkParam::Create<std::string>(""));
+  params.AddParam("op_latency_output_file",
+                  BenchmarkParam::Create<std::string>(""));
+  params.AddParam("op_latency_baseline_file",
+                  BenchmarkParam::Create<std::string>(""));
+  params.AddParam("op_latency_regression_threshold",
+                  BenchmarkParam::Create<float>(0.05f));
   return params;
 }
 
@@ -162,6 +185,26 @@ std::vector<Flag> BenchmarkPerformanceOptions::GetFlags() {
           "random_shuffle_benchmark_runs", &params_,
           "Whether to perform all benchmark runs, each of which has different "
           "performance options, in a random order. It is enabled by default."),
+      CreateFlag<std::string>(
+          "graphs", &params_,
+          "A comma-separated list of models, each of which is benchmarked "
+          "with all the performance options. If empty, only the model set by "
+          "--graph is benchmarked."),
+      CreateFlag<std::string>(
+          "op_latency_output_file", &params_,
+          "If set, op profiling is enabled and the latency of each op in each "
+          "run is written to this file, to be used as a baseline by later "
+          "benchmarks."),
+      CreateFlag<std::string>(
+          "op_latency_baseline_file", &params_,
+          "If set, op profiling is enabled and the latency of each op in each "
+          "run is compared with the one recorded in this file by "
+          "--op_latency_output_file. The benchmark fails if any op is "
+          "significantly slower."),
+      CreateFlag<float>(
+          "op_latency_regression_threshold", &params_,
+          "The relative slowdown of an op over its baseline latency, at 95% "
+          "confidence, above which it is reported as a regression."),
   };
 }
 
@@ -352,10 +395,22 @@ void BenchmarkPerformanceOptions::CreatePerformanceOptions() {
 TfLiteStatus BenchmarkPerformanceOptions::Run() {
   CreatePerformanceOptions();
 
-  if (params_.Get<bool>("random_shuffle_benchmark_runs")) {
-    std::random_device rd;
-    std::mt19937 generator(rd());
-    std::shuffle(all_run_params_.begin(), all_run_params_.end(), generator);
+  std::vector<std::string> graphs;
+  const auto& graphs_list = params_.Get<std::string>("graphs");
+  if (!graphs_list.empty()) {
+    if (!single_option_run_params_->HasParam("graph") ||
+        !util::SplitAndParse(graphs_list, ',', &graphs)) {
+      TFLITE_LOG(ERROR) << "Cannot benchmark the models of --graphs: '"
+                        << graphs_list << "'.";
+      return kTfLiteError;
+    }
+  }
+
+  // Per-op latencies are collected by the op profiler.
+  if ((!params_.Get<std::string>("op_latency_output_file").empty() ||
+       !params_.Get<std::string>("op_latency_baseline_file").empty()) &&
+      single_option_run_params_->HasParam("enable_op_profiling")) {
+    single_option_run_params_->Set<bool>("enable_op_profiling", true);
   }
 
   // We need to clean *internally* created benchmark listeners, like the
@@ -364,31 +419,87 @@ TfLiteStatus BenchmarkPerformanceOptions::Run() {
   // number of externally-added listeners here to prevent they're cleared later.
   const int num_external_listeners = single_option_run_->NumListeners();
 
-  // Now perform all runs, each with different performance-affecting parameters.
-  for (const auto& run_params : all_run_params_) {
-    // If the run_params is empty, then it means "none" is set for
-    // --perf_options_list.
-    if (!run_params.Empty()) {
-      // Reset all performance-related options before any runs.
-      ResetPerformanceOptions();
-      single_option_run_params_->Set(run_params);
+  // Benchmark the model set for single-option runs if --graphs is empty.
+  if (graphs.empty()) graphs.emplace_back();
+  for (const auto& graph : graphs) {
+    if (!graph.empty()) {
+      single_option_run_params_->Set<std::string>("graph", graph);
+    }
+    if (params_.Get<bool>("random_shuffle_benchmark_runs")) {
+      std::random_device rd;
+      std::mt19937 generator(rd());
+      std::shuffle(all_run_params_.begin(), all_run_params_.end(), generator);
     }
-    util::SleepForSeconds(params_.Get<float>("option_benchmark_run_delay"));
-
-    // Clear internally created listeners before each run but keep externally
-    // created ones.
-    single_option_run_->RemoveListeners(num_external_listeners);
 
-    all_run_stats_->MarkBenchmarkStart(*single_option_run_params_);
-    if (TfLiteStatus status = single_option_run_->Run(); status != kTfLiteOk) {
-      TFLITE_LOG(ERROR) << "Error while running a single-option run: "
-                        << status;
-      return status;
+    // Now perform all runs, each with different performance-affecting
+    // parameters.
+    for (const auto& run_params : all_run_params_) {
+      // If the run_params is empty, then it means "none" is set for
+      // --perf_options_list.
+      if (!run_params.Empty()) {
+        // Reset all performance-related options before any runs.
+        ResetPerformanceOptions();
+        single_option_run_params_->Set(run_params);
+      }
+      util::SleepForSeconds(params_.Get<float>("option_benchmark_run_delay"));
+
+      // Clear internally created listeners before each run but keep
+      // externally created ones.
+      single_option_run_->RemoveListeners(num_external_listeners);
+
+      all_run_stats_->MarkBenchmarkStart(*single_option_run_params_);
+      if (TfLiteStatus status = single_option_run_->Run();
+          status != kTfLiteOk) {
+        TFLITE_LOG(ERROR) << "Error while running a single-option run: "
+                          << status;
+        return status;
+      }
+      all_run_stats_->MarkOpLatencies(single_option_run_->MayGetOpLatencies());
     }
   }
 
   all_run_stats_->OutputStats();
-  return kTfLiteOk;
+  return CheckOpLatencies();
+}
+
+TfLiteStatus BenchmarkPerformanceOptions::CheckOpLatencies() {
+  const OpLatencyBaseline op_latencies = all_run_stats_->GetOpLatencyBaseline();
+  const auto& output_file = params_.Get<std::string>("op_latency_output_file");
+  if (!output_file.empty()) {
+    TF_LITE_ENSURE_STATUS(WriteOpLatencyBaseline(op_latencies, output_file));
+    TFLITE_LOG(INFO) << "Wrote the op latencies to '" << output_file << "'.";
+  }
+
+  const auto& baseline_file =
+      params_.Get<std::string>("op_latency_baseline_file");
+  if (baseline_file.empty()) return kTfLiteOk;
+  OpLatencyBaseline baseline;
+  TF_LITE_ENSURE_STATUS(ReadOpLatencyBaseline(baseline_file, &baseline));
+  const std::vector<OpLatencyRegression> regressions =
+      FindOpLatencyRegressions(
+          baseline, op_latencies,
+          params_.Get<float>("op_latency_regression_threshold"));
+
+  TFLITE_LOG(INFO) << "\n==============Op Latency Regressions w/ 95% "
+                      "Confidence==============";
+  for (const auto& regression : regressions) {
+    std::stringstream stream;
+    stream << regression.run << " " << regression.op << ": avg "
+           << regression.baseline.avg_us << "us (std "
+           << regression.baseline.std_deviation_us << "us, count "
+           << regression.baseline.count << ") -> "
+           << regression.current.avg_us << "us (std "
+           << regression.current.std_deviation_us << "us, count "
+           << regression.current.count << "), slower by at least "
+           << regression.min_slowdown_us << "us";
+    TFLITE_LOG(ERROR) << stream.str();
+  }
+  if (regressions.empty()) {
+    TFLITE_LOG(INFO) << "No op is significantly slower than in '"
+                     << baseline_file << "'.";
+    return kTfLiteOk;
+  }
+  return kTfLiteError;
 }
 
 TfLiteStatus BenchmarkPerformanceOptions::Run(int argc, char** argv) {
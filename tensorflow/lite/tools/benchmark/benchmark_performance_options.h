@@ -24,6 +24,7 @@ limitations under the License.
 #include "tensorflow/lite/tools/benchmark/benchmark_model.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_multirun_stats_recorder.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_params.h"
+#include "tensorflow/lite/tools/benchmark/op_latency_regression.h"
 
 namespace tflite {
 namespace benchmark {
@@ -63,6 +64,11 @@ class BenchmarkPerformanceOptions {
   virtual void ResetPerformanceOptions();
   virtual void CreatePerformanceOptions();
 
+  // Writes the op latencies of all runs to --op_latency_output_file and
+  // compares them with --op_latency_baseline_file, if set. Returns an error if
+  // any op regressed.
+  TfLiteStatus CheckOpLatencies();
+
   BenchmarkParams params_;
   std::vector<std::string> perf_options_;
 
@@ -755,6 +755,7 @@ TfLiteStatus BenchmarkTfLiteModel::InitInterpreter() {
 }
 
 TfLiteStatus BenchmarkTfLiteModel::Init() {
+  profiling_listener_ = nullptr;
   TF_LITE_ENSURE_STATUS(LoadModel());
   TF_LITE_ENSURE_STATUS(InitInterpreter());
 
@@ -774,7 +775,10 @@ TfLiteStatus BenchmarkTfLiteModel::Init() {
                          total_nodes + kProfilingBufferHeadrooms);
   }
 
-  AddOwnedListener(MayCreateProfilingListener());
+  std::unique_ptr<ProfilingListener> profiling_listener =
+      MayCreateProfilingListener();
+  profiling_listener_ = profiling_listener.get();
+  AddOwnedListener(std::move(profiling_listener));
   AddOwnedListener(std::unique_ptr<BenchmarkListener>(
       new InterpreterStatePrinter(interpreter_.get())));
 
@@ -948,11 +952,11 @@ std::unique_ptr<tflite::OpResolver> BenchmarkTfLiteModel::GetOpResolver()
   return std::unique_ptr<tflite::OpResolver>(resolver);
 }
 
-std::unique_ptr<BenchmarkListener>
+std::unique_ptr<ProfilingListener>
 BenchmarkTfLiteModel::MayCreateProfilingListener() const {
   if (!params_.Get<bool>("enable_op_profiling")) return nullptr;
 
-  return std::unique_ptr<BenchmarkListener>(new ProfilingListener(
+  return std::unique_ptr<ProfilingListener>(new ProfilingListener(
       interpreter_.get(), params_.Get<int32_t>("max_profiling_buffer_entries"),
       params_.Get<bool>("allow_dynamic_profiling_buffer_increase"),
       params_.Get<std::string>("profiling_output_csv_file"),
@@ -960,6 +964,11 @@ BenchmarkTfLiteModel::MayCreateProfilingListener() const {
           !params_.Get<std::string>("profiling_output_csv_file").empty())));
 }
 
+OpLatencies BenchmarkTfLiteModel::MayGetOpLatencies() const {
+  if (profiling_listener_ == nullptr) return {};
+  return profiling_listener_->GetOpLatencies();
+}
+
 TfLiteStatus BenchmarkTfLiteModel::RunImpl() { return interpreter_->Invoke(); }
 
 }  // namespace benchmark
@@ -27,6 +27,7 @@ limitations under the License.
 #include "tensorflow/lite/core/model.h"
 #include "tensorflow/lite/profiling/profiler.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_model.h"
+#include "tensorflow/lite/tools/benchmark/profiling_listener.h"
 #include "tensorflow/lite/tools/model_loader.h"
 #include "tensorflow/lite/tools/utils.h"
 
@@ -84,6 +85,7 @@ class BenchmarkTfLiteModel : public BenchmarkModel {
   TfLiteStatus Init() override;
   TfLiteStatus RunImpl() override;
   static BenchmarkParams DefaultParams();
+  OpLatencies MayGetOpLatencies() const override;
 
  protected:
   TfLiteStatus PrepareInputData() override;
@@ -101,7 +103,7 @@ class BenchmarkTfLiteModel : public BenchmarkModel {
 
   // Create a BenchmarkListener that's specifically for TFLite profiling if
   // necessary.
-  virtual std::unique_ptr<BenchmarkListener> MayCreateProfilingListener() const;
+  virtual std::unique_ptr<ProfilingListener> MayCreateProfilingListener() const;
 
   void CleanUp();
 
@@ -125,6 +127,8 @@ class BenchmarkTfLiteModel : public BenchmarkModel {
   }
 
   std::vector<std::unique_ptr<BenchmarkListener>> owned_listeners_;
+  // The profiling listener of the last Init(), owned by `owned_listeners_`.
+  ProfilingListener* profiling_listener_ = nullptr;
   std::mt19937 random_engine_;
   std::vector<Interpreter::TfLiteDelegatePtr> owned_delegates_;
   // Always TFLITE_LOG the benchmark result.
@@ -24,7 +24,10 @@ int Main(int argc, char** argv) {
   TFLITE_LOG(INFO) << "STARTING!";
   BenchmarkTfLiteModel benchmark;
   BenchmarkPerformanceOptions all_options_benchmark(&benchmark);
-  all_options_benchmark.Run(argc, argv);
+  if (all_options_benchmark.Run(argc, argv) != kTfLiteOk) {
+    TFLITE_LOG(ERROR) << "Benchmarking failed.";
+    return EXIT_FAILURE;
+  }
   return EXIT_SUCCESS;
 }
 }  // namespace benchmark
@@ -0,0 +1,140 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/tools/benchmark/op_latency_regression.h"
+
+#include <cmath>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "tensorflow/lite/tools/logging.h"
+
+namespace tflite {
+namespace benchmark {
+namespace {
+
+// Two-sided 95% quantile of the standard normal distribution.
+constexpr double kZScore95 = 1.96;
+
+}  // namespace
+
+void AddOpLatencies(const tensorflow::StatsCalculator& stats,
+                    const std::string& prefix, OpLatencies* latencies) {
+  for (const auto& name_and_detail : stats.GetDetails()) {
+    const tensorflow::Stat<int64_t>& elapsed_time =
+        name_and_detail.second.elapsed_time;
+    if (elapsed_time.empty()) continue;
+    OpLatency& latency = (*latencies)[prefix + name_and_detail.first];
+    latency.count = elapsed_time.count();
+    latency.avg_us = elapsed_time.avg();
+    if (elapsed_time.count() > 1) {
+      // Stat only reports the population deviation, rounded to an integer.
+      const double sum = elapsed_time.sum();
+      const double variance =
+          (elapsed_time.squared_sum() - sum * sum / elapsed_time.count()) /
+          (elapsed_time.count() - 1);
+      latency.std_deviation_us = variance > 0 ? std::sqrt(variance) : 0;
+    }
+  }
+}
+
+TfLiteStatus WriteOpLatencyBaseline(const OpLatencyBaseline& baseline,
+                                    const std::string& path) {
+  std::ofstream file(path);
+  if (!file.good()) {
+    TFLITE_LOG(ERROR) << "Failed to open '" << path << "' for writing.";
+    return kTfLiteError;
+  }
+  file.precision(17);
+  for (const auto& run_and_latencies : baseline) {
+    for (const auto& op_and_latency : run_and_latencies.second) {
+      const OpLatency& latency = op_and_latency.second;
+      file << run_and_latencies.first << '\t' << op_and_latency.first << '\t'
+           << latency.count << '\t' << latency.avg_us << '\t'
+           << latency.std_deviation_us << '\n';
+    }
+  }
+  file.close();
+  if (file.fail()) {
+    TFLITE_LOG(ERROR) << "Failed to write '" << path << "'.";
+    return kTfLiteError;
+  }
+  return kTfLiteOk;
+}
+
+TfLiteStatus ReadOpLatencyBaseline(const std::string& path,
+                                   OpLatencyBaseline* baseline) {
+  std::ifstream file(path);
+  if (!file.good()) {
+    TFLITE_LOG(ERROR) << "Failed to open '" << path << "' for reading.";
+    return kTfLiteError;
+  }
+  std::string line;
+  for (int line_number = 1; std::getline(file, line); ++line_number) {
+    if (line.empty()) continue;
+    std::vector<std::string> fields;
+    std::stringstream line_stream(line);
+    for (std::string field; std::getline(line_stream, field, '\t');) {
+      fields.push_back(field);
+    }
+    OpLatency latency;
+    std::stringstream values;
+    if (fields.size() == 5) {
+      values << fields[2] << ' ' << fields[3] << ' ' << fields[4];
+      values >> latency.count >> latency.avg_us >> latency.std_deviation_us;
+    }
+    if (fields.size() != 5 || values.fail()) {
+      TFLITE_LOG(ERROR) << "Malformed op latency at " << path << ":"
+                        << line_number << ": '" << line << "'";
+      return kTfLiteError;
+    }
+    (*baseline)[fields[0]][fields[1]] = latency;
+  }
+  return kTfLiteOk;
+}
+
+std::vector<OpLatencyRegression> FindOpLatencyRegressions(
+    const OpLatencyBaseline& baseline, const OpLatencyBaseline& current,
+    double min_relative_slowdown) {
+  std::vector<OpLatencyRegression> regressions;
+  for (const auto& run_and_latencies : current) {
+    const auto baseline_run = baseline.find(run_and_latencies.first);
+    if (baseline_run == baseline.end()) continue;
+    for (const auto& op_and_latency : run_and_latencies.second) {
+      const auto baseline_op = baseline_run->second.find(op_and_latency.first);
+      if (baseline_op == baseline_run->second.end()) continue;
+      const OpLatency& before = baseline_op->second;
+      const OpLatency& after = op_and_latency.second;
+      if (before.count < 2 || after.count < 2) continue;
+
+      const double standard_error = std::sqrt(
+          before.std_deviation_us * before.std_deviation_us / before.count +
+          after.std_deviation_us * after.std_deviation_us / after.count);
+      const double min_slowdown_us =
+          after.avg_us - before.avg_us - kZScore95 * standard_error;
+      if (min_slowdown_us > 0 &&
+          min_slowdown_us > min_relative_slowdown * before.avg_us) {
+        regressions.push_back({run_and_latencies.first, op_and_latency.first,
+                               before, after, min_slowdown_us});
+      }
+    }
+  }
+  return regressions;
+}
+
+}  // namespace benchmark
+}  // namespace tflite
@@ -0,0 +1,80 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#ifndef TENSORFLOW_LITE_TOOLS_BENCHMARK_OP_LATENCY_REGRESSION_H_
+#define TENSORFLOW_LITE_TOOLS_BENCHMARK_OP_LATENCY_REGRESSION_H_
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "tensorflow/core/util/stats_calculator.h"
+#include "tensorflow/lite/core/c/c_api_types.h"
+
+namespace tflite {
+namespace benchmark {
+
+// Latency of an op over the regular runs of a benchmark.
+struct OpLatency {
+  int64_t count = 0;
+  double avg_us = 0;
+  // Sample standard deviation.
+  double std_deviation_us = 0;
+};
+
+// Op latencies keyed by op name, as reported by the op profiler.
+using OpLatencies = std::map<std::string, OpLatency>;
+
+// Op latencies keyed by benchmark run, e.g. by model and performance options.
+using OpLatencyBaseline = std::map<std::string, OpLatencies>;
+
+// Adds the latency of each node recorded in `stats` to `latencies`, prefixing
+// the node names with `prefix`.
+void AddOpLatencies(const tensorflow::StatsCalculator& stats,
+                    const std::string& prefix, OpLatencies* latencies);
+
+// Writes `baseline` as tab-separated values, one op per line:
+//   run  op  count  avg_us  std_deviation_us
+TfLiteStatus WriteOpLatencyBaseline(const OpLatencyBaseline& baseline,
+                                    const std::string& path);
+
+// Reads a baseline written by WriteOpLatencyBaseline().
+TfLiteStatus ReadOpLatencyBaseline(const std::string& path,
+                                   OpLatencyBaseline* baseline);
+
+// An op whose latency regressed between two benchmarks.
+struct OpLatencyRegression {
+  std::string run;
+  std::string op;
+  OpLatency baseline;
+  OpLatency current;
+  // Lower bound of the 95% confidence interval of the slowdown.
+  double min_slowdown_us = 0;
+};
+
+// Returns the ops of `current` that are significantly slower than in
+// `baseline`: the 95% confidence interval of the difference of their average
+// latencies, computed with Welch's normal approximation, lies above
+// `min_relative_slowdown` times their baseline latency. Ops and runs that are
+// missing from either side, or that ran less than twice, are not compared.
+std::vector<OpLatencyRegression> FindOpLatencyRegressions(
+    const OpLatencyBaseline& baseline, const OpLatencyBaseline& current,
+    double min_relative_slowdown);
+
+}  // namespace benchmark
+}  // namespace tflite
+
+#endif  // TENSORFLOW_LITE_TOOLS_BENCHMARK_OP_LATENCY_REGRESSION_H_
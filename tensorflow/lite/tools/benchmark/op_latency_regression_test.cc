@@ -0,0 +1,102 @@
+/* Copyright 2023 The TensorFlow Authors. All Rights Reserved.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+==============================================================================*/
+
+#include "tensorflow/lite/tools/benchmark/op_latency_regression.h"
+
+#include <fstream>
+#include <string>
+
+#include <gtest/gtest.h>
+#include "tensorflow/core/util/stats_calculator.h"
+#include "tensorflow/lite/core/c/c_api_types.h"
+
+namespace tflite {
+namespace benchmark {
+namespace {
+
+TEST(OpLatencyRegressionTest, AddOpLatencies) {
+  tensorflow::StatsCalculator stats((tensorflow::StatSummarizerOptions()));
+  for (int64_t time_us : {10, 12, 14}) {
+    stats.AddNodeStats("conv:0", "CONV_2D", 0, time_us, 0);
+  }
+  OpLatencies latencies;
+  AddOpLatencies(stats, "0/", &latencies);
+  ASSERT_EQ(latencies.size(), 1);
+  const OpLatency& latency = latencies["0/conv:0"];
+  EXPECT_EQ(latency.count, 3);
+  EXPECT_DOUBLE_EQ(latency.avg_us, 12);
+  EXPECT_DOUBLE_EQ(latency.std_deviation_us, 2);
+}
+
+TEST(OpLatencyRegressionTest, WriteAndReadBaseline) {
+  OpLatencyBaseline baseline;
+  baseline["model.tflite: cpu w/ 1 threads"]["0/[out, other]:3"] = {50, 1.5,
+                                                                   0.25};
+  baseline["model.tflite: cpu w/ 2 threads"]["1/Delegate/Add:0"] = {7, 100, 3};
+  const std::string path = ::testing::TempDir() + "/op_latencies.tsv";
+  ASSERT_EQ(WriteOpLatencyBaseline(baseline, path), kTfLiteOk);
+
+  OpLatencyBaseline read_baseline;
+  ASSERT_EQ(ReadOpLatencyBaseline(path, &read_baseline), kTfLiteOk);
+  ASSERT_EQ(read_baseline.size(), 2);
+  const OpLatency& latency =
+      read_baseline["model.tflite: cpu w/ 1 threads"]["0/[out, other]:3"];
+  EXPECT_EQ(latency.count, 50);
+  EXPECT_DOUBLE_EQ(latency.avg_us, 1.5);
+  EXPECT_DOUBLE_EQ(latency.std_deviation_us, 0.25);
+  EXPECT_EQ(
+      read_baseline["model.tflite: cpu w/ 2 threads"]["1/Delegate/Add:0"].count,
+      7);
+}
+
+TEST(OpLatencyRegressionTest, ReadMalformedBaseline) {
+  const std::string path = ::testing::TempDir() + "/malformed.tsv";
+  std::ofstream(path) << "run\top\tcount\n";
+  OpLatencyBaseline baseline;
+  EXPECT_EQ(ReadOpLatencyBaseline(path, &baseline), kTfLiteError);
+  EXPECT_EQ(ReadOpLatencyBaseline(path + ".missing", &baseline),
+            kTfLiteError);
+}
+
+TEST(OpLatencyRegressionTest, FindRegressions) {
+  OpLatencyBaseline baseline;
+  baseline["run"]["stable"] = {100, 100, 10};
+  baseline["run"]["slower"] = {100, 100, 10};
+  baseline["run"]["noisy"] = {100, 100, 100};
+  baseline["run"]["barely_slower"] = {100, 100, 1};
+  baseline["run"]["removed"] = {100, 100, 10};
+  baseline["other_run"]["slower"] = {100, 100, 10};
+
+  OpLatencyBaseline current;
+  current["run"]["stable"] = {100, 101, 10};
+  current["run"]["slower"] = {100, 120, 10};
+  current["run"]["noisy"] = {100, 120, 100};
+  current["run"]["barely_slower"] = {100, 102, 1};
+  current["run"]["added"] = {100, 1000, 10};
+
+  const auto regressions = FindOpLatencyRegressions(baseline, current, 0.05);
+  ASSERT_EQ(regressions.size(), 1);
+  EXPECT_EQ(regressions[0].run, "run");
+  EXPECT_EQ(regressions[0].op, "slower");
+  EXPECT_GT(regressions[0].min_slowdown_us, 5);
+  EXPECT_LT(regressions[0].min_slowdown_us, 20);
+
+  // Without a relative threshold, any significant slowdown is a regression.
+  EXPECT_EQ(FindOpLatencyRegressions(baseline, current, 0).size(), 2);
+}
+
+}  // namespace
+}  // namespace benchmark
+}  // namespace tflite
@@ -83,6 +83,16 @@ void ProfilingListener::OnBenchmarkEnd(const BenchmarkResults& results) {
   }
 }
 
+OpLatencies ProfilingListener::GetOpLatencies() const {
+  OpLatencies latencies;
+  for (const auto& subgraph_and_stats :
+       run_summarizer_.GetStatsCalculatorMap()) {
+    AddOpLatencies(*subgraph_and_stats.second,
+                   std::to_string(subgraph_and_stats.first) + "/", &latencies);
+  }
+  return latencies;
+}
+
 void ProfilingListener::WriteOutput(const std::string& header,
                                     const string& data, std::ostream* stream) {
   (*stream) << header << std::endl;
@@ -23,6 +23,7 @@ limitations under the License.
 #include "tensorflow/lite/profiling/profile_summarizer.h"
 #include "tensorflow/lite/profiling/profile_summary_formatter.h"
 #include "tensorflow/lite/tools/benchmark/benchmark_model.h"
+#include "tensorflow/lite/tools/benchmark/op_latency_regression.h"
 
 namespace tflite {
 namespace benchmark {
@@ -44,6 +45,10 @@ class ProfilingListener : public BenchmarkListener {
 
   void OnBenchmarkEnd(const BenchmarkResults& results) override;
 
+  // Returns the latency of each op over the regular benchmark runs, keyed by
+  // "<subgraph index>/<node name>".
+  OpLatencies GetOpLatencies() const;
+
  protected:
   profiling::ProfileSummarizer run_summarizer_;
   profiling::ProfileSummarizer init_summarizer_;
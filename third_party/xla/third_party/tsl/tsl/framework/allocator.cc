@@ -60,7 +60,8 @@ bool CPUAllocatorFullStatsEnabled() { return cpu_allocator_collect_full_stats; }
 string AllocatorAttributes::DebugString() const {
   return strings::StrCat("AllocatorAttributes(on_host=", on_host(),
                          " nic_compatible=", nic_compatible(),
-                         " gpu_compatible=", gpu_compatible(), ")");
+                         " gpu_compatible=", gpu_compatible(),
+                         " scratch=", scratch(), ")");
 }
 
 Allocator* cpu_allocator_base() {
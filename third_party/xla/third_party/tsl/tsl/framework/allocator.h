@@ -326,6 +326,11 @@ struct AllocatorAttributes {
   bool gpu_compatible() const { return value & (0x1 << 2); }
   void set_use_pjrt_allocator(bool v) { value |= (static_cast<int>(v) << 3); }
   bool use_pjrt_allocator() const { return value & (0x1 << 3); }
+  // Requests memory for a transient scratch buffer that does not outlive the
+  // op invocation that allocates it. Host devices may serve such requests
+  // from a per-thread arena instead of the device allocator.
+  void set_scratch(bool v) { value |= (static_cast<int>(v) << 4); }
+  bool scratch() const { return value & (0x1 << 4); }
   void Merge(AllocatorAttributes other) {
     value |= other.value;
     if (scope_id != other.scope_id) {